@@ -0,0 +1,106 @@
+#include "compare.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#define MAX_NAME_LEN_INCL_0 0x40
+#define MIN_SIGNIFICANT_DIFFERENCE_MS 0.01
+
+struct PhaseTiming {
+    char benchmark[MAX_NAME_LEN_INCL_0];
+    char phase[MAX_NAME_LEN_INCL_0];
+    double medianMs;
+};
+
+/// Copies the string value following `"key": ` into `value`. Returns a pointer after the value, or NULL if not found.
+static char* findStringValue(char* json, const char* key, char* value) {
+    char pattern[MAX_NAME_LEN_INCL_0];
+    sprintf(pattern, "\"%s\": \"", key);
+    char* start = strstr(json, pattern);
+    if (start == NULL) {
+        return NULL;
+    }
+    start += strlen(pattern);
+    char* end = strchr(start, '"');
+    if (end == NULL || end - start >= MAX_NAME_LEN_INCL_0) {
+        return NULL;
+    }
+    strncpy(value, start, end - start);
+    value[end - start] = 0;
+    return end + 1;
+}
+
+static char* findNumberValue(char* json, const char* key, double* value) {
+    char pattern[MAX_NAME_LEN_INCL_0];
+    sprintf(pattern, "\"%s\": ", key);
+    char* start = strstr(json, pattern);
+    if (start == NULL) {
+        return NULL;
+    }
+    start += strlen(pattern);
+    char* end;
+    *value = strtod(start, &end);
+    return end == start ? NULL : end;
+}
+
+/**
+ * Finds the next phase timing, tracking the benchmark it belongs to in `timing->benchmark`.
+ * Returns a pointer after the timing, or NULL if there are no more timings.
+ */
+static char* findNextPhaseTiming(char* json, struct PhaseTiming* timing) {
+    char* nextPhase = strstr(json, "\"phase\": ");
+    char* nextBenchmark = strstr(json, "\"benchmark\": ");
+
+    if (nextPhase == NULL) {
+        return NULL;
+    }
+
+    if (nextBenchmark != NULL && nextBenchmark < nextPhase) {
+        json = findStringValue(nextBenchmark, "benchmark", timing->benchmark);
+        if (json == NULL) {
+            return NULL;
+        }
+    }
+
+    json = findStringValue(nextPhase, "phase", timing->phase);
+    return json == NULL ? NULL : findNumberValue(json, "medianMs", &timing->medianMs);
+}
+
+static bool findPhaseTiming(char* json, struct PhaseTiming* wanted) {
+    struct PhaseTiming timing = { 0 };
+
+    while ((json = findNextPhaseTiming(json, &timing)) != NULL) {
+        if (strcmp(timing.benchmark, wanted->benchmark) == 0 && strcmp(timing.phase, wanted->phase) == 0) {
+            wanted->medianMs = timing.medianMs;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool compareBenchmarkResults(char* baselineJson, char* resultsJson, double thresholdPercent) {
+    bool regressed = false;
+    struct PhaseTiming timing = { 0 };
+
+    printf("%-12s %-22s %12s %12s %9s\n", "benchmark", "phase", "baseline ms", "current ms", "change");
+
+    while ((resultsJson = findNextPhaseTiming(resultsJson, &timing)) != NULL) {
+        struct PhaseTiming baseline = timing;
+
+        if (!findPhaseTiming(baselineJson, &baseline)) {
+            printf("%-12s %-22s %12s %12.4f %9s\n", timing.benchmark, timing.phase, "-", timing.medianMs, "new");
+            continue;
+        }
+
+        double changePercent = baseline.medianMs > 0 ? (timing.medianMs / baseline.medianMs - 1) * 100 : 0;
+        bool phaseRegressed = changePercent > thresholdPercent
+            && timing.medianMs - baseline.medianMs > MIN_SIGNIFICANT_DIFFERENCE_MS;
+        regressed = regressed || phaseRegressed;
+
+        printf("%-12s %-22s %12.4f %12.4f %+8.1f%%%s\n", timing.benchmark, timing.phase, baseline.medianMs, timing.medianMs, changePercent, phaseRegressed ? " REGRESSION" : "");
+    }
+
+    return regressed;
+}
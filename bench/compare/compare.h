@@ -0,0 +1,14 @@
+#ifndef compare
+#define compare
+
+#include <stdbool.h>
+
+/**
+ * Compares the median phase timings of benchmark results against a baseline,
+ * both produced by `w13asm-bench run`. Prints a line for each benchmark phase.
+ * Returns true if any phase is slower than the baseline by more than
+ * `thresholdPercent` percent.
+ */
+bool compareBenchmarkResults(char* baselineJson, char* resultsJson, double thresholdPercent);
+
+#endif
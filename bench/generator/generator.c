@@ -0,0 +1,164 @@
+#include "generator.h"
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+
+#define LABELS_MAX_SCALE 4000
+#define IMMEDIATES_MAX_SCALE 3900
+#define STRINGS_MAX_SCALE 150
+#define FILL_MAX_SCALE 31
+#define FILL_COUNT 256
+#define MIXED_MAX_SCALE 250
+
+static unsigned int randomState;
+
+static unsigned int nextRandom(unsigned int bound) {
+    randomState = randomState * 1103515245 + 12345;
+    return (randomState >> 16) % bound;
+}
+
+enum SourceProfile getSourceProfile(const char* name) {
+    for (enum SourceProfile profile = 0; profile < SourceProfileInvalid; ++profile) {
+        if (strcmp(name, getSourceProfileName(profile)) == 0) {
+            return profile;
+        }
+    }
+
+    return SourceProfileInvalid;
+}
+
+const char* getSourceProfileName(enum SourceProfile profile) {
+    switch (profile) {
+        case SourceProfileLabels: return "labels";
+        case SourceProfileImmediates: return "immediates";
+        case SourceProfileStrings: return "strings";
+        case SourceProfileFill: return "fill";
+        case SourceProfileComments: return "comments";
+        case SourceProfileMixed: return "mixed";
+        case SourceProfileInvalid: return "";
+    }
+}
+
+int getMaxSourceScale(enum SourceProfile profile) {
+    switch (profile) {
+        case SourceProfileLabels: return LABELS_MAX_SCALE;
+        case SourceProfileImmediates: return IMMEDIATES_MAX_SCALE;
+        case SourceProfileStrings: return STRINGS_MAX_SCALE;
+        case SourceProfileFill: return FILL_MAX_SCALE;
+        case SourceProfileComments: return INT_MAX;
+        case SourceProfileMixed: return MIXED_MAX_SCALE;
+        case SourceProfileInvalid: return 0;
+    }
+}
+
+/// Each unit is a labeled instruction referencing a random label, optionally with an offset.
+static void generateLabels(FILE* file, int scale) {
+    static const char* instructions[] = { "ld", "not", "add", "and", "st", "jmp", "jmn", "jmz" };
+
+    for (int i = 0; i < scale; ++i) {
+        int target = nextRandom(scale);
+        fprintf(file, "label_%d: %s label_%d", i, instructions[nextRandom(8)], target);
+        if (nextRandom(4) == 0) {
+            fprintf(file, "+1");
+        }
+        fprintf(file, "\n");
+    }
+}
+
+/// Each unit is an instruction with an immediate value, written as a number, a character or an expression.
+static void generateImmediates(FILE* file, int scale) {
+    static const char* instructions[] = { "ld", "not", "add", "and" };
+
+    fprintf(file, "start: jmp start\n");
+
+    for (int i = 1; i < scale; ++i) {
+        const char* instruction = instructions[nextRandom(4)];
+        switch (nextRandom(4)) {
+            case 0:
+                fprintf(file, "%s #%d\n", instruction, (int) nextRandom(256));
+                break;
+            case 1:
+                fprintf(file, "%s #'%c'\n", instruction, 'a' + nextRandom(26));
+                break;
+            case 2:
+                fprintf(file, "%s #-'%c'+%d\n", instruction, 'A' + nextRandom(26), (int) nextRandom(32));
+                break;
+            default:
+                fprintf(file, "%s #(0x%02X ^ %d)\n", instruction, nextRandom(256), (int) nextRandom(256));
+                break;
+        }
+    }
+}
+
+/// Each unit is a labeled 52-byte string containing escape sequences.
+static void generateStrings(FILE* file, int scale) {
+    fprintf(file, "start: jmp start\n");
+
+    for (int i = 0; i < scale; ++i) {
+        fprintf(file, "message_%d: \"The quick brown fox jumps over the \\\"lazy\\\" dog\\t%04d\\n\"\n", i, i);
+    }
+}
+
+/// Each unit is a .FILL of 256 bytes, alternating between characters and numbers.
+static void generateFill(FILE* file, int scale) {
+    fprintf(file, "start: jmp start\n");
+
+    for (int i = 0; i < scale; ++i) {
+        if (i % 2 == 0) {
+            fprintf(file, "block_%d: .fill '%c' %d\n", i, 'a' + i % 26, FILL_COUNT);
+        } else {
+            fprintf(file, "block_%d: .fill %d %d\n", i, i, FILL_COUNT);
+        }
+    }
+}
+
+/// Each unit is a line of comment containing characters which are meaningful outside of comments.
+static void generateComments(FILE* file, int scale) {
+    for (int i = 0; i < scale; ++i) {
+        int depth = nextRandom(8) + 1;
+        for (int j = 0; j < depth; ++j) {
+            fprintf(file, ";");
+        }
+        fprintf(file, " line %d: \"not a string\" 'x' .org 0x1234 label: jmp label ; ; ;\n", i);
+    }
+
+    fprintf(file, "end: jmp end ; the only statement\n");
+}
+
+/// Each unit combines a label, instructions with label, immediate and expression arguments, data and a comment.
+static void generateMixed(FILE* file, int scale) {
+    fprintf(file, ".equ BASE 0x%03X\n", 0x100);
+
+    for (int i = 0; i < scale; ++i) {
+        fprintf(file, "; Block %d\n", i);
+        fprintf(file, "block_%d: ld data_%d\n", i, i);
+        fprintf(file, "add #%d\n", (int) nextRandom(256));
+        fprintf(file, "st (data_%d + 1)\n", i);
+        fprintf(file, "jmz block_%d\n", (int) nextRandom(scale));
+        fprintf(file, "data_%d: %d (BASE >> 4) 'x' \"ok\"\n", i, (int) nextRandom(128));
+    }
+}
+
+void generateSource(FILE* file, enum SourceProfile profile, int scale) {
+    randomState = 1;
+
+    if (scale > getMaxSourceScale(profile)) {
+        scale = getMaxSourceScale(profile);
+    }
+
+    if (scale < 1) {
+        scale = 1;
+    }
+
+    fprintf(file, "; Synthetic \"%s\" profile source, scale %d\n", getSourceProfileName(profile), scale);
+
+    switch (profile) {
+        case SourceProfileLabels: return generateLabels(file, scale);
+        case SourceProfileImmediates: return generateImmediates(file, scale);
+        case SourceProfileStrings: return generateStrings(file, scale);
+        case SourceProfileFill: return generateFill(file, scale);
+        case SourceProfileComments: return generateComments(file, scale);
+        case SourceProfileMixed: return generateMixed(file, scale);
+        case SourceProfileInvalid: return;
+    }
+}
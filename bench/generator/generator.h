@@ -0,0 +1,35 @@
+#ifndef generator
+#define generator
+
+#include <stdio.h>
+#include <stdbool.h>
+
+enum SourceProfile {
+    SourceProfileLabels,
+    SourceProfileImmediates,
+    SourceProfileStrings,
+    SourceProfileFill,
+    SourceProfileComments,
+    SourceProfileMixed,
+    SourceProfileInvalid
+};
+
+enum SourceProfile getSourceProfile(const char* name);
+
+const char* getSourceProfileName(enum SourceProfile profile);
+
+/**
+ * Returns the highest scale for which the generated program still fits in
+ * the address space and the assembler's limits.
+ */
+int getMaxSourceScale(enum SourceProfile profile);
+
+/**
+ * Writes a valid, deterministic W13 assembly program of the given profile.
+ * `scale` is the number of repetitions of the profile's basic unit, such as
+ * a labeled instruction or a comment line, and is clamped to
+ * `getMaxSourceScale`.
+ */
+void generateSource(FILE* file, enum SourceProfile profile, int scale);
+
+#endif
@@ -0,0 +1,220 @@
+/*
+    W13ASM-bench Copyright (C) 2025 Piotr Marczyński <piotrmski@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+    See file COPYING.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include "generator/generator.h"
+#include "compare/compare.h"
+#include "../src/assembler/assembler.h"
+#include "../src/output/output.h"
+#include "../src/statistics-report/statistics-report.h"
+
+#define DEFAULT_RUNS 10
+#define DEFAULT_THRESHOLD_PERCENT 10.0
+#define COMMENTS_SCALE 100000
+#define SOURCES_DIRECTORY "bench/sources"
+
+enum Phase {
+    PhaseRead,
+    PhaseTokenize,
+    PhaseParse,
+    PhaseResolveImmediateValues,
+    PhaseResolveLabels,
+    PhaseWrite,
+    PhaseCount
+};
+
+struct PhaseStatistics {
+    double minMs;
+    double medianMs;
+    double meanMs;
+};
+
+static const char* getPhaseName(enum Phase phase) {
+    switch (phase) {
+        case PhaseRead: return "read";
+        case PhaseTokenize: return "tokenize";
+        case PhaseParse: return "parse";
+        case PhaseResolveImmediateValues: return "resolveImmediateValues";
+        case PhaseResolveLabels: return "resolveLabels";
+        case PhaseWrite: return "write";
+        case PhaseCount: return "";
+    }
+}
+
+static char* readFile(const char* path, long* size) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        printf("Error: could not read file \"%s\".\n", path);
+        exit(EXIT_FAILURE);
+    }
+    fseek(file, 0, SEEK_END);
+    *size = ftell(file);
+    rewind(file);
+    char* contents = malloc(*size + 1);
+    contents[fread(contents, 1, *size, file)] = 0;
+    fclose(file);
+    return contents;
+}
+
+static int compareDoubles(const void* a, const void* b) {
+    double difference = *(const double*) a - *(const double*) b;
+    return difference < 0 ? -1 : difference > 0 ? 1 : 0;
+}
+
+static struct PhaseStatistics getPhaseStatistics(double* timesMs, int runs) {
+    qsort(timesMs, runs, sizeof(double), compareDoubles);
+    double sum = 0;
+    for (int i = 0; i < runs; ++i) {
+        sum += timesMs[i];
+    }
+    double median = runs % 2 == 1 ? timesMs[runs / 2] : (timesMs[runs / 2 - 1] + timesMs[runs / 2]) / 2;
+    return (struct PhaseStatistics) { timesMs[0], median, sum / runs };
+}
+
+static void generateSourceFile(const char* path, enum SourceProfile profile, int scale) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        printf("Error: could not write to file \"%s\".\n", path);
+        exit(EXIT_FAILURE);
+    }
+    generateSource(file, profile, scale);
+    fclose(file);
+}
+
+/// Times each phase of assembling the source file `runs` times, and appends the results to `resultsFile`.
+static void runBenchmark(FILE* resultsFile, enum SourceProfile profile, int scale, int runs, bool isLast) {
+    char sourcePath[1024];
+    sprintf(sourcePath, "%s/%s.asm", SOURCES_DIRECTORY, getSourceProfileName(profile));
+    generateSourceFile(sourcePath, profile, scale);
+
+    double* timesMs[PhaseCount];
+    for (int phase = 0; phase < PhaseCount; ++phase) {
+        timesMs[phase] = malloc(runs * sizeof(double));
+    }
+
+    long sourceBytes = 0;
+    int programSize = 0;
+
+    for (int run = 0; run < runs; ++run) {
+        double start = getMonotonicTimeMs();
+        char* source = readFile(sourcePath, &sourceBytes);
+        double afterRead = getMonotonicTimeMs();
+        static struct AssemblerResult result;
+        assemble(source, &result);
+        double afterAssemble = getMonotonicTimeMs();
+        FILE* discardedOutput = tmpfile();
+        programSize = getProgramSize(&result);
+        writeBinary(discardedOutput, &result, programSize);
+        writeSymbols(discardedOutput, &result);
+        fclose(discardedOutput);
+        double afterWrite = getMonotonicTimeMs();
+
+        timesMs[PhaseRead][run] = afterRead - start;
+        timesMs[PhaseTokenize][run] = result.statistics.tokenizeMs;
+        timesMs[PhaseParse][run] = result.statistics.parseMs;
+        timesMs[PhaseResolveImmediateValues][run] = result.statistics.resolveImmediateValuesMs;
+        timesMs[PhaseResolveLabels][run] = result.statistics.resolveLabelsMs;
+        timesMs[PhaseWrite][run] = afterWrite - afterAssemble;
+        free(source);
+    }
+
+    fprintf(resultsFile, "    {\n");
+    fprintf(resultsFile, "      \"benchmark\": \"%s\",\n", getSourceProfileName(profile));
+    fprintf(resultsFile, "      \"scale\": %d,\n", scale > getMaxSourceScale(profile) ? getMaxSourceScale(profile) : scale);
+    fprintf(resultsFile, "      \"sourceBytes\": %ld,\n", sourceBytes);
+    fprintf(resultsFile, "      \"programBytes\": %d,\n", programSize);
+    fprintf(resultsFile, "      \"phases\": [\n");
+    for (int phase = 0; phase < PhaseCount; ++phase) {
+        struct PhaseStatistics statistics = getPhaseStatistics(timesMs[phase], runs);
+        fprintf(resultsFile, "        { \"phase\": \"%s\", \"minMs\": %.4f, \"medianMs\": %.4f, \"meanMs\": %.4f }%s\n",
+            getPhaseName(phase), statistics.minMs, statistics.medianMs, statistics.meanMs, phase == PhaseCount - 1 ? "" : ",");
+        free(timesMs[phase]);
+    }
+    fprintf(resultsFile, "      ]\n");
+    fprintf(resultsFile, "    }%s\n", isLast ? "" : ",");
+
+    printf("%-12s %8ld source bytes, %4d program bytes, %d runs\n", getSourceProfileName(profile), sourceBytes, programSize, runs);
+}
+
+static void runBenchmarks(const char* resultsPath, int runs) {
+    setAssemblerTimingEnabled(true);
+    setParallelLexing(sysconf(_SC_NPROCESSORS_ONLN), PARALLEL_LEXING_MIN_SOURCE_SIZE);
+
+    FILE* resultsFile = fopen(resultsPath, "w");
+    if (resultsFile == NULL) {
+        printf("Error: could not write to file \"%s\".\n", resultsPath);
+        exit(EXIT_FAILURE);
+    }
+
+    fprintf(resultsFile, "{\n  \"runs\": %d,\n  \"benchmarks\": [\n", runs);
+    for (enum SourceProfile profile = 0; profile < SourceProfileInvalid; ++profile) {
+        int scale = profile == SourceProfileComments ? COMMENTS_SCALE : getMaxSourceScale(profile);
+        runBenchmark(resultsFile, profile, scale, runs, profile == SourceProfileInvalid - 1);
+    }
+    fprintf(resultsFile, "  ]\n}\n");
+
+    fclose(resultsFile);
+}
+
+static void printUsage() {
+    printf("W13 assembler benchmark. Copyright (C) 2025 Piotr Marczyński. This program is licensed under GNU GPL v3. See file COPYING.\n");
+    printf("Usage:\n");
+    printf("w13asm-bench generate [profile] [scale] [path/to/source.asm]\n");
+    printf("    Generates a synthetic source. Profiles: labels, immediates, strings, fill, comments, mixed.\n");
+    printf("w13asm-bench run [path/to/results.json] [runs]\n");
+    printf("    Times each assembler phase for every profile and saves the results. Sources are generated in \"%s\".\n", SOURCES_DIRECTORY);
+    printf("w13asm-bench compare [path/to/baseline.json] [path/to/results.json] [threshold percent]\n");
+    printf("    Fails if any median phase time is slower than the baseline by more than the threshold (default %.0f%%).\n", DEFAULT_THRESHOLD_PERCENT);
+}
+
+int main(int argc, const char * argv[]) {
+    if (argc == 5 && strcmp(argv[1], "generate") == 0) {
+        enum SourceProfile profile = getSourceProfile(argv[2]);
+        if (profile == SourceProfileInvalid) {
+            printf("Error: unknown profile \"%s\".\n", argv[2]);
+            return EXIT_FAILURE;
+        }
+        generateSourceFile(argv[4], profile, atoi(argv[3]));
+    } else if ((argc == 3 || argc == 4) && strcmp(argv[1], "run") == 0) {
+        int runs = argc == 4 ? atoi(argv[3]) : DEFAULT_RUNS;
+        if (runs < 1) {
+            printf("Error: number of runs must be positive.\n");
+            return EXIT_FAILURE;
+        }
+        runBenchmarks(argv[2], runs);
+    } else if ((argc == 4 || argc == 5) && strcmp(argv[1], "compare") == 0) {
+        long size;
+        char* baselineJson = readFile(argv[2], &size);
+        char* resultsJson = readFile(argv[3], &size);
+        double thresholdPercent = argc == 5 ? atof(argv[4]) : DEFAULT_THRESHOLD_PERCENT;
+        if (compareBenchmarkResults(baselineJson, resultsJson, thresholdPercent)) {
+            printf("Performance regression detected.\n");
+            return EXIT_FAILURE;
+        }
+    } else {
+        printUsage();
+        return argc == 1 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
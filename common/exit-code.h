@@ -29,7 +29,37 @@ enum ExitCode {
     ExitCodeInvalidCharacterLiteral,
     ExitCodeUndefinedLabel,
     ExitCodeUnexpectedEndOfFile,
-    ExitCodeImmediateValueDeclarationOutOfMemoryRange
+    ExitCodeImmediateValueDeclarationOutOfMemoryRange,
+    ExitCodeInvalidExpression,
+    ExitCodeTooManyConstantDefinitions,
+    ExitCodeCouldNotReadBinFile,
+    ExitCodeBinFileTooLarge,
+    ExitCodeCouldNotReadSymbolsFile,
+    ExitCodeInvalidSymbolsFile,
+    ExitCodeCouldNotWriteAsmFile,
+    ExitCodeInvalidSnapshotFile,
+    ExitCodeCouldNotWriteSnapshotFile,
+    ExitCodeCouldNotWriteTraceFile,
+    ExitCodeCouldNotReadTraceFile,
+    ExitCodeInvalidTraceFile,
+    ExitCodeCouldNotWriteCoverageFile,
+    ExitCodeCouldNotReadCoverageFile,
+    ExitCodeInvalidCoverageFile,
+    ExitCodeWorstCaseStepsExceeded,
+    ExitCodeInvalidInstructionSequence,
+    ExitCodeCouldNotReadRewritesFile,
+    ExitCodeInvalidRewritesFile,
+    ExitCodeCouldNotWriteRewritesFile,
+    ExitCodeStreamedStatementTooLong,
+    ExitCodeCouldNotWriteExpansionsFile,
+    ExitCodeTooManyPooledStrings,
+    ExitCodeUnmatchedReturn,
+    ExitCodeRecursiveCall,
+    ExitCodeCompressedProgramTooLarge,
+    ExitCodeInstructionBudgetExceeded,
+    ExitCodeRunTimedOut,
+    ExitCodeCouldNotWriteListingFile,
+    ExitCodeTooManySubroutineEvents
 };
 
 #endif
\ No newline at end of file
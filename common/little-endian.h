@@ -0,0 +1,54 @@
+#ifndef little_endian
+#define little_endian
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Little-endian integers in the binary files written and read by the tools
+ * (symbol indexes, snapshots and coverage files), independent of the byte
+ * order of the host.
+ */
+
+static inline void writeUint16(FILE* file, uint16_t value) {
+    fputc(value & 0xFF, file);
+    fputc(value >> 8, file);
+}
+
+static inline void writeUint32(FILE* file, uint32_t value) {
+    writeUint16(file, value & 0xFFFF);
+    writeUint16(file, value >> 16);
+}
+
+/// Returns false if the file ends before the value.
+static inline bool readUint16(FILE* file, uint16_t* value) {
+    unsigned char bytes[2];
+    if (fread(bytes, 1, 2, file) != 2) {
+        return false;
+    }
+    *value = bytes[0] | bytes[1] << 8;
+    return true;
+}
+
+/// Returns false if the file ends before the value.
+static inline bool readUint32(FILE* file, uint32_t* value) {
+    uint16_t low, high;
+    if (!readUint16(file, &low) || !readUint16(file, &high)) {
+        return false;
+    }
+    *value = low | (uint32_t) high << 16;
+    return true;
+}
+
+/// Reads a value from a file which was read or mapped into memory as a whole.
+static inline uint16_t decodeUint16(const unsigned char* bytes) {
+    return bytes[0] | bytes[1] << 8;
+}
+
+/// Reads a value from a file which was read or mapped into memory as a whole.
+static inline uint32_t decodeUint32(const unsigned char* bytes) {
+    return decodeUint16(bytes) | (uint32_t) decodeUint16(bytes + 2) << 16;
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef symbol_index
+#define symbol_index
+
+#include <stdint.h>
+#include "target-description.h"
+
+/*
+ * Layout of the binary symbol index file. All integers are little-endian and
+ * every section starts at a 4-byte aligned offset, so the file can be
+ * memory-mapped and read in place. Sections follow the header in this order:
+ * - data type (`enum DataType`) of every address, 1 byte each,
+ * - index into the label table of the label covering every address (the first
+ *   label defined at the closest labeled address at or below it), or
+ *   SYMBOL_INDEX_NO_LABEL, 2 bytes each,
+ * - label table sorted by address, then by order of definition,
+ * - hash table of label table indices increased by 1 (0 marks an empty
+ *   bucket), keyed by `hashSymbolName` with linear probing,
+ * - zero-terminated label names.
+ */
+
+#define SYMBOL_INDEX_MAGIC TARGET_NAME "S"
+#define SYMBOL_INDEX_VERSION 1
+#define SYMBOL_INDEX_NO_LABEL 0xFFFF
+#define SYMBOL_INDEX_HEADER_SIZE 44
+#define SYMBOL_INDEX_LABEL_SIZE 8
+
+struct SymbolIndexHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t addressSpaceSize;
+    uint32_t labelsCount;
+    uint32_t hashBucketsCount; // Power of 2
+    uint32_t dataTypesOffset;
+    uint32_t coveringLabelsOffset;
+    uint32_t labelsOffset;
+    uint32_t hashBucketsOffset;
+    uint32_t namesOffset;
+    uint32_t namesSize;
+};
+
+struct SymbolIndexLabel {
+    uint16_t address;
+    uint16_t nameLength;
+    uint32_t nameOffset; // Relative to the start of the names section
+};
+
+/// 32-bit FNV-1a hash of a label name.
+static inline uint32_t hashSymbolName(const char* name) {
+    uint32_t hash = 2166136261u;
+    while (*name != 0) {
+        hash = (hash ^ (unsigned char) *name++) * 16777619u;
+    }
+    return hash;
+}
+
+#endif
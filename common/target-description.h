@@ -0,0 +1,96 @@
+#ifndef target_description
+#define target_description
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Description of the machine the assembler, the disassembler and the
+ * simulator are built for, selected at compile time with `make TARGET=...`.
+ * An instruction is the opcode shifted left by the number of address bits,
+ * combined with the argument address, stored little-endian in
+ * INSTRUCTION_SIZE bytes. Memory words are bytes on every target. The timer
+ * and the terminal I/O are mapped to the last 5 addresses. TARGET_FILE_NAME
+ * prefixes the executable name and the extensions of the files it writes.
+ */
+
+#if defined(TARGET_W16)
+#define TARGET_NAME "W16"
+#define TARGET_FILE_NAME "w16"
+#define ADDRESS_BITS 16
+#define INSTRUCTION_SIZE 3
+typedef uint32_t InstructionWord;
+#else
+#ifndef TARGET_W13
+#define TARGET_W13
+#endif
+#define TARGET_NAME "W13"
+#define TARGET_FILE_NAME "w13"
+#define ADDRESS_BITS 13
+#define INSTRUCTION_SIZE 2
+typedef uint16_t InstructionWord;
+#endif
+
+#define ADDRESS_SPACE_SIZE (1 << ADDRESS_BITS)
+#define OPCODE_BITS 3
+#define TIMER_ADDRESS (ADDRESS_SPACE_SIZE - 5) // 4 bytes of the elapsed milliseconds
+#define IO_ADDRESS (ADDRESS_SPACE_SIZE - 1)
+
+enum Opcode {
+    OpcodeLd,
+    OpcodeNot,
+    OpcodeAdd,
+    OpcodeAnd,
+    OpcodeSt,
+    OpcodeJmp,
+    OpcodeJmn,
+    OpcodeJmz
+};
+
+static const char* const opcodeNames[] = { "ld", "not", "add", "and", "st", "jmp", "jmn", "jmz" };
+
+static inline bool isValidAddress(int address) {
+    return address >= 0 && address < ADDRESS_SPACE_SIZE;
+}
+
+static inline InstructionWord encodeInstruction(enum Opcode opcode, int argument) {
+    return (InstructionWord) opcode << ADDRESS_BITS | argument;
+}
+
+static inline enum Opcode getInstructionOpcode(InstructionWord instruction) {
+    return instruction >> ADDRESS_BITS & ((1 << OPCODE_BITS) - 1);
+}
+
+/// Whether the bits above the opcode, if the instruction has any, are 0. The machine ignores them.
+static inline bool hasNoUnusedBits(InstructionWord instruction) {
+    return (uint64_t) instruction >> (ADDRESS_BITS + OPCODE_BITS) == 0;
+}
+
+static inline int getInstructionArgument(InstructionWord instruction) {
+    return instruction & (ADDRESS_SPACE_SIZE - 1);
+}
+
+/// Writes the instruction at the address, which must leave room for all of its bytes.
+static inline void storeInstruction(unsigned char* memory, int address, InstructionWord instruction) {
+    for (int i = 0; i < INSTRUCTION_SIZE; ++i) {
+        memory[address + i] = instruction >> 8 * i;
+    }
+}
+
+/// Reads the instruction at the address, wrapping around the end of the address space.
+static inline InstructionWord loadInstruction(const unsigned char* memory, int address) {
+    InstructionWord instruction = 0;
+    for (int i = 0; i < INSTRUCTION_SIZE; ++i) {
+        instruction |= (InstructionWord) memory[(address + i) % ADDRESS_SPACE_SIZE] << 8 * i;
+    }
+    return instruction;
+}
+
+/// Combines the argument with the argument bits of the instruction at the address, which are expected to be 0.
+static inline void addInstructionArgument(unsigned char* memory, int address, int argument) {
+    for (int i = 0; i < INSTRUCTION_SIZE; ++i) {
+        memory[address + i] |= argument >> 8 * i;
+    }
+}
+
+#endif
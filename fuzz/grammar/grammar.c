@@ -0,0 +1,446 @@
+#include "grammar.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include "../../common/target-description.h"
+
+#define MAX_LINES 64
+#define MAX_EXPRESSION_DEPTH 3
+#define LABEL_NAMES_COUNT 12
+#define CONSTANT_NAMES_COUNT 4
+#define MAX_MUTATIONS 4
+
+#define COUNT_OF(array) (sizeof(array) / sizeof(*(array)))
+
+static unsigned int randomState;
+static bool isMalformed; // Whether the program may break the rules of the language
+static int definedLabelsCount;
+static char* output;
+static size_t outputLength;
+
+static unsigned int nextRandom(unsigned int bound) {
+    randomState = randomState * 1103515245 + 12345;
+    return (randomState >> 16) % bound;
+}
+
+/// True once in `oneIn` calls on average.
+static bool chance(unsigned int oneIn) {
+    return nextRandom(oneIn) == 0;
+}
+
+/// Same as `chance` in malformed programs, and always false in well-formed ones.
+static bool malformation(unsigned int oneIn) {
+    return isMalformed && chance(oneIn);
+}
+
+/// Appends the text, truncated so that the source and its terminator fit in the buffer.
+static void writeText(const char* text) {
+    size_t length = strlen(text);
+    if (length > MAX_GENERATED_SOURCE_SIZE - 1 - outputLength) {
+        length = MAX_GENERATED_SOURCE_SIZE - 1 - outputLength;
+    }
+    memcpy(output + outputLength, text, length);
+    outputLength += length;
+}
+
+static void writeFormatted(const char* format, int value) {
+    char text[32];
+    snprintf(text, sizeof(text), format, value);
+    writeText(text);
+}
+
+static void writeRandomCase(const char* text) {
+    for (; *text != 0; ++text) {
+        char character[2] = { *text, 0 };
+        if (character[0] >= 'A' && character[0] <= 'Z' && chance(3)) {
+            character[0] += 'a' - 'A';
+        }
+        writeText(character);
+    }
+}
+
+static void writeSeparator() {
+    static const char* separators[] = { " ", " ", " ", "  ", "\t", " \t " };
+    writeText(separators[nextRandom(COUNT_OF(separators))]);
+}
+
+static void writeLabelName() {
+    static const char* invalidNames[] = { "IO", "undefined", "a_label_name_longer_than_31_chars", "a_label_name_exactly_31_chars__", "9lives", "C0" };
+
+    if (malformation(4)) {
+        writeText(invalidNames[nextRandom(COUNT_OF(invalidNames))]);
+    } else {
+        writeFormatted("l%d", nextRandom(LABEL_NAMES_COUNT));
+    }
+}
+
+/// Labels of well-formed programs are defined once each, in order.
+static void writeLabelDefinition() {
+    if (isMalformed) {
+        writeLabelName();
+    } else if (definedLabelsCount < LABEL_NAMES_COUNT) {
+        writeFormatted("l%d", definedLabelsCount++);
+    } else {
+        return;
+    }
+    writeText(":");
+    writeSeparator();
+}
+
+static void writeConstantName() {
+    writeFormatted("C%d", nextRandom(CONSTANT_NAMES_COUNT));
+}
+
+static void writeNumber() {
+    if (!isMalformed) {
+        return writeFormatted(chance(2) ? "0x%X" : "%d", nextRandom(16));
+    }
+
+    switch (nextRandom(10)) {
+        case 0: return writeFormatted("0x%X", nextRandom(ADDRESS_SPACE_SIZE));
+        case 1: return writeFormatted("0x%x", nextRandom(0x100));
+        case 2: return writeFormatted("-%d", nextRandom(129));
+        case 3: return writeFormatted("%d", 250 + nextRandom(10));
+        case 4: return writeFormatted("%d", ADDRESS_SPACE_SIZE - 0x10 + nextRandom(0x20));
+        case 5: return writeText(chance(2) ? "0x" : "0xZZ");
+        case 6: return writeText(chance(2) ? "99999999999999999999" : "-0x8000000000000000");
+        default: return writeFormatted("%d", nextRandom(16));
+    }
+}
+
+static void writeEscapeSequence(char terminator) {
+    static const char* sequences[] = { "\\n", "\\T", "\\r", "\\x41", "\\X7f", "\\\\", "\\x4", "\\q" }; // The last ones may end the literal early or are invalid
+
+    if (chance(COUNT_OF(sequences) + 1)) {
+        char sequence[3] = { '\\', terminator, 0 };
+        writeText(sequence);
+    } else {
+        writeText(sequences[nextRandom(isMalformed ? COUNT_OF(sequences) : COUNT_OF(sequences) - 3)]);
+    }
+}
+
+static void writeCharacterLiteral() {
+    writeText("'");
+    if (chance(4)) {
+        writeEscapeSequence('\'');
+    } else if (!malformation(16)) {
+        char character[2] = { ' ' + nextRandom('~' - ' '), 0 };
+        writeText(character[0] == '\'' || character[0] == '\\' ? "a" : character);
+    }
+    if (malformation(16)) {
+        writeText("bc"); // Too many characters
+    }
+    if (!malformation(32)) {
+        writeText("'");
+    }
+}
+
+static void writeStringLiteral() {
+    static const char* words[] = { "Hi", "error", "ror", "ok", " ", "\\n", "W13", ";", "'" };
+
+    writeText("\"");
+    for (unsigned int i = nextRandom(5); i > 0; --i) {
+        if (chance(5)) {
+            writeEscapeSequence('"');
+        } else {
+            writeText(words[nextRandom(COUNT_OF(words))]);
+        }
+    }
+    if (!malformation(32)) {
+        writeText("\"");
+    }
+}
+
+static void writeExpression(int depth);
+
+/// Writes any operand in malformed programs, which is likely out of range.
+static void writeOperand(int depth) {
+    switch (nextRandom(depth < MAX_EXPRESSION_DEPTH ? 10 : 6)) {
+        case 0:
+        case 1: return writeLabelName();
+        case 2: return writeConstantName();
+        case 3: return writeCharacterLiteral();
+        case 4:
+        case 5: return writeNumber();
+        case 6:
+            writeText("(");
+            writeExpression(depth + 1);
+            return writeText(chance(16) ? "" : ")");
+        case 7:
+            writeText(chance(2) ? "-" : "~");
+            return writeOperand(depth + 1);
+        default:
+            writeRandomCase(chance(2) ? "LSB(" : "MSB(");
+            writeExpression(depth + 1);
+            return writeText(")");
+    }
+}
+
+static void writeExpression(int depth) {
+    static const char* operators[] = { "+", "-", "*", "/", "%", "<<", ">>", "&", "|", "^", "+", "-" };
+
+    writeOperand(depth);
+    for (unsigned int i = chance(2) ? nextRandom(3) : 0; i > 0; --i) {
+        writeText(chance(2) ? " " : "");
+        writeText(operators[nextRandom(COUNT_OF(operators))]);
+        writeText(chance(2) ? " " : "");
+        writeOperand(depth);
+    }
+}
+
+/// Writes an expression whose value is an address in well-formed programs.
+static void writeAddressExpression() {
+    if (isMalformed) {
+        return writeExpression(0);
+    }
+
+    if (chance(2)) {
+        writeLabelName();
+        if (chance(3)) {
+            writeText("+");
+            if (chance(2)) {
+                writeNumber();
+            } else {
+                writeConstantName();
+            }
+        }
+    } else {
+        writeText("(");
+        writeLabelName();
+        writeText(" + ");
+        writeConstantName();
+        writeText(chance(2) ? " * 2)" : ")");
+    }
+}
+
+/// Writes an expression whose value is a byte in well-formed programs.
+static void writeByteExpression() {
+    static const char* operators[] = { "+", "-", "&", "|", "^" };
+
+    if (isMalformed) {
+        return writeExpression(0);
+    }
+
+    for (int i = chance(2) ? 1 : 0; i >= 0; --i) {
+        switch (nextRandom(5)) {
+            case 0: writeConstantName(); break;
+            case 1: writeCharacterLiteral(); break;
+            case 2:
+                if (definedLabelsCount == 0) {
+                    writeNumber();
+                    break;
+                }
+                writeRandomCase(chance(2) ? "LSB(" : "MSB("); // Of a label defined before, since bytes are evaluated at once
+                writeFormatted("l%d", nextRandom(definedLabelsCount));
+                writeText(")");
+                break;
+            default: writeNumber(); break;
+        }
+        if (i > 0) {
+            writeText(operators[nextRandom(COUNT_OF(operators))]);
+        }
+    }
+}
+
+static void writeInstruction() {
+    static const char* instructions[] = { "LD", "NOT", "ADD", "AND", "ST", "JMP", "JMN", "JMZ", "SUB", "CMP", "OR", "XOR" };
+
+    unsigned int index = nextRandom(COUNT_OF(instructions));
+    writeRandomCase(instructions[index]);
+    writeSeparator();
+
+    bool isStoreOrJump = index >= 4 && index <= 7;
+    if (isStoreOrJump ? malformation(16) : chance(2)) {
+        writeText("#");
+        writeByteExpression();
+    } else {
+        writeAddressExpression();
+    }
+}
+
+/// Calls and returns are only written to malformed programs, since every subroutine has to return.
+static void writePseudoInstruction() {
+    switch (nextRandom(isMalformed ? 3 : 1)) {
+        case 0:
+            writeRandomCase("SHL");
+            writeSeparator();
+            return writeFormatted(malformation(8) ? "#%d" : "%d", isMalformed ? nextRandom(10) : 1 + nextRandom(7));
+        case 1:
+            writeRandomCase("CALL");
+            writeSeparator();
+            return writeLabelName();
+        default:
+            return writeRandomCase("RET");
+    }
+}
+
+static void writeValue() {
+    switch (nextRandom(4)) {
+        case 0: return writeStringLiteral();
+        case 1: return writeCharacterLiteral();
+        default:
+            writeText(isMalformed ? "" : "("); // Values starting with a symbol would be taken for other tokens
+            writeByteExpression();
+            return writeText(isMalformed ? "" : ")");
+    }
+}
+
+static void writeDirective() {
+    static const char* tableFunctions[] = {
+        "toupper", "TOLOWER", "isdigit", "ISALPHA", "isalnum", "isupper", "islower", "isspace", "ispunct", "popcount", "reverse", "shl 3", "SHR 1", "mul 3", "mul", "sqrt"
+    };
+
+    switch (nextRandom(12)) {
+        case 0:
+            if (!isMalformed) {
+                return writeRandomCase(".IMMEDIATES"); // Moving the origin would override values
+            }
+            writeRandomCase(".ORG");
+            writeSeparator();
+            return writeExpression(0);
+        case 1:
+            writeRandomCase(".ALIGN");
+            writeSeparator();
+            return writeFormatted("%d", isMalformed ? (int) nextRandom(16) - 1 : 1 + (int) nextRandom(8));
+        case 2:
+            writeRandomCase(".FILL");
+            writeSeparator();
+            if (chance(4)) {
+                writeCharacterLiteral();
+            } else {
+                writeByteExpression();
+            }
+            writeSeparator();
+            return writeFormatted("%d", isMalformed ? (int) nextRandom(40) - 2 : 1 + (int) nextRandom(40));
+        case 3:
+        case 4:
+            if (!isMalformed) {
+                return writeValue(); // Constants are defined before the program
+            }
+            writeRandomCase(".EQU");
+            writeSeparator();
+            if (chance(8)) {
+                writeLabelName();
+            } else {
+                writeConstantName();
+            }
+            writeSeparator();
+            return writeExpression(0);
+        case 5:
+            return writeRandomCase(".IMMEDIATES");
+        case 6:
+            writeRandomCase(".POOL");
+            writeSeparator();
+            return malformation(8) ? writeNumber() : writeStringLiteral();
+        case 7:
+            writeRandomCase(".TABLE");
+            writeSeparator();
+            return writeText(tableFunctions[nextRandom(isMalformed ? COUNT_OF(tableFunctions) : COUNT_OF(tableFunctions) - 2)]);
+        case 8:
+            writeRandomCase(chance(2) ? ".LSB" : ".MSB");
+            writeSeparator();
+            return writeAddressExpression();
+        default:
+            return writeRandomCase(malformation(8) ? ".UNKNOWN" : ".IMMEDIATES");
+    }
+}
+
+static void writeComment() {
+    static const char* comments[] = { "; comment", ";", "; @bound 2", ";@bound", "; \"unterminated", "; 'x" };
+    writeSeparator();
+    writeText(comments[nextRandom(COUNT_OF(comments))]);
+}
+
+static void writeLine() {
+    if (chance(3)) {
+        writeLabelDefinition();
+    }
+
+    switch (nextRandom(10)) {
+        case 0:
+        case 1:
+        case 2:
+        case 3: writeInstruction(); break;
+        case 4: writePseudoInstruction(); break;
+        case 5:
+        case 6: writeDirective(); break;
+        case 7: writeValue(); break;
+        default: break;
+    }
+
+    if (chance(6)) {
+        writeComment();
+    }
+    writeText(chance(16) ? "\r\n" : "\n");
+}
+
+/// Inserts, deletes or repeats bytes, or cuts the source short. Never inserts a zero byte, which would end the source.
+static void mutate() {
+    static const char insertedCharacters[] = "#:;.'\"\\()+-~xX0123456789 \t\nldst";
+
+    for (unsigned int i = 1 + nextRandom(MAX_MUTATIONS); i > 0 && outputLength > 0; --i) {
+        size_t position = nextRandom(outputLength);
+        switch (nextRandom(4)) {
+            case 0:
+                if (outputLength < MAX_GENERATED_SOURCE_SIZE - 1) {
+                    memmove(output + position + 1, output + position, outputLength - position);
+                    output[position] = insertedCharacters[nextRandom(sizeof(insertedCharacters) - 1)];
+                    ++outputLength;
+                }
+                break;
+            case 1:
+                memmove(output + position, output + position + 1, outputLength - position - 1);
+                --outputLength;
+                break;
+            case 2: {
+                size_t length = 1 + nextRandom(outputLength - position);
+                size_t repeats = 1 + nextRandom(64);
+                for (size_t j = 0; j < repeats && outputLength + length < MAX_GENERATED_SOURCE_SIZE; ++j) {
+                    memmove(output + position + length, output + position, outputLength - position);
+                    outputLength += length;
+                }
+                break;
+            }
+            default:
+                outputLength = position;
+                break;
+        }
+    }
+}
+
+size_t generateProgram(char* source, unsigned int seed) {
+    randomState = seed;
+    isMalformed = chance(2);
+    definedLabelsCount = 0;
+    output = source;
+    outputLength = 0;
+
+    for (int i = 0; i < CONSTANT_NAMES_COUNT; ++i) {
+        if (!malformation(4)) {
+            writeFormatted(".EQU C%d ", i);
+            writeFormatted("%d\n", nextRandom(16));
+        }
+    }
+
+    for (unsigned int i = 1 + nextRandom(MAX_LINES); i > 0; --i) {
+        writeLine();
+    }
+
+    if (!isMalformed && definedLabelsCount < LABEL_NAMES_COUNT) {
+        while (definedLabelsCount < LABEL_NAMES_COUNT) {
+            writeLabelDefinition();
+        }
+        writeText("0\n");
+    }
+
+    if (chance(2)) {
+        writeFormatted("\nIO: .org 0x%X\n", IO_ADDRESS);
+    }
+
+    if (isMalformed && chance(2)) {
+        mutate();
+    }
+
+    output[outputLength] = 0;
+    return outputLength;
+}
@@ -0,0 +1,20 @@
+#ifndef grammar
+#define grammar
+
+#include <stddef.h>
+
+#define MAX_GENERATED_SOURCE_SIZE 0x4000
+
+/**
+ * Writes a random, zero-terminated assembly program determined by the
+ * seed to `source`, which must hold `MAX_GENERATED_SOURCE_SIZE` bytes, and
+ * returns its length. Programs are built from the grammar of the assembly
+ * language: labels, instructions, pseudo-instructions, directives, number,
+ * character and string literals, expressions and comments. Most of them are
+ * plausible, but literals, arguments and names are sometimes out of range or
+ * malformed, and some programs are mutated afterwards by inserting, deleting
+ * or repeating bytes, so that the assembler's error paths are exercised too.
+ */
+size_t generateProgram(char* source, unsigned int seed);
+
+#endif
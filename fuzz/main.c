@@ -0,0 +1,366 @@
+/*
+    W13ASM-fuzz Copyright (C) 2025 Piotr Marczyński <piotrmski@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+    See file COPYING.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "grammar/grammar.h"
+#include "../src/assembler/assembler.h"
+#include "../src/output/output.h"
+#include "../src/statistics-report/statistics-report.h"
+
+#define DEFAULT_DURATION_SECONDS 10
+#define FUZZ_LEXER_THREADS 2
+#define MAX_MESSAGE_LEN 0x200
+#define MAX_VIOLATION_LEN (2 * MAX_MESSAGE_LEN + 0x100)
+#define EXIT_CODES_COUNT (ExitCodeTooManySubroutineEvents + 1)
+#define PROGRESS_INTERVAL_MS 1000.0
+#define FAILURE_SOURCE_PATH "fuzz/failure.asm"
+
+/// The outcome of assembling a source once.
+struct Execution {
+    enum ExitCode exitCode;
+    char errorMessage[MAX_MESSAGE_LEN];
+    uint64_t programHash; // Of the program memory, data types, line numbers and labels
+    uint64_t resultHash; // Of the whole result, including the error message
+};
+
+/// Results are too big for the stack, so they're allocated once and reused.
+static struct AssemblerResult* results[3];
+static char* sourceCopies[3];
+static char violation[MAX_VIOLATION_LEN];
+static long long executionsByExitCode[EXIT_CODES_COUNT];
+
+/// FNV-1a, taking 8 bytes at a time, since the arrays of the result are hashed after every execution.
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = data;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * 0x100000001B3;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3;
+    }
+    return hash;
+}
+
+static uint64_t hashProgram(struct AssemblerResult* result) {
+    uint64_t hash = 0xCBF29CE484222325;
+    hash = hashBytes(hash, result->programMemory, sizeof(result->programMemory));
+    hash = hashBytes(hash, result->dataType, sizeof(result->dataType));
+    hash = hashBytes(hash, result->lineNumberByAddress, sizeof(result->lineNumberByAddress));
+    hash = hashBytes(hash, &result->labelsCount, sizeof(result->labelsCount));
+    for (int i = 0; i < result->labelsCount; ++i) {
+        hash = hashBytes(hash, result->labels[i].name, strlen(result->labels[i].name) + 1);
+        hash = hashBytes(hash, &result->labels[i].address, sizeof(result->labels[i].address));
+    }
+    return hash;
+}
+
+static uint64_t hashResult(struct Execution* execution, struct AssemblerResult* result) {
+    uint64_t hash = hashBytes(0xCBF29CE484222325, &execution->exitCode, sizeof(execution->exitCode));
+    hash = hashBytes(hash, execution->errorMessage, strlen(execution->errorMessage));
+    if (execution->exitCode != ExitCodeSuccess) {
+        return hash;
+    }
+
+    hash = hashBytes(hash, &execution->programHash, sizeof(execution->programHash));
+    hash = hashBytes(hash, &result->expansionsCount, sizeof(result->expansionsCount));
+    for (int i = 0; i < result->expansionsCount; ++i) {
+        hash = hashBytes(hash, &result->expansions[i].lineNumber, sizeof(result->expansions[i].lineNumber));
+        hash = hashBytes(hash, &result->expansions[i].address, sizeof(result->expansions[i].address));
+        hash = hashBytes(hash, &result->expansions[i].instructionsCount, sizeof(result->expansions[i].instructionsCount));
+    }
+    hash = hashBytes(hash, &result->immediatePoolsCount, sizeof(result->immediatePoolsCount));
+    return hashBytes(hash, result->immediatePools, result->immediatePoolsCount * sizeof(struct ImmediatePool));
+}
+
+/// Assembles a copy of the source, since assembling modifies it. The copy must outlive the label names in the result.
+static struct Execution assembleCopy(const char* source, size_t length, int copyIndex, int lexerThreads) {
+    struct Execution execution = { 0 };
+    memcpy(sourceCopies[copyIndex], source, length + 1);
+
+    setParallelLexing(lexerThreads, 0);
+    execution.exitCode = tryAssemble(sourceCopies[copyIndex], results[copyIndex], execution.errorMessage, sizeof(execution.errorMessage));
+    setParallelLexing(0, 0);
+
+    execution.errorMessage[strcspn(execution.errorMessage, "\n")] = 0;
+
+    if (execution.exitCode == ExitCodeSuccess) {
+        execution.programHash = hashProgram(results[copyIndex]);
+    }
+    execution.resultHash = hashResult(&execution, results[copyIndex]);
+    return execution;
+}
+
+static struct Execution assembleStreamCopy(const char* source, size_t length) {
+    struct Execution execution = { 0 };
+    FILE* stream = fmemopen((void*) source, length > 0 ? length : 1, "r"); // An empty buffer can't be opened
+
+    execution.exitCode = tryAssembleStream(stream, results[2], execution.errorMessage, sizeof(execution.errorMessage));
+    fclose(stream);
+
+    if (execution.exitCode == ExitCodeSuccess) {
+        execution.programHash = hashProgram(results[2]);
+        for (int i = 0; i < results[2]->labelsCount; ++i) {
+            free(results[2]->labels[i].name);
+        }
+        for (int i = 0; i < results[2]->expansionsCount; ++i) {
+            free(results[2]->expansions[i].argument);
+        }
+    }
+    return execution;
+}
+
+/// Checks that every declared value lies within the memory, instructions don't overlap other values and line numbers exist.
+static bool isResultConsistent(struct AssemblerResult* result, const char* source) {
+    int linesCount = 1;
+    for (const char* character = source; *character != 0; ++character) {
+        linesCount += *character == '\n';
+    }
+
+    int programSize = getProgramSize(result);
+    if (programSize < 1 || programSize > ADDRESS_SPACE_SIZE) {
+        snprintf(violation, sizeof(violation), "the program size %d is out of range.", programSize);
+        return false;
+    }
+
+    for (int address = 0; address < ADDRESS_SPACE_SIZE; ++address) {
+        if (result->dataType[address] > DataTypeInt) {
+            snprintf(violation, sizeof(violation), "address 0x%04X has an invalid data type %d.", address, result->dataType[address]);
+            return false;
+        }
+        if (result->lineNumberByAddress[address] < 0 || result->lineNumberByAddress[address] > linesCount) {
+            snprintf(violation, sizeof(violation), "address 0x%04X was declared on line %d, which doesn't exist.", address, result->lineNumberByAddress[address]);
+            return false;
+        }
+        if (result->dataType[address] != DataTypeInstruction) {
+            continue;
+        }
+        if (address + INSTRUCTION_SIZE > ADDRESS_SPACE_SIZE || !hasNoUnusedBits(loadInstruction(result->programMemory, address))) {
+            snprintf(violation, sizeof(violation), "the instruction at address 0x%04X doesn't fit in the memory.", address);
+            return false;
+        }
+        for (int i = 1; i < INSTRUCTION_SIZE; ++i) {
+            if (result->dataType[address + i] != DataTypeNone) {
+                snprintf(violation, sizeof(violation), "the instruction at address 0x%04X overlaps another value.", address);
+                return false;
+            }
+        }
+    }
+
+    if (result->labelsCount < 0 || result->labelsCount > MAX_LABEL_DEFS
+        || result->expansionsCount < 0 || result->expansionsCount > MAX_EXPANSIONS
+        || result->immediatePoolsCount < 0 || result->immediatePoolsCount > MAX_IMMEDIATE_POOLS) {
+        snprintf(violation, sizeof(violation), "the result has %d labels, %d expansions and %d immediate pools.", result->labelsCount, result->expansionsCount, result->immediatePoolsCount);
+        return false;
+    }
+
+    for (int i = 0; i < result->labelsCount; ++i) {
+        if (result->labels[i].name == NULL || result->labels[i].address < 0 || result->labels[i].address > ADDRESS_SPACE_SIZE) {
+            snprintf(violation, sizeof(violation), "label %d is invalid.", i);
+            return false;
+        }
+    }
+
+    for (int i = 0; i < result->immediatePoolsCount; ++i) {
+        struct ImmediatePool pool = result->immediatePools[i];
+        if (pool.address < 0 || pool.length < 1 || pool.address + pool.length > ADDRESS_SPACE_SIZE) {
+            snprintf(violation, sizeof(violation), "immediate pool %d at address 0x%04X of %d bytes is out of memory range.", i, pool.address, pool.length);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Assembles the source in memory twice, once on multiple lexer threads, and
+ * once from a stream, and checks that the results are consistent. Returns
+ * false and describes the first broken invariant in `violation` otherwise.
+ */
+static bool checkInvariants(const char* source, size_t length) {
+    struct Execution execution = assembleCopy(source, length, 0, 0);
+    struct Execution repeated = assembleCopy(source, length, 1, 0);
+
+    if (execution.exitCode < ExitCodeSuccess || execution.exitCode >= EXIT_CODES_COUNT) {
+        snprintf(violation, sizeof(violation), "invalid exit code %d.", execution.exitCode);
+        return false;
+    }
+    ++executionsByExitCode[execution.exitCode];
+
+    if (execution.exitCode != ExitCodeSuccess && execution.errorMessage[0] == 0) {
+        snprintf(violation, sizeof(violation), "exit code %d was produced without an error message.", execution.exitCode);
+        return false;
+    }
+
+    if (repeated.resultHash != execution.resultHash) {
+        snprintf(violation, sizeof(violation), "assembling the source again produced a different result (code %d \"%s\" instead of %d \"%s\").",
+            repeated.exitCode, repeated.errorMessage, execution.exitCode, execution.errorMessage);
+        return false;
+    }
+
+    if (execution.exitCode == ExitCodeSuccess && !isResultConsistent(results[0], source)) {
+        return false;
+    }
+
+    struct Execution parallel = assembleCopy(source, length, 1, FUZZ_LEXER_THREADS);
+    if (parallel.resultHash != execution.resultHash) {
+        snprintf(violation, sizeof(violation), "tokenizing on multiple threads produced a different result (code %d \"%s\" instead of %d \"%s\").",
+            parallel.exitCode, parallel.errorMessage, execution.exitCode, execution.errorMessage);
+        return false;
+    }
+
+    struct Execution streamed = assembleStreamCopy(source, length);
+    if (streamed.exitCode == ExitCodeStreamedStatementTooLong) {
+        return true;
+    }
+    if (streamed.exitCode != execution.exitCode || streamed.programHash != execution.programHash) {
+        snprintf(violation, sizeof(violation), "assembling a stream produced a different result (code %d instead of %d).", streamed.exitCode, execution.exitCode);
+        return false;
+    }
+
+    return true;
+}
+
+static void allocateBuffers() {
+    for (int i = 0; i < 3; ++i) {
+        results[i] = malloc(sizeof(struct AssemblerResult));
+        sourceCopies[i] = malloc(MAX_GENERATED_SOURCE_SIZE);
+    }
+}
+
+static void saveSource(const char* path, const char* source, size_t length) {
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        printf("Error: could not write to file \"%s\".\n", path);
+        exit(EXIT_FAILURE);
+    }
+    fwrite(source, sizeof(char), length, file);
+    fclose(file);
+}
+
+static void printSummary(long long executions, double elapsedMs) {
+    printf("%lld executions in %.1f s (%.0f/s), %lld accepted, %lld rejected\n",
+        executions, elapsedMs / 1000, executions * 1000 / (elapsedMs > 0 ? elapsedMs : 1),
+        executionsByExitCode[ExitCodeSuccess], executions - executionsByExitCode[ExitCodeSuccess]);
+
+    printf("Exit codes:");
+    for (int exitCode = 0; exitCode < EXIT_CODES_COUNT; ++exitCode) {
+        if (executionsByExitCode[exitCode] > 0) {
+            printf(" %d: %lld", exitCode, executionsByExitCode[exitCode]);
+        }
+    }
+    printf("\n");
+}
+
+/// Checks generated programs until the time runs out, and saves the first one breaking an invariant.
+static bool runFuzzer(double durationSeconds, unsigned int seed) {
+    char* source = malloc(MAX_GENERATED_SOURCE_SIZE);
+    double start = getMonotonicTimeMs();
+    double lastProgress = start;
+    long long executions = 0;
+    bool passed = true;
+
+    printf("Fuzzing for %.0f s from seed %u.\n", durationSeconds, seed);
+
+    for (double now = start; now - start < durationSeconds * 1000; now = getMonotonicTimeMs()) {
+        unsigned int programSeed = seed + executions;
+        size_t length = generateProgram(source, programSeed);
+
+        if (!checkInvariants(source, length)) {
+            saveSource(FAILURE_SOURCE_PATH, source, length);
+            printf("Invariant broken by the program of seed %u: %s\nThe program was saved to \"%s\".\n", programSeed, violation, FAILURE_SOURCE_PATH);
+            passed = false;
+            break;
+        }
+
+        ++executions;
+        if (now - lastProgress >= PROGRESS_INTERVAL_MS) {
+            printf("%lld executions, %.0f/s\n", executions, executions * 1000 / (now - start));
+            fflush(stdout);
+            lastProgress = now;
+        }
+    }
+
+    printSummary(executions, getMonotonicTimeMs() - start);
+    free(source);
+    return passed;
+}
+
+static bool checkSourceFile(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        printf("Error: could not read file \"%s\".\n", path);
+        exit(EXIT_FAILURE);
+    }
+    char* source = malloc(MAX_GENERATED_SOURCE_SIZE);
+    size_t length = fread(source, 1, MAX_GENERATED_SOURCE_SIZE - 1, file);
+    source[length] = 0;
+    fclose(file);
+
+    bool passed = checkInvariants(source, strlen(source));
+    if (passed) {
+        printf("All invariants hold.\n");
+    } else {
+        printf("Invariant broken: %s\n", violation);
+    }
+    free(source);
+    return passed;
+}
+
+static void printUsage() {
+    printf("W13 assembler fuzzer. Copyright (C) 2025 Piotr Marczyński. This program is licensed under GNU GPL v3. See file COPYING.\n");
+    printf("Usage:\n");
+    printf("w13asm-fuzz run [seconds] [seed]\n");
+    printf("    Assembles random programs for the given time (default %d s) and checks invariants of the results.\n", DEFAULT_DURATION_SECONDS);
+    printf("    The first program breaking an invariant is saved to \"%s\".\n", FAILURE_SOURCE_PATH);
+    printf("w13asm-fuzz generate [seed] [path/to/source.asm]\n");
+    printf("    Saves the program generated from the seed.\n");
+    printf("w13asm-fuzz check [path/to/source.asm]\n");
+    printf("    Checks invariants of the results of assembling the source.\n");
+}
+
+int main(int argc, const char * argv[]) {
+    allocateBuffers();
+
+    if (argc >= 2 && argc <= 4 && strcmp(argv[1], "run") == 0) {
+        double durationSeconds = argc >= 3 ? atof(argv[2]) : DEFAULT_DURATION_SECONDS;
+        unsigned int seed = argc == 4 ? strtoul(argv[3], NULL, 0) : 1;
+        return runFuzzer(durationSeconds, seed) ? EXIT_SUCCESS : EXIT_FAILURE;
+    } else if (argc == 4 && strcmp(argv[1], "generate") == 0) {
+        char* source = malloc(MAX_GENERATED_SOURCE_SIZE);
+        size_t length = generateProgram(source, strtoul(argv[2], NULL, 0));
+        saveSource(argv[3], source, length);
+        free(source);
+    } else if (argc == 3 && strcmp(argv[1], "check") == 0) {
+        return checkSourceFile(argv[2]) ? EXIT_SUCCESS : EXIT_FAILURE;
+    } else {
+        printUsage();
+        return argc == 1 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
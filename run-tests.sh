@@ -1,2 +1,3 @@
 #!/bin/bash
-make clean && make && make w13asm-test && ./dist/w13asm-test && rm ./dist/w13asm-test
\ No newline at end of file
+make clean && make && make w13asm-test && ./dist/w13asm-test && rm ./dist/w13asm-test \
+    && make clean && make TARGET=W16 w16asm-test && ./dist/w16asm-test && rm ./dist/w16asm-test && make clean
@@ -1,27 +1,49 @@
 #include "assembler.h"
 #include "../tokenizer/tokenizer.h"
-#include "../../common/exit-code.h"
+#include "../evaluator/evaluator.h"
+#include "../statistics-report/statistics-report.h"
+#include "../failure/failure.h"
 #include <stdbool.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
 #include <errno.h>
+#include <setjmp.h>
 
-#define MAX_LABEL_DEFS 0x1000
-#define MAX_LABEL_USES 0x2000
+#define MAX_FIXUPS 0x2000
+#define MAX_CONSTANT_DEFS 0x1000
 #define MAX_IMMEDIATE_VAL_USES 0x1000
+#define MAX_POOLED_STRINGS 0x1000
+#define MAX_SUBROUTINE_EVENTS 0x1000
+#define MAX_POOL_ENTRY_USES (ADDRESS_SPACE_SIZE / INSTRUCTION_SIZE) // Every use is an instruction
+#define CALL_LENGTH (7 * INSTRUCTION_SIZE) // A is kept in a scratch cell while the return address is stored by 4 instructions
+#define PENDING_ADDRESS -1 // The address of a label of a pooled string, until the pool is declared
 #define MAX_LABEL_NAME_LEN_INCL_0 0x20
+#define STREAM_BUFFER_SIZE 0x2000 // The longest line which can be assembled from a stream, excluding its comment
+#define STREAM_LOOKAHEAD (STREAM_BUFFER_SIZE / 2)
+#define CHAIN_END (ADDRESS_SPACE_SIZE - 1) // An instruction can't start at the last address
+#define TABLE_SIZE 0x100
+#define TABLE_ALIGNMENT_BITS 8 // Tables are indexed by the least significant byte of an address
+#define SCRATCH_CELLS_COUNT 2
+#define POOL_ENTRIES_COUNT (SCRATCH_CELLS_COUNT + 8) // Scratch cells, followed by the tables of SHL 0 to 7
 
 enum Instruction {
-    InstructionLd = 0,
-    InstructionNot = 1,
-    InstructionAdd = 2,
-    InstructionAnd = 3,
-    InstructionSt = 4,
-    InstructionJmp = 5,
-    InstructionJmn = 6,
-    InstructionJmz = 7,
+    InstructionLd = OpcodeLd,
+    InstructionNot = OpcodeNot,
+    InstructionAdd = OpcodeAdd,
+    InstructionAnd = OpcodeAnd,
+    InstructionSt = OpcodeSt,
+    InstructionJmp = OpcodeJmp,
+    InstructionJmn = OpcodeJmn,
+    InstructionJmz = OpcodeJmz,
+    InstructionSub, // Pseudo-instructions, expanded into the instructions above
+    InstructionCmp,
+    InstructionOr,
+    InstructionXor,
+    InstructionShl,
+    InstructionCall,
+    InstructionRet,
     InstructionInvalid
 };
 
@@ -32,91 +54,230 @@ enum Directive {
     DirectiveLsb,
     DirectiveMsb,
     DirectiveImmediates,
+    DirectiveEqu,
+    DirectiveTable,
+    DirectivePool,
     DirectiveInvalid
 };
 
-enum NumberLiteralRange {
-    NumberLiteralRangeNone,
-    NumberLiteralRangeByte,
-    NumberLiteralRangeAddress
+enum TableFunction {
+    TableFunctionShl,
+    TableFunctionShr,
+    TableFunctionMul,
+    TableFunctionPopcount,
+    TableFunctionReverse,
+    TableFunctionIsDigit,
+    TableFunctionIsAlpha,
+    TableFunctionIsAlnum,
+    TableFunctionIsUpper,
+    TableFunctionIsLower,
+    TableFunctionIsSpace,
+    TableFunctionIsPunct,
+    TableFunctionToUpper,
+    TableFunctionToLower,
+    TableFunctionInvalid
 };
 
-struct LabelDefinition {
-    char* name;
-    int address;
+enum FixupKind {
+    FixupKindInstructionArgument,
+    FixupKindAddressByte,
+    FixupKindValue
+};
+
+enum ConstantState {
+    ConstantStateUnevaluated,
+    ConstantStateEvaluating,
+    ConstantStateEvaluated
 };
 
-struct LabelUse {
+struct ConstantDefinition {
     char* name;
-    int offset;
+    char* expression;
+    int lineNumber;
+    enum ConstantState state;
+    int value;
+};
+
+/// An expression which couldn't be evaluated when it was parsed, to be evaluated in `resolveLabels`.
+struct Fixup {
+    char* expression;
+    enum FixupKind kind;
     int byte;
     int lineNumber;
     int address;
 };
 
+/**
+ * A label used as an instruction argument before its definition, when
+ * assembling a stream. The arguments of all instructions using it are linked
+ * into a chain, each one holding the address of the previous use.
+ */
+struct ForwardReference {
+    char name[MAX_LABEL_NAME_LEN_INCL_0];
+    int lastUseAddress;
+    int lineNumber;
+};
+
+/// An instruction argument referring to a scratch cell or a table used by pseudo-instructions.
+struct PoolEntryUse {
+    int entry;
+    int address;
+};
+
 struct ImmediateValueUse {
     struct Token token;
     int address;
+    bool isAllocated; // Whether the expression is on the heap, to be freed once declared unless it names the value
+    bool isCreated; // Whether the expression was created by the assembler, so that the value is named by its number instead
 };
 
-struct LabelUseParseResult {
-    char* name;
-    int offset;
+/**
+ * A string declared with `.POOL`, whose labels are the label definitions in
+ * the range [labelsStart, labelsEnd). It's stored in the tail of its owner,
+ * which is the string itself unless it's a suffix of another pooled string.
+ */
+struct PooledString {
+    unsigned char* characters; // Including the terminating 0
+    int length;
+    int lineNumber;
+    int labelsStart;
+    int labelsEnd;
+    struct PooledString* owner;
+    int address;
 };
 
-struct EscapeSequenceParseResult {
-    char character;
-    int length;
+/**
+ * A CALL or a RET, in the order of the source. A subroutine is a label used
+ * by CALL, and its return is the first RET after it, which is a JMP patched
+ * by every CALL. Other RETs jump to the return of the last preceding
+ * subroutine.
+ */
+struct SubroutineEvent {
+    bool isReturn;
+    int labelsCount; // The number of label definitions preceding the event
+    int address; // The JMP of RET, or the first ST of CALL
+    char* subroutineName;
+    int lineNumber;
+};
+
+// The state is thread-local, so that sources may be assembled on multiple threads in parallel
+static _Thread_local char* sourceString;
+static _Thread_local int lineNumber = 1;
+static _Thread_local int currentAddress = 0;
+static _Thread_local bool programMemoryWritten[ADDRESS_SPACE_SIZE] = { false };
+static _Thread_local struct LabelDefinition labelDefinitions[MAX_LABEL_DEFS];
+static _Thread_local int labelDefinitionsCount = 0;
+static _Thread_local struct ConstantDefinition constantDefinitions[MAX_CONSTANT_DEFS];
+static _Thread_local int constantDefinitionsCount = 0;
+static _Thread_local struct Fixup fixups[MAX_FIXUPS];
+static _Thread_local int fixupsCount = 0;
+static _Thread_local bool allSymbolsDefined = false;
+static _Thread_local struct ImmediateValueUse immediateValueUses[MAX_IMMEDIATE_VAL_USES];
+static _Thread_local int immediateValueUsesCount = 0;
+static _Thread_local char* labelNamesByImmediateValue[256] = { NULL };
+static _Thread_local int immediateValueAddresses[256] = { 0 };
+static _Thread_local struct PooledString pooledStrings[MAX_POOLED_STRINGS];
+static _Thread_local int pooledStringsCount = 0;
+static _Thread_local unsigned char* declaredCharacters = NULL; // The decoded string being declared
+static _Thread_local struct SubroutineEvent subroutineEvents[MAX_SUBROUTINE_EVENTS];
+static _Thread_local int subroutineEventsCount = 0;
+static _Thread_local struct PoolEntryUse poolEntryUses[MAX_POOL_ENTRY_USES];
+static _Thread_local int poolEntryUsesCount = 0;
+static _Thread_local int poolEntryAddresses[POOL_ENTRIES_COUNT]; // -1 until declared
+static char* const poolEntryNames[POOL_ENTRIES_COUNT] = {
+    "#scratch0", "#scratch1", "#shl0", "#shl1", "#shl2", "#shl3", "#shl4", "#shl5", "#shl6", "#shl7"
 };
+static _Thread_local enum ExpansionGoal expansionGoal = ExpansionGoalSize;
+static _Thread_local int lexerThreadsCount = 0;
+static _Thread_local size_t parallelLexingMinSourceSize = 0;
+static _Thread_local struct LexedSource* lexedSource = NULL; // Tokens lexed in parallel, if any
+static _Thread_local int lexedTokenIndex = 0;
+static _Thread_local struct ForwardReference forwardReferences[MAX_FIXUPS];
+static _Thread_local int forwardReferencesCount = 0;
+static _Thread_local FILE* sourceStream = NULL; // Only set when assembling a stream
+static _Thread_local char streamBuffer[STREAM_BUFFER_SIZE + 1];
+static _Thread_local char* streamEnd; // The end of the whole lines in the buffer, replaced by the terminating 0
+static _Thread_local char streamEndCharacter; // The character replaced by the terminating 0
+static _Thread_local int streamPartialLineLength;
+static _Thread_local bool streamFinished;
+static _Thread_local char statementTokens[STREAM_BUFFER_SIZE]; // Copies of the tokens of the current statement
+static _Thread_local int statementTokensLength = 0;
+static _Thread_local int pendingLabelUses = 0; // Label uses of the expression being evaluated, counted once it's resolved
+static _Thread_local struct AssemblerResult result = { 0 };
+static _Thread_local bool timingEnabled = false;
+
+void setAssemblerTimingEnabled(bool enabled) {
+    timingEnabled = enabled;
+}
+
+void setExpansionGoal(enum ExpansionGoal goal) {
+    expansionGoal = goal;
+}
 
-static char* sourceString;
-static int lineNumber = 1;
-static int currentAddress = 0;
-static bool programMemoryWritten[ADDRESS_SPACE_SIZE] = { false };
-static struct LabelDefinition labelDefinitions[MAX_LABEL_DEFS];
-static int labelDefinitionsCount = 0;
-static struct LabelUse labelUses[MAX_LABEL_USES];
-static int labelUsesCount = 0;
-static struct ImmediateValueUse immediateValueUses[MAX_IMMEDIATE_VAL_USES];
-static int immediateValueUsesCount = 0;
-static char* labelNamesByImmediateValue[256] = { NULL };
-static struct AssemblerResult result = (struct AssemblerResult){ { 0 }, { DataTypeNone }, { NULL } };
+void setParallelLexing(int threadsCount, size_t minSourceSize) {
+    lexerThreadsCount = threadsCount;
+    parallelLexingMinSourceSize = minSourceSize;
+}
+
+static double getTimeMsIfEnabled() {
+    return timingEnabled ? getMonotonicTimeMs() : 0;
+}
 
 static void assertNoMemoryViolation(int address, int lineNumber) {
-    if (address < 0 || address >= ADDRESS_SPACE_SIZE) {
-        printf("Error on line %d: attempting to declare memory value outside of address space.\n", lineNumber);
-        exit(ExitCodeDeclaringValueOutOfMemoryRange);
+    if (!isValidAddress(address)) {
+        fail(ExitCodeDeclaringValueOutOfMemoryRange, "Error on line %d: attempting to declare memory value outside of address space.\n", lineNumber);
     }
 
     if (programMemoryWritten[address]) {
-        printf("Error on line %d: attempting to override memory value.\n", lineNumber);
-        exit(ExitCodeMemoryValueOverridden);
+        fail(ExitCodeMemoryValueOverridden, "Error on line %d: attempting to override memory value.\n", lineNumber);
     }
 
     programMemoryWritten[address] = true;
+    result.lineNumberByAddress[address] = lineNumber;
+    ++result.statistics.bytesEmitted;
 }
 
 static void assertCanAddLabelDefinition(int lineNumber) {
     if (labelDefinitionsCount == MAX_LABEL_DEFS - 1) {
-        printf("Error on line %d: too many label definitions.\n", lineNumber);
-        exit(ExitCodeTooManyLabelDefinitions);
+        fail(ExitCodeTooManyLabelDefinitions, "Error on line %d: too many label definitions.\n", lineNumber);
     }
 }
 
-static void assertCanAddLabelUses(int count, int lineNumber) {
-    if (labelUsesCount == MAX_LABEL_USES - count) {
-        printf("Error on line %d: too many label uses.\n", lineNumber);
-        exit(ExitCodeTooManyLabelUses);
+static void assertCanAddFixup(int lineNumber) {
+    if (fixupsCount == MAX_FIXUPS - 1) {
+        fail(ExitCodeTooManyLabelUses, "Error on line %d: too many label uses.\n", lineNumber);
+    }
+}
+
+static void assertCanAddConstantDefinition(int lineNumber) {
+    if (constantDefinitionsCount == MAX_CONSTANT_DEFS - 1) {
+        fail(ExitCodeTooManyConstantDefinitions, "Error on line %d: too many constant definitions.\n", lineNumber);
     }
 }
 
 static void assertCanAddImmediateValue(int lineNumber) {
     if (immediateValueUsesCount == MAX_IMMEDIATE_VAL_USES - 1) {
-        printf("Error on line %d: too many immediate value uses.\n", lineNumber);
-        exit(ExitCodeTooManyImmediateValueUses);
+        fail(ExitCodeTooManyImmediateValueUses, "Error on line %d: too many immediate value uses.\n", lineNumber);
+    }
+}
+
+static void assertCanAddSubroutineEvent(int lineNumber) {
+    if (subroutineEventsCount == MAX_SUBROUTINE_EVENTS - 1) {
+        fail(ExitCodeTooManySubroutineEvents, "Error on line %d: too many subroutine calls and returns.\n", lineNumber);
+    }
+}
+
+static void assertCanAddPooledString(int lineNumber) {
+    if (pooledStringsCount == MAX_POOLED_STRINGS - 1) {
+        fail(ExitCodeTooManyPooledStrings, "Error on line %d: too many pooled strings.\n", lineNumber);
     }
 }
 
+/// Returns a copy of the string which outlives the stream buffer, or the string itself when assembling a source in memory.
+static char* keepString(char* string) {
+    return sourceStream == NULL ? string : strdup(string);
+}
+
 static char charUppercase(char ch) {
     if (ch >= 'a' && ch <= 'z') return ch - 0x20;
     else return ch;
@@ -151,6 +312,20 @@ static enum Instruction getInstruction(char* name) {
         return InstructionJmn;
     } else if (stringsEqualCaseInsensitive(name, "JMZ")) {
         return InstructionJmz;
+    } else if (stringsEqualCaseInsensitive(name, "SUB")) {
+        return InstructionSub;
+    } else if (stringsEqualCaseInsensitive(name, "CMP")) {
+        return InstructionCmp;
+    } else if (stringsEqualCaseInsensitive(name, "OR")) {
+        return InstructionOr;
+    } else if (stringsEqualCaseInsensitive(name, "XOR")) {
+        return InstructionXor;
+    } else if (stringsEqualCaseInsensitive(name, "SHL")) {
+        return InstructionShl;
+    } else if (stringsEqualCaseInsensitive(name, "CALL")) {
+        return InstructionCall;
+    } else if (stringsEqualCaseInsensitive(name, "RET")) {
+        return InstructionRet;
     } else {
         return InstructionInvalid;
     }
@@ -166,6 +341,13 @@ static const char* getInstructionName(enum Instruction instruction) {
         case InstructionJmp: return "JMP"; 
         case InstructionJmn: return "JMN"; 
         case InstructionJmz: return "JMZ"; 
+        case InstructionSub: return "SUB";
+        case InstructionCmp: return "CMP";
+        case InstructionOr: return "OR";
+        case InstructionXor: return "XOR";
+        case InstructionShl: return "SHL";
+        case InstructionCall: return "CALL";
+        case InstructionRet: return "RET";
         case InstructionInvalid: return "";
     }
 }
@@ -183,17 +365,38 @@ static enum Directive getDirective(char* name) {
         return DirectiveMsb;
     } else if (stringsEqualCaseInsensitive(name, ".IMMEDIATES")) {
         return DirectiveImmediates;
+    } else if (stringsEqualCaseInsensitive(name, ".EQU")) {
+        return DirectiveEqu;
+    } else if (stringsEqualCaseInsensitive(name, ".TABLE")) {
+        return DirectiveTable;
+    } else if (stringsEqualCaseInsensitive(name, ".POOL")) {
+        return DirectivePool;
     } else {
         return DirectiveInvalid;
     }
 }
 
-static bool isStringLiteral(char* tokenValue) {
-    return tokenValue[0] == '"';
+static enum TableFunction getTableFunction(char* name) {
+    static const char* const names[TableFunctionInvalid] = {
+        "SHL", "SHR", "MUL", "POPCOUNT", "REVERSE", "ISDIGIT", "ISALPHA",
+        "ISALNUM", "ISUPPER", "ISLOWER", "ISSPACE", "ISPUNCT", "TOUPPER", "TOLOWER"
+    };
+
+    for (int i = 0; i < TableFunctionInvalid; ++i) {
+        if (stringsEqualCaseInsensitive(name, (char*) names[i])) {
+            return i;
+        }
+    }
+
+    return TableFunctionInvalid;
 }
 
-static bool isNumberLiteral(char* tokenValue) {
-    return tokenValue[0] >= '0' && tokenValue[0] <= '9' || tokenValue[0] == '-' && tokenValue[1] >= '0' && tokenValue[1] <= '9';
+static bool tableFunctionHasArgument(enum TableFunction function) {
+    return function == TableFunctionShl || function == TableFunctionShr || function == TableFunctionMul;
+}
+
+static bool isStringLiteral(char* tokenValue) {
+    return tokenValue[0] == '"';
 }
 
 static bool isCharacterLiteral(char* tokenValue) {
@@ -208,207 +411,554 @@ static bool instructionAcceptsImmediateValue(enum Instruction instruction) {
     return instruction < InstructionSt;
 }
 
-struct LabelDefinition* findLabelDefinition(struct LabelUse* labelUse) {
+static struct LabelDefinition* findLabelDefinition(char* name) {
     for (int i = 0; i < labelDefinitionsCount; ++i) {
-        if (strcmp(labelDefinitions[i].name, labelUse->name) == 0) {
+        if (strcmp(labelDefinitions[i].name, name) == 0) {
             return &labelDefinitions[i];
         }
     }
 
-    printf("Error on line %d: label \"%s\" is undefined.\n", labelUse->lineNumber, labelUse->name);
-    exit(ExitCodeUndefinedLabel);
+    return NULL;
+}
+
+static struct ConstantDefinition* findConstantDefinition(char* name) {
+    for (int i = 0; i < constantDefinitionsCount; ++i) {
+        if (strcmp(constantDefinitions[i].name, name) == 0) {
+            return &constantDefinitions[i];
+        }
+    }
+
+    return NULL;
+}
+
+static bool resolveSymbol(char* name, int lineNumber, int* value);
+
+/// Evaluates the expression, counting the labels it uses only once it's resolved, since an unresolved one is evaluated again later.
+static struct ExpressionEvaluationResult evaluateCountingLabelUses(char* expression, int lineNumber) {
+    int outerLabelUses = pendingLabelUses;
+    pendingLabelUses = 0;
+    struct ExpressionEvaluationResult evaluated = evaluateExpression(expression, lineNumber, resolveSymbol);
+    if (evaluated.resolved) {
+        result.statistics.labelUses += pendingLabelUses;
+    }
+    pendingLabelUses = outerLabelUses;
+    return evaluated;
+}
+
+static bool resolveConstant(struct ConstantDefinition* constant, int* value) {
+    if (constant->state == ConstantStateEvaluated) {
+        *value = constant->value;
+        return true;
+    }
+
+    if (constant->state == ConstantStateEvaluating) {
+        fail(ExitCodeInvalidExpression, "Error on line %d: constant \"%s\" is defined in terms of itself.\n", constant->lineNumber, constant->name);
+    }
+
+    constant->state = ConstantStateEvaluating;
+    struct ExpressionEvaluationResult evaluated = evaluateCountingLabelUses(constant->expression, constant->lineNumber);
+    constant->state = evaluated.resolved ? ConstantStateEvaluated : ConstantStateUnevaluated;
+    constant->value = evaluated.value;
+    *value = evaluated.value;
+    return evaluated.resolved;
+}
+
+static bool resolveSymbol(char* name, int lineNumber, int* value) {
+    struct ConstantDefinition* constant = findConstantDefinition(name);
+    if (constant != NULL) {
+        return resolveConstant(constant, value);
+    }
+
+    struct LabelDefinition* label = findLabelDefinition(name);
+    if (label != NULL && label->address == PENDING_ADDRESS) {
+        return false;
+    } else if (label != NULL) {
+        ++pendingLabelUses;
+        *value = label->address;
+        return true;
+    }
+
+    if (allSymbolsDefined) {
+        fail(ExitCodeUndefinedLabel, "Error on line %d: label \"%s\" is undefined.\n", lineNumber, name);
+    }
+
+    return false;
+}
+
+/**
+ * Fills the buffer after its first `length` characters and returns its new
+ * length. When the buffer is filled with a single line ending in a comment,
+ * the rest of the comment is skipped, so that only its `;` is kept.
+ */
+static int readStream(int length) {
+    length += fread(streamBuffer + length, sizeof(char), STREAM_BUFFER_SIZE - length, sourceStream);
+
+    char* commentStart = length == STREAM_BUFFER_SIZE && memchr(streamBuffer, '\n', length) == NULL
+        ? findUnterminatedComment(streamBuffer, streamBuffer + length)
+        : NULL;
+
+    if (commentStart != NULL) {
+        length = commentStart + 1 - streamBuffer;
+        int character;
+        while ((character = fgetc(sourceStream)) != EOF && character != '\n') {}
+        if (character == '\n') {
+            streamBuffer[length++] = '\n';
+            length += fread(streamBuffer + length, sizeof(char), STREAM_BUFFER_SIZE - length, sourceStream);
+        }
+    }
+
+    return length;
+}
+
+/// Moves the unread lines to the beginning of the buffer and reads as many whole lines as fit after them.
+static void refillStream() {
+    *streamEnd = streamEndCharacter;
+    int length = streamEnd + streamPartialLineLength - sourceString;
+    memmove(streamBuffer, sourceString, length);
+    length = readStream(length);
+
+    sourceString = streamBuffer;
+    streamEnd = streamBuffer + length;
+    streamFinished = length < STREAM_BUFFER_SIZE;
+
+    while (!streamFinished && streamEnd > streamBuffer && streamEnd[-1] != '\n') {
+        --streamEnd;
+    }
+
+    // A literal spanning lines which weren't read yet ends the buffer, so that it's read again from its start
+    char* literalStart = streamFinished ? NULL : findUnterminatedLiteral(streamBuffer, streamEnd);
+    if (literalStart != NULL) {
+        streamEnd = literalStart;
+    }
+
+    if (streamEnd == streamBuffer && !streamFinished) {
+        fail(ExitCodeStreamedStatementTooLong, "Error on line %d: line is too long to be assembled from a stream.\n", lineNumber);
+    }
+
+    streamPartialLineLength = streamBuffer + length - streamEnd;
+    streamEndCharacter = *streamEnd;
+    *streamEnd = 0;
+}
+
+/**
+ * Reads the next token from the stream, refilling the buffer when less than
+ * the lookahead is left, and copies it, so that it stays valid until the
+ * next statement.
+ */
+static struct Token getStreamedToken() {
+    struct Token token;
+
+    do {
+        if (!streamFinished && streamEnd - sourceString < STREAM_LOOKAHEAD) {
+            refillStream();
+        }
+        token = getToken(&sourceString, &lineNumber);
+    } while (token.value == NULL && !streamFinished);
+
+    if (token.value == NULL) {
+        return token;
+    }
+
+    // Since the buffer ends with a line break or a literal, a token reaching its end spans lines which weren't read yet
+    if ((token.value + token.length == streamEnd && !streamFinished) || statementTokensLength + token.length >= STREAM_BUFFER_SIZE) {
+        fail(ExitCodeStreamedStatementTooLong, "Error on line %d: statement is too long to be assembled from a stream.\n", token.lineNumber);
+    }
+
+    char* copy = statementTokens + statementTokensLength;
+    memcpy(copy, token.value, token.length + 1);
+    statementTokensLength += token.length + 1;
+    token.value = copy;
+
+    return token;
+}
+
+static struct Token getLexedToken() {
+    if (lexedTokenIndex < lexedSource->tokensCount) {
+        lineNumber = lexedSource->tokens[lexedTokenIndex].nextLineNumber;
+        return lexedSource->tokens[lexedTokenIndex++].token;
+    }
+
+    if (lexedSource->exitCode != ExitCodeSuccess) {
+        fail(lexedSource->exitCode, "%s", lexedSource->errorMessage);
+    }
+
+    lineNumber = lexedSource->endLineNumber;
+    return (struct Token) { lineNumber, 0, NULL };
 }
 
 static struct Token getNextToken() {
-    return getToken(&sourceString, &lineNumber);
+    struct Token token = sourceStream != NULL ? getStreamedToken() : lexedSource != NULL ? getLexedToken() : getToken(&sourceString, &lineNumber);
+    if (token.value != NULL) {
+        ++result.statistics.tokens;
+    }
+    return token;
 }
 
 static struct Token getNextNonEmptyToken() {
     struct Token result = getNextToken();
     if (result.value == NULL) {
-        printf("Error on line %d: unexpected end of file.\n", lineNumber);
-        exit(ExitCodeUnexpectedEndOfFile);
+        fail(ExitCodeUnexpectedEndOfFile, "Error on line %d: unexpected end of file.\n", lineNumber);
     }
     return result;
 }
 
-static bool isValidLabelDefinitionRemoveColon(struct Token token) {
-    if (token.value[--token.length] != ':') {
-        return false;
-    }
-
-    token.value[token.length] = 0; // Trim the trailing colon character
-
+static void assertValidUniqueSymbolName(struct Token token) {
     if (token.length > MAX_LABEL_NAME_LEN_INCL_0 - 1) {
-        printf("Error on line %d: label name too long.\n", token.lineNumber);
-        exit(ExitCodeLabelNameTooLong);
+        fail(ExitCodeLabelNameTooLong, "Error on line %d: label name too long.\n", token.lineNumber);
     }
 
     for (int i = 0; i < token.length; ++i) {
         char ch = token.value[i];
         bool characterValid = ch == '_' || ch >= 'a' && ch <= 'z' || ch >= 'A' && ch <= 'Z' || i > 0 && ch >= '0' && ch <= '9';
         if (!characterValid) {
-            printf("Error on line %d: \"%s\" is not a valid label name.\n", token.lineNumber, token.value);
-            exit(ExitCodeInvalidLabelName);
+            fail(ExitCodeInvalidLabelName, "Error on line %d: \"%s\" is not a valid label name.\n", token.lineNumber, token.value);
         }
     }
 
-    for (int i = 0; i < labelDefinitionsCount; ++i) {
-        if (strcmp(labelDefinitions[i].name, token.value) == 0) {
-            printf("Error on line %d: label name \"%s\" is not unique.\n", token.lineNumber, token.value);
-            exit(ExitCodeLabelNameNotUnique);
-        }
+    if (findLabelDefinition(token.value) != NULL || findConstantDefinition(token.value) != NULL) {
+        fail(ExitCodeLabelNameNotUnique, "Error on line %d: label name \"%s\" is not unique.\n", token.lineNumber, token.value);
+    }
+}
+
+static bool isValidLabelDefinitionRemoveColon(struct Token token) {
+    if (token.value[--token.length] != ':') {
+        return false;
     }
 
+    token.value[token.length] = 0; // Trim the trailing colon character
+
+    assertValidUniqueSymbolName(token);
+
     return true;
 }
 
-static int parseNumberLiteral(struct Token token, enum NumberLiteralRange range) {
-    char* endChar;
-    int result = strtol(token.value, &endChar, 0);
+static void failUnevaluatedExpression(struct Token token) {
+    fail(ExitCodeUndefinedLabel, "Error on line %d: \"%s\" can't be evaluated before all labels and constants it uses are defined.\n", token.lineNumber, token.value);
+}
 
-    if (errno  != 0 || *endChar != 0) {
-        printf("Error on line %d: \"%s\" is not a valid number.\n", token.lineNumber, token.value);
-        exit(ExitCodeInvalidNumberLiteral);
-    }
+/// Evaluates an expression whose symbols must already be defined, such as a directive argument.
+static int evaluateExpressionNow(struct Token token) {
+    struct ExpressionEvaluationResult evaluated = evaluateCountingLabelUses(token.value, token.lineNumber);
 
-    if (range == NumberLiteralRangeByte) {
-        if (result < CHAR_MIN || result > UCHAR_MAX) {
-            printf("Error on line %d: number %d is out of range.\n", token.lineNumber, result);
-            exit(ExitCodeNumberLiteralOutOutRange);
-        }
-    } else if (range == NumberLiteralRangeAddress) {
-        if (result < 0 || result >= ADDRESS_SPACE_SIZE) {
-            printf("Error on line %d: attempting to reference invalid address 0x%04X.\n", token.lineNumber, result);
-            exit(ExitCodeReferenceToInvalidAddress);
-        } 
+    if (!evaluated.resolved) {
+        failUnevaluatedExpression(token);
     }
-    return result;
+
+    return evaluated.value;
 }
 
-static struct LabelUseParseResult parseLabelUse(struct Token token) {
-    char* offsetSign = strpbrk(token.value, "+-");
-    int offset = 0;
-    if (offsetSign != NULL) {
-        offset = parseNumberLiteral((struct Token) { token.lineNumber, 0, offsetSign }, NumberLiteralRangeNone);
-        *offsetSign = 0;
-    }
-    return (struct LabelUseParseResult) { token.value, offset };
-}
-
-static bool isHexDigit(char character) {
-    return character >= '0' && character <= '9' || character >= 'a' && character <= 'z' || character >= 'A' && character <= 'Z';
-}
-
-static struct EscapeSequenceParseResult parseEscapeSequence(struct Token token) {
-    switch (token.value[1]) {
-        case 'n': 
-        case 'N':
-            return (struct EscapeSequenceParseResult) { '\n', 2 };
-        case 't': 
-        case 'T': 
-            return (struct EscapeSequenceParseResult) { '\t', 2 };
-        case 'r': 
-        case 'R': 
-            return (struct EscapeSequenceParseResult) { '\r', 2 };
-        case '\'':
-            return (struct EscapeSequenceParseResult) { '\'', 2 };
-        case '"':
-            return (struct EscapeSequenceParseResult) { '"', 2 };
-        case '\\':
-            return (struct EscapeSequenceParseResult) { '\\', 2 };
-        case 'x':
-        case 'X':
-            if (!isHexDigit(token.value[2]) || !isHexDigit(token.value[3])) {
-                printf("Error on line %d: invalid escape sequence starting with \"\\%c\".\n", token.lineNumber, token.value[1]);
-                exit(ExitCodeInvalidEscapeSequence);
-            }
-            char numberString[5] = "0x00";
-            numberString[2] = token.value[2];
-            numberString[3] = token.value[3];
-            unsigned char number = parseNumberLiteral((struct Token) { token.lineNumber, 5, numberString }, NumberLiteralRangeNone);
-            return (struct EscapeSequenceParseResult) { number, 4 };
-        default:
-            printf("Error on line %d: invalid escape sequence \"\\%c\".\n", token.lineNumber, token.value[1]);
-            exit(ExitCodeInvalidEscapeSequence);
+static int assertValidAddress(char* expression, int address, int lineNumber) {
+    if (!isValidAddress(address)) {
+        fail(ExitCodeReferenceToInvalidAddress, "Error on line %d: \"%s\" evaluates to %d, which is an invalid address.\n", lineNumber, expression, address);
     }
+
+    return address;
 }
 
-static unsigned char parseCharacterLiteral(struct Token token) {
-    char* fullTokenValue = token.value;
+static unsigned char assertValidByte(char* expression, int value, int lineNumber) {
+    if (value >= CHAR_MIN && value <= UCHAR_MAX) {
+        return value;
+    }
 
-    bool isNegative = token.value[0] == '-';
+    if (isCharacterLiteral(expression)) {
+        fail(ExitCodeCharacterLiteralOutOutRange, "Error on line %d: character literal \"%s\" evaluates to %d, which is out of range.\n", lineNumber, expression, value);
+    } else {
+        fail(ExitCodeNumberLiteralOutOutRange, "Error on line %d: number %d is out of range.\n", lineNumber, value);
+    }
+}
 
-    if (isNegative) {
-        ++token.value;
+static void applyFixup(struct Fixup* fixup, int value) {
+    switch (fixup->kind) {
+        case FixupKindInstructionArgument:
+            assertValidAddress(fixup->expression, value, fixup->lineNumber);
+            addInstructionArgument(result.programMemory, fixup->address, value);
+            break;
+        case FixupKindAddressByte:
+            assertValidAddress(fixup->expression, value, fixup->lineNumber);
+            result.programMemory[fixup->address] = value >> (fixup->byte * 8);
+            result.isAddressInData[value] = true;
+            break;
+        case FixupKindValue:
+            result.programMemory[fixup->address] = assertValidByte(fixup->expression, value, fixup->lineNumber);
+            break;
     }
+}
 
-    int charLength = 1;
-    int character = (isNegative ? -1 : 1) * token.value[1];
-    if (token.value[1] == '\\') {
-        struct EscapeSequenceParseResult parsed = parseEscapeSequence((struct Token) { token.lineNumber, 0, token.value + 1 });
-        character = (isNegative ? -1 : 1) * parsed.character;
-        charLength = parsed.length;
+static bool isSymbolName(char* string) {
+    for (int i = 0; string[i] != 0; ++i) {
+        char ch = string[i];
+        if (!(ch == '_' || (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (i > 0 && ch >= '0' && ch <= '9'))) {
+            return false;
+        }
     }
+    return string[0] != 0;
+}
 
-    if (token.value[0] != '\''
-        || token.value[charLength + 1] != '\''
-        || !(token.value[charLength + 2] == '+'
-            || token.value[charLength + 2] == '-'
-            || token.value[charLength + 2] == 0)) {
-        printf("Error on line %d: \"%s\" is not a valid character literal.\n", token.lineNumber, fullTokenValue);
-        exit(ExitCodeInvalidCharacterLiteral);
+static struct ForwardReference* findForwardReference(char* name) {
+    for (int i = 0; i < forwardReferencesCount; ++i) {
+        if (strcmp(forwardReferences[i].name, name) == 0) {
+            return &forwardReferences[i];
+        }
     }
 
-    if (token.value[charLength + 2] == 0) {
-        return character;
+    return NULL;
+}
+
+/// Whether the argument is a label which isn't defined yet, and can be linked into a chain of forward references.
+static bool isForwardReference(struct Token token) {
+    return sourceStream != NULL && token.length < MAX_LABEL_NAME_LEN_INCL_0 && isSymbolName(token.value) && findConstantDefinition(token.value) == NULL;
+}
+
+/// Links the argument of the instruction at `address` into the chain of uses of the label.
+static void addForwardReference(struct Token token, int address) {
+    struct ForwardReference* reference = findForwardReference(token.value);
+
+    if (reference == NULL) {
+        assertCanAddFixup(token.lineNumber);
+        reference = &forwardReferences[forwardReferencesCount++];
+        strcpy(reference->name, token.value);
+        reference->lastUseAddress = CHAIN_END;
     }
 
-    int offset = parseNumberLiteral((struct Token) { token.lineNumber, 0, token.value + charLength + 2 }, NumberLiteralRangeNone);
-    int result = character + offset;
+    addInstructionArgument(result.programMemory, address, reference->lastUseAddress);
+    reference->lastUseAddress = address;
+    reference->lineNumber = token.lineNumber;
+    ++result.statistics.fixups;
+}
+
+/// Replaces the links of the chain with the value of the label, and removes the reference.
+static void patchForwardReference(struct ForwardReference* reference, int value) {
+    assertValidAddress(reference->name, value, reference->lineNumber);
 
-    if (result < CHAR_MIN || result > UCHAR_MAX) {
-        printf("Error on line %d: character literal \"%s\" evaluates to %d, which is out of range.\n", token.lineNumber, token.value, result);
-        exit(ExitCodeCharacterLiteralOutOutRange);
+    for (int address = reference->lastUseAddress; address != CHAIN_END;) {
+        InstructionWord instruction = loadInstruction(result.programMemory, address);
+        int nextAddress = getInstructionArgument(instruction);
+        storeInstruction(result.programMemory, address, encodeInstruction(getInstructionOpcode(instruction), value));
+        ++result.statistics.labelUses;
+        address = nextAddress;
     }
 
-    return result;
- }
+    *reference = forwardReferences[--forwardReferencesCount];
+}
+
+/// Patches the forward references to the labels defined by the last statement, whose addresses are now final.
+static void patchForwardReferencesToLabels(int labelDefinitionsStartIndex) {
+    for (int i = labelDefinitionsStartIndex; i < labelDefinitionsCount && forwardReferencesCount > 0; ++i) {
+        struct ForwardReference* reference = findForwardReference(labelDefinitions[i].name);
+        if (reference != NULL && labelDefinitions[i].address != PENDING_ADDRESS) {
+            patchForwardReference(reference, labelDefinitions[i].address);
+        }
+    }
+}
+
+/// Applies the value of the expression immediately if possible, otherwise defers it until `resolveLabels`.
+static void applyOrDeferExpression(struct Token token, enum FixupKind kind, int byte, int address) {
+    struct Fixup fixup = (struct Fixup) { token.value, kind, byte, token.lineNumber, address };
+    struct ExpressionEvaluationResult evaluated = evaluateCountingLabelUses(token.value, token.lineNumber);
 
-static void insertInstruction(enum Instruction instruction) {
-    assertNoMemoryViolation(currentAddress, lineNumber);
-    assertNoMemoryViolation(currentAddress + 1, lineNumber);
+    if (evaluated.resolved) {
+        applyFixup(&fixup, evaluated.value);
+    } else if (kind == FixupKindInstructionArgument && isForwardReference(token)) {
+        addForwardReference(token, address);
+    } else {
+        fixup.expression = keepString(token.value);
+        assertCanAddFixup(token.lineNumber);
+        fixups[fixupsCount++] = fixup;
+        ++result.statistics.fixups;
+    }
+}
+
+/// Declares the instruction at the current address with the given argument, and returns its address.
+static int declareInstruction(enum Instruction instruction, int argument, int lineNumber) {
+    for (int i = 0; i < INSTRUCTION_SIZE; ++i) {
+        assertNoMemoryViolation(currentAddress + i, lineNumber);
+    }
     result.dataType[currentAddress] = DataTypeInstruction;
+    storeInstruction(result.programMemory, currentAddress, encodeInstruction((enum Opcode) instruction, argument));
 
-    unsigned short instructionCode = instruction << 13;
-    struct Token param = getNextNonEmptyToken();
+    currentAddress += INSTRUCTION_SIZE;
+    return currentAddress - INSTRUCTION_SIZE;
+}
+
+static void addImmediateValueUse(struct Token token, bool isAllocated, bool isCreated, int address) {
+    assertCanAddImmediateValue(token.lineNumber);
+    immediateValueUses[immediateValueUsesCount++] = (struct ImmediateValueUse) { token, address, isAllocated, isCreated };
+    ++result.statistics.immediateValueUses;
+}
+
+static void emitInstruction(enum Instruction instruction, struct Token param, int lineNumber) {
+    int address = declareInstruction(instruction, 0, lineNumber);
 
-    if (isNumberLiteral(param.value)) {
-        int paramValue = parseNumberLiteral(param, NumberLiteralRangeAddress);
-        instructionCode |= paramValue;
-    } else if (!isImmediateValue(param.value)) {
-        assertCanAddLabelUses(2, param.lineNumber);
-        struct LabelUseParseResult labelUse = parseLabelUse(param);
-        labelUses[labelUsesCount++] =
-            (struct LabelUse) { labelUse.name, labelUse.offset, 0, param.lineNumber, currentAddress };
-        labelUses[labelUsesCount++] =
-            (struct LabelUse) { labelUse.name, labelUse.offset, 1, param.lineNumber, currentAddress + 1 };
+    if (!isImmediateValue(param.value)) {
+        applyOrDeferExpression(param, FixupKindInstructionArgument, 0, address);
     } else {
-        assertCanAddImmediateValue(param.lineNumber);
         if (!instructionAcceptsImmediateValue(instruction)) {
-            printf("Error on line %d: instruction \"%s\" does not accept an immediate value as an argument.\n", param.lineNumber, getInstructionName(instruction));
-            exit(ExitCodeInvalidInstructionArgument);
+            fail(ExitCodeInvalidInstructionArgument, "Error on line %d: instruction \"%s\" does not accept an immediate value as an argument.\n", param.lineNumber, getInstructionName(instruction));
         }
-        immediateValueUses[immediateValueUsesCount++] = (struct ImmediateValueUse) { param, currentAddress };
+        param.value = keepString(param.value);
+        addImmediateValueUse(param, sourceStream != NULL, false, address);
+    }
+}
+
+/// Emits the instruction with an immediate value created by the assembler, whose expression is allocated on the heap.
+static void emitCreatedImmediateValue(enum Instruction instruction, struct Token value, int lineNumber) {
+    addImmediateValueUse(value, true, true, declareInstruction(instruction, 0, lineNumber));
+}
+
+/// Emits an instruction whose argument is a scratch cell or a table, which is declared along with immediate values.
+static void emitPoolEntryInstruction(enum Instruction instruction, int entry, int lineNumber) {
+    if (poolEntryAddresses[entry] >= 0) {
+        declareInstruction(instruction, poolEntryAddresses[entry], lineNumber);
+        return;
+    }
+
+    poolEntryUses[poolEntryUsesCount++] = (struct PoolEntryUse) { entry, declareInstruction(instruction, 0, lineNumber) };
+}
+
+/// Returns an immediate value whose expression is the format applied to the expression of the immediate value `param`.
+static struct Token deriveImmediateValue(struct Token param, const char* format) {
+    int size = strlen(format) + param.length;
+    char* value = malloc(size);
+    snprintf(value, size, format, param.value + 1);
+    return (struct Token) { param.lineNumber, strlen(value), value };
+}
+
+/// Returns an immediate value of the byte, whose expression is kept for the lifetime of the thread, like the source.
+static struct Token createImmediateValue(unsigned char value, int lineNumber) {
+    static _Thread_local char expressions[0x100][sizeof("#255")];
+    char* string = expressions[value];
+    snprintf(string, sizeof(expressions[value]), "#%d", value);
+    return (struct Token) { lineNumber, strlen(string), string };
+}
+
+/**
+ * Stores the return address in the JMP of the subroutine's RET, which is
+ * patched in `resolveSubroutines`, keeping A for the subroutine. The two
+ * bytes of the jump, whose second byte includes the opcode of JMP on W13,
+ * are immediate values.
+ */
+static void emitCall(struct Token param, int lineNumber) {
+    if (!isSymbolName(param.value)) {
+        fail(ExitCodeInvalidInstructionArgument, "Error on line %d: instruction \"CALL\" requires a label name as an argument.\n", param.lineNumber);
+    }
+
+    InstructionWord returnJump = encodeInstruction(OpcodeJmp, currentAddress + CALL_LENGTH);
+    assertCanAddSubroutineEvent(lineNumber);
+    emitPoolEntryInstruction(InstructionSt, 0, lineNumber);
+    emitInstruction(InstructionLd, createImmediateValue(returnJump & 0xFF, param.lineNumber), lineNumber);
+    int storeAddress = declareInstruction(InstructionSt, 0, lineNumber);
+    emitInstruction(InstructionLd, createImmediateValue(returnJump >> 8 & 0xFF, param.lineNumber), lineNumber);
+    declareInstruction(InstructionSt, 0, lineNumber);
+    emitPoolEntryInstruction(InstructionLd, 0, lineNumber);
+    emitInstruction(InstructionJmp, param, lineNumber);
+
+    subroutineEvents[subroutineEventsCount++] = (struct SubroutineEvent) {
+        false, labelDefinitionsCount, storeAddress, keepString(param.value), lineNumber
+    };
+}
+
+static void emitReturn(int lineNumber) {
+    assertCanAddSubroutineEvent(lineNumber);
+    subroutineEvents[subroutineEventsCount++] = (struct SubroutineEvent) {
+        true, labelDefinitionsCount, declareInstruction(InstructionJmp, 0, lineNumber), NULL, lineNumber
+    };
+}
+
+/**
+ * Emits the shortest known sequence for the pseudo-instruction. The sequences
+ * only differ by the goal for SHL, which can look the result up in a table
+ * in 2 instructions, at the cost of 256 bytes.
+ */
+static void expandPseudoInstruction(enum Instruction instruction, struct Token param, int lineNumber) {
+    struct Token one = (struct Token) { param.lineNumber, 2, "#1" };
+    bool isImmediate = isImmediateValue(param.value);
+    int startAddress = currentAddress;
+
+    if (isImmediate && (instruction == InstructionShl || instruction == InstructionCall)) {
+        fail(ExitCodeInvalidInstructionArgument, "Error on line %d: instruction \"%s\" does not accept an immediate value as an argument.\n", param.lineNumber, getInstructionName(instruction));
+    }
+
+    switch (instruction) {
+        case InstructionSub: // A - X = A + ~X + 1
+        case InstructionCmp:
+            if (isImmediate) {
+                emitCreatedImmediateValue(InstructionAdd, deriveImmediateValue(param, "#(-(%s)&0xFF)"), lineNumber);
+            } else {
+                emitPoolEntryInstruction(InstructionSt, 0, lineNumber);
+                emitInstruction(InstructionNot, param, lineNumber);
+                emitInstruction(InstructionAdd, one, lineNumber);
+                emitPoolEntryInstruction(InstructionAdd, 0, lineNumber);
+            }
+            break;
+        case InstructionOr: // A | X = (A & ~X) + X
+            if (isImmediate) {
+                emitCreatedImmediateValue(InstructionAnd, deriveImmediateValue(param, "#(~(%s)&0xFF)"), lineNumber);
+            } else {
+                emitPoolEntryInstruction(InstructionSt, 0, lineNumber);
+                emitInstruction(InstructionNot, param, lineNumber);
+                emitPoolEntryInstruction(InstructionAnd, 0, lineNumber);
+            }
+            emitInstruction(InstructionAdd, param, lineNumber);
+            break;
+        case InstructionXor: // A ^ X = (A & ~X) + (~A & X)
+            emitPoolEntryInstruction(InstructionSt, 0, lineNumber);
+            if (isImmediate) {
+                emitCreatedImmediateValue(InstructionAnd, deriveImmediateValue(param, "#(~(%s)&0xFF)"), lineNumber);
+            } else {
+                emitInstruction(InstructionNot, param, lineNumber);
+                emitPoolEntryInstruction(InstructionAnd, 0, lineNumber);
+            }
+            emitPoolEntryInstruction(InstructionSt, 1, lineNumber);
+            emitPoolEntryInstruction(InstructionNot, 0, lineNumber);
+            emitInstruction(InstructionAnd, param, lineNumber);
+            emitPoolEntryInstruction(InstructionAdd, 1, lineNumber);
+            break;
+        case InstructionShl: {
+            int count = evaluateExpressionNow(param);
+            if (count < 1 || count > 7) {
+                fail(ExitCodeInvalidInstructionArgument, "Error on line %d: invalid shift argument \"%d\". Must be between 1 and 7.\n", param.lineNumber, count);
+            }
+            if (expansionGoal == ExpansionGoalSpeed && count > 1) {
+                // Stores A as the least significant byte of the next instruction's argument, which points to a 256-byte aligned table
+                declareInstruction(InstructionSt, currentAddress + INSTRUCTION_SIZE, lineNumber);
+                emitPoolEntryInstruction(InstructionLd, SCRATCH_CELLS_COUNT + count, lineNumber);
+            } else {
+                for (int i = 0; i < count; ++i) {
+                    emitPoolEntryInstruction(InstructionSt, 0, lineNumber);
+                    emitPoolEntryInstruction(InstructionAdd, 0, lineNumber);
+                }
+            }
+            break;
+        }
+        case InstructionCall:
+            emitCall(param, lineNumber);
+            break;
+        case InstructionRet:
+            emitReturn(lineNumber);
+            break;
+        default:
+            break;
+    }
+
+    result.expansions[result.expansionsCount++] = (struct Expansion) {
+        lineNumber, startAddress, (currentAddress - startAddress) / INSTRUCTION_SIZE, getInstructionName(instruction), keepString(param.value)
+    };
+}
+
+/// `lineNumber` is the line of the mnemonic, since RET takes no argument and the tokenizer may already be past its line.
+static void insertInstruction(enum Instruction instruction, int lineNumber) {
+    struct Token param = instruction == InstructionRet ? (struct Token) { lineNumber, 0, "" } : getNextNonEmptyToken();
+
+    if (instruction > InstructionJmz) {
+        expandPseudoInstruction(instruction, param, lineNumber);
+    } else {
+        emitInstruction(instruction, param, lineNumber);
     }
-    result.programMemory[currentAddress++] = instructionCode;
-    result.programMemory[currentAddress++] = instructionCode >> 8;
 }
 
 static void updateCurrentAddress(int newAddress, int lineNumber, int labelDefinitionsStartIndex) {
-    if (newAddress < 0 || newAddress >= ADDRESS_SPACE_SIZE) {
-        printf("Error on line %d: attempting to set origin to an invalid address 0x%04X.\n", lineNumber, newAddress);
-        exit(ExitCodeOriginOutOfMemoryRange);
+    if (!isValidAddress(newAddress)) {
+        fail(ExitCodeOriginOutOfMemoryRange, "Error on line %d: attempting to set origin to an invalid address 0x%04X.\n", lineNumber, newAddress);
     }
     currentAddress = newAddress;
     for (int i = labelDefinitionsStartIndex; i < labelDefinitionsCount; ++i) {
@@ -418,16 +968,15 @@ static void updateCurrentAddress(int newAddress, int lineNumber, int labelDefini
 
 static void applyOrgDirective(int labelDefinitionsStartIndex) {
     struct Token param = getNextNonEmptyToken();
-    int paramValue = parseNumberLiteral(param, NumberLiteralRangeNone);
+    int paramValue = evaluateExpressionNow(param);
     updateCurrentAddress(paramValue, param.lineNumber, labelDefinitionsStartIndex);
 }
 
 static void applyAlignDirective(int labelDefinitionsStartIndex) {
     struct Token param = getNextNonEmptyToken();
-    int paramValue = parseNumberLiteral(param, NumberLiteralRangeNone);
+    int paramValue = evaluateExpressionNow(param);
     if (paramValue < 1 || paramValue > 12) {
-        printf("Error on line %d: invalid align argument \"%d\". Must be between 1 and 12.\n", param.lineNumber, paramValue);
-        exit(ExitCodeInvalidDirectiveArgument);
+        fail(ExitCodeInvalidDirectiveArgument, "Error on line %d: invalid align argument \"%d\". Must be between 1 and 12.\n", param.lineNumber, paramValue);
     }
     unsigned short bitsToReset = (1 << paramValue) - 1;
     int newAddress = (currentAddress & bitsToReset) == 0
@@ -440,24 +989,16 @@ static void applyFillDirective() {
     struct Token valueParam = getNextNonEmptyToken();
     struct Token countParam = getNextNonEmptyToken();
 
-    unsigned char value, count;
-    enum DataType valueToFillType;
-    
-    if (isCharacterLiteral(valueParam.value)) {
-        valueToFillType = DataTypeChar;
-        value = parseCharacterLiteral(valueParam);
-    } else if (isNumberLiteral(valueParam.value)) {
-        valueToFillType = DataTypeInt;
-        value = parseNumberLiteral(valueParam, NumberLiteralRangeByte);
-    } else {
-        printf("Error on line %d: \"%s\" is neither a character nor a number.\n", valueParam.lineNumber, valueParam.value);
-        exit(ExitCodeInvalidDirectiveArgument);
+    if (isStringLiteral(valueParam.value)) {
+        fail(ExitCodeInvalidDirectiveArgument, "Error on line %d: \"%s\" is neither a character nor a number.\n", valueParam.lineNumber, valueParam.value);
     }
 
-    count = parseNumberLiteral(countParam, NumberLiteralRangeNone);
+    enum DataType valueToFillType = isCharacterLiteral(valueParam.value) ? DataTypeChar : DataTypeInt;
+    unsigned char value = assertValidByte(valueParam.value, evaluateExpressionNow(valueParam), valueParam.lineNumber);
+
+    int count = evaluateExpressionNow(countParam);
     if (count < 1) {
-        printf("Error on line %d: fill count must be positive.\n", countParam.lineNumber);
-        exit(ExitCodeInvalidDirectiveArgument);
+        fail(ExitCodeInvalidDirectiveArgument, "Error on line %d: fill count must be positive.\n", countParam.lineNumber);
     }
 
     for (int i = 0; i < count; ++i) {
@@ -469,52 +1010,320 @@ static void applyFillDirective() {
 
 static void applyLsbOrMsbDirective(enum Directive directive) {
     struct Token param = getNextNonEmptyToken();
-    struct LabelUseParseResult labelUse = parseLabelUse(param);
     int byte = directive == DirectiveLsb ? 0 : 1;
     assertNoMemoryViolation(currentAddress, param.lineNumber);
     result.dataType[currentAddress] = DataTypeInt;
-    assertCanAddLabelUses(1, param.lineNumber);
-    labelUses[labelUsesCount++] =
-        (struct LabelUse) { labelUse.name, labelUse.offset, byte, param.lineNumber, currentAddress++ };
+    applyOrDeferExpression(param, FixupKindAddressByte, byte, currentAddress++);
+}
+
+/// Predicates evaluate to 0xFF if true, so that the result can be tested with both JMN and JMZ.
+static unsigned char computeTableValue(enum TableFunction function, int index, int argument) {
+    bool isUpper = index >= 'A' && index <= 'Z';
+    bool isLower = index >= 'a' && index <= 'z';
+    bool isDigit = index >= '0' && index <= '9';
+    int bitsSet = 0;
+    int reversed = 0;
+
+    for (int i = 0; i < 8; ++i) {
+        bitsSet += index >> i & 1;
+        reversed |= (index >> i & 1) << (7 - i);
+    }
+
+    switch (function) {
+        case TableFunctionShl: return index << argument;
+        case TableFunctionShr: return index >> argument;
+        case TableFunctionMul: return index * argument;
+        case TableFunctionPopcount: return bitsSet;
+        case TableFunctionReverse: return reversed;
+        case TableFunctionIsDigit: return isDigit ? 0xFF : 0;
+        case TableFunctionIsAlpha: return isUpper || isLower ? 0xFF : 0;
+        case TableFunctionIsAlnum: return isUpper || isLower || isDigit ? 0xFF : 0;
+        case TableFunctionIsUpper: return isUpper ? 0xFF : 0;
+        case TableFunctionIsLower: return isLower ? 0xFF : 0;
+        case TableFunctionIsSpace: return index == ' ' || (index >= '\t' && index <= '\r') ? 0xFF : 0;
+        case TableFunctionIsPunct: return index > ' ' && index < 0x7F && !isUpper && !isLower && !isDigit ? 0xFF : 0;
+        case TableFunctionToUpper: return isLower ? index - 0x20 : index;
+        case TableFunctionToLower: return isUpper ? index + 0x20 : index;
+        case TableFunctionInvalid: return 0;
+    }
+}
+
+static void declareTable(enum TableFunction function, int argument, int lineNumber) {
+    for (int i = 0; i < TABLE_SIZE; ++i) {
+        assertNoMemoryViolation(currentAddress, lineNumber);
+        result.dataType[currentAddress] = DataTypeInt;
+        result.programMemory[currentAddress++] = computeTableValue(function, i, argument);
+    }
+}
+
+/// Declares the scratch cell or the table after the immediate values, the tables aligned to 256 bytes.
+static void declarePoolEntry(int entry) {
+    if (entry >= SCRATCH_CELLS_COUNT) {
+        int alignmentMask = (1 << TABLE_ALIGNMENT_BITS) - 1;
+        currentAddress = (currentAddress + alignmentMask) & ~alignmentMask;
+    }
+
+    if (currentAddress >= ADDRESS_SPACE_SIZE) {
+        fail(ExitCodeImmediateValueDeclarationOutOfMemoryRange, "Error on line %d: can't add scratch cells and tables of pseudo-instructions after the last explicit value declaration due to insufficient space.\n", lineNumber);
+    }
+
+    assertCanAddLabelDefinition(lineNumber);
+    labelDefinitions[labelDefinitionsCount++] = (struct LabelDefinition) { keepString(poolEntryNames[entry]), currentAddress };
+    poolEntryAddresses[entry] = currentAddress;
+
+    if (entry >= SCRATCH_CELLS_COUNT) {
+        declareTable(TableFunctionShl, entry - SCRATCH_CELLS_COUNT, lineNumber);
+    } else {
+        assertNoMemoryViolation(currentAddress, lineNumber);
+        result.dataType[currentAddress] = DataTypeInt;
+        result.programMemory[currentAddress++] = 0;
+    }
+}
+
+static void resolvePoolEntries() {
+    bool isUsed[POOL_ENTRIES_COUNT] = { false };
+
+    for (int i = 0; i < poolEntryUsesCount; ++i) {
+        isUsed[poolEntryUses[i].entry] = true;
+    }
+
+    for (int entry = 0; entry < POOL_ENTRIES_COUNT; ++entry) {
+        if (isUsed[entry] && poolEntryAddresses[entry] < 0) {
+            declarePoolEntry(entry);
+        }
+    }
+
+    for (int i = 0; i < poolEntryUsesCount; ++i) {
+        addInstructionArgument(result.programMemory, poolEntryUses[i].address, poolEntryAddresses[poolEntryUses[i].entry]);
+    }
+
+    poolEntryUsesCount = 0;
+}
+
+/// Stores the characters of the string literal followed by 0, and returns their count including the 0.
+static int decodeString(struct Token token, unsigned char* characters) {
+    int length = 0;
+
+    for (int i = 1; i < token.length - 1; ++i) {
+        if (token.value[i] == '\\') {
+            struct EscapeSequenceParseResult parsed = parseEscapeSequence(token.value + i, token.lineNumber);
+            characters[length++] = parsed.character;
+            i += parsed.length - 1;
+        } else {
+            characters[length++] = token.value[i];
+        }
+    }
+
+    characters[length++] = 0;
+    return length;
+}
+
+static void declareCharacters(unsigned char* characters, int length, int lineNumber) {
+    for (int i = 0; i < length; ++i) {
+        assertNoMemoryViolation(currentAddress, lineNumber);
+        result.dataType[currentAddress] = DataTypeChar;
+        result.programMemory[currentAddress++] = characters[i];
+    }
+}
+
+static void declareString(struct Token token) {
+    declaredCharacters = malloc(token.length);
+    declareCharacters(declaredCharacters, decodeString(token, declaredCharacters), token.lineNumber);
+    free(declaredCharacters);
+    declaredCharacters = NULL;
+}
+
+/// Orders strings by their reversed characters, so that every string is followed by the strings it's a suffix of.
+static int compareReversedStrings(const void* a, const void* b) {
+    struct PooledString* string1 = *(struct PooledString**) a;
+    struct PooledString* string2 = *(struct PooledString**) b;
+
+    for (int i = 1; i <= string1->length && i <= string2->length; ++i) {
+        int difference = string1->characters[string1->length - i] - string2->characters[string2->length - i];
+        if (difference != 0) {
+            return difference;
+        }
+    }
+
+    return string1->length - string2->length;
+}
+
+static bool isSuffix(struct PooledString* suffix, struct PooledString* string) {
+    return suffix->length <= string->length
+        && memcmp(suffix->characters, string->characters + string->length - suffix->length, suffix->length) == 0;
+}
+
+/**
+ * Declares the strings which aren't suffixes of other pooled strings in the
+ * order of the source, and defines the labels of every pooled string at its
+ * position in the tail of its owner.
+ */
+static void declarePooledStrings() {
+    static _Thread_local struct PooledString* sortedStrings[MAX_POOLED_STRINGS];
+
+    for (int i = 0; i < pooledStringsCount; ++i) {
+        sortedStrings[i] = &pooledStrings[i];
+    }
+
+    qsort(sortedStrings, pooledStringsCount, sizeof(struct PooledString*), compareReversedStrings);
+
+    for (int i = pooledStringsCount - 1; i >= 0; --i) {
+        bool hasOwner = i + 1 < pooledStringsCount && isSuffix(sortedStrings[i], sortedStrings[i + 1]);
+        sortedStrings[i]->owner = hasOwner ? sortedStrings[i + 1]->owner : sortedStrings[i];
+    }
+
+    for (int i = 0; i < pooledStringsCount; ++i) {
+        struct PooledString* string = &pooledStrings[i];
+
+        if (string->owner == string) {
+            if (currentAddress + string->length > ADDRESS_SPACE_SIZE) {
+                fail(ExitCodeImmediateValueDeclarationOutOfMemoryRange, "Error on line %d: can't add pooled strings after the last explicit value declaration due to insufficient space.\n", string->lineNumber);
+            }
+            string->address = currentAddress;
+            declareCharacters(string->characters, string->length, string->lineNumber);
+        } else {
+            result.statistics.pooledStringBytesSaved += string->length;
+        }
+    }
+
+    for (int i = 0; i < pooledStringsCount; ++i) {
+        struct PooledString* string = &pooledStrings[i];
+        int address = string->owner->address + string->owner->length - string->length;
+
+        for (int j = string->labelsStart; j < string->labelsEnd; ++j) {
+            labelDefinitions[j].address = address;
+            struct ForwardReference* reference = findForwardReference(labelDefinitions[j].name);
+            if (reference != NULL) {
+                patchForwardReference(reference, address);
+            }
+        }
+    }
+
+    for (int i = 0; i < pooledStringsCount; ++i) {
+        free(pooledStrings[i].characters);
+    }
+
+    pooledStringsCount = 0;
 }
 
 static void resolveImmediateValues() {
+    double start = getTimeMsIfEnabled();
+    int poolAddress = currentAddress;
+
+    declarePooledStrings();
+
+    if (immediateValueUsesCount > result.statistics.peakImmediateValueUses) {
+        result.statistics.peakImmediateValueUses = immediateValueUsesCount;
+    }
+
+    int deferredUsesCount = 0;
+
     for (int i = 0; i < immediateValueUsesCount; ++i) {
         struct Token token = immediateValueUses[i].token;
         struct Token valueToken = (struct Token) { token.lineNumber, token.length - 1, token.value + 1 };
+        struct ExpressionEvaluationResult evaluated = evaluateCountingLabelUses(valueToken.value, token.lineNumber);
+
+        if (!evaluated.resolved && !allSymbolsDefined) { // Uses a label defined later, so it's declared in a later pool
+            immediateValueUses[deferredUsesCount++] = immediateValueUses[i];
+            continue;
+        } else if (!evaluated.resolved) {
+            failUnevaluatedExpression(valueToken);
+        }
 
-        unsigned char value = isCharacterLiteral(valueToken.value)
-            ? parseCharacterLiteral(valueToken)
-            : parseNumberLiteral(valueToken, NumberLiteralRangeByte);
+        unsigned char value = assertValidByte(valueToken.value, evaluated.value, token.lineNumber);
         enum DataType dataType = isCharacterLiteral(valueToken.value) ? DataTypeChar : DataTypeInt;
         
-        if (labelNamesByImmediateValue[value] == NULL) {
+        if (labelNamesByImmediateValue[value] != NULL) {
+            ++result.statistics.immediatePoolHits;
+        } else {
+            ++result.statistics.immediatePoolMisses;
             if (currentAddress >= ADDRESS_SPACE_SIZE) {
-                printf("Error on line %d: can't add immediate values after the last explicit value declaration due to insufficient space.\n", lineNumber);
-                exit(ExitCodeImmediateValueDeclarationOutOfMemoryRange);
+                fail(ExitCodeImmediateValueDeclarationOutOfMemoryRange, "Error on line %d: can't add immediate values after the last explicit value declaration due to insufficient space.\n", lineNumber);
             }
             assertNoMemoryViolation(currentAddress, lineNumber);
             assertCanAddLabelDefinition(token.lineNumber);
-            labelNamesByImmediateValue[value] = token.value;
-            labelDefinitions[labelDefinitionsCount++] = (struct LabelDefinition) { token.value, currentAddress };
+            labelNamesByImmediateValue[value] = immediateValueUses[i].isCreated ? keepString(createImmediateValue(value, token.lineNumber).value) : token.value;
+            immediateValueAddresses[value] = currentAddress;
+            labelDefinitions[labelDefinitionsCount++] = (struct LabelDefinition) { labelNamesByImmediateValue[value], currentAddress };
             result.dataType[currentAddress] = dataType;
             result.programMemory[currentAddress++] = value;
         }
 
-        assertCanAddLabelUses(2, token.lineNumber);
-        labelUses[labelUsesCount++] =
-            (struct LabelUse) { labelNamesByImmediateValue[value], 0, 0, token.lineNumber, immediateValueUses[i].address };
-        labelUses[labelUsesCount++] =
-            (struct LabelUse) { labelNamesByImmediateValue[value], 0, 1, token.lineNumber, immediateValueUses[i].address + 1 };
+        addInstructionArgument(result.programMemory, immediateValueUses[i].address, immediateValueAddresses[value]);
+
+        if (immediateValueUses[i].isAllocated && labelNamesByImmediateValue[value] != token.value) {
+            free(token.value);
+        }
+        immediateValueUses[i].isAllocated = false; // Freed, or kept by the result as a label name
     }
 
-    immediateValueUsesCount = 0;
+    immediateValueUsesCount = deferredUsesCount;
+    resolvePoolEntries();
+
+    if (currentAddress > poolAddress && result.immediatePoolsCount < MAX_IMMEDIATE_POOLS) {
+        result.immediatePools[result.immediatePoolsCount++] = (struct ImmediatePool) { poolAddress, currentAddress - poolAddress };
+    }
+    result.statistics.resolveImmediateValuesMs += getTimeMsIfEnabled() - start;
+}
+
+/// Defers declaring the string until the immediate values are declared, leaving its labels undefined until then.
+static void applyPoolDirective(int labelDefinitionsStartIndex) {
+    struct Token stringParam = getNextNonEmptyToken();
+
+    if (!isStringLiteral(stringParam.value)) {
+        fail(ExitCodeInvalidDirectiveArgument, "Error on line %d: invalid pooled string \"%s\".\n", stringParam.lineNumber, stringParam.value);
+    }
+
+    assertCanAddPooledString(stringParam.lineNumber);
+    struct PooledString* string = &pooledStrings[pooledStringsCount++];
+    string->characters = malloc(stringParam.length);
+    string->length = decodeString(stringParam, string->characters);
+    string->lineNumber = stringParam.lineNumber;
+    string->labelsStart = labelDefinitionsStartIndex;
+    string->labelsEnd = labelDefinitionsCount;
+
+    for (int i = labelDefinitionsStartIndex; i < labelDefinitionsCount; ++i) {
+        labelDefinitions[i].address = PENDING_ADDRESS;
+    }
 }
 
 static void applyImmediatesDirective() {
     resolveImmediateValues();
 }
 
+/// Aligns the current address like `.ALIGN 8`, so that the index is the least significant byte of the address.
+static void applyTableDirective(int labelDefinitionsStartIndex) {
+    struct Token functionParam = getNextNonEmptyToken();
+    enum TableFunction function = getTableFunction(functionParam.value);
+    int argument = 0;
+
+    if (function == TableFunctionInvalid) {
+        fail(ExitCodeInvalidDirectiveArgument, "Error on line %d: \"%s\" is not a table function.\n", functionParam.lineNumber, functionParam.value);
+    }
+
+    if (tableFunctionHasArgument(function)) {
+        struct Token argumentParam = getNextNonEmptyToken();
+        argument = evaluateExpressionNow(argumentParam);
+        if (function != TableFunctionMul && (argument < 0 || argument > 7)) {
+            fail(ExitCodeInvalidDirectiveArgument, "Error on line %d: invalid shift argument \"%d\". Must be between 0 and 7.\n", argumentParam.lineNumber, argument);
+        }
+    }
+
+    int alignmentMask = (1 << TABLE_ALIGNMENT_BITS) - 1;
+    updateCurrentAddress((currentAddress + alignmentMask) & ~alignmentMask, functionParam.lineNumber, labelDefinitionsStartIndex);
+    declareTable(function, argument, functionParam.lineNumber);
+}
+
+static void applyEquDirective() {
+    struct Token name = getNextNonEmptyToken();
+    struct Token value = getNextNonEmptyToken();
+    assertValidUniqueSymbolName(name);
+    assertCanAddConstantDefinition(name.lineNumber);
+    ++result.statistics.constantDefinitions;
+    constantDefinitions[constantDefinitionsCount++] =
+        (struct ConstantDefinition) { keepString(name.value), keepString(value.value), value.lineNumber, ConstantStateUnevaluated, 0 };
+}
+
 static void applyDirective(enum Directive directive, int labelDefinitionsStartIndex) {
     switch (directive) {
         case DirectiveOrg: return applyOrgDirective(labelDefinitionsStartIndex);
@@ -523,37 +1332,17 @@ static void applyDirective(enum Directive directive, int labelDefinitionsStartIn
         case DirectiveLsb:
         case DirectiveMsb: return applyLsbOrMsbDirective(directive);
         case DirectiveImmediates: return applyImmediatesDirective();
+        case DirectiveEqu: return applyEquDirective();
+        case DirectiveTable: return applyTableDirective(labelDefinitionsStartIndex);
+        case DirectivePool: return applyPoolDirective(labelDefinitionsStartIndex);
         case DirectiveInvalid: break;
     }
 }
 
-static void declareString(struct Token token) {
-    for (int i = 1; i < token.length - 1; ++i) {
-        assertNoMemoryViolation(currentAddress, token.lineNumber);
-        result.dataType[currentAddress] = DataTypeChar;
-        if (token.value[i] == '\\') {
-            struct EscapeSequenceParseResult parsed = parseEscapeSequence((struct Token) { token.length, 0, token.value + i });
-            result.programMemory[currentAddress++] = parsed.character;
-            i += parsed.length - 1;
-        } else {
-            result.programMemory[currentAddress++] = token.value[i];
-        }
-    }
-    assertNoMemoryViolation(currentAddress, token.lineNumber);
-    result.dataType[currentAddress] = DataTypeChar;
-    result.programMemory[currentAddress++] = 0;
-}
-
-static void declareNumber(struct Token token) {
+static void declareValue(struct Token token) {
     assertNoMemoryViolation(currentAddress, token.lineNumber);
-    result.dataType[currentAddress] = DataTypeInt;
-    result.programMemory[currentAddress++] = parseNumberLiteral(token, NumberLiteralRangeByte);
-}
-
-static void declareCharacter(struct Token token) {
-    assertNoMemoryViolation(currentAddress, token.lineNumber);
-    result.dataType[currentAddress] = DataTypeChar;
-    result.programMemory[currentAddress++] = parseCharacterLiteral(token);
+    result.dataType[currentAddress] = isCharacterLiteral(token.value) ? DataTypeChar : DataTypeInt;
+    applyOrDeferExpression(token, FixupKindValue, 0, currentAddress++);
 }
 
 static struct Token parseLabelDefinitionsGetNextToken() {
@@ -563,7 +1352,8 @@ static struct Token parseLabelDefinitionsGetNextToken() {
         token = getNextToken();
         if (token.value != NULL && isValidLabelDefinitionRemoveColon(token)) {
             assertCanAddLabelDefinition(token.lineNumber);
-            labelDefinitions[labelDefinitionsCount++] = (struct LabelDefinition) { token.value, currentAddress };
+            ++result.statistics.labelDefinitions;
+            labelDefinitions[labelDefinitionsCount++] = (struct LabelDefinition) { keepString(token.value), currentAddress };
         } else {
             break;
         }
@@ -574,71 +1364,350 @@ static struct Token parseLabelDefinitionsGetNextToken() {
 
 /// Returns true if statement parsing should continue
 static bool parseStatement() {
+    statementTokensLength = 0;
     int labelDefinitionsStartIndex = labelDefinitionsCount;
     struct Token firstTokenAfterLabels = parseLabelDefinitionsGetNextToken();
 
     if (firstTokenAfterLabels.value == NULL) {
         if (labelDefinitionsCount > labelDefinitionsStartIndex) {
-            printf("Error on line %d: unexpected label definition at the end of the file.\n", lineNumber);
-            exit(ExitCodeUnexpectedEndOfFile);
+            fail(ExitCodeUnexpectedEndOfFile, "Error on line %d: unexpected label definition at the end of the file.\n", lineNumber);
         }
 
         return false;
     }
 
+    ++result.statistics.statements;
+
     enum Instruction instruction;
     enum Directive directive;
 
     if ((instruction = getInstruction(firstTokenAfterLabels.value)) != InstructionInvalid) {
-        insertInstruction(instruction);
+        insertInstruction(instruction, firstTokenAfterLabels.lineNumber);
     } else if ((directive = getDirective(firstTokenAfterLabels.value)) != DirectiveInvalid) {
         applyDirective(directive, labelDefinitionsStartIndex);
     } else if (isStringLiteral(firstTokenAfterLabels.value)) {
         declareString(firstTokenAfterLabels);
-    } else if (isNumberLiteral(firstTokenAfterLabels.value)) {
-        declareNumber(firstTokenAfterLabels);
-    } else if (isCharacterLiteral(firstTokenAfterLabels.value)) {
-        declareCharacter(firstTokenAfterLabels);
+    } else if (isValueExpression(firstTokenAfterLabels.value)) {
+        declareValue(firstTokenAfterLabels);
     } else {
-        printf("Error on line %d: invalid token \"%s\".\n", firstTokenAfterLabels.lineNumber, firstTokenAfterLabels.value);
-        exit(ExitCodeInvalidToken);
+        fail(ExitCodeInvalidToken, "Error on line %d: invalid token \"%s\".\n", firstTokenAfterLabels.lineNumber, firstTokenAfterLabels.value);
     }
 
+    patchForwardReferencesToLabels(labelDefinitionsStartIndex);
+
     return true;
 }
 
+static void patchJumpArgument(int address, int value, char* name, int lineNumber) {
+    struct Fixup fixup = (struct Fixup) { name, FixupKindInstructionArgument, 0, lineNumber, address };
+    applyFixup(&fixup, value);
+}
+
+/// Marks the subroutines reachable from `subroutine`, failing if any of them calls a subroutine which is being called.
+static void assertNoRecursiveCalls(int subroutine, int* callerByEvent, char* visitState) {
+    visitState[subroutine] = 1;
+
+    for (int i = 0; i < subroutineEventsCount; ++i) {
+        if (callerByEvent[i] != subroutine) {
+            continue;
+        }
+
+        int callee = findLabelDefinition(subroutineEvents[i].subroutineName) - labelDefinitions;
+        if (visitState[callee] == 1) {
+            fail(ExitCodeRecursiveCall, "Error on line %d: recursive call of subroutine \"%s\", whose return address would be overwritten.\n", subroutineEvents[i].lineNumber, subroutineEvents[i].subroutineName);
+        } else if (visitState[callee] == 0) {
+            assertNoRecursiveCalls(callee, callerByEvent, visitState);
+        }
+    }
+
+    visitState[subroutine] = 2;
+}
+
+/**
+ * Patches the CALLs to store the address of the JMP of the subroutine's
+ * return, and the other RETs to jump to the return of their subroutine.
+ * A CALL is made from the last subroutine defined before it, unless the
+ * subroutine has no RET after the CALL.
+ */
+static void resolveSubroutines() {
+    static _Thread_local bool isSubroutine[MAX_LABEL_DEFS];
+    static _Thread_local int lastSubroutineBefore[MAX_LABEL_DEFS + 1]; // By the number of preceding label definitions
+    static _Thread_local int returnEvent[MAX_LABEL_DEFS];
+    static _Thread_local int lastReturnEvent[MAX_LABEL_DEFS];
+    static _Thread_local int callerByEvent[MAX_SUBROUTINE_EVENTS];
+    static _Thread_local char visitState[MAX_LABEL_DEFS];
+
+    memset(isSubroutine, 0, sizeof(isSubroutine));
+    memset(returnEvent, -1, sizeof(returnEvent));
+    memset(lastReturnEvent, -1, sizeof(lastReturnEvent));
+    memset(visitState, 0, sizeof(visitState));
+
+    for (int i = 0; i < subroutineEventsCount; ++i) {
+        struct SubroutineEvent* event = &subroutineEvents[i];
+        struct LabelDefinition* label = event->isReturn ? NULL : findLabelDefinition(event->subroutineName);
+        if (!event->isReturn && label == NULL) {
+            fail(ExitCodeUndefinedLabel, "Error on line %d: subroutine \"%s\" is undefined.\n", event->lineNumber, event->subroutineName);
+        } else if (label != NULL) {
+            isSubroutine[label - labelDefinitions] = true;
+        }
+    }
+
+    lastSubroutineBefore[0] = -1;
+    for (int i = 0; i < labelDefinitionsCount; ++i) {
+        lastSubroutineBefore[i + 1] = isSubroutine[i] ? i : lastSubroutineBefore[i];
+    }
+
+    int nextSubroutineWithoutReturn = 0;
+    for (int i = 0; i < subroutineEventsCount; ++i) {
+        struct SubroutineEvent* event = &subroutineEvents[i];
+        if (!event->isReturn) {
+            continue;
+        }
+
+        for (; nextSubroutineWithoutReturn < event->labelsCount; ++nextSubroutineWithoutReturn) {
+            returnEvent[nextSubroutineWithoutReturn] = i;
+        }
+
+        int subroutine = lastSubroutineBefore[event->labelsCount];
+        if (subroutine < 0) {
+            fail(ExitCodeUnmatchedReturn, "Error on line %d: \"RET\" is not preceded by a subroutine label used by \"CALL\".\n", event->lineNumber);
+        }
+
+        lastReturnEvent[subroutine] = i;
+        if (returnEvent[subroutine] != i) {
+            patchJumpArgument(event->address, subroutineEvents[returnEvent[subroutine]].address, labelDefinitions[subroutine].name, event->lineNumber);
+        }
+    }
+
+    for (int i = 0; i < subroutineEventsCount; ++i) {
+        struct SubroutineEvent* event = &subroutineEvents[i];
+        callerByEvent[i] = -1;
+        if (event->isReturn) {
+            continue;
+        }
+
+        int subroutine = findLabelDefinition(event->subroutineName) - labelDefinitions;
+        if (returnEvent[subroutine] < 0) {
+            fail(ExitCodeUnmatchedReturn, "Error on line %d: subroutine \"%s\" is not followed by \"RET\".\n", event->lineNumber, event->subroutineName);
+        }
+
+        int returnAddress = subroutineEvents[returnEvent[subroutine]].address;
+        patchJumpArgument(event->address, returnAddress, event->subroutineName, event->lineNumber);
+        patchJumpArgument(event->address + 2 * INSTRUCTION_SIZE, returnAddress + 1, event->subroutineName, event->lineNumber);
+
+        int caller = lastSubroutineBefore[event->labelsCount];
+        callerByEvent[i] = caller >= 0 && lastReturnEvent[caller] > i ? caller : -1;
+    }
+
+    for (int i = 0; i < labelDefinitionsCount; ++i) {
+        if (isSubroutine[i] && visitState[i] == 0) {
+            assertNoRecursiveCalls(i, callerByEvent, visitState);
+        }
+    }
+
+    for (int i = 0; i < subroutineEventsCount; ++i) {
+        if (sourceStream != NULL) {
+            free(subroutineEvents[i].subroutineName);
+        }
+    }
+
+    subroutineEventsCount = 0;
+}
+
+/// Frees the copies of the expressions and constants kept while assembling a stream, once they are no longer needed.
+static void freeKeptStrings() {
+    if (sourceStream == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < fixupsCount; ++i) {
+        free(fixups[i].expression);
+        fixups[i].expression = NULL;
+    }
+
+    for (int i = 0; i < constantDefinitionsCount; ++i) {
+        free(constantDefinitions[i].name);
+        free(constantDefinitions[i].expression);
+        constantDefinitions[i].name = constantDefinitions[i].expression = NULL;
+    }
+}
+
 static void resolveLabels() {
+    double start = getTimeMsIfEnabled();
+
     for (int i = labelDefinitionsCount - 1; i >= 0; --i) {
         result.labelNameByAddress[labelDefinitions[i].address] = labelDefinitions[i].name;
     }
 
-    for (int i = 0; i < labelUsesCount; ++i) {
-        struct LabelUse* labelUse = &labelUses[i];
-        struct LabelDefinition* labelDefinition = findLabelDefinition(labelUse);
-        int evaluatedAddress = labelDefinition->address + labelUse->offset;
-        
-        if (evaluatedAddress < 0 || evaluatedAddress >= ADDRESS_SPACE_SIZE) {
-            printf("Error on line %d: \"%s%s%d\" evaluates to %d, which is an invalid address.\n", labelUse->lineNumber, labelUse->name, labelUse->offset < 0 ? "" : "+", labelUse->offset, evaluatedAddress);
-            exit(ExitCodeReferenceToInvalidAddress);
+    memcpy(result.labels, labelDefinitions, labelDefinitionsCount * sizeof(struct LabelDefinition));
+    result.labelsCount = labelDefinitionsCount;
+
+    for (int i = 0; i < constantDefinitionsCount; ++i) {
+        int value;
+        resolveConstant(&constantDefinitions[i], &value);
+    }
+
+    while (forwardReferencesCount > 0) { // Only references to constants and undefined labels are left
+        int value;
+        resolveSymbol(forwardReferences[0].name, forwardReferences[0].lineNumber, &value);
+        patchForwardReference(&forwardReferences[0], value);
+    }
+
+    for (int i = 0; i < fixupsCount; ++i) {
+        struct Fixup* fixup = &fixups[i];
+        applyFixup(fixup, evaluateCountingLabelUses(fixup->expression, fixup->lineNumber).value);
+    }
+
+    freeKeptStrings();
+
+    result.statistics.resolveLabelsMs = getTimeMsIfEnabled() - start;
+}
+
+static void freeLexedSource() {
+    if (lexedSource != NULL) {
+        free(lexedSource->tokens);
+        free(lexedSource);
+        lexedSource = NULL;
+    }
+    lexedTokenIndex = 0;
+}
+
+static void resetState() {
+    lineNumber = 1;
+    currentAddress = 0;
+    memset(programMemoryWritten, 0, sizeof(programMemoryWritten));
+    freeKeptStrings(); // Left by an error
+    labelDefinitionsCount = 0;
+    constantDefinitionsCount = 0;
+    fixupsCount = 0;
+    allSymbolsDefined = false;
+    for (int i = 0; i < immediateValueUsesCount; ++i) { // Left by an error
+        if (immediateValueUses[i].isAllocated) {
+            free(immediateValueUses[i].token.value);
         }
-        
-        result.programMemory[labelUse->address] |= evaluatedAddress >> (labelUse->byte * 8);
     }
+    immediateValueUsesCount = 0;
+    memset(labelNamesByImmediateValue, 0, sizeof(labelNamesByImmediateValue));
+    memset(&result, 0, sizeof(result));
+    forwardReferencesCount = 0;
+    pendingLabelUses = 0;
+    sourceStream = NULL;
+    freeLexedSource();
+    for (int i = 0; i < pooledStringsCount; ++i) { // Left by an error
+        free(pooledStrings[i].characters);
+    }
+    free(declaredCharacters);
+    declaredCharacters = NULL;
+    pooledStringsCount = 0;
+    subroutineEventsCount = 0;
+    poolEntryUsesCount = 0;
+    memset(poolEntryAddresses, -1, sizeof(poolEntryAddresses));
 }
 
-struct AssemblerResult assemble(char* source) {
-    sourceString = source;
+static void assembleStatements(struct AssemblerResult* assemblerResult) {
+    double parseStart = getTimeMsIfEnabled();
+
+    // When timed, the source is tokenized before it's parsed, so that the clock isn't read for every token
+    bool isLexedInParallel = lexerThreadsCount > 1 && strlen(sourceString) >= parallelLexingMinSourceSize;
+    if (sourceStream == NULL && (isLexedInParallel || timingEnabled)) {
+        lexedSource = malloc(sizeof(struct LexedSource));
+        *lexedSource = tokenizeInParallel(sourceString, isLexedInParallel ? lexerThreadsCount : 1);
+        result.statistics.tokenizeMs += getTimeMsIfEnabled() - parseStart;
+    }
 
     while (parseStatement()) {}
 
+    freeLexedSource();
+
+    result.statistics.parseMs = getTimeMsIfEnabled() - parseStart
+        - result.statistics.tokenizeMs
+        - result.statistics.resolveImmediateValuesMs;
+
     for (int i = 0; i < ADDRESS_SPACE_SIZE; ++i) {
         if (programMemoryWritten[i]) {
             currentAddress = i + 1;
         }
     }
 
+    allSymbolsDefined = true;
+
     resolveImmediateValues();
+    resolveSubroutines();
     resolveLabels();
 
-    return result;
-}
\ No newline at end of file
+    bool programEmpty = true;
+    for (int i = 0; i < ADDRESS_SPACE_SIZE && programEmpty; ++i) {
+        programEmpty = result.dataType[i] == DataTypeNone;
+    }
+
+    if (programEmpty) {
+        fail(ExitCodeResultProgramEmpty, "Error: the resulting program is empty.\n");
+    }
+
+    result.statistics.peakLabelDefinitions = labelDefinitionsCount;
+    result.statistics.peakConstantDefinitions = constantDefinitionsCount;
+
+    *assemblerResult = result;
+}
+
+void assemble(char* source, struct AssemblerResult* assemblerResult) {
+    resetState();
+    sourceString = source;
+    assembleStatements(assemblerResult);
+}
+
+void assembleStream(FILE* stream, struct AssemblerResult* assemblerResult) {
+    resetState();
+    sourceStream = stream;
+    sourceString = streamEnd = streamBuffer;
+    streamEndCharacter = 0;
+    streamPartialLineLength = 0;
+    streamFinished = false;
+    assembleStatements(assemblerResult);
+}
+
+enum ExitCode tryAssemble(char* source, struct AssemblerResult* assemblerResult, char* errorMessage, int errorMessageSize) {
+    jmp_buf errorJump;
+
+    if (setjmp(errorJump) != 0) {
+        return getCaughtExitCode();
+    }
+
+    beginCatchingErrors(&errorJump, errorMessage, errorMessageSize);
+    assemble(source, assemblerResult);
+    endCatchingErrors();
+
+    return ExitCodeSuccess;
+}
+
+/// Frees the strings kept from a stream which failed to assemble, which would otherwise be owned by the result.
+static void freeFailedStreamStrings() {
+    for (int i = 0; i < labelDefinitionsCount; ++i) {
+        free(labelDefinitions[i].name);
+    }
+
+    for (int i = 0; i < result.expansionsCount; ++i) {
+        free(result.expansions[i].argument);
+    }
+
+    for (int i = 0; i < subroutineEventsCount; ++i) {
+        free(subroutineEvents[i].subroutineName);
+    }
+
+    labelDefinitionsCount = result.expansionsCount = subroutineEventsCount = 0;
+}
+
+enum ExitCode tryAssembleStream(FILE* stream, struct AssemblerResult* assemblerResult, char* errorMessage, int errorMessageSize) {
+    jmp_buf errorJump;
+
+    if (setjmp(errorJump) != 0) {
+        freeFailedStreamStrings();
+        return getCaughtExitCode();
+    }
+
+    beginCatchingErrors(&errorJump, errorMessage, errorMessageSize);
+    assembleStream(stream, assemblerResult);
+    endCatchingErrors();
+
+    return ExitCodeSuccess;
+}
@@ -1,9 +1,15 @@
 #ifndef assembler
 #define assembler
 #include <stdio.h>
+#include <stdbool.h>
 #include "../tokenizer/tokenizer.h"
+#include "../../common/exit-code.h"
+#include "../../common/target-description.h"
 
-#define ADDRESS_SPACE_SIZE 0x2000
+#define MAX_LABEL_DEFS 0x1000
+#define PARALLEL_LEXING_MIN_SOURCE_SIZE 0x100000 // Smaller sources are tokenized faster than threads start
+#define MAX_EXPANSIONS (ADDRESS_SPACE_SIZE / INSTRUCTION_SIZE) // Every expansion has at least one instruction
+#define MAX_IMMEDIATE_POOLS 0x100
 
 enum DataType {
     DataTypeNone = 0,
@@ -12,12 +18,119 @@ enum DataType {
     DataTypeInt
 };
 
+struct LabelDefinition {
+    char* name;
+    int address;
+};
+
+enum ExpansionGoal {
+    ExpansionGoalSize,
+    ExpansionGoalSpeed
+};
+
+/// The instructions emitted for a pseudo-instruction.
+struct Expansion {
+    int lineNumber;
+    int address;
+    int instructionsCount;
+    const char* name;
+    char* argument;
+};
+
+/// The addresses declared at once with the immediate values, pooled strings, scratch bytes and tables.
+struct ImmediatePool {
+    int address;
+    int length;
+};
+
+/**
+ * Phase timings are only measured if enabled with `setAssemblerTimingEnabled`.
+ * Tokenizing a stream is included in parsing, since it's done while parsing.
+ */
+struct AssemblerStatistics {
+    double tokenizeMs;
+    double parseMs; // Excluding tokenization and explicit immediate value declarations
+    double resolveImmediateValuesMs;
+    double resolveLabelsMs;
+    int tokens;
+    int statements;
+    int labelDefinitions;
+    int constantDefinitions;
+    int labelUses;
+    int fixups;
+    int immediateValueUses;
+    int immediatePoolHits;
+    int immediatePoolMisses;
+    int pooledStringBytesSaved; // Bytes of strings stored in the tail of another pooled string
+    int bytesEmitted;
+    int peakLabelDefinitions;
+    int peakConstantDefinitions;
+    int peakImmediateValueUses;
+};
+
 struct AssemblerResult {
     unsigned char programMemory[ADDRESS_SPACE_SIZE];
     enum DataType dataType[ADDRESS_SPACE_SIZE];
-    char* labelNameByAddress[ADDRESS_SPACE_SIZE];
+    int lineNumberByAddress[ADDRESS_SPACE_SIZE]; // The source line declaring each value, or 0
+    char* labelNameByAddress[ADDRESS_SPACE_SIZE]; // The first label defined at each address
+    bool isAddressInData[ADDRESS_SPACE_SIZE]; // Whether a byte of the address is placed in memory by .LSB or .MSB
+    struct LabelDefinition labels[MAX_LABEL_DEFS]; // All labels, in order of definition
+    int labelsCount;
+    struct Expansion expansions[MAX_EXPANSIONS]; // In order of the source
+    int expansionsCount;
+    struct ImmediatePool immediatePools[MAX_IMMEDIATE_POOLS]; // The first non-empty pools, in order of declaration
+    int immediatePoolsCount;
+    struct AssemblerStatistics statistics;
 };
 
-struct AssemblerResult assemble(char* source);
+/**
+ * Enables measuring phase timings in `AssemblerResult.statistics`, which is
+ * disabled by default because a source in memory is then tokenized as a
+ * whole before it's parsed, keeping all of its tokens in memory.
+ */
+void setAssemblerTimingEnabled(bool enabled);
+
+/**
+ * Selects between the shortest and the fastest expansion of pseudo-instructions
+ * assembled on the calling thread. The default is `ExpansionGoalSize`.
+ */
+void setExpansionGoal(enum ExpansionGoal goal);
+
+/**
+ * Makes `assemble` on the calling thread tokenize sources of at least
+ * `minSourceSize` bytes on up to `threadsCount` threads before parsing them.
+ * Sources are tokenized while they're parsed if `threadsCount` is below 2,
+ * which is the default.
+ */
+void setParallelLexing(int threadsCount, size_t minSourceSize);
+
+/**
+ * Assembles the zero-terminated `source`, which is modified in the process,
+ * into `*assemblerResult`, which is too large to be kept on the stack.
+ * May be called repeatedly. Prints an error message and exits the program if
+ * the source is invalid or the resulting program is empty.
+ */
+void assemble(char* source, struct AssemblerResult* assemblerResult);
+
+/**
+ * Same as `assemble`, but instead of exiting the program on error, stores
+ * the error message in `errorMessage` and returns the exit code. Returns
+ * `ExitCodeSuccess` otherwise.
+ * May be called from multiple threads simultaneously.
+ */
+enum ExitCode tryAssemble(char* source, struct AssemblerResult* assemblerResult, char* errorMessage, int errorMessageSize);
+
+/**
+ * Same as `assemble`, but reads the source from the stream in chunks of whole
+ * lines in a single pass, so that memory use doesn't depend on the length of
+ * the source. Forward references to labels used as instruction arguments are
+ * linked through the arguments themselves and patched when the label is
+ * defined. Label names and expansion arguments in the result are allocated
+ * on the heap.
+ */
+void assembleStream(FILE* stream, struct AssemblerResult* assemblerResult);
+
+/// Same as `tryAssemble`, but reads the source from the stream as `assembleStream` does.
+enum ExitCode tryAssembleStream(FILE* stream, struct AssemblerResult* assemblerResult, char* errorMessage, int errorMessageSize);
 
 #endif
\ No newline at end of file
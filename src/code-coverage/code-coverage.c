@@ -0,0 +1,255 @@
+#include "code-coverage.h"
+#include <stdlib.h>
+#include <string.h>
+#include "../../common/little-endian.h"
+
+#define COVERAGE_MAGIC TARGET_NAME "C"
+#define COVERAGE_VERSION 2
+
+struct LineCoverage {
+    int instructions;
+    int executedInstructions;
+    bool hasConditionalJumps;
+    uint64_t jumpsTaken;
+    uint64_t jumpsNotTaken;
+};
+
+struct CoverageTotals {
+    int instructions;
+    int executedInstructions;
+    int jumpDirections; // Two for each conditional jump
+    int coveredJumpDirections;
+};
+
+struct Coverage* createCoverage() {
+    return calloc(1, sizeof(struct Coverage));
+}
+
+static uint32_t addSaturated(uint32_t a, uint32_t b) {
+    return a > UINT32_MAX - b ? UINT32_MAX : a + b;
+}
+
+void mergeCoverage(struct Coverage* destination, struct Coverage* source) {
+    for (int i = 0; i < ADDRESS_SPACE_SIZE / 64; ++i) {
+        destination->executed[i] |= source->executed[i];
+    }
+    for (int i = 0; i < ADDRESS_SPACE_SIZE; ++i) {
+        destination->executionCounts[i] = addSaturated(destination->executionCounts[i], source->executionCounts[i]);
+        destination->jumpsTaken[i] = addSaturated(destination->jumpsTaken[i], source->jumpsTaken[i]);
+        destination->jumpsNotTaken[i] = addSaturated(destination->jumpsNotTaken[i], source->jumpsNotTaken[i]);
+    }
+}
+
+void saveCoverage(FILE* file, struct Coverage* coverage) {
+    uint32_t jumpsCount = 0;
+    uint32_t executedCount = 0;
+    for (int i = 0; i < ADDRESS_SPACE_SIZE; ++i) {
+        jumpsCount += coverage->jumpsTaken[i] > 0 || coverage->jumpsNotTaken[i] > 0;
+        executedCount += coverage->executionCounts[i] > 0;
+    }
+
+    fwrite(COVERAGE_MAGIC, sizeof(char), 4, file);
+    writeUint16(file, COVERAGE_VERSION);
+    writeUint16(file, 0);
+    writeUint32(file, ADDRESS_SPACE_SIZE);
+
+    for (int i = 0; i < ADDRESS_SPACE_SIZE / 64; ++i) {
+        writeUint32(file, coverage->executed[i] & 0xFFFFFFFF);
+        writeUint32(file, coverage->executed[i] >> 32);
+    }
+
+    writeUint32(file, jumpsCount);
+
+    for (int i = 0; i < ADDRESS_SPACE_SIZE; ++i) {
+        if (coverage->jumpsTaken[i] > 0 || coverage->jumpsNotTaken[i] > 0) {
+            writeUint16(file, i);
+            writeUint16(file, 0);
+            writeUint32(file, coverage->jumpsTaken[i]);
+            writeUint32(file, coverage->jumpsNotTaken[i]);
+        }
+    }
+
+    writeUint32(file, executedCount);
+
+    for (int i = 0; i < ADDRESS_SPACE_SIZE; ++i) {
+        if (coverage->executionCounts[i] > 0) {
+            writeUint16(file, i);
+            writeUint16(file, 0);
+            writeUint32(file, coverage->executionCounts[i]);
+        }
+    }
+}
+
+bool loadCoverage(FILE* file, struct Coverage* coverage) {
+    char magic[4];
+    uint16_t version, reserved;
+    uint32_t addressSpaceSize, jumpsCount, executedCount;
+
+    if (fread(magic, sizeof(char), 4, file) != 4 || memcmp(magic, COVERAGE_MAGIC, 4) != 0
+        || !readUint16(file, &version) || version != COVERAGE_VERSION
+        || !readUint16(file, &reserved)
+        || !readUint32(file, &addressSpaceSize) || addressSpaceSize != ADDRESS_SPACE_SIZE) {
+        return false;
+    }
+
+    struct Coverage* loaded = createCoverage();
+    bool valid = true;
+
+    for (int i = 0; valid && i < ADDRESS_SPACE_SIZE / 64; ++i) {
+        uint32_t low, high;
+        valid = readUint32(file, &low) && readUint32(file, &high);
+        loaded->executed[i] = low | (uint64_t) high << 32;
+    }
+
+    valid = valid && readUint32(file, &jumpsCount) && jumpsCount <= ADDRESS_SPACE_SIZE;
+
+    for (uint32_t i = 0; valid && i < jumpsCount; ++i) {
+        uint16_t address;
+        valid = readUint16(file, &address) && isValidAddress(address) && readUint16(file, &reserved)
+            && readUint32(file, &loaded->jumpsTaken[address]) && readUint32(file, &loaded->jumpsNotTaken[address]);
+    }
+
+    valid = valid && readUint32(file, &executedCount) && executedCount <= ADDRESS_SPACE_SIZE;
+
+    for (uint32_t i = 0; valid && i < executedCount; ++i) {
+        uint16_t address;
+        valid = readUint16(file, &address) && isValidAddress(address) && readUint16(file, &reserved)
+            && readUint32(file, &loaded->executionCounts[address]);
+    }
+
+    if (valid) {
+        mergeCoverage(coverage, loaded);
+    }
+
+    free(loaded);
+    return valid;
+}
+
+static bool isConditionalJump(struct AssemblerResult* result, int address) {
+    enum Opcode opcode = getInstructionOpcode(loadInstruction(result->programMemory, address));
+    return opcode == OpcodeJmn || opcode == OpcodeJmz;
+}
+
+static void writeRatio(FILE* file, int covered, int total) {
+    if (total > 0) {
+        fprintf(file, "%d/%d (%.1f%%)", covered, total, 100.0 * covered / total);
+    } else {
+        fprintf(file, "0/0");
+    }
+}
+
+/// Adds the coverage of the instruction at `address` to `line`.
+static void addInstruction(struct LineCoverage* line, struct Coverage* coverage, struct AssemblerResult* result, int address) {
+    ++line->instructions;
+    line->executedInstructions += isExecuted(coverage, address);
+
+    if (isConditionalJump(result, address)) {
+        line->hasConditionalJumps = true;
+        line->jumpsTaken += coverage->jumpsTaken[address];
+        line->jumpsNotTaken += coverage->jumpsNotTaken[address];
+    }
+}
+
+static struct CoverageTotals countCoverage(struct Coverage* coverage, struct AssemblerResult* result, int start, int end) {
+    struct CoverageTotals totals = { 0 };
+
+    for (int i = start; i < end; ++i) {
+        if (result->dataType[i] != DataTypeInstruction) {
+            continue;
+        }
+
+        ++totals.instructions;
+        totals.executedInstructions += isExecuted(coverage, i);
+
+        if (isConditionalJump(result, i)) {
+            totals.jumpDirections += 2;
+            totals.coveredJumpDirections += (coverage->jumpsTaken[i] > 0) + (coverage->jumpsNotTaken[i] > 0);
+        }
+    }
+
+    return totals;
+}
+
+static void writeTotals(FILE* file, struct CoverageTotals totals) {
+    writeRatio(file, totals.executedInstructions, totals.instructions);
+    fprintf(file, " instructions, ");
+    writeRatio(file, totals.coveredJumpDirections, totals.jumpDirections);
+    fprintf(file, " jump directions\n");
+}
+
+/// Writes the coverage of the instructions following each label, up to the next label.
+static void writeLabelsCoverage(FILE* file, struct Coverage* coverage, struct AssemblerResult* result) {
+    int address = 0;
+
+    while (address < ADDRESS_SPACE_SIZE) {
+        int end = address + 1;
+        while (end < ADDRESS_SPACE_SIZE && result->labelNameByAddress[end] == NULL) {
+            ++end;
+        }
+
+        struct CoverageTotals totals = countCoverage(coverage, result, address, end);
+
+        if (totals.instructions > 0) {
+            if (result->labelNameByAddress[address] != NULL) {
+                fprintf(file, "%s: ", result->labelNameByAddress[address]);
+            } else {
+                fprintf(file, "0x%04X: ", address);
+            }
+            writeTotals(file, totals);
+        }
+
+        address = end;
+    }
+}
+
+static char getLineMarker(struct LineCoverage* line) {
+    if (line->instructions == 0) {
+        return ' ';
+    } else if (line->executedInstructions == line->instructions) {
+        return '+';
+    } else {
+        return line->executedInstructions == 0 ? '-' : '~';
+    }
+}
+
+static void writeSourceCoverage(FILE* file, struct Coverage* coverage, struct AssemblerResult* result, const char* source) {
+    int linesCount = 1;
+    for (const char* c = source; *c != 0; ++c) {
+        linesCount += *c == '\n' && c[1] != 0; // A line break at the end doesn't start another line
+    }
+
+    struct LineCoverage* lines = calloc(linesCount + 1, sizeof(struct LineCoverage));
+
+    for (int i = 0; i < ADDRESS_SPACE_SIZE; ++i) {
+        int lineNumber = result->lineNumberByAddress[i];
+        if (result->dataType[i] == DataTypeInstruction && lineNumber > 0 && lineNumber <= linesCount) {
+            addInstruction(&lines[lineNumber], coverage, result, i);
+        }
+    }
+
+    const char* lineStart = source;
+
+    for (int lineNumber = 1; lineNumber <= linesCount; ++lineNumber) {
+        int length = strcspn(lineStart, "\n");
+        int printedLength = length > 0 && lineStart[length - 1] == '\r' ? length - 1 : length;
+        char jumps[32] = { 0 };
+
+        if (lines[lineNumber].hasConditionalJumps) {
+            snprintf(jumps, sizeof(jumps), "T:%llu N:%llu", (unsigned long long) lines[lineNumber].jumpsTaken, (unsigned long long) lines[lineNumber].jumpsNotTaken);
+        }
+
+        fprintf(file, "%5d %c %-13s| %.*s\n", lineNumber, getLineMarker(&lines[lineNumber]), jumps, printedLength, lineStart);
+        lineStart += length + (lineStart[length] == '\n');
+    }
+
+    free(lines);
+}
+
+void writeCoverageReport(FILE* file, struct Coverage* coverage, struct AssemblerResult* result, const char* source) {
+    fprintf(file, "Total: ");
+    writeTotals(file, countCoverage(coverage, result, 0, ADDRESS_SPACE_SIZE));
+    fprintf(file, "\nLabels:\n");
+    writeLabelsCoverage(file, coverage, result);
+    fprintf(file, "\nSource (+ covered, ~ partially covered, - not covered, T/N conditional jumps taken/not taken):\n");
+    writeSourceCoverage(file, coverage, result, source);
+}
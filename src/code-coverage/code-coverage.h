@@ -0,0 +1,56 @@
+#ifndef code_coverage
+#define code_coverage
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "../assembler/assembler.h"
+
+/**
+ * Addresses of executed instructions, the number of times each of them was
+ * executed, and the number of times each conditional jump was taken and not
+ * taken. Executed addresses are also kept in a bitmap, so that recording a
+ * step is cheap enough to leave enabled for whole test runs, and the counts
+ * serve as an execution profile.
+ */
+struct Coverage {
+    uint64_t executed[ADDRESS_SPACE_SIZE / 64];
+    uint32_t executionCounts[ADDRESS_SPACE_SIZE];
+    uint32_t jumpsTaken[ADDRESS_SPACE_SIZE];
+    uint32_t jumpsNotTaken[ADDRESS_SPACE_SIZE];
+};
+
+/// Returns empty coverage, which should be released with `free`.
+struct Coverage* createCoverage();
+
+/// Counts are saturated at UINT32_MAX rather than wrapping, like when coverage is merged.
+static inline void recordCoverage(struct Coverage* coverage, int pc, bool conditionalJump, bool jumped) {
+    coverage->executed[pc / 64] |= (uint64_t) 1 << pc % 64;
+    coverage->executionCounts[pc] += coverage->executionCounts[pc] != UINT32_MAX;
+    if (conditionalJump) {
+        uint32_t* jumps = jumped ? &coverage->jumpsTaken[pc] : &coverage->jumpsNotTaken[pc];
+        *jumps += *jumps != UINT32_MAX;
+    }
+}
+
+static inline bool isExecuted(struct Coverage* coverage, int address) {
+    return coverage->executed[address / 64] >> address % 64 & 1;
+}
+
+/// Adds the coverage of `source` to `destination`, merging the bitmaps with a bitwise OR and summing the counts.
+void mergeCoverage(struct Coverage* destination, struct Coverage* source);
+
+/// Writes the bitmap followed by the counts of only the conditional jumps and the instructions which were executed.
+void saveCoverage(FILE* file, struct Coverage* coverage);
+
+/// Reads coverage written by `saveCoverage` and merges it into `coverage`. Returns false if the file is malformed.
+bool loadCoverage(FILE* file, struct Coverage* coverage);
+
+/**
+ * Writes a summary of the instructions and conditional jump directions
+ * covered, overall and after each label of `result`, followed by the
+ * assembly `source` of `result` with the coverage of every line.
+ */
+void writeCoverageReport(FILE* file, struct Coverage* coverage, struct AssemblerResult* result, const char* source);
+
+#endif
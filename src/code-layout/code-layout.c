@@ -0,0 +1,460 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "code-layout.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "../source-line/source-line.h"
+
+#define NO_BLOCK -1
+
+enum LineType {
+    LineTypeOther, // Ends a region
+    LineTypeEmpty, // Only whitespace or a comment
+    LineTypeLabels, // Only label definitions and an optional comment
+    LineTypeCode // A single instruction or pseudo-instruction, optionally after label definitions
+};
+
+struct Line {
+    const char* text;
+    enum LineType type;
+    bool hasLabels;
+    const char* mnemonic;
+    const char* rest; // Past the argument
+    int instructionsCount;
+    int firstAddress;
+    int lastAddress; // Of the last instruction
+};
+
+/// Lines of a region starting at label definitions, up to the next ones, whose instructions follow each other in memory.
+struct Block {
+    int firstLine;
+    int endLine; // Past the last line, which is a code line
+    int start;
+    int end; // Past the last instruction
+    bool fallsThrough; // Whether execution may continue past the last instruction
+    int jumpTarget; // Block of the region which the final `JMP` jumps to, or NO_BLOCK
+    bool jumpRemovable; // Whether the final `JMP` is alone on its line
+    uint64_t weight; // Number of times execution fell through or took the final jump in the profile
+    int next; // In its chain
+    int chain; // First block of the chain
+    int chainLast;
+    int chainLength;
+    bool isPinned; // Whether the block may be modified or jumped to when running, so that it stays in place with its jumps
+};
+
+/// A transfer of control from the end of a block to the start of another one, which can fall through if they're adjacent.
+struct Edge {
+    int from;
+    int to;
+    uint64_t weight;
+    bool fallsThrough;
+};
+
+/// Finds the labels, the mnemonic and the end of the argument of the line. Lines declaring no instructions are typed later.
+static void parseLine(struct Line* line) {
+    const char* token = skipSpaces(line->text);
+    int length = getTokenLength(token);
+
+    while (length > 0 && token[length - 1] == ':') {
+        line->hasLabels = true;
+        token = skipSpaces(token + length);
+        length = getTokenLength(token);
+    }
+
+    if (length == 0) {
+        line->type = !isLineEnd(token) ? LineTypeOther : line->hasLabels ? LineTypeLabels : LineTypeEmpty;
+        return;
+    }
+
+    const char* argument = skipSpaces(token + length);
+    line->mnemonic = token;
+    line->rest = argument + getTokenLength(argument);
+    line->type = *token != '.' && isLineEnd(skipSpaces(line->rest)) ? LineTypeCode : LineTypeOther;
+}
+
+static bool usesSubroutines(struct AssemblerResult* image) {
+    for (int i = 0; i < image->expansionsCount; ++i) {
+        if (strcmp(image->expansions[i].name, "CALL") == 0 || strcmp(image->expansions[i].name, "RET") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Whether a byte of an instruction is the target of a `ST`, i.e. it's modified when running.
+static bool* findStoredAddresses(struct AssemblerResult* image) {
+    bool* isStoredTo = calloc(ADDRESS_SPACE_SIZE, sizeof(bool));
+    for (int address = 0; address < ADDRESS_SPACE_SIZE; ++address) {
+        InstructionWord instruction = loadInstruction(image->programMemory, address);
+        if (image->dataType[address] == DataTypeInstruction && getInstructionOpcode(instruction) == OpcodeSt) {
+            isStoredTo[getInstructionArgument(instruction)] = true;
+        }
+    }
+    return isStoredTo;
+}
+
+/// Splits the lines of the region into blocks, starting a block at each line with labels after code, along with the comments above it.
+static int buildBlocks(struct Line* lines, int firstLine, int endLine, struct Block* blocks) {
+    int count = 0;
+    bool hasCode = false;
+
+    for (int i = firstLine; i < endLine; ++i) {
+        if (i == firstLine || (lines[i].hasLabels && hasCode)) {
+            int start = i;
+            while (count > 0 && start - 1 > blocks[count - 1].firstLine && lines[start - 1].type == LineTypeEmpty) {
+                --start;
+            }
+            if (count > 0) {
+                blocks[count - 1].endLine = start;
+            }
+            blocks[count++] = (struct Block) { .firstLine = start, .start = -1 };
+            hasCode = false;
+        }
+
+        if (lines[i].type == LineTypeCode) {
+            struct Block* block = &blocks[count - 1];
+            block->start = block->start < 0 ? lines[i].firstAddress : block->start;
+            block->end = lines[i].lastAddress + INSTRUCTION_SIZE;
+            hasCode = true;
+        }
+    }
+
+    blocks[count - 1].endLine = endLine;
+    return count;
+}
+
+static int findBlock(struct Block* blocks, int count, int address) {
+    for (int i = 0; i < count; ++i) {
+        if (blocks[i].start == address) {
+            return i;
+        }
+    }
+    return NO_BLOCK;
+}
+
+/// Finds where execution continues after each block of the region, and how many times it did in the profile.
+static void findSuccessors(struct Line* lines, struct Block* blocks, int count, struct AssemblerResult* image, struct Coverage* profile) {
+    for (int i = 0; i < count; ++i) {
+        struct Block* block = &blocks[i];
+        struct Line* lastLine = &lines[block->endLine - 1];
+        int last = block->end - INSTRUCTION_SIZE;
+        InstructionWord instruction = loadInstruction(image->programMemory, last);
+        enum Opcode opcode = getInstructionOpcode(instruction);
+        int argument = getInstructionArgument(instruction);
+
+        block->fallsThrough = opcode != OpcodeJmp;
+        block->jumpTarget = opcode == OpcodeJmp && argument != last ? findBlock(blocks, count, argument) : NO_BLOCK; // Jumping to itself halts
+        block->jumpRemovable = lastLine->instructionsCount == 1 && namesEqualCaseInsensitive(lastLine->mnemonic, "jmp", getTokenLength(lastLine->mnemonic));
+        block->weight = opcode >= OpcodeJmn ? profile->jumpsNotTaken[last] : profile->executionCounts[last];
+        block->next = NO_BLOCK;
+        block->chain = i;
+        block->chainLast = i;
+        block->chainLength = 1;
+    }
+}
+
+static int compareEdges(const void* a, const void* b) {
+    const struct Edge* first = a;
+    const struct Edge* second = b;
+    if (first->weight != second->weight) {
+        return first->weight > second->weight ? -1 : 1;
+    } else if (first->fallsThrough != second->fallsThrough) {
+        return first->fallsThrough ? -1 : 1;
+    }
+    return first->from - second->from;
+}
+
+/**
+ * Joins blocks into chains, following the edges from the most to the least
+ * frequent one, so that each edge joins the end of one chain to the start of
+ * another. The first block of the region starts its chain, and the block
+ * which must stay last, if any, ends its chain, which is only joined to the
+ * first one if no other chain is left.
+ */
+static void buildChains(struct Block* blocks, int count, int pinnedLast) {
+    struct Edge* edges = malloc(count * sizeof(struct Edge));
+    int edgesCount = 0;
+
+    for (int i = 0; i < count; ++i) {
+        if (blocks[i].fallsThrough && i + 1 < count) {
+            edges[edgesCount++] = (struct Edge) { i, i + 1, blocks[i].weight, true };
+        } else if (blocks[i].jumpTarget != NO_BLOCK && blocks[i].jumpRemovable) {
+            edges[edgesCount++] = (struct Edge) { i, blocks[i].jumpTarget, blocks[i].weight, false };
+        }
+    }
+
+    qsort(edges, edgesCount, sizeof(struct Edge), compareEdges);
+
+    for (int i = 0; i < edgesCount; ++i) {
+        int from = edges[i].from;
+        int to = edges[i].to;
+        int fromChain = blocks[from].chain;
+
+        if (blocks[from].next != NO_BLOCK || blocks[to].chain != to || fromChain == to || to == 0
+            || (fromChain == 0 && pinnedLast != NO_BLOCK && blocks[pinnedLast].chain == to && blocks[0].chainLength + blocks[to].chainLength < count)) {
+            continue;
+        }
+
+        blocks[from].next = to;
+        blocks[fromChain].chainLast = blocks[to].chainLast;
+        blocks[fromChain].chainLength += blocks[to].chainLength;
+        for (int block = to; block != NO_BLOCK; block = blocks[block].next) {
+            blocks[block].chain = fromChain;
+        }
+    }
+
+    free(edges);
+}
+
+/// Lists the blocks of the chain starting at `chain` in `order`, and returns the number of blocks listed in total.
+static int appendChain(struct Block* blocks, int chain, int* order, int orderLength) {
+    for (int block = chain; block != NO_BLOCK; block = blocks[block].next) {
+        order[orderLength++] = block;
+    }
+    return orderLength;
+}
+
+/// Writes the line without its instruction, unless nothing else is left.
+static void writeLineWithoutInstruction(FILE* file, struct Line* line) {
+    const char* comment = skipSpaces(line->rest);
+    if (!line->hasLabels && *comment != ';') {
+        return;
+    }
+    fwrite(line->text, sizeof(char), line->mnemonic - line->text, file);
+    fwrite(line->rest, sizeof(char), strcspn(line->rest, "\n"), file);
+    fprintf(file, "\n");
+}
+
+/// Writes a `JMP` to the label after the last line of the block, in the case of its mnemonic.
+static void writeJump(FILE* file, struct Line* lastLine, const char* label) {
+    const char* indentation = lastLine->text;
+    int indentationLength = lastLine->hasLabels ? 0 : lastLine->mnemonic - lastLine->text;
+    bool isUpperCase = lastLine->mnemonic[0] >= 'A' && lastLine->mnemonic[0] <= 'Z';
+    fprintf(file, "%.*s%s %s\n", indentationLength, indentation, isUpperCase ? "JMP" : "jmp", label);
+}
+
+/**
+ * Reorders the blocks of the region, and writes them with the final jumps
+ * which became fall-throughs removed and jumps added where a fall-through was
+ * broken. Returns false if the order and the jumps stay the same.
+ */
+static bool writeRegion(FILE* file, struct Line* lines, struct Block* blocks, int count, struct AssemblerResult* image, struct LayoutReport* report) {
+    struct Block* last = &blocks[count - 1];
+    const char* exitLabel = image->dataType[last->end % ADDRESS_SPACE_SIZE] == DataTypeInstruction ? image->labelNameByAddress[last->end % ADDRESS_SPACE_SIZE] : NULL;
+    int pinnedLast = last->fallsThrough && exitLabel == NULL ? count - 1 : NO_BLOCK;
+
+    buildChains(blocks, count, pinnedLast);
+
+    int* order = malloc(count * sizeof(int));
+    int orderLength = appendChain(blocks, 0, order, 0);
+
+    for (int i = 1; i < count; ++i) {
+        if (blocks[i].chain == i && (pinnedLast == NO_BLOCK || blocks[pinnedLast].chain != i)) {
+            orderLength = appendChain(blocks, i, order, orderLength);
+        }
+    }
+    if (pinnedLast != NO_BLOCK && blocks[pinnedLast].chain != 0) {
+        orderLength = appendChain(blocks, blocks[pinnedLast].chain, order, orderLength);
+    }
+
+    bool changed = false;
+
+    for (int i = 0; i < count; ++i) {
+        struct Block* block = &blocks[order[i]];
+        int next = i + 1 < count ? order[i + 1] : NO_BLOCK;
+        changed = changed || order[i] != i || (block->jumpRemovable && block->jumpTarget != NO_BLOCK && block->jumpTarget == next);
+    }
+
+    for (int i = 0; changed && i < count; ++i) {
+        struct Block* block = &blocks[order[i]];
+        int next = i + 1 < count ? order[i + 1] : NO_BLOCK;
+        int successor = order[i] + 1 < count ? order[i] + 1 : NO_BLOCK;
+        bool removesJump = block->jumpRemovable && block->jumpTarget != NO_BLOCK && block->jumpTarget == next;
+
+        report->movedBlocks += order[i] != i;
+
+        for (int line = block->firstLine; line < block->endLine; ++line) {
+            if (removesJump && line == block->endLine - 1) {
+                writeLineWithoutInstruction(file, &lines[line]);
+            } else {
+                fwrite(lines[line].text, sizeof(char), strcspn(lines[line].text, "\n"), file);
+                fprintf(file, "\n");
+            }
+        }
+
+        if (removesJump) {
+            ++report->removedJumps;
+            report->expectedSteps -= block->weight;
+        } else if (block->fallsThrough && next != successor) {
+            writeJump(file, &lines[block->endLine - 1], successor == NO_BLOCK ? exitLabel : image->labelNameByAddress[blocks[successor].start]);
+            ++report->insertedJumps;
+            report->expectedSteps += block->weight;
+        }
+    }
+
+    free(order);
+    return changed;
+}
+
+/// Pins the blocks with an instruction which is stored to, or whose address is placed in memory by `.LSB` or `.MSB`.
+static void pinModifiedBlocks(struct Block* blocks, int count, struct AssemblerResult* image, bool* isStoredTo) {
+    for (int i = 0; i < count; ++i) {
+        for (int address = blocks[i].start; address < blocks[i].end; ++address) {
+            blocks[i].isPinned = blocks[i].isPinned || isStoredTo[address] || image->isAddressInData[address];
+        }
+    }
+}
+
+/**
+ * Writes the lines before the blocks, which follow each other in a region,
+ * and the blocks in a new order if it's expected to take fewer steps, or as
+ * many in less code. Returns whether they were reordered.
+ */
+static bool layOutBlocks(FILE* file, struct Line* lines, int linesCount, int* written, struct Block* blocks, int count, struct AssemblerResult* image, struct Coverage* profile, struct LayoutReport* report) {
+    findSuccessors(lines, blocks, count, image, profile);
+
+    for (; *written < blocks[0].firstLine; ++*written) {
+        fwrite(lines[*written].text, sizeof(char), strcspn(lines[*written].text, "\n") + (*written < linesCount), file);
+    }
+
+    char* regionText;
+    size_t regionSize;
+    FILE* region = open_memstream(&regionText, &regionSize);
+    struct LayoutReport regionReport = *report;
+    bool regionChanged = writeRegion(region, lines, blocks, count, image, &regionReport);
+    fclose(region);
+
+    int removedJumps = regionReport.removedJumps - report->removedJumps;
+    int insertedJumps = regionReport.insertedJumps - report->insertedJumps;
+    bool applied = regionChanged && (regionReport.expectedSteps < report->expectedSteps
+        || (regionReport.expectedSteps == report->expectedSteps && removedJumps > insertedJumps));
+
+    if (applied) {
+        fwrite(regionText, sizeof(char), regionSize, file);
+        *report = regionReport;
+        *written = blocks[count - 1].endLine;
+    }
+
+    free(regionText);
+    return applied;
+}
+
+/// Types the lines declaring instructions, which are code lines if they declare them at consecutive addresses.
+static void findInstructions(struct Line* lines, int linesCount, struct AssemblerResult* image) {
+    for (int address = 0; address < ADDRESS_SPACE_SIZE; ++address) {
+        int lineNumber = image->lineNumberByAddress[address];
+        if (image->dataType[address] == DataTypeInstruction && lineNumber > 0 && lineNumber <= linesCount) {
+            struct Line* line = &lines[lineNumber];
+            line->firstAddress = line->instructionsCount == 0 ? address : line->firstAddress;
+            line->lastAddress = address;
+            ++line->instructionsCount;
+        }
+    }
+
+    for (int i = 1; i <= linesCount; ++i) {
+        struct Line* line = &lines[i];
+        bool consecutive = line->instructionsCount > 0 && (line->lastAddress - line->firstAddress) / INSTRUCTION_SIZE + 1 == line->instructionsCount;
+        if ((line->type == LineTypeCode && !consecutive) || (line->type != LineTypeCode && line->instructionsCount > 0)) {
+            line->type = LineTypeOther;
+        }
+    }
+}
+
+char* applyProfileLayout(const char* source, struct Coverage* profile, struct LayoutReport* report) {
+    *report = (struct LayoutReport) { 0 };
+
+    for (int i = 0; i < ADDRESS_SPACE_SIZE; ++i) {
+        report->profiledSteps += profile->executionCounts[i];
+    }
+    report->expectedSteps = report->profiledSteps;
+
+    struct AssemblerResult* image = malloc(sizeof(struct AssemblerResult));
+    char* copy = strdup(source);
+    char errorMessage[0x100];
+
+    if (tryAssemble(copy, image, errorMessage, sizeof(errorMessage)) != ExitCodeSuccess || usesSubroutines(image) || referencesUnlabeledCode(image)) {
+        free(copy);
+        free(image);
+        return strdup(source); // Errors are reported when the source is assembled
+    }
+
+    int linesCount = 1;
+    for (const char* c = source; *c != 0; ++c) {
+        linesCount += *c == '\n';
+    }
+
+    struct Line* lines = calloc(linesCount + 2, sizeof(struct Line));
+    struct Block* blocks = malloc((linesCount + 1) * sizeof(struct Block));
+
+    lines[1].text = source;
+    for (int i = 2; i <= linesCount; ++i) {
+        lines[i].text = strchr(lines[i - 1].text, '\n') + 1;
+    }
+    for (int i = 1; i <= linesCount; ++i) {
+        parseLine(&lines[i]);
+    }
+    lines[linesCount + 1].type = LineTypeOther; // Ends the last region
+
+    findInstructions(lines, linesCount, image);
+    bool* isStoredTo = findStoredAddresses(image);
+
+    char* laidOut;
+    size_t laidOutSize;
+    FILE* file = open_memstream(&laidOut, &laidOutSize);
+    bool changed = false;
+    int regionStart = 0;
+    int lastCodeLine = 0;
+    int written = 1; // Lines before it were written
+
+    for (int i = 1; i <= linesCount + 1; ++i) {
+        bool continuesRegion = regionStart > 0 && (lines[i].type == LineTypeEmpty || lines[i].type == LineTypeLabels
+            || (lines[i].type == LineTypeCode && lines[i].firstAddress == lines[lastCodeLine].lastAddress + INSTRUCTION_SIZE));
+
+        if (regionStart > 0 && !continuesRegion) {
+            int count = buildBlocks(lines, regionStart, lastCodeLine + 1, blocks);
+            pinModifiedBlocks(blocks, count, image, isStoredTo);
+
+            // Pinned blocks split the region into runs of blocks laid out separately
+            for (int first = 0, end = 0; first < count; first = end) {
+                end = first + 1;
+                while (!blocks[first].isPinned && end < count && !blocks[end].isPinned) {
+                    ++end;
+                }
+                if (!blocks[first].isPinned) {
+                    changed = layOutBlocks(file, lines, linesCount, &written, blocks + first, end - first, image, profile, report) || changed;
+                }
+            }
+
+            regionStart = 0;
+        }
+
+        if (lines[i].type == LineTypeCode) {
+            regionStart = regionStart > 0 ? regionStart : i;
+            lastCodeLine = i;
+        }
+    }
+
+    for (; written <= linesCount; ++written) {
+        fwrite(lines[written].text, sizeof(char), strcspn(lines[written].text, "\n") + (written < linesCount), file);
+    }
+
+    fclose(file);
+    free(lines);
+    free(blocks);
+    free(isStoredTo);
+    free(copy); // Label names of the image point into it
+
+    copy = strdup(laidOut);
+    bool valid = !changed || tryAssemble(copy, image, errorMessage, sizeof(errorMessage)) == ExitCodeSuccess;
+    free(copy);
+    free(image);
+
+    if (!valid) {
+        free(laidOut);
+        *report = (struct LayoutReport) { 0, 0, 0, report->profiledSteps, report->profiledSteps };
+        return strdup(source);
+    }
+
+    return laidOut;
+}
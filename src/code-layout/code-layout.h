@@ -0,0 +1,37 @@
+#ifndef code_layout
+#define code_layout
+
+#include <stdint.h>
+#include "../assembler/assembler.h"
+#include "../code-coverage/code-coverage.h"
+
+/// What laying out the code changed, and its expected effect on the profiled run.
+struct LayoutReport {
+    int movedBlocks;
+    int removedJumps;
+    int insertedJumps;
+    uint64_t profiledSteps; // Instructions executed in the profiled run
+    uint64_t expectedSteps; // Instructions the same run is expected to execute after the layout
+};
+
+/**
+ * Returns a copy of the source in which blocks of code are reordered using
+ * the execution counts of `profile`, recorded by running the program
+ * assembled from the same source, so that the most frequent transfers of
+ * control fall through. A block starts at a line with a label and ends before
+ * the next one, and blocks are only moved within a region of consecutive
+ * lines with a single instruction or pseudo-instruction each, so code placed
+ * by `.ORG` and other directives, and the first block of every region, stay
+ * where they are. So do blocks with an instruction stored to by `ST` or
+ * whose address is placed in memory by `.LSB` or `.MSB`, along with their
+ * jumps. A `JMP` ending a block is removed if its target is placed
+ * right after it, and a `JMP` to the next block is added after a block which
+ * used to fall through to it. A region keeps its layout unless the new one
+ * is expected to take fewer steps, or as many in less code. Nothing is
+ * reordered if any instruction refers to code by an address without a label
+ * or to the middle of an instruction, if the program uses `CALL` or `RET`, or
+ * if the reordered source doesn't assemble.
+ */
+char* applyProfileLayout(const char* source, struct Coverage* profile, struct LayoutReport* report);
+
+#endif
@@ -0,0 +1,287 @@
+#include "compressor.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../output/output.h"
+
+#define MAX_TOKEN_LENGTH 0x7F // Stored in the 7 least significant bits of the token's header
+#define MATCH_FLAG 0x80 // Set in the header of a match, which is followed by the address of the bytes to copy
+#define END_OF_PAYLOAD 0
+#define MIN_MATCH_LENGTH 4 // A match takes 3 bytes of the payload
+#define MATCH_HASH_BITS 12
+#define MAX_MATCH_CANDIDATES 0x100
+#define MAX_PAYLOAD_SIZE (ADDRESS_SPACE_SIZE + ADDRESS_SPACE_SIZE / MAX_TOKEN_LENGTH + 2)
+#define MAX_STUB_SOURCE_LEN 0x1000
+#define MEASURED_RELOCATION_ADDRESS 0x1000 // Where the decompressor is assembled to measure its size
+
+/**
+ * The stub copies the decompressor, which is stored after it but assembled at
+ * the relocation address, along with the payload, and jumps to it. The
+ * decompressor reads the payload one byte at a time, and jumps to the state
+ * stored in the argument of `state` to handle it: a token header, a literal
+ * byte or a byte of a match's address. After a byte is written, `resume`
+ * either reads the next literal byte or copies the next byte of the match.
+ */
+static const char* stubSourceFormat =
+    ".EQU STORED %d\n"
+    ".EQU RELOCATION %d\n"
+    ".EQU PAYLOAD %d\n"
+    "copyFrom: ld STORED\n"
+    "copyTo: st RELOCATION\n"
+    "ld copyFrom\n"
+    "add one\n"
+    "st copyFrom\n"
+    "jmz copyFromCarry\n"
+    "copyNext: ld copyTo\n"
+    "add one\n"
+    "st copyTo\n"
+    "jmz copyToCarry\n"
+    "countNext: ld countLsb\n"
+    "add one\n"
+    "st countLsb\n"
+    "jmz countCarry\n"
+    "jmp copyFrom\n"
+    "copyFromCarry: ld copyFrom+1\n"
+    "add one\n"
+    "st copyFrom+1\n"
+    "jmp copyNext\n"
+    "copyToCarry: ld copyTo+1\n"
+    "add one\n"
+    "st copyTo+1\n"
+    "jmp countNext\n"
+    "countCarry: ld countMsb\n"
+    "add one\n"
+    "st countMsb\n"
+    "jmz decompress\n"
+    "jmp copyFrom\n"
+    "one: 1\n"
+    "countLsb: %d ; The number of bytes to copy, negated\n"
+    "countMsb: %d\n"
+    ".ORG RELOCATION\n"
+    "decompress:\n"
+    "read: ld PAYLOAD\n"
+    "st byte\n"
+    "ld read\n"
+    "add increment\n"
+    "st read\n"
+    "jmz readCarry\n"
+    "state: jmp header\n"
+    "readCarry: ld read+1\n"
+    "add increment\n"
+    "st read+1\n"
+    "jmp state\n"
+    "header: ld byte\n"
+    "jmz 0\n"
+    "jmn match\n"
+    "st count\n"
+    "ld toLiteral\n"
+    "st state\n"
+    "ld toLiteral+1\n"
+    "st state+1\n"
+    "ld toRead\n"
+    "st resume\n"
+    "ld toRead+1\n"
+    "st resume+1\n"
+    "jmp read\n"
+    "literal: ld byte\n"
+    "jmp to\n"
+    "match: and lengthMask\n"
+    "st count\n"
+    "ld toAddressLsb\n"
+    "st state\n"
+    "ld toAddressLsb+1\n"
+    "st state+1\n"
+    "jmp read\n"
+    "addressLsb: ld byte\n"
+    "st from\n"
+    "ld toAddressMsb\n"
+    "st state\n"
+    "ld toAddressMsb+1\n"
+    "st state+1\n"
+    "jmp read\n"
+    "addressMsb: ld byte\n"
+    "st from+1\n"
+    "ld toNextCopy\n"
+    "st resume\n"
+    "ld toNextCopy+1\n"
+    "st resume+1\n"
+    "from: ld 0\n"
+    "to: st 0\n"
+    "ld to\n"
+    "add increment\n"
+    "st to\n"
+    "jmz toCarry\n"
+    "countDown: ld count\n"
+    "add decrement\n"
+    "st count\n"
+    "jmz endOfToken\n"
+    "resume: jmp read\n"
+    "toCarry: ld to+1\n"
+    "add increment\n"
+    "st to+1\n"
+    "jmp countDown\n"
+    "endOfToken: ld toHeader\n"
+    "st state\n"
+    "ld toHeader+1\n"
+    "st state+1\n"
+    "jmp read\n"
+    "nextCopy: ld from\n"
+    "add increment\n"
+    "st from\n"
+    "jmz fromCarry\n"
+    "jmp from\n"
+    "fromCarry: ld from+1\n"
+    "add increment\n"
+    "st from+1\n"
+    "jmp from\n"
+    "toHeader: jmp header ; Copied to the arguments of `state` and `resume`\n"
+    "toLiteral: jmp literal\n"
+    "toAddressLsb: jmp addressLsb\n"
+    "toAddressMsb: jmp addressMsb\n"
+    "toRead: jmp read\n"
+    "toNextCopy: jmp nextCopy\n"
+    "increment: 1\n"
+    "decrement: -1\n"
+    "lengthMask: 0x7F\n"
+    "byte: 0\n"
+    "count: 0\n";
+
+static int hashAt(unsigned char* bytes, int position) {
+    return (bytes[position] << 8 ^ bytes[position + 1] << 4 ^ bytes[position + 2]) & ((1 << MATCH_HASH_BITS) - 1);
+}
+
+/// Adds the position to the chain of positions starting with the same 3 bytes.
+static void insertPosition(unsigned char* bytes, int size, int position, int* chainHeads, int* previousPositions) {
+    if (position + 3 <= size) {
+        int hash = hashAt(bytes, position);
+        previousPositions[position] = chainHeads[hash];
+        chainHeads[hash] = position;
+    }
+}
+
+/**
+ * Returns the length of the longest sequence starting at an earlier position
+ * which matches the one at `position`, and stores its address in `*source`.
+ * The sequences may overlap, since the decompressor copies one byte at a time.
+ */
+static int findLongestMatch(unsigned char* bytes, int size, int position, int* chainHeads, int* previousPositions, int* source) {
+    int longestLength = 0;
+
+    if (position + 3 > size) {
+        return 0;
+    }
+
+    int maxLength = size - position < MAX_TOKEN_LENGTH ? size - position : MAX_TOKEN_LENGTH;
+    int candidate = chainHeads[hashAt(bytes, position)];
+
+    for (int i = 0; i < MAX_MATCH_CANDIDATES && candidate >= 0 && longestLength < maxLength; ++i) {
+        int length = 0;
+        while (length < maxLength && bytes[candidate + length] == bytes[position + length]) {
+            ++length;
+        }
+        if (length > longestLength) {
+            longestLength = length;
+            *source = candidate;
+        }
+        candidate = previousPositions[candidate];
+    }
+
+    return longestLength;
+}
+
+static int writeLiterals(unsigned char* bytes, int start, int end, unsigned char* payload, int payloadSize) {
+    while (start < end) {
+        int length = end - start < MAX_TOKEN_LENGTH ? end - start : MAX_TOKEN_LENGTH;
+        payload[payloadSize++] = length;
+        memcpy(payload + payloadSize, bytes + start, length);
+        payloadSize += length;
+        start += length;
+    }
+
+    return payloadSize;
+}
+
+/// Encodes the bytes greedily as literal runs and matches, followed by the end of payload. Returns the size of the payload.
+static int encodePayload(unsigned char* bytes, int size, unsigned char* payload) {
+    int* chainHeads = malloc(sizeof(int) << MATCH_HASH_BITS);
+    int* previousPositions = malloc(size * sizeof(int));
+    int payloadSize = 0;
+    int literalsStart = 0;
+    int position = 0;
+
+    memset(chainHeads, 0xFF, sizeof(int) << MATCH_HASH_BITS);
+
+    while (position < size) {
+        int source;
+        int length = findLongestMatch(bytes, size, position, chainHeads, previousPositions, &source);
+
+        if (length >= MIN_MATCH_LENGTH) {
+            payloadSize = writeLiterals(bytes, literalsStart, position, payload, payloadSize);
+            payload[payloadSize++] = MATCH_FLAG | length;
+            payload[payloadSize++] = source & 0xFF;
+            payload[payloadSize++] = source >> 8;
+            for (int i = 0; i < length; ++i) {
+                insertPosition(bytes, size, position++, chainHeads, previousPositions);
+            }
+            literalsStart = position;
+        } else {
+            insertPosition(bytes, size, position++, chainHeads, previousPositions);
+        }
+    }
+
+    payloadSize = writeLiterals(bytes, literalsStart, position, payload, payloadSize);
+    payload[payloadSize++] = END_OF_PAYLOAD;
+
+    free(chainHeads);
+    free(previousPositions);
+    return payloadSize;
+}
+
+/// Assembles the stub, whose size doesn't depend on the addresses, as it uses no immediate values.
+static bool assembleStub(struct AssemblerResult* stub, int storedAddress, int relocationAddress, int payloadAddress, int copiedBytesCount) {
+    char source[MAX_STUB_SOURCE_LEN];
+    char errorMessage[0x100];
+    int negatedCount = -copiedBytesCount & 0xFFFF;
+
+    snprintf(source, sizeof(source), stubSourceFormat, storedAddress, relocationAddress, payloadAddress, negatedCount & 0xFF, negatedCount >> 8);
+    return tryAssemble(source, stub, errorMessage, sizeof(errorMessage)) == ExitCodeSuccess;
+}
+
+bool compressProgram(struct AssemblerResult* program, struct CompressedProgram* compressed) {
+    struct AssemblerResult* stub = malloc(sizeof(struct AssemblerResult));
+    unsigned char* payload = malloc(MAX_PAYLOAD_SIZE);
+
+    memset(compressed, 0, sizeof(struct CompressedProgram));
+    compressed->programSize = getProgramSize(program);
+    compressed->payloadSize = encodePayload(program->programMemory, compressed->programSize, payload);
+
+    bool fits = assembleStub(stub, 0, MEASURED_RELOCATION_ADDRESS, 0, 1);
+    int copierSize = getNextSegment(stub, 0).length;
+    int decompressorSize = getNextSegment(stub, MEASURED_RELOCATION_ADDRESS).length;
+    int copiedBytesCount = decompressorSize + compressed->payloadSize;
+
+    compressed->stubSize = copierSize + decompressorSize;
+    compressed->imageSize = compressed->stubSize + compressed->payloadSize;
+    compressed->relocationAddress = RELOCATION_END_ADDRESS - copiedBytesCount;
+
+    fits = fits
+        && compressed->relocationAddress >= compressed->programSize
+        && compressed->relocationAddress >= compressed->imageSize
+        && assembleStub(stub, copierSize, compressed->relocationAddress, compressed->relocationAddress + decompressorSize, copiedBytesCount);
+
+    if (fits) {
+        struct AssemblerResult* image = &compressed->image;
+        memcpy(image->programMemory, stub->programMemory, copierSize);
+        memcpy(image->dataType, stub->dataType, copierSize * sizeof(enum DataType));
+        memcpy(image->programMemory + copierSize, stub->programMemory + compressed->relocationAddress, decompressorSize);
+        memcpy(image->dataType + copierSize, stub->dataType + compressed->relocationAddress, decompressorSize * sizeof(enum DataType));
+        memcpy(image->programMemory + compressed->stubSize, payload, compressed->payloadSize);
+        for (int i = compressed->stubSize; i < compressed->imageSize; ++i) {
+            image->dataType[i] = DataTypeInt;
+        }
+    }
+
+    free(stub);
+    free(payload);
+    return fits;
+}
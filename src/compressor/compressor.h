@@ -0,0 +1,29 @@
+#ifndef compressor
+#define compressor
+
+#include <stdbool.h>
+#include "../assembler/assembler.h"
+
+#define RELOCATION_END_ADDRESS TIMER_ADDRESS // The decompressor and the payload are copied below the timer
+
+/// A program packed behind a stub, which unpacks it in place when run.
+struct CompressedProgram {
+    struct AssemblerResult image; // The stub at address 0, followed by the payload
+    int imageSize;
+    int programSize; // Of the unpacked program
+    int stubSize;
+    int payloadSize;
+    int relocationAddress; // Where the decompressor and the payload are copied before unpacking
+};
+
+/**
+ * Compresses the program into a payload of literal runs and matches, which
+ * copy earlier bytes of the program by their address, and places it after a
+ * stub at address 0. When run, the stub copies its decompressor and the
+ * payload to the end of the program memory, unpacks the program at address
+ * 0 and jumps to it with A set to 0. Returns false if the copy would overlap
+ * the unpacked program or the compressed image.
+ */
+bool compressProgram(struct AssemblerResult* program, struct CompressedProgram* compressed);
+
+#endif
@@ -0,0 +1,317 @@
+#include "disassembler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "../../common/symbol-index.h"
+#include "../../common/little-endian.h"
+
+#define MAX_LABEL_NAME_LEN 31
+#define MIN_UNDECLARED_ZEROS_LEN 16 // Shorter runs of zeros are decoded as instructions if symbols are absent
+#define NO_LABEL -1
+
+enum Unit {
+    UnitUndeclared,
+    UnitInstruction,
+    UnitInstructionHigherByte,
+    UnitChar,
+    UnitInt
+};
+
+static _Thread_local enum Unit unitByAddress[ADDRESS_SPACE_SIZE];
+static _Thread_local int firstLabelByAddress[ADDRESS_SPACE_SIZE];
+static _Thread_local int nextLabelAtSameAddress[MAX_LABEL_DEFS];
+
+static bool isValidLabelName(char* name) {
+    int length = strlen(name);
+
+    if (length == 0 || length > MAX_LABEL_NAME_LEN || (name[0] >= '0' && name[0] <= '9')) {
+        return false;
+    }
+
+    for (int i = 0; i < length; ++i) {
+        if (name[i] != '_' && !(name[i] >= 'a' && name[i] <= 'z') && !(name[i] >= 'A' && name[i] <= 'Z') && !(name[i] >= '0' && name[i] <= '9')) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool addLabel(struct AssemblerResult* image, char* name, int address) {
+    if (image->labelsCount == MAX_LABEL_DEFS || address < 0 || address >= ADDRESS_SPACE_SIZE) {
+        return false;
+    }
+
+    image->labels[image->labelsCount++] = (struct LabelDefinition) { name, address };
+
+    if (image->labelNameByAddress[address] == NULL) {
+        image->labelNameByAddress[address] = name;
+    }
+
+    return true;
+}
+
+static bool loadSymbolsCsv(char* contents, struct AssemblerResult* image) {
+    char* line = contents;
+
+    while (*line != 0) {
+        char* end = strchr(line, '\n');
+        if (end != NULL) {
+            *end = 0;
+        }
+
+        char* type = strchr(line, ',');
+        char* name = type == NULL ? NULL : strchr(type + 1, ',');
+        if (name == NULL) {
+            return false;
+        }
+        *type++ = 0;
+        *name++ = 0;
+
+        char* endChar;
+        long address = strtol(line, &endChar, 16);
+        if (*endChar != 0 || address < 0 || address >= ADDRESS_SPACE_SIZE) {
+            return false;
+        }
+
+        if (strcmp(type, "instruction") == 0) {
+            image->dataType[address] = DataTypeInstruction;
+        } else if (strcmp(type, "char") == 0) {
+            image->dataType[address] = DataTypeChar;
+        } else if (strcmp(type, "int") == 0) {
+            image->dataType[address] = DataTypeInt;
+        } else {
+            return false;
+        }
+
+        if (*name != 0 && !addLabel(image, name, address)) {
+            return false;
+        }
+
+        line = end == NULL ? line + strlen(line) : end + 1;
+    }
+
+    return true;
+}
+
+static bool loadSymbolIndex(unsigned char* contents, long size, struct AssemblerResult* image) {
+    if (size < SYMBOL_INDEX_HEADER_SIZE || decodeUint16(contents + 4) != SYMBOL_INDEX_VERSION || decodeUint32(contents + 8) != ADDRESS_SPACE_SIZE) {
+        return false;
+    }
+
+    uint32_t labelsCount = decodeUint32(contents + 12);
+    uint32_t dataTypesOffset = decodeUint32(contents + 20);
+    uint32_t labelsOffset = decodeUint32(contents + 28);
+    uint32_t namesOffset = decodeUint32(contents + 36);
+    uint32_t namesSize = decodeUint32(contents + 40);
+
+    if (dataTypesOffset > size - ADDRESS_SPACE_SIZE
+        || labelsCount > MAX_LABEL_DEFS
+        || labelsOffset > size - labelsCount * SYMBOL_INDEX_LABEL_SIZE
+        || namesOffset > size - namesSize
+        || (namesSize == 0 && labelsCount > 0)
+        || (namesSize > 0 && contents[namesOffset + namesSize - 1] != 0)) {
+        return false;
+    }
+
+    for (int i = 0; i < ADDRESS_SPACE_SIZE; ++i) {
+        if (contents[dataTypesOffset + i] > DataTypeInt) {
+            return false;
+        }
+        image->dataType[i] = contents[dataTypesOffset + i];
+    }
+
+    for (uint32_t i = 0; i < labelsCount; ++i) {
+        unsigned char* label = contents + labelsOffset + i * SYMBOL_INDEX_LABEL_SIZE;
+        uint32_t nameOffset = decodeUint32(label + 4);
+        if (nameOffset >= namesSize || !addLabel(image, (char*) contents + namesOffset + nameOffset, decodeUint16(label))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool loadSymbols(char* contents, long size, struct AssemblerResult* image) {
+    if (size >= 4 && memcmp(contents, SYMBOL_INDEX_MAGIC, 4) == 0) {
+        return loadSymbolIndex((unsigned char*) contents, size, image);
+    } else {
+        return loadSymbolsCsv(contents, image);
+    }
+}
+
+static void decodeUnits(struct AssemblerResult* image, int programSize, bool hasSymbols) {
+    for (int i = 0; i < programSize; ++i) {
+        enum DataType dataType = hasSymbols ? image->dataType[i] : i % INSTRUCTION_SIZE == 0 ? DataTypeInstruction : DataTypeNone;
+
+        if (dataType == DataTypeInstruction && i + INSTRUCTION_SIZE <= programSize && hasNoUnusedBits(loadInstruction(image->programMemory, i))) {
+            unitByAddress[i] = UnitInstruction;
+            for (int j = 1; j < INSTRUCTION_SIZE; ++j) {
+                unitByAddress[++i] = UnitInstructionHigherByte;
+            }
+        } else if (dataType == DataTypeChar) {
+            unitByAddress[i] = UnitChar;
+        } else if (dataType != DataTypeNone || image->programMemory[i] != 0) {
+            unitByAddress[i] = UnitInt;
+        } else {
+            unitByAddress[i] = UnitUndeclared;
+        }
+    }
+
+    if (hasSymbols) {
+        return;
+    }
+
+    // Long runs of zeros are more likely unused memory than instructions
+    int start = 0;
+    while (start < programSize) {
+        int end = start;
+        while (end < programSize && unitByAddress[end] == UnitInstruction && loadInstruction(image->programMemory, end) == 0) {
+            end += INSTRUCTION_SIZE;
+        }
+        if (end - start >= MIN_UNDECLARED_ZEROS_LEN) {
+            for (int i = start; i < end; ++i) {
+                unitByAddress[i] = UnitUndeclared;
+            }
+        }
+        start = end > start ? end : start + INSTRUCTION_SIZE;
+    }
+}
+
+/// Links labels at each address in order of definition, skipping names which can't be used in a source.
+static void indexLabels(struct AssemblerResult* image) {
+    for (int i = 0; i < ADDRESS_SPACE_SIZE; ++i) {
+        firstLabelByAddress[i] = NO_LABEL;
+    }
+
+    for (int i = image->labelsCount - 1; i >= 0; --i) {
+        if (isValidLabelName(image->labels[i].name)) {
+            nextLabelAtSameAddress[i] = firstLabelByAddress[image->labels[i].address];
+            firstLabelByAddress[image->labels[i].address] = i;
+        }
+    }
+}
+
+static bool isStatementStart(int address, int programSize) {
+    return address < programSize && unitByAddress[address] != UnitUndeclared && unitByAddress[address] != UnitInstructionHigherByte;
+}
+
+static void writeCharacter(FILE* file, unsigned char character, char quote) {
+    switch (character) {
+        case '\n':
+            fprintf(file, "\\n");
+            break;
+        case '\t':
+            fprintf(file, "\\t");
+            break;
+        case '\r':
+            fprintf(file, "\\r");
+            break;
+        default:
+            // A backslash is written as a hexadecimal escape, because "\\" can't end a string or character literal
+            if (character < 0x20 || character > 0x7E || character == '\\' || character == quote) {
+                fprintf(file, "\\x%02X", character);
+            } else {
+                fputc(character, file);
+            }
+            break;
+    }
+}
+
+/// Returns the length of a zero-terminated string of characters starting at `address`, or 0 if there is none.
+static int getStringLength(struct AssemblerResult* image, int address, int programSize) {
+    for (int i = address; i < programSize && unitByAddress[i] == UnitChar; ++i) {
+        if (i > address && firstLabelByAddress[i] != NO_LABEL) {
+            return 0;
+        } else if (image->programMemory[i] == 0) {
+            return i > address ? i - address + 1 : 0;
+        }
+    }
+
+    return 0;
+}
+
+/// Writes a statement starting at `address` and returns the number of bytes it occupies.
+static int writeStatement(FILE* file, struct AssemblerResult* image, int address, int programSize) {
+    unsigned char* memory = image->programMemory + address;
+
+    switch (unitByAddress[address]) {
+        case UnitInstruction: {
+            InstructionWord instruction = loadInstruction(image->programMemory, address);
+            int argument = getInstructionArgument(instruction);
+            fprintf(file, "%s ", opcodeNames[getInstructionOpcode(instruction)]);
+            if (firstLabelByAddress[argument] != NO_LABEL) {
+                fprintf(file, "%s", image->labels[firstLabelByAddress[argument]].name);
+            } else {
+                fprintf(file, "0x%04X", argument);
+            }
+            return INSTRUCTION_SIZE;
+        }
+        case UnitChar: {
+            int stringLength = getStringLength(image, address, programSize);
+            if (stringLength > 0) {
+                fputc('"', file);
+                for (int i = 0; i < stringLength - 1; ++i) {
+                    writeCharacter(file, memory[i], '"');
+                }
+                fputc('"', file);
+                return stringLength;
+            }
+            fputc('\'', file);
+            writeCharacter(file, memory[0], '\'');
+            fputc('\'', file);
+            return 1;
+        }
+        default:
+            fprintf(file, "%d", memory[0]);
+            return 1;
+    }
+}
+
+void disassemble(FILE* file, struct AssemblerResult* image, int programSize, bool hasSymbols) {
+    decodeUnits(image, programSize, hasSymbols);
+    indexLabels(image);
+
+    fprintf(file, "; Disassembled by " TARGET_FILE_NAME "asm\n");
+
+    // Labels of addresses where no statement starts are declared as constants
+    bool constantsDeclared = false;
+    for (int i = 0; i < ADDRESS_SPACE_SIZE; ++i) {
+        if (!isStatementStart(i, programSize)) {
+            for (int label = firstLabelByAddress[i]; label != NO_LABEL; label = nextLabelAtSameAddress[label]) {
+                fprintf(file, "%s.equ %s 0x%04X\n", constantsDeclared ? "" : "\n", image->labels[label].name, i);
+                constantsDeclared = true;
+            }
+        }
+    }
+
+    fprintf(file, "\n");
+
+    int address = 0;
+
+    while (address < programSize) {
+        if (!isStatementStart(address, programSize)) {
+            int end = address;
+            while (end < programSize && !isStatementStart(end, programSize)) {
+                ++end;
+            }
+
+            if (end < programSize) {
+                fprintf(file, "\n.org 0x%04X\n", end);
+            } else {
+                fprintf(file, "\n.fill 0 %d\n", end - address);
+            }
+
+            address = end;
+            continue;
+        }
+
+        for (int label = firstLabelByAddress[address]; label != NO_LABEL; label = nextLabelAtSameAddress[label]) {
+            fprintf(file, "%s: ", image->labels[label].name);
+        }
+
+        address += writeStatement(file, image, address, programSize);
+        fprintf(file, "\n");
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef disassembler
+#define disassembler
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "../assembler/assembler.h"
+
+/**
+ * Loads data types and labels from the contents of either a symbols CSV file
+ * or a binary symbol index (recognized by its header) into `image`. Label
+ * names point into `contents`, which is modified in the process. Returns
+ * false if the contents are malformed.
+ */
+bool loadSymbols(char* contents, long size, struct AssemblerResult* image);
+
+/**
+ * Writes assembly source which assembles to the first `programSize` bytes of
+ * `image->programMemory`. If `hasSymbols`, data types and labels of `image`
+ * are used to separate code from data and to name addresses, otherwise the
+ * program is decoded as a sequence of instructions.
+ */
+void disassemble(FILE* file, struct AssemblerResult* image, int programSize, bool hasSymbols);
+
+#endif
@@ -0,0 +1,299 @@
+#include "evaluator.h"
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <errno.h>
+#include <ctype.h>
+#include <strings.h>
+#include "../failure/failure.h"
+
+#define MAX_SYMBOL_NAME_LEN_INCL_0 0x100
+
+struct Evaluation {
+    char* expression;
+    char* position;
+    int lineNumber;
+    SymbolResolver resolveSymbol;
+    bool resolved;
+};
+
+static int evaluateBitwiseOr(struct Evaluation* evaluation);
+
+static void failInvalidExpression(struct Evaluation* evaluation) {
+    fail(ExitCodeInvalidExpression, "Error on line %d: \"%s\" is not a valid expression.\n", evaluation->lineNumber, evaluation->expression);
+}
+
+static bool isSymbolCharacter(char ch, bool isFirst) {
+    return ch == '_' || (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (!isFirst && ch >= '0' && ch <= '9');
+}
+
+static bool isHexDigit(char character) {
+    return (character >= '0' && character <= '9') || (character >= 'a' && character <= 'z') || (character >= 'A' && character <= 'Z');
+}
+
+static void skipWhitespace(struct Evaluation* evaluation) {
+    while (isspace(*evaluation->position)) {
+        ++evaluation->position;
+    }
+}
+
+/// Skips whitespace, then consumes `operator` and returns true if it follows.
+static bool consumeOperator(struct Evaluation* evaluation, char* operator) {
+    skipWhitespace(evaluation);
+    int length = strlen(operator);
+    if (strncmp(evaluation->position, operator, length) != 0) {
+        return false;
+    }
+    // Don't confuse "<" or ">" with "<<" or ">>", and "&", "|" with their doubled forms
+    if (length == 1 && evaluation->position[1] == operator[0] && strchr("<>&|", operator[0]) != NULL) {
+        return false;
+    }
+    evaluation->position += length;
+    return true;
+}
+
+static void expectOperator(struct Evaluation* evaluation, char* operator) {
+    if (!consumeOperator(evaluation, operator)) {
+        failInvalidExpression(evaluation);
+    }
+}
+
+struct EscapeSequenceParseResult parseEscapeSequence(char* sequence, int lineNumber) {
+    switch (sequence[1]) {
+        case 'n':
+        case 'N':
+            return (struct EscapeSequenceParseResult) { '\n', 2 };
+        case 't':
+        case 'T':
+            return (struct EscapeSequenceParseResult) { '\t', 2 };
+        case 'r':
+        case 'R':
+            return (struct EscapeSequenceParseResult) { '\r', 2 };
+        case '\'':
+            return (struct EscapeSequenceParseResult) { '\'', 2 };
+        case '"':
+            return (struct EscapeSequenceParseResult) { '"', 2 };
+        case '\\':
+            return (struct EscapeSequenceParseResult) { '\\', 2 };
+        case 'x':
+        case 'X':
+            if (!isHexDigit(sequence[2]) || !isHexDigit(sequence[3])) {
+                fail(ExitCodeInvalidEscapeSequence, "Error on line %d: invalid escape sequence starting with \"\\%c\".\n", lineNumber, sequence[1]);
+            }
+            char numberString[5] = "0x00";
+            numberString[2] = sequence[2];
+            numberString[3] = sequence[3];
+            char* endChar;
+            unsigned char number = strtol(numberString, &endChar, 0);
+            if (*endChar != 0) {
+                fail(ExitCodeInvalidNumberLiteral, "Error on line %d: \"%s\" is not a valid number.\n", lineNumber, numberString);
+            }
+            return (struct EscapeSequenceParseResult) { number, 4 };
+        default:
+            fail(ExitCodeInvalidEscapeSequence, "Error on line %d: invalid escape sequence \"\\%c\".\n", lineNumber, sequence[1]);
+    }
+}
+
+static int evaluateNumberLiteral(struct Evaluation* evaluation) {
+    char* start = evaluation->position;
+    while (isSymbolCharacter(*evaluation->position, false)) {
+        ++evaluation->position;
+    }
+
+    char literal[MAX_SYMBOL_NAME_LEN_INCL_0] = { 0 };
+    strncpy(literal, start, evaluation->position - start < MAX_SYMBOL_NAME_LEN_INCL_0 ? evaluation->position - start : MAX_SYMBOL_NAME_LEN_INCL_0 - 1);
+
+    char* endChar;
+    errno = 0;
+    long result = strtol(literal, &endChar, 0);
+
+    if (errno != 0 || *endChar != 0 || result > INT_MAX || evaluation->position - start >= MAX_SYMBOL_NAME_LEN_INCL_0) {
+        fail(ExitCodeInvalidNumberLiteral, "Error on line %d: \"%s\" is not a valid number.\n", evaluation->lineNumber, literal);
+    }
+
+    return result;
+}
+
+static int evaluateCharacterLiteral(struct Evaluation* evaluation) {
+    char* literal = evaluation->position;
+    int length = 1;
+    char character = literal[1];
+
+    if (character == '\\') {
+        struct EscapeSequenceParseResult parsed = parseEscapeSequence(literal + 1, evaluation->lineNumber);
+        character = parsed.character;
+        length = parsed.length;
+    }
+
+    if ((character == 0 && length == 1) || literal[length + 1] != '\'') {
+        fail(ExitCodeInvalidCharacterLiteral, "Error on line %d: \"%s\" is not a valid character literal.\n", evaluation->lineNumber, evaluation->expression);
+    }
+
+    evaluation->position += length + 2;
+    return character;
+}
+
+static int evaluateSymbol(struct Evaluation* evaluation) {
+    char* start = evaluation->position;
+    while (isSymbolCharacter(*evaluation->position, false)) {
+        ++evaluation->position;
+    }
+
+    int length = evaluation->position - start;
+    if (length >= MAX_SYMBOL_NAME_LEN_INCL_0) {
+        failInvalidExpression(evaluation);
+    }
+
+    char name[MAX_SYMBOL_NAME_LEN_INCL_0] = { 0 };
+    strncpy(name, start, length);
+
+    bool isLsb = strcasecmp(name, "LSB") == 0;
+    bool isMsb = strcasecmp(name, "MSB") == 0;
+
+    if ((isLsb || isMsb) && consumeOperator(evaluation, "(")) {
+        int argument = evaluateBitwiseOr(evaluation);
+        expectOperator(evaluation, ")");
+        return isLsb ? argument & 0xFF : (argument >> 8) & 0xFF;
+    }
+
+    int value = 0;
+    if (evaluation->resolveSymbol == NULL || !evaluation->resolveSymbol(name, evaluation->lineNumber, &value)) {
+        evaluation->resolved = false;
+    }
+    return value;
+}
+
+static int evaluatePrimary(struct Evaluation* evaluation) {
+    skipWhitespace(evaluation);
+    char ch = *evaluation->position;
+
+    if (ch >= '0' && ch <= '9') {
+        return evaluateNumberLiteral(evaluation);
+    } else if (ch == '\'') {
+        return evaluateCharacterLiteral(evaluation);
+    } else if (isSymbolCharacter(ch, true)) {
+        return evaluateSymbol(evaluation);
+    } else if (consumeOperator(evaluation, "(")) {
+        int result = evaluateBitwiseOr(evaluation);
+        expectOperator(evaluation, ")");
+        return result;
+    }
+
+    failInvalidExpression(evaluation);
+    return 0;
+}
+
+static int evaluateUnary(struct Evaluation* evaluation) {
+    if (consumeOperator(evaluation, "-")) {
+        return -(unsigned) evaluateUnary(evaluation);
+    } else if (consumeOperator(evaluation, "+")) {
+        return evaluateUnary(evaluation);
+    } else if (consumeOperator(evaluation, "~")) {
+        return ~evaluateUnary(evaluation);
+    }
+    return evaluatePrimary(evaluation);
+}
+
+static int evaluateMultiplicative(struct Evaluation* evaluation) {
+    int result = evaluateUnary(evaluation);
+    while (true) {
+        bool isMultiplication = consumeOperator(evaluation, "*");
+        bool isDivision = !isMultiplication && consumeOperator(evaluation, "/");
+        bool isModulo = !isMultiplication && !isDivision && consumeOperator(evaluation, "%");
+        if (!isMultiplication && !isDivision && !isModulo) {
+            return result;
+        }
+
+        int operand = evaluateUnary(evaluation);
+        if (isMultiplication) {
+            result = (unsigned) result * (unsigned) operand;
+        } else if (evaluation->resolved) {
+            if (operand == 0) {
+                fail(ExitCodeInvalidExpression, "Error on line %d: division by zero in expression \"%s\".\n", evaluation->lineNumber, evaluation->expression);
+            }
+            if (result == INT_MIN && operand == -1) {
+                result = isDivision ? INT_MIN : 0;
+            } else {
+                result = isDivision ? result / operand : result % operand;
+            }
+        }
+    }
+}
+
+static int evaluateAdditive(struct Evaluation* evaluation) {
+    int result = evaluateMultiplicative(evaluation);
+    while (true) {
+        if (consumeOperator(evaluation, "+")) {
+            result = (unsigned) result + (unsigned) evaluateMultiplicative(evaluation);
+        } else if (consumeOperator(evaluation, "-")) {
+            result = (unsigned) result - (unsigned) evaluateMultiplicative(evaluation);
+        } else {
+            return result;
+        }
+    }
+}
+
+static int evaluateShift(struct Evaluation* evaluation) {
+    int result = evaluateAdditive(evaluation);
+    while (true) {
+        bool isLeftShift = consumeOperator(evaluation, "<<");
+        if (!isLeftShift && !consumeOperator(evaluation, ">>")) {
+            return result;
+        }
+
+        int operand = evaluateAdditive(evaluation);
+        if (!evaluation->resolved) {
+            continue;
+        }
+        if (operand < 0 || operand > 31) {
+            fail(ExitCodeInvalidExpression, "Error on line %d: shift by %d in expression \"%s\" is out of range.\n", evaluation->lineNumber, operand, evaluation->expression);
+        }
+        result = isLeftShift ? (int) ((unsigned) result << operand) : result >> operand;
+    }
+}
+
+static int evaluateBitwiseAnd(struct Evaluation* evaluation) {
+    int result = evaluateShift(evaluation);
+    while (consumeOperator(evaluation, "&")) {
+        result &= evaluateShift(evaluation);
+    }
+    return result;
+}
+
+static int evaluateBitwiseXor(struct Evaluation* evaluation) {
+    int result = evaluateBitwiseAnd(evaluation);
+    while (consumeOperator(evaluation, "^")) {
+        result ^= evaluateBitwiseAnd(evaluation);
+    }
+    return result;
+}
+
+static int evaluateBitwiseOr(struct Evaluation* evaluation) {
+    int result = evaluateBitwiseXor(evaluation);
+    while (consumeOperator(evaluation, "|")) {
+        result |= evaluateBitwiseXor(evaluation);
+    }
+    return result;
+}
+
+struct ExpressionEvaluationResult evaluateExpression(char* expression, int lineNumber, SymbolResolver resolveSymbol) {
+    struct Evaluation evaluation = (struct Evaluation) { expression, expression, lineNumber, resolveSymbol, true };
+
+    int value = evaluateBitwiseOr(&evaluation);
+
+    skipWhitespace(&evaluation);
+    if (*evaluation.position != 0) {
+        failInvalidExpression(&evaluation);
+    }
+
+    return (struct ExpressionEvaluationResult) { evaluation.resolved, evaluation.resolved ? value : 0 };
+}
+
+bool isValueExpression(char* string) {
+    if (string[0] == '-') {
+        ++string;
+    }
+    return (string[0] >= '0' && string[0] <= '9') || string[0] == '\'' || string[0] == '(' || string[0] == '~';
+}
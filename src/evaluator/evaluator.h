@@ -0,0 +1,45 @@
+#ifndef evaluator
+#define evaluator
+
+#include <stdbool.h>
+
+struct EscapeSequenceParseResult {
+    char character;
+    int length;
+};
+
+struct ExpressionEvaluationResult {
+    bool resolved;
+    int value;
+};
+
+/**
+ * Stores the value of the symbol named `name` in `*value` and returns true,
+ * or returns false if the value of the symbol can't be determined yet.
+ */
+typedef bool (*SymbolResolver)(char* name, int lineNumber, int* value);
+
+/**
+ * `sequence` points to the backslash character starting the escape sequence.
+ */
+struct EscapeSequenceParseResult parseEscapeSequence(char* sequence, int lineNumber);
+
+/**
+ * Evaluates a zero-terminated integer expression consisting of number literals,
+ * character literals, symbol names, parentheses, unary operators - + ~,
+ * binary operators * / % + - << >> & ^ | (with C precedence) and functions
+ * LSB(x) and MSB(x).
+ * Symbol values are obtained using `resolveSymbol`, which may be NULL if
+ * there aren't any symbols. If any of them can't be determined, the returned
+ * structure has `resolved` set to false.
+ * Exits the program if the expression is malformed.
+ */
+struct ExpressionEvaluationResult evaluateExpression(char* expression, int lineNumber, SymbolResolver resolveSymbol);
+
+/**
+ * Returns true if the first character of the string may begin a constant
+ * value expression, i.e. a data declaration.
+ */
+bool isValueExpression(char* string);
+
+#endif
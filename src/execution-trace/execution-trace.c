@@ -0,0 +1,100 @@
+#include "execution-trace.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_MAGIC TARGET_NAME "T"
+#define TRACE_VERSION 1
+#define TRACE_HEADER_SIZE 8
+
+struct Trace* startTrace(FILE* file) {
+    struct Trace* trace = malloc(sizeof(struct Trace));
+    trace->file = file;
+    trace->entriesCount = 0;
+    trace->flushedEntriesCount = 0;
+
+    if (file != NULL) {
+        unsigned char header[TRACE_HEADER_SIZE] = { 0, 0, 0, 0, TRACE_VERSION, TRACE_VERSION >> 8, TRACE_ENTRY_SIZE, TRACE_ENTRY_SIZE >> 8 };
+        memcpy(header, TRACE_MAGIC, 4);
+        fwrite(header, sizeof(unsigned char), TRACE_HEADER_SIZE, file);
+    }
+
+    return trace;
+}
+
+void flushTrace(struct Trace* trace) {
+    static _Thread_local unsigned char bytes[TRACE_BUFFER_CAPACITY * TRACE_ENTRY_SIZE];
+    int count = trace->entriesCount - trace->flushedEntriesCount;
+
+    for (int i = 0; i < count; ++i) {
+        struct TraceEntry* entry = &trace->entries[(trace->flushedEntriesCount + i) % TRACE_BUFFER_CAPACITY];
+        unsigned char* encoded = bytes + i * TRACE_ENTRY_SIZE;
+        encoded[0] = entry->pc;
+        encoded[1] = entry->pc >> 8;
+        encoded[2] = entry->instruction;
+        encoded[3] = entry->instruction >> 8;
+        encoded[4] = entry->a;
+        encoded[5] = entry->value;
+        encoded[6] = entry->flags;
+        encoded[7] = (uint32_t) entry->instruction >> 16; // Only used by targets with instructions longer than 2 bytes
+    }
+
+    fwrite(bytes, TRACE_ENTRY_SIZE, count, trace->file);
+    trace->flushedEntriesCount = trace->entriesCount;
+}
+
+void finishTrace(struct Trace* trace) {
+    if (trace->file != NULL) {
+        flushTrace(trace);
+    }
+    free(trace);
+}
+
+static void writeAddress(FILE* file, int address, struct AssemblerResult* symbols) {
+    if (symbols != NULL && symbols->labelNameByAddress[address] != NULL) {
+        fprintf(file, "%s", symbols->labelNameByAddress[address]);
+    } else {
+        fprintf(file, "0x%04X", address);
+    }
+}
+
+bool decodeTrace(FILE* traceFile, FILE* file, struct AssemblerResult* symbols) {
+    unsigned char header[TRACE_HEADER_SIZE];
+
+    if (fread(header, sizeof(unsigned char), TRACE_HEADER_SIZE, traceFile) != TRACE_HEADER_SIZE
+        || memcmp(header, TRACE_MAGIC, 4) != 0
+        || (header[4] | header[5] << 8) != TRACE_VERSION
+        || (header[6] | header[7] << 8) != TRACE_ENTRY_SIZE) {
+        return false;
+    }
+
+    unsigned char encoded[TRACE_ENTRY_SIZE];
+    uint64_t step = 0;
+
+    fprintf(file, "step,pc,instruction,a,memory\n");
+
+    while (fread(encoded, sizeof(unsigned char), TRACE_ENTRY_SIZE, traceFile) == TRACE_ENTRY_SIZE) {
+        int pc = encoded[0] | encoded[1] << 8;
+        InstructionWord instruction = encoded[2] | encoded[3] << 8 | (uint32_t) encoded[7] << 16;
+        int opcode = getInstructionOpcode(instruction);
+        int address = getInstructionArgument(instruction);
+        int flags = encoded[6];
+
+        if (pc >= ADDRESS_SPACE_SIZE) {
+            return false;
+        }
+
+        fprintf(file, "%llu,", (unsigned long long) step++);
+        writeAddress(file, pc, symbols);
+        fprintf(file, ",%s ", opcodeNames[opcode]);
+        writeAddress(file, address, symbols);
+        fprintf(file, "%s,0x%02X,", flags & TraceEntryFlagJumped ? " (jumped)" : "", encoded[4]);
+
+        if (opcode < 4 || flags & TraceEntryFlagStored) {
+            fprintf(file, "%s 0x%02X", flags & TraceEntryFlagStored ? "stored" : "loaded", encoded[5]);
+        }
+
+        fprintf(file, "\n");
+    }
+
+    return true;
+}
@@ -0,0 +1,61 @@
+#ifndef execution_trace
+#define execution_trace
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "../assembler/assembler.h"
+
+#define TRACE_BUFFER_CAPACITY 0x1000 // Power of 2
+#define TRACE_ENTRY_SIZE 8
+
+enum TraceEntryFlag {
+    TraceEntryFlagJumped = 1, // The instruction was a jump, and the jump was taken
+    TraceEntryFlagStored = 2 // `value` was stored to memory rather than loaded
+};
+
+/// One executed instruction. `a` is the value of the register A after the instruction.
+struct TraceEntry {
+    uint16_t pc;
+    InstructionWord instruction;
+    uint8_t a;
+    uint8_t value;
+    uint8_t flags;
+};
+
+/**
+ * A ring buffer of trace entries. If `file` is not NULL, the buffer is
+ * flushed to it whenever it fills up, otherwise the oldest entries are
+ * overwritten, so that only the most recent ones are kept.
+ */
+struct Trace {
+    FILE* file;
+    uint64_t entriesCount; // Since the trace started
+    uint64_t flushedEntriesCount;
+    struct TraceEntry entries[TRACE_BUFFER_CAPACITY];
+};
+
+/// Starts a trace, and writes the trace file header if `file` is not NULL.
+struct Trace* startTrace(FILE* file);
+
+/// Writes buffered entries to the file.
+void flushTrace(struct Trace* trace);
+
+/// Flushes the remaining entries and frees the trace.
+void finishTrace(struct Trace* trace);
+
+static inline void recordTraceEntry(struct Trace* trace, struct TraceEntry entry) {
+    if (trace->file != NULL && trace->entriesCount - trace->flushedEntriesCount == TRACE_BUFFER_CAPACITY) {
+        flushTrace(trace);
+    }
+    trace->entries[trace->entriesCount++ % TRACE_BUFFER_CAPACITY] = entry;
+}
+
+/**
+ * Writes every entry of the trace file as a line of text, naming addresses
+ * with the first label of `symbols` if it's not NULL. Returns false if the
+ * trace file is malformed.
+ */
+bool decodeTrace(FILE* traceFile, FILE* file, struct AssemblerResult* symbols);
+
+#endif
@@ -0,0 +1,55 @@
+#include "failure.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <setjmp.h>
+
+static _Thread_local jmp_buf* currentErrorJump = NULL;
+static _Thread_local char* currentErrorMessage = NULL;
+static _Thread_local int currentErrorMessageSize = 0;
+static _Thread_local enum ExitCode caughtExitCode = ExitCodeSuccess;
+
+void fail(enum ExitCode exitCode, const char* format, ...) {
+    va_list arguments;
+    va_start(arguments, format);
+
+    if (currentErrorJump == NULL) {
+        vprintf(format, arguments);
+        va_end(arguments);
+        exit(exitCode);
+    }
+
+    if (currentErrorMessageSize > 0) {
+        vsnprintf(currentErrorMessage, currentErrorMessageSize, format, arguments);
+    }
+    va_end(arguments);
+
+    jmp_buf* errorJump = currentErrorJump;
+    endCatchingErrors();
+    caughtExitCode = exitCode;
+    longjmp(*errorJump, 1);
+}
+
+void beginCatchingErrors(jmp_buf* errorJump, char* errorMessage, int errorMessageSize) {
+    currentErrorJump = errorJump;
+    currentErrorMessage = errorMessage;
+    currentErrorMessageSize = errorMessageSize;
+}
+
+void endCatchingErrors() {
+    currentErrorJump = NULL;
+    currentErrorMessage = NULL;
+    currentErrorMessageSize = 0;
+}
+
+struct ErrorCatching getErrorCatching() {
+    return (struct ErrorCatching) { currentErrorJump, currentErrorMessage, currentErrorMessageSize };
+}
+
+void resumeCatchingErrors(struct ErrorCatching catching) {
+    beginCatchingErrors(catching.errorJump, catching.errorMessage, catching.errorMessageSize);
+}
+
+enum ExitCode getCaughtExitCode() {
+    return caughtExitCode;
+}
@@ -0,0 +1,41 @@
+#ifndef failure
+#define failure
+
+#include <setjmp.h>
+#include "../../common/exit-code.h"
+
+/**
+ * Reports an error described by a printf-style format and aborts assembling.
+ * By default prints the message and exits the program with `exitCode`.
+ * While errors are caught on the current thread, stores the message instead
+ * and jumps back to the point where catching began.
+ */
+[[noreturn]] void fail(enum ExitCode exitCode, const char* format, ...);
+
+/**
+ * Makes `fail` on the current thread store the error message in
+ * `errorMessage` and `longjmp` to `errorJump`. Since the value returned by
+ * `setjmp` can only be compared in a condition, the exit code is read
+ * afterwards with `getCaughtExitCode`.
+ */
+void beginCatchingErrors(jmp_buf* errorJump, char* errorMessage, int errorMessageSize);
+
+void endCatchingErrors();
+
+/// Where errors caught on the current thread are reported, so that catching them can be resumed.
+struct ErrorCatching {
+    jmp_buf* errorJump;
+    char* errorMessage;
+    int errorMessageSize;
+};
+
+/// Returns where errors are caught on the current thread, to be passed to `resumeCatchingErrors`.
+struct ErrorCatching getErrorCatching();
+
+/// Catches errors on the current thread as they were caught when `catching` was returned.
+void resumeCatchingErrors(struct ErrorCatching catching);
+
+/// Returns the exit code of the last error caught on the current thread.
+enum ExitCode getCaughtExitCode();
+
+#endif
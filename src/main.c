@@ -20,12 +20,21 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include "program-input/program-input.h"
 #include "assembler/assembler.h"
+#include "output/output.h"
+#include "statistics-report/statistics-report.h"
+#include "disassembler/disassembler.h"
+#include "simulator/simulator.h"
+#include "code-coverage/code-coverage.h"
+#include "path-analysis/path-analysis.h"
+#include "superoptimizer/superoptimizer.h"
+#include "compressor/compressor.h"
+#include "memory-map/memory-map.h"
+#include "code-layout/code-layout.h"
 #include "../common/exit-code.h"
 
-#define IO_INTERFACE_ADDRESS 0x1fff
-
 static char* getFileContents(FILE* filePtr) {
     fseek(filePtr, 0, SEEK_END);
     int fileSize = ftell(filePtr);
@@ -40,13 +49,11 @@ static char* getFileContents(FILE* filePtr) {
     return fileContents;
 }
 
-int main(int argc, const char * argv[]) {
-    struct ProgramInput input = getProgramInput(argc, argv);
-
-    FILE* asmFile = fopen(input.asmFilePath, "r");
+static char* readAsmFile(const char* path) {
+    FILE* asmFile = fopen(path, "r");
 
     if (asmFile == NULL) {
-        printf("Error: could not read file \"%s\".\n", input.asmFilePath);
+        printf("Error: could not read file \"%s\".\n", path);
         exit(ExitCodeCouldNotReadAsmFile);
     }
 
@@ -54,31 +61,448 @@ int main(int argc, const char * argv[]) {
 
     fclose(asmFile);
 
-    struct AssemblerResult result = assemble(asmFileContents);
+    return asmFileContents;
+}
+
+static void readSymbols(const char* path, struct AssemblerResult* symbols) {
+    FILE* symbolsFile = fopen(path, "rb");
+
+    if (symbolsFile == NULL) {
+        printf("Error: could not read file \"%s\".\n", path);
+        exit(ExitCodeCouldNotReadSymbolsFile);
+    }
+
+    fseek(symbolsFile, 0, SEEK_END);
+    long symbolsFileSize = ftell(symbolsFile);
+    rewind(symbolsFile);
+    char* symbolsFileContents = malloc(symbolsFileSize + 1);
+    symbolsFileSize = fread(symbolsFileContents, sizeof(char), symbolsFileSize, symbolsFile);
+    symbolsFileContents[symbolsFileSize] = 0;
+
+    fclose(symbolsFile);
+
+    if (!loadSymbols(symbolsFileContents, symbolsFileSize, symbols)) {
+        printf("Error: file \"%s\" is not a valid symbols file.\n", path);
+        exit(ExitCodeInvalidSymbolsFile);
+    }
+}
+
+static void disassembleBinary(struct ProgramInput input) {
+    static struct AssemblerResult image;
+
+    FILE* binFile = fopen(input.binaryFilePath, "rb");
+
+    if (binFile == NULL) {
+        printf("Error: could not read file \"%s\".\n", input.binaryFilePath);
+        exit(ExitCodeCouldNotReadBinFile);
+    }
+
+    int programSize = fread(image.programMemory, sizeof(unsigned char), ADDRESS_SPACE_SIZE, binFile);
+
+    if (getc(binFile) != EOF) {
+        printf("Error: file \"%s\" is larger than the address space.\n", input.binaryFilePath);
+        exit(ExitCodeBinFileTooLarge);
+    }
+
+    fclose(binFile);
+
+    if (input.symbolsFilePath != NULL) {
+        readSymbols(input.symbolsFilePath, &image);
+    }
+
+    FILE* asmFile = fopen(input.asmFilePath, "w");
+
+    if (asmFile == NULL) {
+        printf("Error: could not write to file \"%s\".\n", input.asmFilePath);
+        exit(ExitCodeCouldNotWriteAsmFile);
+    }
+
+    disassemble(asmFile, &image, programSize, input.symbolsFilePath != NULL);
+
+    fclose(asmFile);
+}
+
+/// Runs the binary or resumes the snapshot with the standard input (read until EOF) as terminal input.
+static void runBinary(struct ProgramInput input) {
+    FILE* binFile = fopen(input.binaryFilePath, "rb");
+
+    if (binFile == NULL) {
+        printf("Error: could not read file \"%s\".\n", input.binaryFilePath);
+        exit(ExitCodeCouldNotReadBinFile);
+    }
+
+    char magic[4] = { 0 };
+    fread(magic, sizeof(char), 4, binFile);
+    rewind(binFile);
+
+    struct Machine* machine;
+
+    if (memcmp(magic, SNAPSHOT_MAGIC, 4) == 0) {
+        machine = loadSnapshot(binFile, stdout);
+        if (machine == NULL) {
+            printf("Error: file \"%s\" is not a valid snapshot.\n", input.binaryFilePath);
+            exit(ExitCodeInvalidSnapshotFile);
+        }
+    } else {
+        unsigned char program[ADDRESS_SPACE_SIZE];
+        int programSize = fread(program, sizeof(unsigned char), ADDRESS_SPACE_SIZE, binFile);
+        if (getc(binFile) != EOF) {
+            printf("Error: file \"%s\" is larger than the address space.\n", input.binaryFilePath);
+            exit(ExitCodeBinFileTooLarge);
+        }
+        machine = createMachine(program, programSize, stdout);
+    }
+
+    fclose(binFile);
+
+    FILE* traceFile = NULL;
 
-    int programSize = 0;
+    if (input.traceFilePath != NULL) {
+        traceFile = fopen(input.traceFilePath, "wb");
 
-    for (int i = 0; i < ADDRESS_SPACE_SIZE; ++i) {
-        if (result.dataType[i] != DataTypeNone) {
-            programSize = i + (result.dataType[i] == DataTypeInstruction ? 2 : 1);
+        if (traceFile == NULL) {
+            printf("Error: could not write to file \"%s\".\n", input.traceFilePath);
+            exit(ExitCodeCouldNotWriteTraceFile);
         }
+
+        machine->trace = startTrace(traceFile);
+    }
+
+    if (input.coverageFilesCount > 0) {
+        machine->coverage = createCoverage();
+    }
+
+    unsigned char buffer[0x1000];
+    int length;
+    while ((length = fread(buffer, sizeof(unsigned char), sizeof(buffer), stdin)) > 0) {
+        provideInput(machine, buffer, length);
+    }
+
+    if (input.nanosecondsPerStep != 0) {
+        machine->nanosecondsPerStep = input.nanosecondsPerStep;
+    }
+
+    uint64_t steps;
+    enum ExitCode runExitCode = runWithinLimits(machine, input.maxSteps, input.stepsBudget, input.timeoutMs, &steps);
+    fflush(stdout);
+
+    if (traceFile != NULL) {
+        finishTrace(machine->trace);
+        machine->trace = NULL;
+        fclose(traceFile);
+    }
+
+    if (machine->coverage != NULL) {
+        FILE* coverageFile = fopen(input.coverageFilePaths[0], "wb");
+
+        if (coverageFile == NULL) {
+            printf("Error: could not write to file \"%s\".\n", input.coverageFilePaths[0]);
+            exit(ExitCodeCouldNotWriteCoverageFile);
+        }
+
+        saveCoverage(coverageFile, machine->coverage);
+
+        fclose(coverageFile);
+        free(machine->coverage);
+        machine->coverage = NULL;
+    }
+
+    if (input.snapshotFilePath != NULL) {
+        FILE* snapshotFile = fopen(input.snapshotFilePath, "wb");
+
+        if (snapshotFile == NULL) {
+            printf("Error: could not write to file \"%s\".\n", input.snapshotFilePath);
+            exit(ExitCodeCouldNotWriteSnapshotFile);
+        }
+
+        saveSnapshot(snapshotFile, machine);
+
+        fclose(snapshotFile);
     }
 
-    if (programSize == 0) {
-        printf("Error: the resulting program is empty.\n");
-        exit(ExitCodeResultProgramEmpty);
+    destroyMachine(machine);
+
+    if (runExitCode == ExitCodeInstructionBudgetExceeded) {
+        printf("Error: the program didn't halt within the budget of %llu instructions.\n", input.stepsBudget);
+        exit(ExitCodeInstructionBudgetExceeded);
+    } else if (runExitCode == ExitCodeRunTimedOut) {
+        printf("Error: the program didn't halt within %llu ms, after %llu instructions.\n", input.timeoutMs, (unsigned long long) steps);
+        exit(ExitCodeRunTimedOut);
     }
+}
+
+static void printTrace(struct ProgramInput input) {
+    static struct AssemblerResult symbols;
+
+    if (input.symbolsFilePath != NULL) {
+        readSymbols(input.symbolsFilePath, &symbols);
+    }
+
+    FILE* traceFile = fopen(input.traceFilePath, "rb");
+
+    if (traceFile == NULL) {
+        printf("Error: could not read file \"%s\".\n", input.traceFilePath);
+        exit(ExitCodeCouldNotReadTraceFile);
+    }
+
+    if (!decodeTrace(traceFile, stdout, input.symbolsFilePath == NULL ? NULL : &symbols)) {
+        printf("Error: file \"%s\" is not a valid trace.\n", input.traceFilePath);
+        exit(ExitCodeInvalidTraceFile);
+    }
+
+    fclose(traceFile);
+}
+
+/// Assembles the source to map addresses to lines and labels, and prints the merged coverage of all the coverage files.
+static void printCoverageReport(struct ProgramInput input) {
+    char* asmFileContents = readAsmFile(input.asmFilePath);
+    char* source = malloc(strlen(asmFileContents) + 1);
+    strcpy(source, asmFileContents);
+
+    static struct AssemblerResult result;
+    assemble(asmFileContents, &result);
+    struct Coverage* coverage = createCoverage();
+
+    for (int i = 0; i < input.coverageFilesCount; ++i) {
+        FILE* coverageFile = fopen(input.coverageFilePaths[i], "rb");
+
+        if (coverageFile == NULL) {
+            printf("Error: could not read file \"%s\".\n", input.coverageFilePaths[i]);
+            exit(ExitCodeCouldNotReadCoverageFile);
+        }
+
+        if (!loadCoverage(coverageFile, coverage)) {
+            printf("Error: file \"%s\" is not a valid coverage file.\n", input.coverageFilePaths[i]);
+            exit(ExitCodeInvalidCoverageFile);
+        }
+
+        fclose(coverageFile);
+    }
+
+    writeCoverageReport(stdout, coverage, &result, source);
+
+    free(coverage);
+    free(source);
+}
 
-    FILE* binFile = fopen(input.binaryFilePath, "wb");
+/// Prints the static analysis of the assembled source, and fails if the worst case exceeds the maximum number of steps.
+static void printPathAnalysis(struct ProgramInput input) {
+    char* asmFileContents = readAsmFile(input.asmFilePath);
+    char* source = malloc(strlen(asmFileContents) + 1);
+    strcpy(source, asmFileContents);
+
+    static struct AssemblerResult result;
+    assemble(asmFileContents, &result);
+    uint64_t worstCaseSteps = writePathAnalysis(stdout, &result, source);
+
+    free(source);
+
+    if (worstCaseSteps > input.maxSteps) {
+        printf("Error: the worst case number of steps exceeds %llu.\n", input.maxSteps);
+        exit(ExitCodeWorstCaseStepsExceeded);
+    }
+}
+
+/// Prints the shortest sequence equivalent to the given one, and appends the rewrite to the rewrites file.
+static void printSuperoptimizedSequence(struct ProgramInput input) {
+    char* text = malloc(strlen(input.sequence) + 1);
+    strcpy(text, input.sequence);
+
+    char* variableNames[MAX_SEQUENCE_VARIABLES] = { NULL };
+    struct Sequence target = { 0 };
+    struct Sequence result;
+
+    if (!parseSequence(text, &target, variableNames)) {
+        printf("Error: \"%s\" is not a valid sequence of up to %d instructions without jumps, using up to %d variables.\n", input.sequence, MAX_SEQUENCE_LEN, MAX_SEQUENCE_VARIABLES);
+        exit(ExitCodeInvalidInstructionSequence);
+    }
+
+    if (!superoptimize(&target, &result)) {
+        printf("No shorter sequence was found.\n");
+        free(text);
+        return;
+    }
+
+    writeSequence(stdout, &target);
+    printf(" => ");
+    writeSequence(stdout, &result);
+    printf("\n");
+
+    if (input.rewritesFilePath != NULL) {
+        FILE* rewritesFile = fopen(input.rewritesFilePath, "a");
+
+        if (rewritesFile == NULL) {
+            printf("Error: could not write to file \"%s\".\n", input.rewritesFilePath);
+            exit(ExitCodeCouldNotWriteRewritesFile);
+        }
+
+        writeSequence(rewritesFile, &target);
+        fprintf(rewritesFile, " => ");
+        writeSequence(rewritesFile, &result);
+        fprintf(rewritesFile, "\n");
+
+        fclose(rewritesFile);
+    }
+
+    free(text);
+}
+
+/// Returns the source with the rewrites from the file applied.
+static char* applyRewritesFile(const char* path, char* asmFileContents) {
+    static struct Rewrite rewrites[MAX_REWRITES];
+
+    FILE* rewritesFile = fopen(path, "r");
+
+    if (rewritesFile == NULL) {
+        printf("Error: could not read file \"%s\".\n", path);
+        exit(ExitCodeCouldNotReadRewritesFile);
+    }
+
+    char* rewritesFileContents = getFileContents(rewritesFile);
+
+    fclose(rewritesFile);
+
+    int rewritesCount = parseRewrites(rewritesFileContents, rewrites);
+
+    if (rewritesCount < 0) {
+        printf("Error: file \"%s\" is not a valid rewrites file.\n", path);
+        exit(ExitCodeInvalidRewritesFile);
+    }
+
+    int appliedCount;
+    char* rewritten = applyRewrites(asmFileContents, rewrites, rewritesCount, &appliedCount);
+
+    free(rewritesFileContents);
+    free(asmFileContents);
+
+    return rewritten;
+}
+
+/// Returns the source with its code laid out by the execution counts from the coverage file, and prints the expected effect.
+static char* applyLayoutProfile(const char* path, char* asmFileContents) {
+    FILE* profileFile = fopen(path, "rb");
+
+    if (profileFile == NULL) {
+        printf("Error: could not read file \"%s\".\n", path);
+        exit(ExitCodeCouldNotReadCoverageFile);
+    }
+
+    struct Coverage* profile = createCoverage();
+
+    if (!loadCoverage(profileFile, profile)) {
+        printf("Error: file \"%s\" is not a valid coverage file.\n", path);
+        exit(ExitCodeInvalidCoverageFile);
+    }
+
+    fclose(profileFile);
+
+    struct LayoutReport report;
+    char* laidOut = applyProfileLayout(asmFileContents, profile, &report);
+    long long savedSteps = (long long) report.profiledSteps - (long long) report.expectedSteps;
+
+    printf("Moved %d blocks, removed %d jumps and added %d. The profiled run of %llu instructions is expected to take %llu (%lld fewer, %.1f%%).\n",
+        report.movedBlocks, report.removedJumps, report.insertedJumps, (unsigned long long) report.profiledSteps, (unsigned long long) report.expectedSteps,
+        savedSteps, report.profiledSteps == 0 ? 0.0 : 100.0 * savedSteps / report.profiledSteps);
+
+    free(profile);
+    free(asmFileContents);
+
+    return laidOut;
+}
+
+int main(int argc, const char * argv[]) {
+    struct ProgramInput input = getProgramInput(argc, argv);
+
+    if (input.mode == ProgramModeDisassemble) {
+        disassembleBinary(input);
+        return ExitCodeSuccess;
+    } else if (input.mode == ProgramModeRun) {
+        runBinary(input);
+        return ExitCodeSuccess;
+    } else if (input.mode == ProgramModeDecodeTrace) {
+        printTrace(input);
+        return ExitCodeSuccess;
+    } else if (input.mode == ProgramModeCoverageReport) {
+        printCoverageReport(input);
+        return ExitCodeSuccess;
+    } else if (input.mode == ProgramModeAnalyze) {
+        printPathAnalysis(input);
+        return ExitCodeSuccess;
+    } else if (input.mode == ProgramModeSuperoptimize) {
+        printSuperoptimizedSequence(input);
+        return ExitCodeSuccess;
+    }
+
+    setAssemblerTimingEnabled(input.statisticsFormat != StatisticsFormatNone);
+    setExpansionGoal(input.expansionGoal);
+    setParallelLexing(sysconf(_SC_NPROCESSORS_ONLN), PARALLEL_LEXING_MIN_SOURCE_SIZE);
+
+    double readStart = getMonotonicTimeMs();
+    double readMs = 0; // A streamed source is read while it's assembled
+    static struct AssemblerResult result;
+    char* listedSource = NULL; // Assembling modifies the source
+
+    if (strcmp(input.asmFilePath, STREAMED_SOURCE_PATH) == 0) {
+        assembleStream(stdin, &result);
+    } else {
+        char* asmFileContents = readAsmFile(input.asmFilePath);
+
+        if (input.rewritesFilePath != NULL) {
+            asmFileContents = applyRewritesFile(input.rewritesFilePath, asmFileContents);
+        }
+
+        if (input.layoutProfilePath != NULL) {
+            asmFileContents = applyLayoutProfile(input.layoutProfilePath, asmFileContents);
+        }
+
+        readMs = getMonotonicTimeMs() - readStart;
+
+        if (input.listingFilePath != NULL) {
+            listedSource = strdup(asmFileContents);
+        }
+
+        assemble(asmFileContents, &result);
+    }
+
+    int programSize = getProgramSize(&result);
+
+    struct AssemblerResult* image = &result;
+    struct CompressedProgram* compressed = input.isCompressed ? malloc(sizeof(struct CompressedProgram)) : NULL;
+
+    if (compressed != NULL) {
+        if (!compressProgram(&result, compressed)) {
+            printf("Error: the compressed program of %d bytes doesn't fit in the address space along with the unpacked program.\n", compressed->imageSize);
+            exit(ExitCodeCompressedProgramTooLarge);
+        }
+
+        if (compressed->imageSize >= compressed->programSize) {
+            printf("Warning: compressing %d bytes would produce %d bytes (a stub of %d bytes and a payload of %d bytes), so the program is saved uncompressed.\n",
+                compressed->programSize, compressed->imageSize, compressed->stubSize, compressed->payloadSize);
+        } else {
+            image = &compressed->image;
+            programSize = compressed->imageSize;
+            printf("Compressed %d bytes into %d bytes (a stub of %d bytes and a payload of %d bytes), %.1f%% of the original size.\n",
+                compressed->programSize, compressed->imageSize, compressed->stubSize, compressed->payloadSize, 100.0 * compressed->imageSize / compressed->programSize);
+        }
+    }
+
+    double writeStart = getMonotonicTimeMs(); // After compressing, which isn't a part of writing the output
+
+    FILE* binFile = fopen(input.binaryFilePath, input.binaryFormat == BinaryFormatIntelHex ? "w" : "wb");
 
     if (binFile == NULL) {
         printf("Error: could not write to file \"%s\".\n", input.binaryFilePath);
         exit(ExitCodeCouldNotWriteBinFile);
     }
 
-    fwrite(result.programMemory, sizeof(unsigned char), programSize, binFile);
+    if (input.binaryFormat == BinaryFormatIntelHex) {
+        writeIntelHex(binFile, image);
+    } else {
+        writeBinary(binFile, image, programSize);
+    }
 
     fclose(binFile);
+    free(compressed);
 
     FILE* symbolsFile = input.symbolsFilePath == NULL ? NULL : fopen(input.symbolsFilePath, "w");
 
@@ -88,26 +512,52 @@ int main(int argc, const char * argv[]) {
             exit(ExitCodeCouldNotWriteSymbolsFile);
         }
 
-        for (int i = 0; i < ADDRESS_SPACE_SIZE; ++i) {
-        if (result.dataType[i] != DataTypeNone || result.labelNameByAddress[i] != NULL) {
-                fprintf(symbolsFile, "0x%04X,", i);
-                switch (result.dataType[i]) {
-                    case DataTypeInstruction:
-                        fprintf(symbolsFile, "instruction");
-                        break;
-                    case DataTypeChar:
-                        fprintf(symbolsFile, "char");
-                        break;
-                    default:
-                        fprintf(symbolsFile, i == IO_INTERFACE_ADDRESS ? "char" : "int");
-                        break;
-                }
-                fprintf(symbolsFile, ",%s\n", result.labelNameByAddress[i] == NULL ? "" : result.labelNameByAddress[i]);
-            }
-        }
-        
+        writeSymbols(symbolsFile, &result);
+
         fclose(symbolsFile);
     }
 
+    FILE* symbolIndexFile = input.symbolIndexFilePath == NULL ? NULL : fopen(input.symbolIndexFilePath, "wb");
+
+    if (input.symbolIndexFilePath != NULL) {
+        if (symbolIndexFile == NULL) {
+            printf("Error: could not write to file \"%s\".\n", input.symbolIndexFilePath);
+            exit(ExitCodeCouldNotWriteSymbolsFile);
+        }
+
+        writeSymbolIndex(symbolIndexFile, &result);
+
+        fclose(symbolIndexFile);
+    }
+
+    if (input.expansionsFilePath != NULL) {
+        FILE* expansionsFile = fopen(input.expansionsFilePath, "w");
+
+        if (expansionsFile == NULL) {
+            printf("Error: could not write to file \"%s\".\n", input.expansionsFilePath);
+            exit(ExitCodeCouldNotWriteExpansionsFile);
+        }
+
+        writeExpansions(expansionsFile, &result);
+
+        fclose(expansionsFile);
+    }
+
+    if (input.listingFilePath != NULL) {
+        FILE* listingFile = fopen(input.listingFilePath, "w");
+
+        if (listingFile == NULL) {
+            printf("Error: could not write to file \"%s\".\n", input.listingFilePath);
+            exit(ExitCodeCouldNotWriteListingFile);
+        }
+
+        writeListing(listingFile, &result, listedSource);
+
+        fclose(listingFile);
+        free(listedSource);
+    }
+
+    printStatistics(stdout, &result.statistics, readMs, getMonotonicTimeMs() - writeStart, input.statisticsFormat);
+
     return ExitCodeSuccess;
 }
\ No newline at end of file
@@ -0,0 +1,251 @@
+#include "memory-map.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../output/output.h"
+
+#define LISTING_BUFFER_SIZE 0x10000
+#define MAX_LISTED_BYTES 4 // Per source line, followed by the number of remaining bytes
+#define LISTED_BYTES_WIDTH 18
+
+/// Collects the listing, which is written to the file with a single call whenever the buffer fills up.
+struct ListingWriter {
+    FILE* file;
+    size_t length;
+    char buffer[LISTING_BUFFER_SIZE];
+};
+
+static void flushListing(struct ListingWriter* writer) {
+    fwrite(writer->buffer, sizeof(char), writer->length, writer->file);
+    writer->length = 0;
+}
+
+static void writeCharacters(struct ListingWriter* writer, const char* characters, size_t length) {
+    while (length > 0) {
+        if (writer->length == LISTING_BUFFER_SIZE) {
+            flushListing(writer);
+        }
+        size_t chunkLength = LISTING_BUFFER_SIZE - writer->length < length ? LISTING_BUFFER_SIZE - writer->length : length;
+        memcpy(writer->buffer + writer->length, characters, chunkLength);
+        writer->length += chunkLength;
+        characters += chunkLength;
+        length -= chunkLength;
+    }
+}
+
+static void writeText(struct ListingWriter* writer, const char* text) {
+    writeCharacters(writer, text, strlen(text));
+}
+
+/// Writes the text followed by spaces up to the width.
+static void writeTextPadded(struct ListingWriter* writer, const char* text, int width) {
+    int length = strlen(text);
+    writeText(writer, text);
+    for (int i = length; i < width; ++i) {
+        writeCharacters(writer, " ", 1);
+    }
+}
+
+/// Stores the number in the base with at least `digits` digits, padded with the character on the left, and returns its length.
+static int formatNumber(char* destination, unsigned int value, unsigned int base, int digits, char padding) {
+    char characters[16];
+    int length = 0;
+
+    do {
+        characters[sizeof(characters) - ++length] = "0123456789ABCDEF"[value % base];
+        value /= base;
+    } while (value > 0);
+
+    while (length < digits) {
+        characters[sizeof(characters) - ++length] = padding;
+    }
+
+    memcpy(destination, characters + sizeof(characters) - length, length);
+    return length;
+}
+
+static void writeNumber(struct ListingWriter* writer, unsigned int value, unsigned int base, int digits, char padding) {
+    char characters[16];
+    writeCharacters(writer, characters, formatNumber(characters, value, base, digits, padding));
+}
+
+static void writeAddress(struct ListingWriter* writer, int address) {
+    writeText(writer, "0x");
+    writeNumber(writer, address, 16, 4, '0');
+}
+
+/// Writes the start and the inclusive end of the range, and its size.
+static void writeRange(struct ListingWriter* writer, int address, int length) {
+    writeText(writer, "  ");
+    writeAddress(writer, address);
+    writeText(writer, "  ");
+    writeAddress(writer, address + length - 1);
+    writeNumber(writer, length, 10, 7, ' ');
+}
+
+static int compareHoleLengths(const void* a, const void* b) {
+    const struct Segment* holeA = a;
+    const struct Segment* holeB = b;
+    return holeA->length != holeB->length ? holeB->length - holeA->length : holeA->origin - holeB->origin;
+}
+
+static void writeSections(struct ListingWriter* writer, struct AssemblerResult* result) {
+    writeText(writer, "Sections:\n  Start   End     Bytes  Instr  Chars   Ints  Label\n");
+
+    for (struct Segment segment = getNextSegment(result, 0); segment.length > 0; segment = getNextSegment(result, segment.origin + segment.length)) {
+        int bytesByDataType[DataTypeInt + 1] = { 0 };
+        for (int address = segment.origin; address < segment.origin + segment.length; ++address) {
+            ++bytesByDataType[result->dataType[address]];
+        }
+
+        writeRange(writer, segment.origin, segment.length);
+        writeNumber(writer, bytesByDataType[DataTypeInstruction] * INSTRUCTION_SIZE, 10, 7, ' ');
+        writeNumber(writer, bytesByDataType[DataTypeChar], 10, 7, ' ');
+        writeNumber(writer, bytesByDataType[DataTypeInt], 10, 7, ' ');
+        writeText(writer, "  ");
+        writeText(writer, result->labelNameByAddress[segment.origin] == NULL ? "" : result->labelNameByAddress[segment.origin]);
+        writeText(writer, "\n");
+    }
+}
+
+static void writeSummaryAndHoles(struct ListingWriter* writer, struct AssemblerResult* result) {
+    struct Segment holes[PROGRAM_MEMORY_SIZE / 2 + 1];
+    int holesCount = 0;
+    int usedBytes = 0;
+    int sectionsCount = 0;
+
+    for (int address = 0; address < PROGRAM_MEMORY_SIZE; ++address) {
+        if (isAddressDeclared(result, address)) {
+            ++usedBytes;
+        } else if (holesCount > 0 && holes[holesCount - 1].origin + holes[holesCount - 1].length == address) {
+            ++holes[holesCount - 1].length;
+        } else {
+            holes[holesCount++] = (struct Segment) { address, 1 };
+        }
+    }
+
+    for (struct Segment segment = getNextSegment(result, 0); segment.length > 0; segment = getNextSegment(result, segment.origin + segment.length)) {
+        ++sectionsCount;
+    }
+
+    int usedPerMille = (usedBytes * 1000 + PROGRAM_MEMORY_SIZE / 2) / PROGRAM_MEMORY_SIZE;
+    writeText(writer, "Program memory: ");
+    writeNumber(writer, usedBytes, 10, 1, ' ');
+    writeText(writer, " of ");
+    writeNumber(writer, PROGRAM_MEMORY_SIZE, 10, 1, ' ');
+    writeText(writer, " bytes used (");
+    writeNumber(writer, usedPerMille / 10, 10, 1, ' ');
+    writeText(writer, ".");
+    writeNumber(writer, usedPerMille % 10, 10, 1, ' ');
+    writeText(writer, "%) in ");
+    writeNumber(writer, sectionsCount, 10, 1, ' ');
+    writeText(writer, " sections, ");
+    writeNumber(writer, PROGRAM_MEMORY_SIZE - usedBytes, 10, 1, ' ');
+    writeText(writer, " bytes free in ");
+    writeNumber(writer, holesCount, 10, 1, ' ');
+    writeText(writer, " holes\n\n");
+
+    writeSections(writer, result);
+
+    qsort(holes, holesCount, sizeof(struct Segment), compareHoleLengths);
+    writeText(writer, "\nLargest free holes:\n  Start   End     Bytes\n");
+    for (int i = 0; i < holesCount && i < MAX_LISTED_HOLES; ++i) {
+        writeRange(writer, holes[i].origin, holes[i].length);
+        writeText(writer, "\n");
+    }
+}
+
+static void writeImmediatePools(struct ListingWriter* writer, struct AssemblerResult* result) {
+    int pooledBytes = 0;
+
+    writeText(writer, "\nImmediate pools:\n  Start   End     Bytes\n");
+    for (int i = 0; i < result->immediatePoolsCount; ++i) {
+        writeRange(writer, result->immediatePools[i].address, result->immediatePools[i].length);
+        writeText(writer, "\n");
+        pooledBytes += result->immediatePools[i].length;
+    }
+
+    writeText(writer, "  Total");
+    writeNumber(writer, pooledBytes, 10, 16, ' ');
+    writeText(writer, "\n");
+}
+
+/// Writes every line of the source, preceded by the first address and bytes it declared outside of immediate pools.
+static void writeSourceLines(struct ListingWriter* writer, struct AssemblerResult* result, const char* source) {
+    int linesCount = 0;
+    for (const char* character = source; *character != 0; ++character) {
+        linesCount += *character == '\n' || character[1] == 0; // The last line may not end with a line feed
+    }
+
+    int* firstAddressByLine = malloc((linesCount + 1) * sizeof(int));
+    int* bytesCountByLine = calloc(linesCount + 1, sizeof(int));
+    bool* isPooled = calloc(ADDRESS_SPACE_SIZE, sizeof(bool));
+
+    for (int i = 0; i < result->immediatePoolsCount; ++i) {
+        for (int j = 0; j < result->immediatePools[i].length; ++j) {
+            isPooled[result->immediatePools[i].address + j] = true;
+        }
+    }
+
+    for (int address = ADDRESS_SPACE_SIZE - 1; address >= 0; --address) {
+        int lineNumber = result->lineNumberByAddress[address];
+        if (isAddressDeclared(result, address) && !isPooled[address] && lineNumber > 0 && lineNumber <= linesCount) {
+            firstAddressByLine[lineNumber] = address;
+            ++bytesCountByLine[lineNumber];
+        }
+    }
+
+    writeText(writer, "\nListing:\n  Address  ");
+    writeTextPadded(writer, "Bytes", LISTED_BYTES_WIDTH);
+    writeText(writer, " Line  Source\n");
+
+    const char* line = source;
+    for (int lineNumber = 1; lineNumber <= linesCount; ++lineNumber) {
+        size_t lineLength = strcspn(line, "\n");
+        int bytesCount = bytesCountByLine[lineNumber];
+        char bytes[LISTED_BYTES_WIDTH + 1] = { 0 };
+        int bytesLength = 0;
+
+        if (bytesCount > 0) {
+            int address = firstAddressByLine[lineNumber];
+            for (int i = 0; i < bytesCount && i < MAX_LISTED_BYTES && result->lineNumberByAddress[address + i] == lineNumber; ++i) {
+                bytesLength += formatNumber(bytes + bytesLength, result->programMemory[address + i], 16, 2, '0');
+                bytes[bytesLength++] = ' ';
+            }
+            if (bytesCount > MAX_LISTED_BYTES) {
+                bytes[bytesLength++] = '+';
+                formatNumber(bytes + bytesLength, bytesCount - MAX_LISTED_BYTES, 10, 1, ' ');
+            }
+            writeText(writer, "  ");
+            writeAddress(writer, address);
+            writeText(writer, "   ");
+            writeTextPadded(writer, bytes, LISTED_BYTES_WIDTH);
+        } else {
+            writeTextPadded(writer, "", LISTED_BYTES_WIDTH + 11);
+        }
+
+        writeNumber(writer, lineNumber, 10, 5, ' ');
+        writeText(writer, "  ");
+        writeCharacters(writer, line, lineLength > 0 && line[lineLength - 1] == '\r' ? lineLength - 1 : lineLength);
+        writeText(writer, "\n");
+        line += lineLength + (line[lineLength] == '\n');
+    }
+
+    free(firstAddressByLine);
+    free(bytesCountByLine);
+    free(isPooled);
+}
+
+void writeListing(FILE* file, struct AssemblerResult* result, const char* source) {
+    struct ListingWriter* writer = malloc(sizeof(struct ListingWriter));
+    writer->file = file;
+    writer->length = 0;
+
+    writeSummaryAndHoles(writer, result);
+    writeImmediatePools(writer, result);
+    writeSourceLines(writer, result, source);
+
+    flushListing(writer);
+    free(writer);
+}
@@ -0,0 +1,19 @@
+#ifndef memory_map
+#define memory_map
+
+#include <stdio.h>
+#include "../assembler/assembler.h"
+
+#define PROGRAM_MEMORY_SIZE TIMER_ADDRESS // The timer and terminal I/O addresses follow the program memory
+#define MAX_LISTED_HOLES 8
+
+/**
+ * Writes the memory usage of the program: its sections (ranges of declared
+ * addresses) with the number of bytes of each data type, the largest free
+ * holes in the program memory and the immediate pools, followed by every line
+ * of the source with the address and the bytes it declared. Bytes declared in
+ * immediate pools are only described by the pools.
+ */
+void writeListing(FILE* file, struct AssemblerResult* result, const char* source);
+
+#endif
@@ -0,0 +1,233 @@
+#include "output.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../common/symbol-index.h"
+#include "../../common/little-endian.h"
+
+#define INTEL_HEX_RECORD_MAX_LENGTH 16
+#define INTEL_HEX_RECORD_TYPE_DATA 0x00
+#define INTEL_HEX_RECORD_TYPE_END_OF_FILE 0x01
+
+int getProgramSize(struct AssemblerResult* result) {
+    int programSize = 0;
+
+    for (int i = 0; i < ADDRESS_SPACE_SIZE; ++i) {
+        if (result->dataType[i] != DataTypeNone) {
+            programSize = i + (result->dataType[i] == DataTypeInstruction ? INSTRUCTION_SIZE : 1);
+        }
+    }
+
+    return programSize;
+}
+
+bool isAddressDeclared(struct AssemblerResult* result, int address) {
+    if (result->dataType[address] != DataTypeNone) {
+        return true;
+    }
+    for (int i = 1; i < INSTRUCTION_SIZE && i <= address; ++i) {
+        if (result->dataType[address - i] == DataTypeInstruction) {
+            return true;
+        }
+    }
+    return false;
+}
+
+struct Segment getNextSegment(struct AssemblerResult* result, int address) {
+    while (address < ADDRESS_SPACE_SIZE && !isAddressDeclared(result, address)) {
+        ++address;
+    }
+
+    int end = address;
+
+    while (end < ADDRESS_SPACE_SIZE && isAddressDeclared(result, end)) {
+        ++end;
+    }
+
+    return (struct Segment) { address, end - address };
+}
+
+void writeBinary(FILE* file, struct AssemblerResult* result, int programSize) {
+    fwrite(result->programMemory, sizeof(unsigned char), programSize, file);
+}
+
+static void writeIntelHexRecord(FILE* file, int recordType, int address, unsigned char* data, int length) {
+    unsigned char checksum = length + (address >> 8) + address + recordType;
+
+    fprintf(file, ":%02X%04X%02X", length, address, recordType);
+
+    for (int i = 0; i < length; ++i) {
+        fprintf(file, "%02X", data[i]);
+        checksum += data[i];
+    }
+
+    fprintf(file, "%02X\n", (unsigned char) -checksum);
+}
+
+void writeIntelHex(FILE* file, struct AssemblerResult* result) {
+    struct Segment segment = getNextSegment(result, 0);
+
+    while (segment.length > 0) {
+        for (int offset = 0; offset < segment.length; offset += INTEL_HEX_RECORD_MAX_LENGTH) {
+            int length = segment.length - offset < INTEL_HEX_RECORD_MAX_LENGTH ? segment.length - offset : INTEL_HEX_RECORD_MAX_LENGTH;
+            writeIntelHexRecord(file, INTEL_HEX_RECORD_TYPE_DATA, segment.origin + offset, result->programMemory + segment.origin + offset, length);
+        }
+
+        segment = getNextSegment(result, segment.origin + segment.length);
+    }
+
+    writeIntelHexRecord(file, INTEL_HEX_RECORD_TYPE_END_OF_FILE, 0, NULL, 0);
+}
+
+void writeSymbols(FILE* file, struct AssemblerResult* result) {
+    for (int i = 0; i < ADDRESS_SPACE_SIZE; ++i) {
+        if (result->dataType[i] != DataTypeNone || result->labelNameByAddress[i] != NULL) {
+            fprintf(file, "0x%04X,", i);
+            switch (result->dataType[i]) {
+                case DataTypeInstruction:
+                    fprintf(file, "instruction");
+                    break;
+                case DataTypeChar:
+                    fprintf(file, "char");
+                    break;
+                default:
+                    fprintf(file, i == IO_ADDRESS ? "char" : "int");
+                    break;
+            }
+            fprintf(file, ",%s\n", result->labelNameByAddress[i] == NULL ? "" : result->labelNameByAddress[i]);
+        }
+    }
+}
+
+static int compareLabelAddresses(const void* a, const void* b) {
+    const struct LabelDefinition* labelA = *(const struct LabelDefinition**) a;
+    const struct LabelDefinition* labelB = *(const struct LabelDefinition**) b;
+    // Labels at the same address keep the order of definition
+    return labelA->address != labelB->address ? labelA->address - labelB->address : labelA < labelB ? -1 : 1;
+}
+
+void writeSymbolIndex(FILE* file, struct AssemblerResult* result) {
+    uint32_t labelsCount = 0;
+    uint32_t namesSize = 0;
+    struct LabelDefinition** labels = malloc((result->labelsCount + 1) * sizeof(struct LabelDefinition*));
+
+    for (int i = 0; i < result->labelsCount; ++i) {
+        // Labels of implicitly declared immediate values can't be used in a source
+        if (result->labels[i].name[0] != '#') {
+            labels[labelsCount] = &result->labels[i];
+            namesSize += strlen(labels[labelsCount++]->name) + 1;
+        }
+    }
+
+    qsort(labels, labelsCount, sizeof(struct LabelDefinition*), compareLabelAddresses);
+
+    uint16_t* coveringLabels = malloc(ADDRESS_SPACE_SIZE * sizeof(uint16_t));
+    uint16_t coveringLabel = SYMBOL_INDEX_NO_LABEL;
+
+    uint32_t nextLabel = 0;
+    for (int address = 0; address < ADDRESS_SPACE_SIZE; ++address) {
+        if (nextLabel < labelsCount && labels[nextLabel]->address == address) {
+            coveringLabel = nextLabel;
+            while (nextLabel < labelsCount && labels[nextLabel]->address == address) {
+                ++nextLabel;
+            }
+        }
+        coveringLabels[address] = coveringLabel;
+    }
+
+    uint32_t hashBucketsCount = 1;
+    while (hashBucketsCount < labelsCount * 2) {
+        hashBucketsCount *= 2;
+    }
+
+    uint32_t* hashBuckets = calloc(hashBucketsCount, sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < labelsCount; ++i) {
+        uint32_t bucket = hashSymbolName(labels[i]->name) & (hashBucketsCount - 1);
+        while (hashBuckets[bucket] != 0) {
+            bucket = (bucket + 1) & (hashBucketsCount - 1);
+        }
+        hashBuckets[bucket] = i + 1;
+    }
+
+    uint32_t dataTypesOffset = SYMBOL_INDEX_HEADER_SIZE;
+    uint32_t coveringLabelsOffset = dataTypesOffset + ADDRESS_SPACE_SIZE;
+    uint32_t labelsOffset = coveringLabelsOffset + ADDRESS_SPACE_SIZE * sizeof(uint16_t);
+    uint32_t hashBucketsOffset = labelsOffset + labelsCount * SYMBOL_INDEX_LABEL_SIZE;
+    uint32_t namesOffset = hashBucketsOffset + hashBucketsCount * sizeof(uint32_t);
+    struct SymbolIndexHeader header = { SYMBOL_INDEX_MAGIC, SYMBOL_INDEX_VERSION, SYMBOL_INDEX_HEADER_SIZE, ADDRESS_SPACE_SIZE, labelsCount, hashBucketsCount,
+        dataTypesOffset, coveringLabelsOffset, labelsOffset, hashBucketsOffset, namesOffset, namesSize };
+
+    fwrite(header.magic, sizeof(char), 4, file);
+    writeUint16(file, header.version);
+    writeUint16(file, header.headerSize);
+    writeUint32(file, header.addressSpaceSize);
+    writeUint32(file, header.labelsCount);
+    writeUint32(file, header.hashBucketsCount);
+    writeUint32(file, header.dataTypesOffset);
+    writeUint32(file, header.coveringLabelsOffset);
+    writeUint32(file, header.labelsOffset);
+    writeUint32(file, header.hashBucketsOffset);
+    writeUint32(file, header.namesOffset);
+    writeUint32(file, header.namesSize);
+
+    for (int i = 0; i < ADDRESS_SPACE_SIZE; ++i) {
+        fputc(result->dataType[i], file);
+    }
+
+    for (int i = 0; i < ADDRESS_SPACE_SIZE; ++i) {
+        writeUint16(file, coveringLabels[i]);
+    }
+
+    uint32_t nameOffset = 0;
+    for (uint32_t i = 0; i < labelsCount; ++i) {
+        uint16_t nameLength = strlen(labels[i]->name);
+        writeUint16(file, labels[i]->address);
+        writeUint16(file, nameLength);
+        writeUint32(file, nameOffset);
+        nameOffset += nameLength + 1;
+    }
+
+    for (uint32_t i = 0; i < hashBucketsCount; ++i) {
+        writeUint32(file, hashBuckets[i]);
+    }
+
+    for (uint32_t i = 0; i < labelsCount; ++i) {
+        fwrite(labels[i]->name, sizeof(char), strlen(labels[i]->name) + 1, file);
+    }
+
+    free(labels);
+    free(coveringLabels);
+    free(hashBuckets);
+}
+
+/// Writes the argument by the name of its label, or as the value of an immediate value or as an address.
+static void writeInstructionArgument(FILE* file, struct AssemblerResult* result, int argument) {
+    const char* name = result->labelNameByAddress[argument];
+
+    if (name == NULL) {
+        fprintf(file, "0x%04X", argument);
+    } else if (name[0] == '#' && !isalpha(name[1])) {
+        fprintf(file, "#%d", result->programMemory[argument]);
+    } else {
+        fprintf(file, "%s", name);
+    }
+}
+
+void writeExpansions(FILE* file, struct AssemblerResult* result) {
+    for (int i = 0; i < result->expansionsCount; ++i) {
+        struct Expansion* expansion = &result->expansions[i];
+        fprintf(file, "%d: %s%s%s\n", expansion->lineNumber, expansion->name, expansion->argument[0] == 0 ? "" : " ", expansion->argument);
+
+        for (int j = 0; j < expansion->instructionsCount; ++j) {
+            int address = expansion->address + j * INSTRUCTION_SIZE;
+            InstructionWord instruction = loadInstruction(result->programMemory, address);
+            fprintf(file, "    0x%04X: %s ", address, opcodeNames[getInstructionOpcode(instruction)]);
+            writeInstructionArgument(file, result, getInstructionArgument(instruction));
+            fprintf(file, "\n");
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef output
+#define output
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "../assembler/assembler.h"
+
+/**
+ * Returns the number of bytes between address 0 and the end of the last
+ * declared value, or 0 if the program is empty.
+ */
+int getProgramSize(struct AssemblerResult* result);
+
+/// Whether the address holds a declared value or a byte of a declared instruction.
+bool isAddressDeclared(struct AssemblerResult* result, int address);
+
+enum BinaryFormat {
+    BinaryFormatRaw,
+    BinaryFormatIntelHex
+};
+
+/// A range of consecutive addresses which hold declared values.
+struct Segment {
+    int origin;
+    int length;
+};
+
+/**
+ * Returns the first segment which starts at or after `address`, or a segment
+ * of length 0 if there is none.
+ */
+struct Segment getNextSegment(struct AssemblerResult* result, int address);
+
+void writeBinary(FILE* file, struct AssemblerResult* result, int programSize);
+
+/**
+ * Writes only the declared segments of the program as Intel HEX data records,
+ * followed by an end of file record.
+ */
+void writeIntelHex(FILE* file, struct AssemblerResult* result);
+
+/**
+ * Writes the comma-separated address, data type and label name of every
+ * address which is declared or labeled.
+ */
+void writeSymbols(FILE* file, struct AssemblerResult* result);
+
+/**
+ * Writes all labels and the data type of every address in the binary,
+ * memory-mappable format described in common/symbol-index.h.
+ */
+void writeSymbolIndex(FILE* file, struct AssemblerResult* result);
+
+/**
+ * Writes every pseudo-instruction with its line number, followed by the
+ * address and the disassembly of each instruction it was expanded into.
+ */
+void writeExpansions(FILE* file, struct AssemblerResult* result);
+
+#endif
@@ -0,0 +1,560 @@
+#include "path-analysis.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define MAX_BLOCKS (ADDRESS_SPACE_SIZE / INSTRUCTION_SIZE)
+#define NO_BLOCK -1
+#define NO_LOOP -1
+#define BOUND_ANNOTATION "@bound"
+
+enum VisitState {
+    VisitStateNotVisited,
+    VisitStateInProgress,
+    VisitStateDone
+};
+
+/// A sequence of instructions which is only entered at its first instruction and only left after its last one.
+struct Block {
+    int start; // Address of the first instruction
+    int end; // Address of the last instruction
+    int instructionsCount;
+    int successors[2];
+    bool backEdges[2]; // Whether the edge to each successor closes a cycle in the depth-first search
+    int successorsCount;
+    int leavingAddresses[2]; // Addresses which aren't instructions, but execution continues at
+    int leavingAddressesCount;
+    bool returns; // Whether the block ends with a RET, which jumps to the return address stored by a CALL
+};
+
+/// All cycles through the back edges to a single header block.
+struct Loop {
+    int header;
+    bool bounded; // Whether every back edge has a bound annotation
+    uint64_t bound; // Sum of the bounds of the back edges
+    int bodySize;
+    uint64_t worstCaseSteps; // Of all iterations, each time the loop is entered
+    int* exits; // Blocks outside of the body which the body has edges to
+    int exitsCount;
+};
+
+static _Thread_local struct Block blocks[MAX_BLOCKS];
+static _Thread_local int blocksCount;
+static _Thread_local int blockByAddress[ADDRESS_SPACE_SIZE];
+static _Thread_local bool isLeader[ADDRESS_SPACE_SIZE];
+static _Thread_local bool isReturn[ADDRESS_SPACE_SIZE]; // The JMP of a RET, whose argument is set when running
+static _Thread_local int predecessorsStart[MAX_BLOCKS + 1];
+static _Thread_local int predecessors[MAX_BLOCKS * 2];
+static _Thread_local enum VisitState visitState[MAX_BLOCKS];
+static _Thread_local struct Loop loops[MAX_BLOCKS];
+static _Thread_local int loopsCount;
+static _Thread_local int loopByHeader[MAX_BLOCKS];
+static _Thread_local int loopsBySize[MAX_BLOCKS];
+static _Thread_local int bodyLoop[MAX_BLOCKS]; // Loop whose body was marked last
+static _Thread_local int collapsedLoop[MAX_BLOCKS]; // The outermost loop containing the block, whose worst case is known
+static _Thread_local int blocksStack[MAX_BLOCKS];
+static _Thread_local bool onPath[MAX_BLOCKS];
+static _Thread_local int worstCaseContext[MAX_BLOCKS]; // Loop, or `loopsCount` for the whole program
+static _Thread_local uint64_t worstCaseSteps[MAX_BLOCKS];
+static _Thread_local bool acyclicStepsKnown[MAX_BLOCKS];
+static _Thread_local uint64_t acyclicSteps[MAX_BLOCKS];
+
+static uint64_t addSteps(uint64_t a, uint64_t b) {
+    return a > STEPS_UNBOUNDED - b ? STEPS_UNBOUNDED : a + b;
+}
+
+static uint64_t multiplySteps(uint64_t a, uint64_t b) {
+    return a != 0 && b > STEPS_UNBOUNDED / a ? STEPS_UNBOUNDED : a * b;
+}
+
+static bool isInstruction(struct AssemblerResult* result, int address) {
+    return result->dataType[address % ADDRESS_SPACE_SIZE] == DataTypeInstruction;
+}
+
+static int getOpcode(struct AssemblerResult* result, int address) {
+    return getInstructionOpcode(loadInstruction(result->programMemory, address));
+}
+
+static int getArgument(struct AssemblerResult* result, int address) {
+    return getInstructionArgument(loadInstruction(result->programMemory, address));
+}
+
+/// Adds an edge to the instruction at `address`, unless it isn't an instruction. Edges are resolved to blocks later.
+static void addEdge(struct AssemblerResult* result, struct Block* block, int address) {
+    address %= ADDRESS_SPACE_SIZE;
+    if (isInstruction(result, address)) {
+        block->successors[block->successorsCount++] = address;
+    } else {
+        block->leavingAddresses[block->leavingAddressesCount++] = address;
+    }
+}
+
+static void markReturns(struct AssemblerResult* result) {
+    memset(isReturn, 0, sizeof(isReturn));
+
+    for (int i = 0; i < result->expansionsCount; ++i) {
+        if (strcmp(result->expansions[i].name, "RET") == 0) {
+            isReturn[result->expansions[i].address] = true;
+        }
+    }
+}
+
+static void markLeaders(struct AssemblerResult* result) {
+    memset(isLeader, 0, sizeof(isLeader));
+    isLeader[0] = true;
+
+    for (int i = 0; i < ADDRESS_SPACE_SIZE; ++i) {
+        if (!isInstruction(result, i)) {
+            continue;
+        }
+        if (result->labelNameByAddress[i] != NULL) {
+            isLeader[i] = true;
+        }
+        if (getOpcode(result, i) >= OpcodeJmp && !isReturn[i]) {
+            isLeader[getArgument(result, i)] = true;
+            isLeader[(i + INSTRUCTION_SIZE) % ADDRESS_SPACE_SIZE] = true;
+        }
+    }
+}
+
+static void buildBlocks(struct AssemblerResult* result) {
+    markReturns(result);
+    markLeaders(result);
+    blocksCount = 0;
+
+    for (int i = 0; i < ADDRESS_SPACE_SIZE; ++i) {
+        blockByAddress[i] = NO_BLOCK;
+    }
+
+    for (int start = 0; start < ADDRESS_SPACE_SIZE; ++start) {
+        if (!isInstruction(result, start) || blockByAddress[start] != NO_BLOCK) {
+            continue;
+        }
+
+        struct Block* block = &blocks[blocksCount];
+        memset(block, 0, sizeof(struct Block));
+        block->start = start;
+
+        for (int address = start; ; address = (address + INSTRUCTION_SIZE) % ADDRESS_SPACE_SIZE) {
+            blockByAddress[address] = blocksCount;
+            block->end = address;
+            ++block->instructionsCount;
+
+            int next = (address + INSTRUCTION_SIZE) % ADDRESS_SPACE_SIZE;
+
+            if (isReturn[address]) {
+                block->returns = true;
+                break;
+            } else if (getOpcode(result, address) >= OpcodeJmp) {
+                // Taking a jump to the jump itself halts the machine
+                if (getArgument(result, address) != address) {
+                    addEdge(result, block, getArgument(result, address));
+                }
+                if (getOpcode(result, address) != OpcodeJmp) {
+                    addEdge(result, block, next);
+                }
+                break;
+            } else if (!isInstruction(result, next) || isLeader[next] || blockByAddress[next] != NO_BLOCK) {
+                addEdge(result, block, next);
+                break;
+            }
+        }
+
+        ++blocksCount;
+    }
+
+    for (int i = 0; i < blocksCount; ++i) {
+        for (int j = 0; j < blocks[i].successorsCount; ++j) {
+            blocks[i].successors[j] = blockByAddress[blocks[i].successors[j]];
+        }
+    }
+}
+
+static void indexPredecessors() {
+    memset(predecessorsStart, 0, sizeof(predecessorsStart));
+
+    for (int i = 0; i < blocksCount; ++i) {
+        for (int j = 0; j < blocks[i].successorsCount; ++j) {
+            ++predecessorsStart[blocks[i].successors[j] + 1];
+        }
+    }
+    for (int i = 0; i < blocksCount; ++i) {
+        predecessorsStart[i + 1] += predecessorsStart[i];
+    }
+
+    static _Thread_local int predecessorsCount[MAX_BLOCKS];
+    memset(predecessorsCount, 0, sizeof(predecessorsCount));
+
+    for (int i = 0; i < blocksCount; ++i) {
+        for (int j = 0; j < blocks[i].successorsCount; ++j) {
+            int successor = blocks[i].successors[j];
+            predecessors[predecessorsStart[successor] + predecessorsCount[successor]++] = i;
+        }
+    }
+}
+
+static void findBackEdges(int block) {
+    visitState[block] = VisitStateInProgress;
+
+    for (int i = 0; i < blocks[block].successorsCount; ++i) {
+        int successor = blocks[block].successors[i];
+        if (visitState[successor] == VisitStateInProgress) {
+            blocks[block].backEdges[i] = true;
+        } else if (visitState[successor] == VisitStateNotVisited) {
+            findBackEdges(successor);
+        }
+    }
+
+    visitState[block] = VisitStateDone;
+}
+
+/// Returns the bound annotated in the comment on the line, or STEPS_UNBOUNDED if there is none.
+static uint64_t getAnnotatedBound(const char* source, int lineNumber) {
+    const char* line = source;
+    for (int i = 1; i < lineNumber && line != NULL; ++i) {
+        line = strchr(line, '\n');
+        line = line == NULL ? NULL : line + 1;
+    }
+
+    char quote = 0;
+
+    for (const char* c = line; c != NULL && *c != 0 && *c != '\n'; ++c) {
+        if (quote != 0) {
+            if (*c == '\\' && c[1] != 0 && c[1] != '\n') {
+                ++c;
+            } else if (*c == quote) {
+                quote = 0;
+            }
+        } else if (*c == '"' || *c == '\'') {
+            quote = *c;
+        } else if (*c == ';') {
+            int commentLength = strcspn(c, "\n");
+            const char* annotation = strstr(c, BOUND_ANNOTATION);
+            if (annotation == NULL || annotation - c >= commentLength) {
+                return STEPS_UNBOUNDED;
+            }
+            const char* value = annotation + strlen(BOUND_ANNOTATION);
+            value += strspn(value, " \t");
+            return *value >= '0' && *value <= '9' ? strtoull(value, NULL, 0) : STEPS_UNBOUNDED;
+        }
+    }
+
+    return STEPS_UNBOUNDED;
+}
+
+static void findLoops(struct AssemblerResult* result, const char* source) {
+    loopsCount = 0;
+
+    for (int i = 0; i < blocksCount; ++i) {
+        loopByHeader[i] = NO_LOOP;
+    }
+
+    for (int i = 0; i < blocksCount; ++i) {
+        for (int j = 0; j < blocks[i].successorsCount; ++j) {
+            if (!blocks[i].backEdges[j]) {
+                continue;
+            }
+
+            int header = blocks[i].successors[j];
+            if (loopByHeader[header] == NO_LOOP) {
+                loopByHeader[header] = loopsCount;
+                loops[loopsCount++] = (struct Loop) { header, true, 0, 0, 0, NULL, 0 };
+            }
+
+            struct Loop* loop = &loops[loopByHeader[header]];
+            uint64_t bound = getAnnotatedBound(source, result->lineNumberByAddress[blocks[i].end]);
+            loop->bounded = loop->bounded && bound != STEPS_UNBOUNDED;
+            loop->bound = addSteps(loop->bound, bound);
+        }
+    }
+}
+
+/// Marks blocks which reach a back edge of the loop without passing its header, and returns their number.
+static int markLoopBody(int loop) {
+    int header = loops[loop].header;
+    int stackSize = 0;
+    int bodySize = 1;
+    bodyLoop[header] = loop;
+
+    for (int i = predecessorsStart[header]; i < predecessorsStart[header + 1]; ++i) {
+        int latch = predecessors[i];
+        for (int j = 0; j < blocks[latch].successorsCount; ++j) {
+            if (blocks[latch].successors[j] == header && blocks[latch].backEdges[j] && bodyLoop[latch] != loop) {
+                bodyLoop[latch] = loop;
+                blocksStack[stackSize++] = latch;
+                ++bodySize;
+            }
+        }
+    }
+
+    while (stackSize > 0) {
+        int block = blocksStack[--stackSize];
+        for (int i = predecessorsStart[block]; i < predecessorsStart[block + 1]; ++i) {
+            if (bodyLoop[predecessors[i]] != loop) {
+                bodyLoop[predecessors[i]] = loop;
+                blocksStack[stackSize++] = predecessors[i];
+                ++bodySize;
+            }
+        }
+    }
+
+    return bodySize;
+}
+
+static bool isFollowedWithin(int block, int successorIndex, int loop) {
+    int successor = blocks[block].successors[successorIndex];
+    return !blocks[block].backEdges[successorIndex]
+        && (loop == loopsCount || (bodyLoop[successor] == loop && successor != loops[loop].header));
+}
+
+/**
+ * Returns the worst case number of steps starting at the block, and ending
+ * after leaving the loop (or halting, if `loop` is `loopsCount`). Loops
+ * entered on the way count as a single block taking all of their iterations.
+ */
+static uint64_t getWorstCaseSteps(int block, int loop) {
+    if (worstCaseContext[block] == loop) {
+        return worstCaseSteps[block];
+    } else if (onPath[block]) {
+        return STEPS_UNBOUNDED; // A cycle, which isn't closed by a back edge, enters a loop past its header
+    }
+
+    onPath[block] = true;
+
+    int innerLoop = collapsedLoop[block];
+    uint64_t steps;
+    uint64_t stepsAfter = 0;
+
+    if (innerLoop != NO_LOOP) {
+        steps = loops[innerLoop].worstCaseSteps;
+        for (int i = 0; i < loops[innerLoop].exitsCount; ++i) {
+            int exit = loops[innerLoop].exits[i];
+            if (loop == loopsCount || (bodyLoop[exit] == loop && exit != loops[loop].header)) {
+                uint64_t exitSteps = getWorstCaseSteps(exit, loop);
+                stepsAfter = exitSteps > stepsAfter ? exitSteps : stepsAfter;
+            }
+        }
+    } else {
+        steps = blocks[block].instructionsCount;
+        if (blocks[block].leavingAddressesCount > 0 || blocks[block].returns) {
+            stepsAfter = STEPS_UNBOUNDED; // Execution continues at code which isn't known
+        }
+        for (int i = 0; i < blocks[block].successorsCount; ++i) {
+            if (isFollowedWithin(block, i, loop)) {
+                uint64_t successorSteps = getWorstCaseSteps(blocks[block].successors[i], loop);
+                stepsAfter = successorSteps > stepsAfter ? successorSteps : stepsAfter;
+            }
+        }
+    }
+
+    onPath[block] = false;
+    worstCaseContext[block] = loop;
+    worstCaseSteps[block] = addSteps(steps, stepsAfter);
+    return worstCaseSteps[block];
+}
+
+static int compareLoopsBySize(const void* a, const void* b) {
+    return loops[*(const int*) a].bodySize - loops[*(const int*) b].bodySize;
+}
+
+/// Computes the worst case of every loop, starting with the innermost ones, and replaces each loop with a single block.
+static void collapseLoops() {
+    for (int i = 0; i < blocksCount; ++i) {
+        bodyLoop[i] = NO_LOOP;
+        collapsedLoop[i] = NO_LOOP;
+        worstCaseContext[i] = NO_LOOP;
+        onPath[i] = false;
+    }
+
+    for (int i = 0; i < loopsCount; ++i) {
+        loops[i].bodySize = markLoopBody(i);
+        loopsBySize[i] = i;
+    }
+
+    qsort(loopsBySize, loopsCount, sizeof(int), compareLoopsBySize);
+
+    // Each body is marked again, so the marks must not be left by the same loop
+    for (int i = 0; i < blocksCount; ++i) {
+        bodyLoop[i] = NO_LOOP;
+    }
+
+    for (int i = 0; i < loopsCount; ++i) {
+        int loop = loopsBySize[i];
+        markLoopBody(loop);
+
+        uint64_t iterationSteps = getWorstCaseSteps(loops[loop].header, loop);
+        loops[loop].worstCaseSteps = loops[loop].bounded ? multiplySteps(addSteps(loops[loop].bound, 1), iterationSteps) : STEPS_UNBOUNDED;
+        loops[loop].exits = malloc(blocksCount * 2 * sizeof(int));
+        loops[loop].exitsCount = 0;
+
+        for (int block = 0; block < blocksCount; ++block) {
+            if (bodyLoop[block] != loop) {
+                continue;
+            }
+            collapsedLoop[block] = loop;
+            for (int j = 0; j < blocks[block].successorsCount; ++j) {
+                if (!blocks[block].backEdges[j] && bodyLoop[blocks[block].successors[j]] != loop) {
+                    loops[loop].exits[loops[loop].exitsCount++] = blocks[block].successors[j];
+                }
+            }
+        }
+    }
+}
+
+/// Returns the number of steps on the longest path starting at the block, which doesn't follow back edges.
+static uint64_t getAcyclicSteps(int block) {
+    if (!acyclicStepsKnown[block]) {
+        uint64_t stepsAfter = 0;
+        for (int i = 0; i < blocks[block].successorsCount; ++i) {
+            if (!blocks[block].backEdges[i]) {
+                uint64_t successorSteps = getAcyclicSteps(blocks[block].successors[i]);
+                stepsAfter = successorSteps > stepsAfter ? successorSteps : stepsAfter;
+            }
+        }
+        acyclicSteps[block] = blocks[block].instructionsCount + stepsAfter;
+        acyclicStepsKnown[block] = true;
+    }
+    return acyclicSteps[block];
+}
+
+static void writeSteps(FILE* file, uint64_t steps) {
+    if (steps == STEPS_UNBOUNDED) {
+        fprintf(file, "unbounded");
+    } else {
+        fprintf(file, "%llu steps", (unsigned long long) steps);
+    }
+}
+
+static void writeAddressName(FILE* file, struct AssemblerResult* result, int address) {
+    if (result->labelNameByAddress[address] != NULL) {
+        fprintf(file, "%s", result->labelNameByAddress[address]);
+    } else {
+        fprintf(file, "0x%04X", address);
+    }
+}
+
+/// Writes the analysis of the code following each label, up to the next label.
+static void writeRoutines(FILE* file, struct AssemblerResult* result) {
+    fprintf(file, "Routines:\n");
+
+    for (int address = 0; address < ADDRESS_SPACE_SIZE; ++address) {
+        if (!isInstruction(result, address) || (result->labelNameByAddress[address] == NULL && address != 0)) {
+            continue;
+        }
+
+        int instructionsCount = 0;
+        for (int i = address; i < ADDRESS_SPACE_SIZE && (i == address || result->labelNameByAddress[i] == NULL); ++i) {
+            instructionsCount += isInstruction(result, i);
+        }
+
+        int block = blockByAddress[address];
+        writeAddressName(file, result, address);
+        fprintf(file, ": %d instructions, longest acyclic path %llu steps, worst case ", instructionsCount, (unsigned long long) getAcyclicSteps(block));
+        writeSteps(file, getWorstCaseSteps(block, loopsCount));
+        fprintf(file, "\n");
+    }
+}
+
+static void writeLoops(FILE* file, struct AssemblerResult* result, const char* source) {
+    if (loopsCount == 0) {
+        return;
+    }
+
+    fprintf(file, "\nLoops:\n");
+
+    for (int header = 0; header < blocksCount; ++header) {
+        int loop = loopByHeader[header];
+        if (loop == NO_LOOP) {
+            continue;
+        }
+
+        writeAddressName(file, result, blocks[header].start);
+        fprintf(file, " (line %d): worst case ", result->lineNumberByAddress[blocks[header].start]);
+        writeSteps(file, loops[loop].worstCaseSteps);
+        fprintf(file, "\n");
+
+        for (int i = predecessorsStart[header]; i < predecessorsStart[header + 1]; ++i) {
+            int latch = predecessors[i];
+            for (int j = 0; j < blocks[latch].successorsCount; ++j) {
+                if (blocks[latch].successors[j] != header || !blocks[latch].backEdges[j]) {
+                    continue;
+                }
+                int lineNumber = result->lineNumberByAddress[blocks[latch].end];
+                uint64_t bound = getAnnotatedBound(source, lineNumber);
+                if (bound == STEPS_UNBOUNDED) {
+                    fprintf(file, "    line %d: jump back without a bound annotation\n", lineNumber);
+                } else {
+                    fprintf(file, "    line %d: jump back at most %llu times\n", lineNumber, (unsigned long long) bound);
+                }
+            }
+        }
+    }
+}
+
+static void writeWarnings(FILE* file, struct AssemblerResult* result) {
+    bool warningsWritten = false;
+
+    if (!isInstruction(result, 0)) {
+        fprintf(file, "\nWarnings:\nexecution starts at 0x0000, which isn't an instruction\n");
+        warningsWritten = true;
+    }
+
+    for (int i = 0; i < blocksCount; ++i) {
+        for (int j = 0; j < blocks[i].leavingAddressesCount; ++j) {
+            fprintf(file, "%sline %d: execution continues at 0x%04X, which isn't an instruction\n",
+                warningsWritten ? "" : "\nWarnings:\n", result->lineNumberByAddress[blocks[i].end], blocks[i].leavingAddresses[j]);
+            warningsWritten = true;
+        }
+        if (blocks[i].returns) {
+            fprintf(file, "%sline %d: RET returns to the address stored by CALL, which isn't analyzed\n",
+                warningsWritten ? "" : "\nWarnings:\n", result->lineNumberByAddress[blocks[i].end]);
+            warningsWritten = true;
+        }
+    }
+}
+
+uint64_t writePathAnalysis(FILE* file, struct AssemblerResult* result, const char* source) {
+    buildBlocks(result);
+    indexPredecessors();
+
+    memset(visitState, 0, sizeof(visitState));
+    memset(acyclicStepsKnown, 0, sizeof(acyclicStepsKnown));
+
+    // Depth-first search starts at the entry point, so that loops are closed by the jumps back to their beginning
+    if (blockByAddress[0] != NO_BLOCK) {
+        findBackEdges(blockByAddress[0]);
+    }
+    for (int i = 0; i < ADDRESS_SPACE_SIZE; ++i) {
+        if (blockByAddress[i] != NO_BLOCK && result->labelNameByAddress[i] != NULL && visitState[blockByAddress[i]] == VisitStateNotVisited) {
+            findBackEdges(blockByAddress[i]);
+        }
+    }
+    for (int i = 0; i < blocksCount; ++i) {
+        if (visitState[i] == VisitStateNotVisited) {
+            findBackEdges(i);
+        }
+    }
+
+    findLoops(result, source);
+    collapseLoops();
+
+    int instructionsCount = 0;
+    for (int i = 0; i < blocksCount; ++i) {
+        instructionsCount += blocks[i].instructionsCount;
+    }
+
+    uint64_t entrySteps = blockByAddress[0] == NO_BLOCK ? STEPS_UNBOUNDED : getWorstCaseSteps(blockByAddress[0], loopsCount);
+
+    fprintf(file, "Instructions: %d, blocks: %d, worst case ", instructionsCount, blocksCount);
+    writeSteps(file, entrySteps);
+    fprintf(file, "\n\n");
+    writeRoutines(file, result);
+    writeLoops(file, result, source);
+    writeWarnings(file, result);
+
+    for (int i = 0; i < loopsCount; ++i) {
+        free(loops[i].exits);
+    }
+
+    return entrySteps;
+}
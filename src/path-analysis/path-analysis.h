@@ -0,0 +1,23 @@
+#ifndef path_analysis
+#define path_analysis
+
+#include <stdio.h>
+#include <stdint.h>
+#include "../assembler/assembler.h"
+
+#define STEPS_UNBOUNDED UINT64_MAX
+
+/**
+ * Builds the control flow graph of the assembled program, with basic blocks
+ * split at labels, at jump targets and after jumps, and writes the number of
+ * instructions, the longest acyclic path and the worst case number of steps
+ * starting at each label, followed by the loops and the jumps which leave
+ * the code. A loop is bounded if the comment on the line of every jump back
+ * to its first instruction contains "@bound N", N being the maximum number of
+ * times the jump is taken each time the loop is entered. A RET leaves the
+ * analyzed code, since its target is stored by CALL when running. Returns
+ * the worst case number of steps starting at address 0, or STEPS_UNBOUNDED.
+ */
+uint64_t writePathAnalysis(FILE* file, struct AssemblerResult* result, const char* source);
+
+#endif
@@ -3,17 +3,58 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <stdint.h>
 #include "../../common/exit-code.h"
 
+/// Parses the argument of the flag as a non-negative number, or exits the program if it's missing or invalid.
+static unsigned long long parseFlagNumber(int argc, const char * argv[], int i, const char* description) {
+    if (i + 1 == argc) {
+        printf("Error: %s was not provided.\n", description);
+        exit(ExitCodeProgramArgumentsInvalid);
+    }
+
+    char* endChar;
+    unsigned long long value = strtoull(argv[i + 1], &endChar, 0);
+
+    if (*endChar != 0 || argv[i + 1][0] == '-' || argv[i + 1][0] == 0) {
+        printf("Error: \"%s\" is not a valid %s.\n", argv[i + 1], description);
+        exit(ExitCodeProgramArgumentsInvalid);
+    }
+
+    return value;
+}
+
 struct ProgramInput getProgramInput(int argc, const char * argv[]) {
     const char* asmFilePath = NULL;
     const char* binaryFilePath = NULL;
     const char* symbolsFilePath = NULL;
+    const char* symbolIndexFilePath = NULL;
+    enum StatisticsFormat statisticsFormat = StatisticsFormatNone;
+    enum BinaryFormat binaryFormat = BinaryFormatRaw;
+    enum ProgramMode mode = ProgramModeAssemble;
+    unsigned long long maxSteps = ULLONG_MAX;
+    const char* snapshotFilePath = NULL;
+    const char* traceFilePath = NULL;
+    const char** coverageFilePaths = NULL;
+    int coverageFilesCount = 0;
+    const char* sequence = NULL;
+    const char* rewritesFilePath = NULL;
+    const char* expansionsFilePath = NULL;
+    const char* listingFilePath = NULL;
+    enum ExpansionGoal expansionGoal = ExpansionGoalSize;
+    bool isCompressed = false;
+    unsigned long long nanosecondsPerStep = 0;
+    unsigned long long stepsBudget = ULLONG_MAX;
+    unsigned long long timeoutMs = 0;
+    const char* layoutProfilePath = NULL;
 
     bool helpFlag = false;
+    const char** positionalArguments = calloc(argc + 3, sizeof(const char*)); // At least 3, so that optional arguments read as NULL
+    int positionalArgumentsCount = 0;
 
     for (int i = 1; i < argc; ++i) {
-        if (argv[i][0] == '-') {
+        if (argv[i][0] == '-' && strcmp(argv[i], STREAMED_SOURCE_PATH) != 0) {
             if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
                 if (helpFlag) {
                     printf("Error: help flag was used more than once.\n");
@@ -21,38 +62,305 @@ struct ProgramInput getProgramInput(int argc, const char * argv[]) {
                 } else {
                     helpFlag = true;
                 }
+            } else if (strcmp(argv[i], "--stats") == 0 || strcmp(argv[i], "--stats-json") == 0) {
+                if (statisticsFormat != StatisticsFormatNone) {
+                    printf("Error: statistics flag was used more than once.\n");
+                    exit(ExitCodeProgramArgumentsInvalid);
+                } else {
+                    statisticsFormat = strcmp(argv[i], "--stats") == 0 ? StatisticsFormatText : StatisticsFormatJson;
+                }
+            } else if (strcmp(argv[i], "--disassemble") == 0 || strcmp(argv[i], "--run") == 0 || strcmp(argv[i], "--decode-trace") == 0 || strcmp(argv[i], "--coverage-report") == 0 || strcmp(argv[i], "--analyze") == 0 || strcmp(argv[i], "--superoptimize") == 0) {
+                if (mode != ProgramModeAssemble) {
+                    printf("Error: mode flag was used more than once.\n");
+                    exit(ExitCodeProgramArgumentsInvalid);
+                } else if (strcmp(argv[i], "--disassemble") == 0) {
+                    mode = ProgramModeDisassemble;
+                } else if (strcmp(argv[i], "--coverage-report") == 0) {
+                    mode = ProgramModeCoverageReport;
+                } else if (strcmp(argv[i], "--analyze") == 0) {
+                    mode = ProgramModeAnalyze;
+                } else if (strcmp(argv[i], "--superoptimize") == 0) {
+                    mode = ProgramModeSuperoptimize;
+                } else {
+                    mode = strcmp(argv[i], "--run") == 0 ? ProgramModeRun : ProgramModeDecodeTrace;
+                }
+            } else if (strcmp(argv[i], "--trace") == 0) {
+                if (traceFilePath != NULL) {
+                    printf("Error: trace flag was used more than once.\n");
+                    exit(ExitCodeProgramArgumentsInvalid);
+                } else if (i + 1 == argc) {
+                    printf("Error: trace destination file path was not provided.\n");
+                    exit(ExitCodeProgramArgumentsInvalid);
+                } else {
+                    traceFilePath = argv[++i];
+                }
+            } else if (strcmp(argv[i], "--coverage") == 0) {
+                if (coverageFilesCount > 0) {
+                    printf("Error: coverage flag was used more than once.\n");
+                    exit(ExitCodeProgramArgumentsInvalid);
+                } else if (i + 1 == argc) {
+                    printf("Error: coverage destination file path was not provided.\n");
+                    exit(ExitCodeProgramArgumentsInvalid);
+                } else {
+                    coverageFilePaths = argv + ++i;
+                    coverageFilesCount = 1;
+                }
+            } else if (strcmp(argv[i], "--virtual-clock") == 0) {
+                if (nanosecondsPerStep != 0) {
+                    printf("Error: virtual clock flag was used more than once.\n");
+                    exit(ExitCodeProgramArgumentsInvalid);
+                }
+                nanosecondsPerStep = parseFlagNumber(argc, argv, i++, "number of nanoseconds per instruction");
+                if (nanosecondsPerStep == 0 || nanosecondsPerStep > UINT32_MAX) {
+                    printf("Error: the number of nanoseconds per instruction must be between 1 and %u.\n", UINT32_MAX);
+                    exit(ExitCodeProgramArgumentsInvalid);
+                }
+            } else if (strcmp(argv[i], "--budget") == 0) {
+                if (stepsBudget != ULLONG_MAX) {
+                    printf("Error: budget flag was used more than once.\n");
+                    exit(ExitCodeProgramArgumentsInvalid);
+                }
+                stepsBudget = parseFlagNumber(argc, argv, i++, "instruction budget");
+            } else if (strcmp(argv[i], "--timeout") == 0) {
+                if (timeoutMs != 0) {
+                    printf("Error: timeout flag was used more than once.\n");
+                    exit(ExitCodeProgramArgumentsInvalid);
+                }
+                timeoutMs = parseFlagNumber(argc, argv, i++, "timeout");
+                if (timeoutMs == 0) {
+                    printf("Error: the timeout must be at least 1 ms.\n");
+                    exit(ExitCodeProgramArgumentsInvalid);
+                }
+            } else if (strcmp(argv[i], "--rewrites") == 0) {
+                if (rewritesFilePath != NULL) {
+                    printf("Error: rewrites flag was used more than once.\n");
+                    exit(ExitCodeProgramArgumentsInvalid);
+                } else if (i + 1 == argc) {
+                    printf("Error: rewrites file path was not provided.\n");
+                    exit(ExitCodeProgramArgumentsInvalid);
+                } else {
+                    rewritesFilePath = argv[++i];
+                }
+            } else if (strcmp(argv[i], "--layout") == 0) {
+                if (layoutProfilePath != NULL) {
+                    printf("Error: layout flag was used more than once.\n");
+                    exit(ExitCodeProgramArgumentsInvalid);
+                } else if (i + 1 == argc) {
+                    printf("Error: layout profile file path was not provided.\n");
+                    exit(ExitCodeProgramArgumentsInvalid);
+                } else {
+                    layoutProfilePath = argv[++i];
+                }
+            } else if (strcmp(argv[i], "--expansions") == 0) {
+                if (expansionsFilePath != NULL) {
+                    printf("Error: expansions flag was used more than once.\n");
+                    exit(ExitCodeProgramArgumentsInvalid);
+                } else if (i + 1 == argc) {
+                    printf("Error: expansions destination file path was not provided.\n");
+                    exit(ExitCodeProgramArgumentsInvalid);
+                } else {
+                    expansionsFilePath = argv[++i];
+                }
+            } else if (strcmp(argv[i], "--listing") == 0) {
+                if (listingFilePath != NULL) {
+                    printf("Error: listing flag was used more than once.\n");
+                    exit(ExitCodeProgramArgumentsInvalid);
+                } else if (i + 1 == argc) {
+                    printf("Error: listing destination file path was not provided.\n");
+                    exit(ExitCodeProgramArgumentsInvalid);
+                } else {
+                    listingFilePath = argv[++i];
+                }
+            } else if (strcmp(argv[i], "--optimize-speed") == 0) {
+                if (expansionGoal != ExpansionGoalSize) {
+                    printf("Error: optimize speed flag was used more than once.\n");
+                    exit(ExitCodeProgramArgumentsInvalid);
+                } else {
+                    expansionGoal = ExpansionGoalSpeed;
+                }
+            } else if (strcmp(argv[i], "--ihex") == 0) {
+                if (binaryFormat != BinaryFormatRaw) {
+                    printf("Error: Intel HEX flag was used more than once.\n");
+                    exit(ExitCodeProgramArgumentsInvalid);
+                } else {
+                    binaryFormat = BinaryFormatIntelHex;
+                }
+            } else if (strcmp(argv[i], "--compress") == 0) {
+                if (isCompressed) {
+                    printf("Error: compress flag was used more than once.\n");
+                    exit(ExitCodeProgramArgumentsInvalid);
+                } else {
+                    isCompressed = true;
+                }
+            } else if (strcmp(argv[i], "--symbol-index") == 0) {
+                if (symbolIndexFilePath != NULL) {
+                    printf("Error: symbol index flag was used more than once.\n");
+                    exit(ExitCodeProgramArgumentsInvalid);
+                } else if (i + 1 == argc) {
+                    printf("Error: symbol index destination file path was not provided.\n");
+                    exit(ExitCodeProgramArgumentsInvalid);
+                } else {
+                    symbolIndexFilePath = argv[++i];
+                }
             } else {
                 printf("Error: unknown flag \"%s\".\n", argv[i]);
                 exit(ExitCodeProgramArgumentsInvalid);
             }
         } else {
-            if (i == 1) {
-                asmFilePath = argv[i];
-            } else if (i == 2) {
-                binaryFilePath = argv[i];
-            } else if (i == 3) {
-                symbolsFilePath = argv[i];
-            } else {
-                printf("Error: too many arguments.\n");
+            positionalArguments[positionalArgumentsCount++] = argv[i];
+        }
+    }
+
+    if (positionalArgumentsCount > (mode == ProgramModeCoverageReport ? argc : mode == ProgramModeDecodeTrace || mode == ProgramModeAnalyze || mode == ProgramModeSuperoptimize ? 2 : 3)) {
+        printf("Error: too many arguments.\n");
+        exit(ExitCodeProgramArgumentsInvalid);
+    }
+
+    if (traceFilePath != NULL && mode != ProgramModeRun) {
+        printf("Error: the trace flag can only be used with the run flag.\n");
+        exit(ExitCodeProgramArgumentsInvalid);
+    }
+
+    if (coverageFilesCount > 0 && mode != ProgramModeRun) {
+        printf("Error: the coverage flag can only be used with the run flag.\n");
+        exit(ExitCodeProgramArgumentsInvalid);
+    }
+
+    if ((nanosecondsPerStep != 0 || stepsBudget != ULLONG_MAX || timeoutMs != 0) && mode != ProgramModeRun) {
+        printf("Error: the virtual clock, budget and timeout flags can only be used with the run flag.\n");
+        exit(ExitCodeProgramArgumentsInvalid);
+    }
+
+    if (rewritesFilePath != NULL && mode != ProgramModeAssemble) {
+        printf("Error: the rewrites flag can only be used when assembling.\n");
+        exit(ExitCodeProgramArgumentsInvalid);
+    }
+
+    if (rewritesFilePath != NULL && positionalArguments[0] != NULL && strcmp(positionalArguments[0], STREAMED_SOURCE_PATH) == 0) {
+        printf("Error: the rewrites flag can't be used with a streamed source.\n");
+        exit(ExitCodeProgramArgumentsInvalid);
+    }
+
+    if (layoutProfilePath != NULL && positionalArguments[0] != NULL && strcmp(positionalArguments[0], STREAMED_SOURCE_PATH) == 0) {
+        printf("Error: the layout flag can't be used with a streamed source.\n");
+        exit(ExitCodeProgramArgumentsInvalid);
+    }
+
+    if (listingFilePath != NULL && positionalArguments[0] != NULL && strcmp(positionalArguments[0], STREAMED_SOURCE_PATH) == 0) {
+        printf("Error: the listing flag can't be used with a streamed source.\n");
+        exit(ExitCodeProgramArgumentsInvalid);
+    }
+
+    if (mode == ProgramModeAssemble) {
+        asmFilePath = positionalArguments[0];
+        binaryFilePath = positionalArguments[1];
+        symbolsFilePath = positionalArguments[2];
+    } else if (mode == ProgramModeDisassemble) {
+        binaryFilePath = positionalArguments[0];
+        asmFilePath = positionalArguments[1];
+        symbolsFilePath = positionalArguments[2];
+    } else if (mode == ProgramModeDecodeTrace) {
+        traceFilePath = positionalArguments[0];
+        symbolsFilePath = positionalArguments[1];
+    } else if (mode == ProgramModeCoverageReport) {
+        asmFilePath = positionalArguments[0];
+        coverageFilePaths = positionalArguments + 1;
+        coverageFilesCount = positionalArgumentsCount > 0 ? positionalArgumentsCount - 1 : 0;
+    } else if (mode == ProgramModeSuperoptimize) {
+        sequence = positionalArguments[0];
+        rewritesFilePath = positionalArguments[1];
+    } else {
+        if (mode == ProgramModeAnalyze) {
+            asmFilePath = positionalArguments[0];
+        } else {
+            binaryFilePath = positionalArguments[0];
+            snapshotFilePath = positionalArguments[2];
+        }
+        if (positionalArguments[1] != NULL) {
+            char* endChar;
+            maxSteps = strtoull(positionalArguments[1], &endChar, 0);
+            if (*endChar != 0 || positionalArguments[1][0] == '-') {
+                printf("Error: \"%s\" is not a valid number of steps.\n", positionalArguments[1]);
                 exit(ExitCodeProgramArgumentsInvalid);
             }
         }
     }
 
     if (argc == 1 || helpFlag) {
-        printf("W13 assembler. Copyright (C) 2025 Piotr Marczyński. This program is licensed under GNU GPL v3. See file COPYING.\n");
+        printf(TARGET_NAME " assembler. Copyright (C) 2025 Piotr Marczyński. This program is licensed under GNU GPL v3. See file COPYING.\n");
         printf("Usage:\n");
-        printf("w13asm [path/to/assembly-source.asm] [path/to/binary-destination.bin] [path/to/symbols-destination.csv]\n");
+        printf(TARGET_FILE_NAME "asm [path/to/assembly-source.asm] [path/to/binary-destination.bin] [path/to/symbols-destination.csv]\n");
         printf("Assembles the source file and saves the resulting binary file.\n");
         printf("Assembly source and binary destination paths are required.\n");
         printf("Symbols destination path is optional.\n");
+        printf("If the source path is \"-\", the source is read from the standard input and assembled in a single pass as it's read.\n");
+        printf(TARGET_FILE_NAME "asm --disassemble [path/to/binary.bin] [path/to/assembly-destination.asm] [path/to/symbols.csv]\n");
+        printf("Disassembles the binary file and saves assembly source, which assembles to the same binary.\n");
+        printf("Binary and assembly destination paths are required.\n");
+        printf("Symbols path is optional, and may point to a symbols CSV file or a binary symbol index.\n");
+        printf(TARGET_FILE_NAME "asm --run [path/to/binary.bin] [max steps] [path/to/snapshot-destination." TARGET_FILE_NAME "s]\n");
+        printf("Runs the binary file, or resumes a snapshot, with standard input and output as the terminal.\n");
+        printf("Optionally stops after the given number of steps, and saves the state of the machine to a snapshot.\n");
+        printf(TARGET_FILE_NAME "asm --decode-trace [path/to/trace." TARGET_FILE_NAME "t] [path/to/symbols.csv]\n");
+        printf("Prints the execution trace as comma-separated values. Symbols path is optional.\n");
+        printf(TARGET_FILE_NAME "asm --coverage-report [path/to/assembly-source.asm] [path/to/coverage." TARGET_FILE_NAME "c] [path/to/more-coverage." TARGET_FILE_NAME "c] ...\n");
+        printf("Merges the coverage files recorded by running the assembled source, and prints the coverage of every label and line.\n");
+        printf(TARGET_FILE_NAME "asm --analyze [path/to/assembly-source.asm] [max steps]\n");
+        printf("Prints the number of instructions, the longest acyclic path and the worst case number of steps starting at each label.\n");
+        printf("Optionally fails if the worst case number of steps starting at address 0 is greater than the given number.\n");
+        printf(TARGET_FILE_NAME "asm --superoptimize \"[instruction; instruction; ...]\" [path/to/rewrites.txt]\n");
+        printf("Searches for the shortest sequence of instructions with the same effect on A and on up to 2 variables, e.g. \"ld x; add #1; add #1\".\n");
+        printf("Optionally appends the rewrite to the rewrites file, which can be applied when assembling.\n");
         printf("Flags:\n");
         printf("-h or --help - prints this message.\n");
+        printf("--disassemble - disassembles a binary instead of assembling a source.\n");
+        printf("--run - runs a binary or a snapshot instead of assembling a source.\n");
+        printf("--decode-trace - prints an execution trace instead of assembling a source.\n");
+        printf("--coverage-report - prints a coverage report instead of assembling a source.\n");
+        printf("--analyze - prints a static analysis of the paths through the code instead of assembling a source.\n");
+        printf("--superoptimize - searches for a shorter sequence of instructions instead of assembling a source.\n");
+        printf("--virtual-clock [nanoseconds] - advances the timer by the given time per instruction executed with --run instead of following the wall clock.\n");
+        printf("--budget [steps] - fails if the program run with --run doesn't halt within the given number of instructions.\n");
+        printf("--timeout [milliseconds] - fails if the program run with --run doesn't halt within the given wall-clock time.\n");
+        printf("--rewrites [path/to/rewrites.txt] - replaces sequences of instructions in the source with the shorter ones from the rewrites file before assembling.\n");
+        printf("--layout [path/to/coverage." TARGET_FILE_NAME "c] - reorders blocks of code in the source before assembling, so that the jumps executed most often in the recorded run fall through.\n");
+        printf("--trace [path/to/trace." TARGET_FILE_NAME "t] - records every instruction executed with --run in a binary trace file.\n");
+        printf("--coverage [path/to/coverage." TARGET_FILE_NAME "c] - records the instructions and conditional jumps executed with --run, and how many times, in a coverage file.\n");
+        printf("--expansions [path/to/expansions.txt] - additionally saves the instructions which every pseudo-instruction was expanded into.\n");
+        printf("--listing [path/to/listing.txt] - additionally saves the memory map and every source line with the address and bytes it declared.\n");
+        printf("--optimize-speed - expands pseudo-instructions into the fastest instead of the shortest sequences.\n");
+        printf("--ihex - saves only the declared memory ranges in the Intel HEX format instead of a raw binary.\n");
+        printf("--compress - saves the program compressed behind a stub, which unpacks it in place when run.\n");
+        printf("--symbol-index [path/to/symbols.idx] - additionally saves the symbols as a binary index, which can be memory-mapped.\n");
+        printf("--stats - prints phase timings and counters after assembling.\n");
+        printf("--stats-json - same as --stats, formatted as JSON.\n");
         exit(ExitCodeSuccess);
-    } else if (binaryFilePath == NULL) {
+    } else if (mode == ProgramModeRun && binaryFilePath == NULL) {
+        printf("Error: binary file path was not provided.\n");
+        exit(ExitCodeProgramArgumentsInvalid);
+    } else if (mode == ProgramModeDecodeTrace && traceFilePath == NULL) {
+        printf("Error: trace file path was not provided.\n");
+        exit(ExitCodeProgramArgumentsInvalid);
+    } else if ((mode == ProgramModeAssemble || mode == ProgramModeDisassemble) && positionalArguments[1] == NULL) {
         printf("Error: destination file path was not provided.\n");
         exit(ExitCodeProgramArgumentsInvalid);
+    } else if (mode == ProgramModeAnalyze && asmFilePath == NULL) {
+        printf("Error: assembly source file path was not provided.\n");
+        exit(ExitCodeProgramArgumentsInvalid);
+    } else if (mode == ProgramModeSuperoptimize && sequence == NULL) {
+        printf("Error: instruction sequence was not provided.\n");
+        exit(ExitCodeProgramArgumentsInvalid);
+    } else if (mode == ProgramModeCoverageReport && coverageFilesCount == 0) {
+        printf("Error: coverage file path was not provided.\n");
+        exit(ExitCodeProgramArgumentsInvalid);
+    } else if (mode != ProgramModeAssemble && (binaryFormat != BinaryFormatRaw || symbolIndexFilePath != NULL || statisticsFormat != StatisticsFormatNone || expansionsFilePath != NULL || listingFilePath != NULL || expansionGoal != ExpansionGoalSize || isCompressed || layoutProfilePath != NULL)) {
+        printf("Error: the mode flag can't be combined with flags which apply to assembling.\n");
+        exit(ExitCodeProgramArgumentsInvalid);
+    }
+
+    if (mode != ProgramModeCoverageReport) { // Otherwise the coverage file paths are kept in it for the whole run
+        free(positionalArguments);
     }
 
-    return (struct ProgramInput) { asmFilePath, binaryFilePath, symbolsFilePath };
+    return (struct ProgramInput) { asmFilePath, binaryFilePath, symbolsFilePath, symbolIndexFilePath, statisticsFormat, binaryFormat, mode, maxSteps, snapshotFilePath, traceFilePath, coverageFilePaths, coverageFilesCount, sequence, rewritesFilePath, expansionsFilePath, listingFilePath, expansionGoal, isCompressed, nanosecondsPerStep, stepsBudget, timeoutMs, layoutProfilePath };
 }
\ No newline at end of file
@@ -2,11 +2,44 @@
 #define program_input
 
 #include <stdbool.h>
+#include "../statistics-report/statistics-report.h"
+#include "../output/output.h"
+
+#define STREAMED_SOURCE_PATH "-" // Assembles the standard input as a stream
+
+enum ProgramMode {
+    ProgramModeAssemble,
+    ProgramModeDisassemble,
+    ProgramModeRun,
+    ProgramModeDecodeTrace,
+    ProgramModeCoverageReport,
+    ProgramModeAnalyze,
+    ProgramModeSuperoptimize
+};
 
 struct ProgramInput {
     const char* asmFilePath;
     const char* binaryFilePath;
     const char* symbolsFilePath;
+    const char* symbolIndexFilePath;
+    enum StatisticsFormat statisticsFormat;
+    enum BinaryFormat binaryFormat;
+    enum ProgramMode mode;
+    unsigned long long maxSteps;
+    const char* snapshotFilePath;
+    const char* traceFilePath;
+    const char** coverageFilePaths; // The destination with --run, or the files to merge with --coverage-report
+    int coverageFilesCount;
+    const char* sequence;
+    const char* rewritesFilePath; // The rewrites applied when assembling, or the database extended with --superoptimize
+    const char* expansionsFilePath;
+    const char* listingFilePath;
+    enum ExpansionGoal expansionGoal;
+    bool isCompressed; // The binary is saved with a stub which unpacks the program
+    unsigned long long nanosecondsPerStep; // The virtual clock rate with --run, or 0 to keep the clock of the snapshot or the wall clock
+    unsigned long long stepsBudget; // Running fails if the program doesn't halt within the budget
+    unsigned long long timeoutMs; // Running fails if the program doesn't halt within the timeout, unless it's 0
+    const char* layoutProfilePath; // The coverage file whose execution counts the code is laid out by when assembling
 };
 
 struct ProgramInput getProgramInput(int argc, const char * argv[]);
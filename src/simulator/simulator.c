@@ -0,0 +1,380 @@
+#include "simulator.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "../statistics-report/statistics-report.h"
+#include "../../common/little-endian.h"
+
+#define SNAPSHOT_VERSION 2 // Version 1 had no virtual clock
+#define NANOSECONDS_PER_MILLISECOND 1000000
+
+static void releasePage(struct MemoryPage* page) {
+    if (page != NULL && --page->referencesCount == 0) {
+        free(page);
+    }
+}
+
+/// Returns a page which may be written to, duplicating it first if it's shared.
+static struct MemoryPage* getWritablePage(struct Machine* machine, int pageIndex) {
+    struct MemoryPage* page = machine->pages[pageIndex];
+
+    if (page != NULL && page->referencesCount == 1) {
+        return page;
+    }
+
+    struct MemoryPage* copy = malloc(sizeof(struct MemoryPage));
+    copy->referencesCount = 1;
+
+    if (page == NULL) {
+        memset(copy->bytes, 0, MEMORY_PAGE_SIZE);
+    } else {
+        memcpy(copy->bytes, page->bytes, MEMORY_PAGE_SIZE);
+        releasePage(page);
+    }
+
+    machine->pages[pageIndex] = copy;
+    return copy;
+}
+
+static void writeMemory(struct Machine* machine, int address, uint8_t value) {
+    if (machine->pages[address / MEMORY_PAGE_SIZE] == NULL && value == 0) {
+        return;
+    }
+    getWritablePage(machine, address / MEMORY_PAGE_SIZE)->bytes[address % MEMORY_PAGE_SIZE] = value;
+}
+
+uint8_t peekMemory(struct Machine* machine, int address) {
+    struct MemoryPage* page = machine->pages[address / MEMORY_PAGE_SIZE];
+    return page == NULL ? 0 : page->bytes[address % MEMORY_PAGE_SIZE];
+}
+
+/// Reads the instruction at the program counter, wrapping around the end of the address space.
+static InstructionWord fetchInstruction(struct Machine* machine) {
+    InstructionWord instruction = 0;
+    for (int i = 0; i < INSTRUCTION_SIZE; ++i) {
+        instruction |= (InstructionWord) peekMemory(machine, (machine->pc + i) % ADDRESS_SPACE_SIZE) << 8 * i;
+    }
+    return instruction;
+}
+
+static uint32_t getElapsedMs(struct Machine* machine) {
+    if (machine->nanosecondsPerStep > 0) {
+        return machine->virtualTimeNs / NANOSECONDS_PER_MILLISECOND;
+    }
+    return getMonotonicTimeMs() - machine->clockOriginMs;
+}
+
+static uint8_t loadMemory(struct Machine* machine, int address) {
+    if (address == IO_ADDRESS) {
+        return machine->inputPosition < machine->inputLength ? machine->input[machine->inputPosition++] : 0;
+    } else if (address == TIMER_ADDRESS) {
+        machine->timerLatchMs = getElapsedMs(machine);
+    }
+
+    if (address >= TIMER_ADDRESS && address < TIMER_ADDRESS + 4) {
+        return machine->timerLatchMs >> ((address - TIMER_ADDRESS) * 8);
+    }
+
+    return peekMemory(machine, address);
+}
+
+static void storeMemory(struct Machine* machine, int address, uint8_t value) {
+    if (address == IO_ADDRESS) {
+        if (machine->outputFile != NULL) {
+            fputc(value, machine->outputFile);
+        }
+    } else if (address < TIMER_ADDRESS) {
+        writeMemory(machine, address, value);
+    }
+}
+
+struct Machine* createMachine(unsigned char* program, int programSize, FILE* outputFile) {
+    struct Machine* machine = calloc(1, sizeof(struct Machine));
+    machine->outputFile = outputFile;
+    machine->clockOriginMs = getMonotonicTimeMs();
+
+    for (int i = 0; i < programSize && i < ADDRESS_SPACE_SIZE; ++i) {
+        writeMemory(machine, i, program[i]);
+    }
+
+    return machine;
+}
+
+void destroyMachine(struct Machine* machine) {
+    for (int i = 0; i < MEMORY_PAGES_COUNT; ++i) {
+        releasePage(machine->pages[i]);
+    }
+    free(machine->input);
+    free(machine);
+}
+
+void provideInput(struct Machine* machine, const unsigned char* characters, int length) {
+    if (length == 0) {
+        return;
+    }
+
+    if (machine->inputPosition > 0) { // The input of a new machine isn't allocated yet
+        machine->inputLength -= machine->inputPosition;
+        memmove(machine->input, machine->input + machine->inputPosition, machine->inputLength);
+        machine->inputPosition = 0;
+    }
+
+    if (machine->inputLength + length > machine->inputCapacity) {
+        machine->inputCapacity = (machine->inputLength + length) * 2;
+        machine->input = realloc(machine->input, machine->inputCapacity);
+    }
+    memcpy(machine->input + machine->inputLength, characters, length);
+    machine->inputLength += length;
+}
+
+void step(struct Machine* machine) {
+    if (machine->halted) {
+        return;
+    }
+
+    InstructionWord instruction = fetchInstruction(machine);
+    enum Opcode opcode = getInstructionOpcode(instruction);
+    int address = getInstructionArgument(instruction);
+    bool jump = false;
+    uint8_t value = 0;
+
+    switch (opcode) {
+        case OpcodeLd:
+            machine->a = value = loadMemory(machine, address);
+            break;
+        case OpcodeNot:
+            value = loadMemory(machine, address);
+            machine->a = ~value;
+            break;
+        case OpcodeAdd:
+            value = loadMemory(machine, address);
+            machine->a += value;
+            break;
+        case OpcodeAnd:
+            value = loadMemory(machine, address);
+            machine->a &= value;
+            break;
+        case OpcodeSt:
+            value = machine->a;
+            storeMemory(machine, address, value);
+            break;
+        case OpcodeJmp:
+            jump = true;
+            break;
+        case OpcodeJmn:
+            jump = machine->a >= 0x80;
+            break;
+        case OpcodeJmz:
+            jump = machine->a == 0;
+            break;
+    }
+
+    ++machine->steps;
+    machine->virtualTimeNs += machine->nanosecondsPerStep;
+
+    if (machine->trace != NULL) {
+        uint8_t flags = (jump ? TraceEntryFlagJumped : 0) | (opcode == OpcodeSt ? TraceEntryFlagStored : 0);
+        recordTraceEntry(machine->trace, (struct TraceEntry) { machine->pc, instruction, machine->a, value, flags });
+    }
+
+    if (machine->coverage != NULL) {
+        recordCoverage(machine->coverage, machine->pc, opcode >= OpcodeJmn, jump);
+    }
+
+    if (jump) {
+        machine->halted = address == machine->pc;
+        machine->pc = address;
+    } else {
+        machine->pc = (machine->pc + INSTRUCTION_SIZE) % ADDRESS_SPACE_SIZE;
+    }
+}
+
+uint64_t run(struct Machine* machine, uint64_t maxSteps) {
+    uint64_t startSteps = machine->steps;
+
+    while (!machine->halted && machine->steps - startSteps < maxSteps) {
+        step(machine);
+    }
+
+    return machine->steps - startSteps;
+}
+
+uint64_t runWithTimeout(struct Machine* machine, uint64_t maxSteps, double timeoutMs) {
+    double deadlineMs = getMonotonicTimeMs() + timeoutMs;
+    uint64_t steps = 0;
+
+    while (!machine->halted && steps < maxSteps && getMonotonicTimeMs() < deadlineMs) {
+        steps += run(machine, maxSteps - steps < TIMEOUT_CHECK_INTERVAL ? maxSteps - steps : TIMEOUT_CHECK_INTERVAL);
+    }
+
+    return steps;
+}
+
+enum ExitCode runWithinLimits(struct Machine* machine, uint64_t maxSteps, uint64_t stepsBudget, double timeoutMs, uint64_t* steps) {
+    uint64_t limit = stepsBudget < maxSteps ? stepsBudget : maxSteps;
+    *steps = timeoutMs == 0 ? run(machine, limit) : runWithTimeout(machine, limit, timeoutMs);
+
+    if (machine->halted) {
+        return ExitCodeSuccess;
+    } else if (*steps == stepsBudget) {
+        return ExitCodeInstructionBudgetExceeded;
+    } else if (*steps < limit) {
+        return ExitCodeRunTimedOut;
+    }
+    return ExitCodeSuccess;
+}
+
+struct Machine* forkMachine(struct Machine* machine) {
+    struct Machine* fork = malloc(sizeof(struct Machine));
+    *fork = *machine;
+    fork->input = NULL;
+    fork->inputLength = 0;
+    fork->inputPosition = 0;
+    fork->inputCapacity = 0;
+    fork->trace = NULL;
+    fork->coverage = NULL;
+    provideInput(fork, machine->input + machine->inputPosition, machine->inputLength - machine->inputPosition);
+
+    for (int i = 0; i < MEMORY_PAGES_COUNT; ++i) {
+        if (fork->pages[i] != NULL) {
+            ++fork->pages[i]->referencesCount;
+        }
+    }
+
+    return fork;
+}
+
+void restoreMachine(struct Machine* machine, struct Machine* snapshot) {
+    struct Machine* fork = forkMachine(snapshot);
+    FILE* outputFile = machine->outputFile;
+    struct Trace* trace = machine->trace;
+    struct Coverage* coverage = machine->coverage;
+
+    for (int i = 0; i < MEMORY_PAGES_COUNT; ++i) {
+        releasePage(machine->pages[i]);
+    }
+    free(machine->input);
+
+    *machine = *fork;
+    machine->outputFile = outputFile;
+    machine->trace = trace;
+    machine->coverage = coverage;
+    free(fork);
+}
+
+/// Returns whether at least `length` bytes are left in the file, or true if its size can't be determined.
+static bool hasRemainingBytes(FILE* file, uint32_t length) {
+    long position = ftell(file);
+    if (position < 0 || fseek(file, 0, SEEK_END) != 0) {
+        return true;
+    }
+
+    long end = ftell(file);
+    fseek(file, position, SEEK_SET);
+    return end >= position && (unsigned long) (end - position) >= length;
+}
+
+static bool isPageEmpty(struct MemoryPage* page) {
+    for (int i = 0; page != NULL && i < MEMORY_PAGE_SIZE; ++i) {
+        if (page->bytes[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void saveSnapshot(FILE* file, struct Machine* machine) {
+    uint32_t pagesBitmap = 0;
+    for (int i = 0; i < MEMORY_PAGES_COUNT; ++i) {
+        if (!isPageEmpty(machine->pages[i])) {
+            pagesBitmap |= 1u << i;
+        }
+    }
+
+    fwrite(SNAPSHOT_MAGIC, sizeof(char), 4, file);
+    writeUint16(file, SNAPSHOT_VERSION);
+    writeUint16(file, machine->pc);
+    fputc(machine->a, file);
+    fputc(machine->halted, file);
+    writeUint32(file, machine->steps & 0xFFFFFFFF);
+    writeUint32(file, machine->steps >> 32);
+    writeUint32(file, getElapsedMs(machine));
+    writeUint32(file, machine->timerLatchMs);
+    writeUint32(file, machine->nanosecondsPerStep);
+    writeUint32(file, machine->virtualTimeNs & 0xFFFFFFFF);
+    writeUint32(file, machine->virtualTimeNs >> 32);
+    writeUint32(file, pagesBitmap);
+    writeUint32(file, machine->inputLength - machine->inputPosition);
+    if (machine->inputLength > machine->inputPosition) { // There may be no input buffer
+        fwrite(machine->input + machine->inputPosition, sizeof(unsigned char), machine->inputLength - machine->inputPosition, file);
+    }
+
+    for (int i = 0; i < MEMORY_PAGES_COUNT; ++i) {
+        if (pagesBitmap & 1u << i) {
+            fwrite(machine->pages[i]->bytes, sizeof(unsigned char), MEMORY_PAGE_SIZE, file);
+        }
+    }
+}
+
+struct Machine* loadSnapshot(FILE* file, FILE* outputFile) {
+    char magic[4];
+    uint16_t version, pc;
+    uint32_t stepsLow, stepsHigh, elapsedMs, timerLatchMs, pagesBitmap, inputLength;
+    uint32_t nanosecondsPerStep = 0, virtualTimeLow = 0, virtualTimeHigh = 0;
+
+    if (fread(magic, sizeof(char), 4, file) != 4 || memcmp(magic, SNAPSHOT_MAGIC, 4) != 0
+        || !readUint16(file, &version) || version < 1 || version > SNAPSHOT_VERSION
+        || !readUint16(file, &pc) || !isValidAddress(pc)) {
+        return NULL;
+    }
+
+    int a = fgetc(file);
+    int halted = fgetc(file);
+
+    if (a == EOF || halted == EOF
+        || !readUint32(file, &stepsLow) || !readUint32(file, &stepsHigh)
+        || !readUint32(file, &elapsedMs) || !readUint32(file, &timerLatchMs)
+        || (version >= 2 && (!readUint32(file, &nanosecondsPerStep) || !readUint32(file, &virtualTimeLow) || !readUint32(file, &virtualTimeHigh)))
+        || !readUint32(file, &pagesBitmap) || !readUint32(file, &inputLength)) {
+        return NULL;
+    }
+
+    // The input capacity is twice the length of the input and it's an int
+    if (inputLength > INT_MAX / 2 || !hasRemainingBytes(file, inputLength)) {
+        return NULL;
+    }
+
+    unsigned char* input = malloc(inputLength + 1);
+    if (fread(input, sizeof(unsigned char), inputLength, file) != inputLength) {
+        free(input);
+        return NULL;
+    }
+
+    struct Machine* machine = createMachine(NULL, 0, outputFile);
+    machine->pc = pc;
+    machine->a = a;
+    machine->halted = halted != 0;
+    machine->steps = stepsLow | (uint64_t) stepsHigh << 32;
+    machine->clockOriginMs -= elapsedMs;
+    machine->timerLatchMs = timerLatchMs;
+    machine->nanosecondsPerStep = nanosecondsPerStep;
+    machine->virtualTimeNs = virtualTimeLow | (uint64_t) virtualTimeHigh << 32;
+
+    provideInput(machine, input, inputLength);
+    free(input);
+
+    bool valid = true;
+
+    for (int i = 0; valid && i < MEMORY_PAGES_COUNT; ++i) {
+        if (pagesBitmap & 1u << i) {
+            valid = fread(getWritablePage(machine, i)->bytes, sizeof(unsigned char), MEMORY_PAGE_SIZE, file) == MEMORY_PAGE_SIZE;
+        }
+    }
+
+    if (!valid) {
+        destroyMachine(machine);
+        return NULL;
+    }
+
+    return machine;
+}
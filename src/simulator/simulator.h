@@ -0,0 +1,92 @@
+#ifndef simulator
+#define simulator
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "../assembler/assembler.h"
+#include "../execution-trace/execution-trace.h"
+#include "../code-coverage/code-coverage.h"
+
+#define SNAPSHOT_MAGIC TARGET_NAME "M"
+#define MEMORY_PAGES_COUNT 32 // Snapshots mark the non-empty pages in a 32-bit bitmap
+#define MEMORY_PAGE_SIZE (ADDRESS_SPACE_SIZE / MEMORY_PAGES_COUNT)
+#define TIMEOUT_CHECK_INTERVAL 0x10000 // Steps executed between reading the clock when a run has a timeout
+
+/// A page of memory, which may be shared by forked machines until one of them writes to it.
+struct MemoryPage {
+    int referencesCount;
+    unsigned char bytes[MEMORY_PAGE_SIZE];
+};
+
+struct Machine {
+    struct MemoryPage* pages[MEMORY_PAGES_COUNT]; // NULL pages contain only zeros
+    uint16_t pc;
+    uint8_t a;
+    bool halted; // Set after a jump to the address of the jump instruction itself
+    uint64_t steps;
+    double clockOriginMs; // Monotonic time at which the machine was started
+    uint32_t timerLatchMs; // Elapsed time latched by the last read of TIMER_ADDRESS
+    uint32_t nanosecondsPerStep; // Virtual time which passes with every step, or 0 if the timer follows the monotonic clock
+    uint64_t virtualTimeNs; // Virtual time which has passed, if it's enabled
+    unsigned char* input; // Characters provided for loading from IO_ADDRESS
+    int inputLength;
+    int inputPosition; // Index of the next character to be loaded
+    int inputCapacity;
+    FILE* outputFile; // Receives characters stored to IO_ADDRESS, may be NULL
+    struct Trace* trace; // Records every executed instruction, may be NULL
+    struct Coverage* coverage; // Records executed addresses and conditional jumps, may be NULL
+};
+
+/// Creates a machine with the program loaded at address 0 and all registers set to 0.
+struct Machine* createMachine(unsigned char* program, int programSize, FILE* outputFile);
+
+void destroyMachine(struct Machine* machine);
+
+/// Appends characters to the terminal input buffer.
+void provideInput(struct Machine* machine, const unsigned char* characters, int length);
+
+/// Returns the value at the address without the side effects of loading it.
+uint8_t peekMemory(struct Machine* machine, int address);
+
+/// Executes a single instruction, unless the machine is halted.
+void step(struct Machine* machine);
+
+/// Executes instructions until the machine halts or `maxSteps` are executed. Returns the number of executed steps.
+uint64_t run(struct Machine* machine, uint64_t maxSteps);
+
+/**
+ * Same as `run`, but also stops after `timeoutMs` milliseconds of wall-clock
+ * time, which is only measured every `TIMEOUT_CHECK_INTERVAL` steps.
+ */
+uint64_t runWithTimeout(struct Machine* machine, uint64_t maxSteps, double timeoutMs);
+
+/**
+ * Runs the machine like `runWithTimeout`, without a timeout if `timeoutMs`
+ * is 0, and stores the number of executed steps in `*steps`. Returns
+ * `ExitCodeInstructionBudgetExceeded` if it doesn't halt within
+ * `stepsBudget` steps, `ExitCodeRunTimedOut` if it doesn't halt in time,
+ * and `ExitCodeSuccess` if it halts or stops after `maxSteps` steps.
+ */
+enum ExitCode runWithinLimits(struct Machine* machine, uint64_t maxSteps, uint64_t stepsBudget, double timeoutMs, uint64_t* steps);
+
+/**
+ * Creates a copy of the machine in constant time. Memory pages are shared
+ * between the copies and duplicated only when written to. The copy is
+ * neither traced nor covered.
+ */
+struct Machine* forkMachine(struct Machine* machine);
+
+/// Replaces the state of the machine with the state of the snapshot, sharing memory pages.
+void restoreMachine(struct Machine* machine, struct Machine* snapshot);
+
+/**
+ * Writes the machine state in a compact format: registers, timer (including
+ * the virtual clock), pending input and only the non-zero memory pages.
+ */
+void saveSnapshot(FILE* file, struct Machine* machine);
+
+/// Reads a machine state written by `saveSnapshot`. Returns NULL if the file is malformed.
+struct Machine* loadSnapshot(FILE* file, FILE* outputFile);
+
+#endif
@@ -0,0 +1,54 @@
+#include "source-line.h"
+#include <string.h>
+#include <strings.h>
+
+const char* skipSpaces(const char* text) {
+    return text + strspn(text, " \t\r");
+}
+
+bool isLineEnd(const char* text) {
+    return *text == ';' || *text == '\n' || *text == 0;
+}
+
+int getTokenLength(const char* text) {
+    char quote = 0;
+    int depth = 0;
+    int i = 0;
+
+    for (; text[i] != 0 && text[i] != '\n'; ++i) {
+        if (quote != 0) {
+            if (text[i] == '\\' && text[i + 1] != 0 && text[i + 1] != '\n') {
+                ++i;
+            } else if (text[i] == quote) {
+                quote = 0;
+            }
+        } else if (text[i] == '"' || text[i] == '\'') {
+            quote = text[i];
+        } else if (text[i] == '(' || text[i] == ')') {
+            depth += text[i] == '(' ? 1 : -1;
+        } else if (text[i] == ';' || (depth <= 0 && (text[i] == ' ' || text[i] == '\t' || text[i] == '\r'))) {
+            break;
+        }
+    }
+
+    return i;
+}
+
+bool namesEqualCaseInsensitive(const char* a, const char* b, int length) {
+    return strncasecmp(a, b, length) == 0 && b[length] == 0;
+}
+
+bool referencesUnlabeledCode(struct AssemblerResult* image) {
+    for (int address = 0; address < ADDRESS_SPACE_SIZE; ++address) {
+        if (image->dataType[address] != DataTypeInstruction) {
+            continue;
+        }
+        int argument = getInstructionArgument(loadInstruction(image->programMemory, address));
+        for (int i = 0; i < INSTRUCTION_SIZE && i <= argument; ++i) {
+            if (image->dataType[argument - i] == DataTypeInstruction && (i > 0 || image->labelNameByAddress[argument] == NULL)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
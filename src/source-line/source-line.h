@@ -0,0 +1,33 @@
+#ifndef source_line
+#define source_line
+
+#include <stdbool.h>
+#include "../assembler/assembler.h"
+
+/*
+ * Scanning of assembly source lines by the tools which rewrite the source
+ * (the code layout and the superoptimizer), keeping the rest of every line
+ * intact. A token ends at whitespace outside of parentheses, a semicolon or
+ * the end of line, unless quoted.
+ */
+
+/// Returns `text` past spaces, tabs and carriage returns.
+const char* skipSpaces(const char* text);
+
+/// Whether `text` is at a comment or the end of line.
+bool isLineEnd(const char* text);
+
+/// Returns the length of the token at `text`.
+int getTokenLength(const char* text);
+
+/// Whether the first `length` characters of `a` are the zero-terminated name `b`, ignoring case.
+bool namesEqualCaseInsensitive(const char* a, const char* b, int length);
+
+/**
+ * Whether any instruction refers to code by an address without a label, e.g.
+ * "label+2", or to the middle of an instruction, which moving or replacing
+ * instructions in the source could invalidate.
+ */
+bool referencesUnlabeledCode(struct AssemblerResult* image);
+
+#endif
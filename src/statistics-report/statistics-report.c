@@ -0,0 +1,76 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "statistics-report.h"
+#include <stdio.h>
+#include <time.h>
+
+double getMonotonicTimeMs() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000.0 + time.tv_nsec / 1000000.0;
+}
+
+static void printStatisticsText(FILE* file, struct AssemblerStatistics* s, double readMs, double writeMs) {
+    fprintf(file, "Phase timings (ms):\n");
+    fprintf(file, "  read                        %10.4f\n", readMs);
+    fprintf(file, "  tokenize                    %10.4f\n", s->tokenizeMs);
+    fprintf(file, "  parse                       %10.4f\n", s->parseMs);
+    fprintf(file, "  resolve immediate values    %10.4f\n", s->resolveImmediateValuesMs);
+    fprintf(file, "  resolve labels              %10.4f\n", s->resolveLabelsMs);
+    fprintf(file, "  write                       %10.4f\n", writeMs);
+    fprintf(file, "Counters:\n");
+    fprintf(file, "  tokens                      %10d\n", s->tokens);
+    fprintf(file, "  statements                  %10d\n", s->statements);
+    fprintf(file, "  label definitions           %10d\n", s->labelDefinitions);
+    fprintf(file, "  constant definitions        %10d\n", s->constantDefinitions);
+    fprintf(file, "  label uses                  %10d\n", s->labelUses);
+    fprintf(file, "  fixups                      %10d\n", s->fixups);
+    fprintf(file, "  immediate value uses        %10d\n", s->immediateValueUses);
+    fprintf(file, "  immediate pool hits         %10d\n", s->immediatePoolHits);
+    fprintf(file, "  immediate pool misses       %10d\n", s->immediatePoolMisses);
+    fprintf(file, "  pooled string bytes saved   %10d\n", s->pooledStringBytesSaved);
+    fprintf(file, "  bytes emitted               %10d\n", s->bytesEmitted);
+    fprintf(file, "Peak table sizes:\n");
+    fprintf(file, "  label definitions           %10d\n", s->peakLabelDefinitions);
+    fprintf(file, "  constant definitions        %10d\n", s->peakConstantDefinitions);
+    fprintf(file, "  immediate value uses        %10d\n", s->peakImmediateValueUses);
+}
+
+static void printStatisticsJson(FILE* file, struct AssemblerStatistics* s, double readMs, double writeMs) {
+    fprintf(file, "{\n");
+    fprintf(file, "  \"phasesMs\": {\n");
+    fprintf(file, "    \"read\": %.4f,\n", readMs);
+    fprintf(file, "    \"tokenize\": %.4f,\n", s->tokenizeMs);
+    fprintf(file, "    \"parse\": %.4f,\n", s->parseMs);
+    fprintf(file, "    \"resolveImmediateValues\": %.4f,\n", s->resolveImmediateValuesMs);
+    fprintf(file, "    \"resolveLabels\": %.4f,\n", s->resolveLabelsMs);
+    fprintf(file, "    \"write\": %.4f\n", writeMs);
+    fprintf(file, "  },\n");
+    fprintf(file, "  \"counters\": {\n");
+    fprintf(file, "    \"tokens\": %d,\n", s->tokens);
+    fprintf(file, "    \"statements\": %d,\n", s->statements);
+    fprintf(file, "    \"labelDefinitions\": %d,\n", s->labelDefinitions);
+    fprintf(file, "    \"constantDefinitions\": %d,\n", s->constantDefinitions);
+    fprintf(file, "    \"labelUses\": %d,\n", s->labelUses);
+    fprintf(file, "    \"fixups\": %d,\n", s->fixups);
+    fprintf(file, "    \"immediateValueUses\": %d,\n", s->immediateValueUses);
+    fprintf(file, "    \"immediatePoolHits\": %d,\n", s->immediatePoolHits);
+    fprintf(file, "    \"immediatePoolMisses\": %d,\n", s->immediatePoolMisses);
+    fprintf(file, "    \"pooledStringBytesSaved\": %d,\n", s->pooledStringBytesSaved);
+    fprintf(file, "    \"bytesEmitted\": %d\n", s->bytesEmitted);
+    fprintf(file, "  },\n");
+    fprintf(file, "  \"peakTableSizes\": {\n");
+    fprintf(file, "    \"labelDefinitions\": %d,\n", s->peakLabelDefinitions);
+    fprintf(file, "    \"constantDefinitions\": %d,\n", s->peakConstantDefinitions);
+    fprintf(file, "    \"immediateValueUses\": %d\n", s->peakImmediateValueUses);
+    fprintf(file, "  }\n");
+    fprintf(file, "}\n");
+}
+
+void printStatistics(FILE* file, struct AssemblerStatistics* assemblerStatistics, double readMs, double writeMs, enum StatisticsFormat format) {
+    switch (format) {
+        case StatisticsFormatText: return printStatisticsText(file, assemblerStatistics, readMs, writeMs);
+        case StatisticsFormatJson: return printStatisticsJson(file, assemblerStatistics, readMs, writeMs);
+        case StatisticsFormatNone: return;
+    }
+}
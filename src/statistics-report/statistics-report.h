@@ -0,0 +1,25 @@
+#ifndef statistics_report
+#define statistics_report
+
+#include <stdio.h>
+#include "../assembler/assembler.h"
+
+enum StatisticsFormat {
+    StatisticsFormatNone,
+    StatisticsFormatText,
+    StatisticsFormatJson
+};
+
+/**
+ * Returns the time in milliseconds elapsed since an arbitrary point, using a
+ * monotonic clock.
+ */
+double getMonotonicTimeMs();
+
+/**
+ * Prints phase timings and counters collected while assembling the program,
+ * along with the time of reading the source and writing the output files.
+ */
+void printStatistics(FILE* file, struct AssemblerStatistics* assemblerStatistics, double readMs, double writeMs, enum StatisticsFormat format);
+
+#endif
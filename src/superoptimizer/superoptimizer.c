@@ -0,0 +1,620 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "superoptimizer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "../evaluator/evaluator.h"
+#include "../simulator/simulator.h"
+#include "../source-line/source-line.h"
+
+#define OPCODES_COUNT 5 // Instructions other than jumps
+#define TEST_VECTORS_COUNT 64
+#define MAX_CHOICES (OPCODES_COUNT * (MAX_SEQUENCE_VARIABLES + 0x100))
+#define REWRITE_SEPARATOR "=>"
+
+static const char* const instructionNames[OPCODES_COUNT] = { "ld", "not", "add", "and", "st" };
+static const char* const variableNames[MAX_SEQUENCE_VARIABLES] = { "x", "y" };
+
+struct State {
+    uint8_t a;
+    uint8_t variables[MAX_SEQUENCE_VARIABLES];
+};
+
+/// Shared by the threads searching for sequences of a single length.
+struct Search {
+    struct Sequence* target;
+    int length;
+    struct SequenceInstruction choices[MAX_CHOICES];
+    int choicesCount;
+    struct State inputs[TEST_VECTORS_COUNT];
+    struct State outputs[TEST_VECTORS_COUNT];
+    atomic_int nextFirstChoice;
+    atomic_int foundFirstChoice; // The lowest first choice of an equivalent sequence found so far
+    struct Sequence found[MAX_CHOICES];
+};
+
+/// An instruction of a source line which may be replaced.
+struct ReplaceableInstruction {
+    int lineNumber;
+    int address;
+    int opcode;
+    bool isImmediate;
+    int argumentAddress;
+    const char* argument; // Source text of the argument
+    int argumentLength;
+};
+
+static int getOpcode(const char* name, int length) {
+    for (int i = 0; i < OPCODES_COUNT; ++i) {
+        if (namesEqualCaseInsensitive(name, instructionNames[i], length)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool parseInstruction(char* text, struct SequenceInstruction* instruction, char* names[MAX_SEQUENCE_VARIABLES], int* variablesCount) {
+    text = (char*) skipSpaces(text);
+    int nameLength = getTokenLength(text);
+    char* argument = (char*) skipSpaces(text + nameLength);
+    int argumentLength = getTokenLength(argument);
+
+    instruction->opcode = getOpcode(text, nameLength);
+
+    if (instruction->opcode < 0 || argumentLength == 0 || *skipSpaces(argument + argumentLength) != 0) {
+        return false;
+    }
+
+    argument[argumentLength] = 0;
+    instruction->isImmediate = argument[0] == '#';
+
+    if (instruction->isImmediate) {
+        struct ExpressionEvaluationResult evaluated = evaluateExpression(argument + 1, 0, NULL);
+        instruction->argument = evaluated.value & 0xFF;
+        return evaluated.resolved && evaluated.value >= -0x80 && evaluated.value <= 0xFF && instruction->opcode != 4;
+    }
+
+    for (int i = 0; i < *variablesCount; ++i) {
+        if (strcmp(names[i], argument) == 0) {
+            instruction->argument = i;
+            return true;
+        }
+    }
+
+    if (*variablesCount == MAX_SEQUENCE_VARIABLES) {
+        return false;
+    }
+
+    names[*variablesCount] = argument;
+    instruction->argument = (*variablesCount)++;
+    return true;
+}
+
+bool parseSequence(char* text, struct Sequence* sequence, char* names[MAX_SEQUENCE_VARIABLES]) {
+    sequence->length = 0;
+
+    while (*skipSpaces(text) != 0) {
+        char* end = text;
+        while (*end != 0 && *end != ';') {
+            end += *end == '\'' || *end == '"' ? getTokenLength(end) : 1;
+        }
+        bool last = *end == 0;
+        *end = 0;
+
+        if (sequence->length == MAX_SEQUENCE_LEN || !parseInstruction(text, &sequence->instructions[sequence->length++], names, &sequence->variablesCount)) {
+            return false;
+        }
+
+        text = last ? end : end + 1;
+    }
+
+    return true;
+}
+
+void writeSequence(FILE* file, struct Sequence* sequence) {
+    for (int i = 0; i < sequence->length; ++i) {
+        struct SequenceInstruction* instruction = &sequence->instructions[i];
+        fprintf(file, "%s%s ", i > 0 ? "; " : "", instructionNames[instruction->opcode]);
+        if (instruction->isImmediate) {
+            fprintf(file, "#%d", instruction->argument);
+        } else {
+            fprintf(file, "%s", variableNames[instruction->argument]);
+        }
+    }
+}
+
+static void executeInstruction(struct SequenceInstruction* instruction, struct State* state) {
+    uint8_t value = instruction->isImmediate ? instruction->argument : state->variables[instruction->argument];
+
+    switch (instruction->opcode) {
+        case 0: state->a = value; break;
+        case 1: state->a = ~value; break;
+        case 2: state->a += value; break;
+        case 3: state->a &= value; break;
+        case 4: state->variables[instruction->argument] = state->a; break;
+    }
+}
+
+static void execute(struct Sequence* sequence, int length, struct State* state) {
+    for (int i = 0; i < length; ++i) {
+        executeInstruction(&sequence->instructions[i], state);
+    }
+}
+
+/// Whether the instruction overwrites A, which the previous instruction only computed.
+static bool isDeadStore(struct SequenceInstruction* previous, struct SequenceInstruction* instruction) {
+    return previous->opcode != 4 && (instruction->opcode == 0 || instruction->opcode == 1);
+}
+
+static bool statesEqual(struct State* a, struct State* b, int variablesCount) {
+    return a->a == b->a && memcmp(a->variables, b->variables, variablesCount) == 0;
+}
+
+/// Compares the effects of the sequences for every value of A and of the variables.
+static bool sequencesEquivalent(struct Sequence* a, struct Sequence* b, int variablesCount) {
+    uint32_t combinationsCount = 1u << 8 * (variablesCount + 1);
+
+    for (uint32_t combination = 0; combination < combinationsCount; ++combination) {
+        struct State input = { combination & 0xFF, { 0 } };
+        for (int i = 0; i < variablesCount; ++i) {
+            input.variables[i] = combination >> 8 * (i + 1);
+        }
+
+        struct State stateA = input;
+        struct State stateB = input;
+        execute(a, a->length, &stateA);
+        execute(b, b->length, &stateB);
+
+        if (!statesEqual(&stateA, &stateB, variablesCount)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// Immediate values of the target, values derived from pairs of them, and a few common ones.
+static void addImmediateChoices(struct Search* search) {
+    bool isChoice[0x100] = { false };
+    isChoice[0] = isChoice[1] = isChoice[0x7F] = isChoice[0x80] = isChoice[0xFF] = true;
+
+    for (int i = 0; i < search->target->length; ++i) {
+        struct SequenceInstruction* a = &search->target->instructions[i];
+        if (!a->isImmediate) {
+            continue;
+        }
+        isChoice[a->argument] = isChoice[-a->argument & 0xFF] = isChoice[~a->argument & 0xFF] = true;
+
+        for (int j = 0; j < search->target->length; ++j) {
+            struct SequenceInstruction* b = &search->target->instructions[j];
+            if (b->isImmediate) {
+                isChoice[(a->argument + b->argument) & 0xFF] = true;
+                isChoice[(a->argument - b->argument) & 0xFF] = true;
+                isChoice[a->argument & b->argument] = true;
+            }
+        }
+    }
+
+    for (int opcode = 0; opcode < OPCODES_COUNT; ++opcode) {
+        for (int i = 0; i < search->target->variablesCount; ++i) {
+            search->choices[search->choicesCount++] = (struct SequenceInstruction) { opcode, false, i };
+        }
+        for (int value = 0; value < 0x100 && opcode != 4; ++value) {
+            if (isChoice[value]) {
+                search->choices[search->choicesCount++] = (struct SequenceInstruction) { opcode, true, value };
+            }
+        }
+    }
+}
+
+static void generateTestVectors(struct Search* search) {
+    uint32_t random = 0x2545F491;
+
+    for (int i = 0; i < TEST_VECTORS_COUNT; ++i) {
+        struct State* input = &search->inputs[i];
+        // A few vectors with all values equal to edge cases, followed by pseudorandom ones
+        uint8_t edgeValues[4] = { 0, 0xFF, 0x80, 0x7F };
+        for (int j = 0; j < MAX_SEQUENCE_VARIABLES + 1; ++j) {
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            uint8_t value = i < 4 ? edgeValues[i] : random >> 8;
+            if (j == 0) {
+                input->a = value;
+            } else {
+                input->variables[j - 1] = value;
+            }
+        }
+        search->outputs[i] = *input;
+        execute(search->target, search->target->length, &search->outputs[i]);
+    }
+}
+
+/// Extends the candidate with every choice of the next instruction. `states` hold the effect of the candidate so far.
+static bool extendCandidate(struct Search* search, struct Sequence* candidate, struct State* states) {
+    if (candidate->length == search->length) {
+        for (int i = 0; i < TEST_VECTORS_COUNT; ++i) {
+            if (!statesEqual(&states[i], &search->outputs[i], search->target->variablesCount)) {
+                return false;
+            }
+        }
+        return sequencesEquivalent(candidate, search->target, search->target->variablesCount);
+    }
+
+    struct State nextStates[TEST_VECTORS_COUNT];
+
+    for (int choice = 0; choice < search->choicesCount; ++choice) {
+        struct SequenceInstruction* instruction = &search->choices[choice];
+        if (isDeadStore(&candidate->instructions[candidate->length - 1], instruction)) {
+            continue; // A shorter candidate has the same effect
+        }
+
+        candidate->instructions[candidate->length++] = *instruction;
+        for (int i = 0; i < TEST_VECTORS_COUNT; ++i) {
+            nextStates[i] = states[i];
+            executeInstruction(instruction, &nextStates[i]);
+        }
+        if (extendCandidate(search, candidate, nextStates)) {
+            return true;
+        }
+        --candidate->length;
+    }
+
+    return false;
+}
+
+static void* searchCandidates(void* argument) {
+    struct Search* search = argument;
+    int firstChoice;
+
+    while ((firstChoice = atomic_fetch_add(&search->nextFirstChoice, 1)) < atomic_load(&search->foundFirstChoice)) {
+        struct Sequence candidate = { 1, search->target->variablesCount, { search->choices[firstChoice] } };
+        struct State states[TEST_VECTORS_COUNT];
+
+        for (int i = 0; i < TEST_VECTORS_COUNT; ++i) {
+            states[i] = search->inputs[i];
+            execute(&candidate, 1, &states[i]);
+        }
+
+        if (extendCandidate(search, &candidate, states)) {
+            search->found[firstChoice] = candidate;
+            int expected = atomic_load(&search->foundFirstChoice);
+            while (firstChoice < expected && !atomic_compare_exchange_weak(&search->foundFirstChoice, &expected, firstChoice));
+        }
+    }
+
+    return NULL;
+}
+
+bool superoptimize(struct Sequence* target, struct Sequence* result) {
+    struct Sequence empty = { 0, target->variablesCount, { { 0 } } };
+
+    if (target->length > 0 && sequencesEquivalent(&empty, target, target->variablesCount)) {
+        *result = empty;
+        return true;
+    }
+
+    struct Search* search = calloc(1, sizeof(struct Search));
+    search->target = target;
+    addImmediateChoices(search);
+    generateTestVectors(search);
+
+    long threadsCount = sysconf(_SC_NPROCESSORS_ONLN);
+    threadsCount = threadsCount < 1 ? 1 : threadsCount;
+    pthread_t* threads = malloc(threadsCount * sizeof(pthread_t));
+    bool found = false;
+
+    for (search->length = 1; search->length < target->length && !found; ++search->length) {
+        atomic_store(&search->nextFirstChoice, 0);
+        atomic_store(&search->foundFirstChoice, search->choicesCount);
+
+        int startedCount = 0;
+        while (startedCount < threadsCount && pthread_create(&threads[startedCount], NULL, searchCandidates, search) == 0) {
+            ++startedCount;
+        }
+        if (startedCount < threadsCount) {
+            searchCandidates(search); // The calling thread takes over the choices of the threads which couldn't be created
+        }
+        for (int i = 0; i < startedCount; ++i) {
+            pthread_join(threads[i], NULL);
+        }
+
+        int foundFirstChoice = atomic_load(&search->foundFirstChoice);
+        if (foundFirstChoice < search->choicesCount) {
+            *result = search->found[foundFirstChoice];
+            found = true;
+        }
+    }
+
+    free(threads);
+    free(search);
+    return found;
+}
+
+int parseRewrites(char* contents, struct Rewrite* rewrites) {
+    int count = 0;
+    char* line = contents;
+
+    while (*line != 0) {
+        char* end = line + strcspn(line, "\n");
+        bool last = *end == 0;
+        *end = 0;
+
+        if (*skipSpaces(line) != 0) {
+            char* separator = strstr(line, REWRITE_SEPARATOR);
+            char* names[MAX_SEQUENCE_VARIABLES] = { NULL };
+
+            if (separator == NULL || count == MAX_REWRITES) {
+                return -1;
+            }
+            *separator = 0;
+
+            struct Rewrite* rewrite = &rewrites[count++];
+            memset(rewrite, 0, sizeof(struct Rewrite));
+
+            if (!parseSequence(line, &rewrite->pattern, names)) {
+                return -1;
+            }
+
+            rewrite->replacement.variablesCount = rewrite->pattern.variablesCount;
+
+            if (!parseSequence(separator + strlen(REWRITE_SEPARATOR), &rewrite->replacement, names)
+                || rewrite->replacement.variablesCount != rewrite->pattern.variablesCount
+                || rewrite->replacement.length >= rewrite->pattern.length) {
+                return -1;
+            }
+        }
+
+        line = last ? end : end + 1;
+    }
+
+    return count;
+}
+
+/**
+ * Finds the mnemonic and the argument of a line consisting of labels, an
+ * instruction and an optional comment. Returns false if the line has any other
+ * tokens, or labels when `labelsAllowed` is false.
+ */
+static bool findInstructionTokens(const char* line, bool labelsAllowed, const char** mnemonic, const char** argument, int* argumentLength) {
+    const char* token = skipSpaces(line);
+    int length = getTokenLength(token);
+
+    while (length > 0 && token[length - 1] == ':') {
+        if (!labelsAllowed) {
+            return false;
+        }
+        token = skipSpaces(token + length);
+        length = getTokenLength(token);
+    }
+
+    *mnemonic = token;
+    *argument = skipSpaces(token + length);
+    *argumentLength = getTokenLength(*argument);
+    const char* rest = skipSpaces(*argument + *argumentLength);
+
+    return length > 0 && *argumentLength > 0 && isLineEnd(rest);
+}
+
+static bool isEmptyLine(const char* line) {
+    return isLineEnd(skipSpaces(line));
+}
+
+/// Returns whether the instructions at the start of `instructions` match the pattern, binding variables to addresses.
+static bool matchesPattern(struct Sequence* pattern, struct ReplaceableInstruction* instructions, struct AssemblerResult* image, int* variableIndices) {
+    int variableAddresses[MAX_SEQUENCE_VARIABLES];
+
+    for (int i = 0; i < pattern->variablesCount; ++i) {
+        variableAddresses[i] = -1;
+    }
+
+    for (int i = 0; i < pattern->length; ++i) {
+        struct SequenceInstruction* expected = &pattern->instructions[i];
+        struct ReplaceableInstruction* actual = &instructions[i];
+
+        if (expected->opcode != actual->opcode || expected->isImmediate != actual->isImmediate) {
+            return false;
+        } else if (expected->isImmediate) {
+            if (image->programMemory[actual->argumentAddress] != expected->argument) {
+                return false;
+            }
+            continue;
+        } else if (actual->argumentAddress >= TIMER_ADDRESS) {
+            return false; // Loading and storing memory-mapped devices has side effects
+        }
+
+        if (variableAddresses[expected->argument] < 0) {
+            for (int j = 0; j < pattern->variablesCount; ++j) {
+                if (variableAddresses[j] == actual->argumentAddress) {
+                    return false;
+                }
+            }
+            variableAddresses[expected->argument] = actual->argumentAddress;
+            variableIndices[expected->argument] = i;
+        } else if (variableAddresses[expected->argument] != actual->argumentAddress) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// Writes the line without its instruction, or with the instruction replaced if `replacement` is not NULL.
+static void writeReplacedLine(FILE* file, const char* line, struct SequenceInstruction* replacement, struct ReplaceableInstruction* instructions, int* variableIndices) {
+    const char* mnemonic;
+    const char* argument;
+    int argumentLength;
+    findInstructionTokens(line, true, &mnemonic, &argument, &argumentLength);
+
+    fwrite(line, sizeof(char), mnemonic - line, file);
+
+    if (replacement != NULL) {
+        fprintf(file, "%s ", instructionNames[replacement->opcode]);
+        if (replacement->isImmediate) {
+            fprintf(file, "#%d", replacement->argument);
+        } else {
+            struct ReplaceableInstruction* bound = &instructions[variableIndices[replacement->argument]];
+            fwrite(bound->argument, sizeof(char), bound->argumentLength, file);
+        }
+    }
+
+    const char* rest = argument + argumentLength;
+    fwrite(rest, sizeof(char), strcspn(rest, "\n"), file);
+}
+
+/// Whether a byte of the instruction other than the first is referenced or labeled.
+static bool isReferencedWithin(struct AssemblerResult* image, bool* isReferenced, int address) {
+    for (int i = 1; i < INSTRUCTION_SIZE; ++i) {
+        if (isReferenced[address + i] || image->labelNameByAddress[address + i] != NULL) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Whether a byte of the instruction is stored to or its address is placed in memory by data, so it may be modified when running.
+static bool isModifiedOrInData(struct AssemblerResult* image, bool* isStoredTo, int address) {
+    for (int i = 0; i < INSTRUCTION_SIZE; ++i) {
+        if (isStoredTo[address + i] || image->isAddressInData[address + i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+char* applyRewrites(const char* source, struct Rewrite* rewrites, int count, int* rewritesCount) {
+    *rewritesCount = 0;
+
+    struct AssemblerResult* image = malloc(sizeof(struct AssemblerResult));
+    char* copy = strdup(source);
+    char errorMessage[0x100];
+
+    if (tryAssemble(copy, image, errorMessage, sizeof(errorMessage)) != ExitCodeSuccess) {
+        free(copy);
+        free(image);
+        return strdup(source); // Errors are reported when the source is assembled
+    }
+    free(copy);
+
+    int linesCount = 1;
+    for (const char* c = source; *c != 0; ++c) {
+        linesCount += *c == '\n';
+    }
+
+    const char** lines = malloc((linesCount + 1) * sizeof(const char*));
+    int* declaredBytesByLine = calloc(linesCount + 1, sizeof(int));
+    int* instructionAddressByLine = calloc(linesCount + 1, sizeof(int));
+    bool* isReferenced = calloc(ADDRESS_SPACE_SIZE, sizeof(bool));
+    bool* isStoredTo = calloc(ADDRESS_SPACE_SIZE, sizeof(bool));
+
+    lines[1] = source;
+    for (int i = 2; i <= linesCount; ++i) {
+        lines[i] = strchr(lines[i - 1], '\n') + 1;
+    }
+
+    for (int i = 0; i < ADDRESS_SPACE_SIZE; ++i) {
+        int lineNumber = image->lineNumberByAddress[i];
+        if (lineNumber > 0 && lineNumber <= linesCount) {
+            ++declaredBytesByLine[lineNumber];
+            if (image->dataType[i] == DataTypeInstruction) {
+                instructionAddressByLine[lineNumber] = i;
+            }
+        }
+        if (image->dataType[i] == DataTypeInstruction) {
+            InstructionWord instruction = loadInstruction(image->programMemory, i);
+            isReferenced[getInstructionArgument(instruction)] = true;
+            isStoredTo[getInstructionArgument(instruction)] |= getInstructionOpcode(instruction) == OpcodeSt;
+        }
+    }
+
+    char* rewritten;
+    size_t rewrittenSize;
+    FILE* file = open_memstream(&rewritten, &rewrittenSize);
+    bool isSafe = !referencesUnlabeledCode(image);
+    int lineNumber = 1;
+
+    if (!isSafe) {
+        fprintf(file, "%s", source);
+    }
+
+    while (isSafe && lineNumber <= linesCount) {
+        struct ReplaceableInstruction instructions[MAX_SEQUENCE_LEN];
+        int instructionsCount = 0;
+
+        // Collects instructions without jumps on the following lines, which can only be entered at the first one
+        for (int i = lineNumber; i <= linesCount && instructionsCount < MAX_SEQUENCE_LEN; ++i) {
+            struct ReplaceableInstruction* instruction = &instructions[instructionsCount];
+            const char* mnemonic;
+            int address = instructionAddressByLine[i];
+
+            if (instructionsCount > 0 && declaredBytesByLine[i] == 0 && isEmptyLine(lines[i])) {
+                continue;
+            } else if (declaredBytesByLine[i] != INSTRUCTION_SIZE || image->dataType[address] != DataTypeInstruction
+                || !findInstructionTokens(lines[i], instructionsCount == 0, &mnemonic, &instruction->argument, &instruction->argumentLength)
+                || (instructionsCount > 0 && address != instructions[instructionsCount - 1].address + INSTRUCTION_SIZE)
+                || (instructionsCount > 0 && (isReferenced[address] || image->labelNameByAddress[address] != NULL))
+                || isReferencedWithin(image, isReferenced, address) || isModifiedOrInData(image, isStoredTo, address)) {
+                break;
+            }
+
+            instruction->lineNumber = i;
+            instruction->address = address;
+            instruction->opcode = getInstructionOpcode(loadInstruction(image->programMemory, address));
+            instruction->isImmediate = instruction->argument[0] == '#';
+            instruction->argumentAddress = getInstructionArgument(loadInstruction(image->programMemory, address));
+
+            if (instruction->opcode >= OPCODES_COUNT || getOpcode(mnemonic, getTokenLength(mnemonic)) != instruction->opcode) {
+                break;
+            }
+            ++instructionsCount;
+        }
+
+        struct Rewrite* rewrite = NULL;
+        int variableIndices[MAX_SEQUENCE_VARIABLES];
+
+        for (int i = 0; i < count && rewrite == NULL; ++i) {
+            if (rewrites[i].pattern.length <= instructionsCount && matchesPattern(&rewrites[i].pattern, instructions, image, variableIndices)) {
+                rewrite = &rewrites[i];
+            }
+        }
+
+        if (rewrite == NULL) {
+            fwrite(lines[lineNumber], sizeof(char), strcspn(lines[lineNumber], "\n"), file);
+            if (lineNumber < linesCount) {
+                fputc('\n', file);
+            }
+            ++lineNumber;
+            continue;
+        }
+
+        int lastLineNumber = instructions[rewrite->pattern.length - 1].lineNumber;
+
+        for (int i = 0; lineNumber <= lastLineNumber; ++lineNumber) {
+            if (i < rewrite->pattern.length && instructions[i].lineNumber == lineNumber) {
+                struct SequenceInstruction* replacement = i < rewrite->replacement.length ? &rewrite->replacement.instructions[i] : NULL;
+                writeReplacedLine(file, lines[lineNumber], replacement, instructions, variableIndices);
+                ++i;
+            } else {
+                fwrite(lines[lineNumber], sizeof(char), strcspn(lines[lineNumber], "\n"), file);
+            }
+            if (lineNumber < linesCount) {
+                fputc('\n', file);
+            }
+        }
+
+        ++*rewritesCount;
+    }
+
+    fclose(file);
+    free(lines);
+    free(declaredBytesByLine);
+    free(instructionAddressByLine);
+    free(isReferenced);
+    free(isStoredTo);
+    free(image);
+    return rewritten;
+}
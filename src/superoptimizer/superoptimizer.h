@@ -0,0 +1,74 @@
+#ifndef superoptimizer
+#define superoptimizer
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "../assembler/assembler.h"
+
+#define MAX_SEQUENCE_LEN 6
+#define MAX_SEQUENCE_VARIABLES 2 // Equivalence is tested for every value of A and of each variable
+#define MAX_REWRITES 0x400
+
+/**
+ * An instruction without a jump, whose argument is either one of the memory
+ * cells named by the variables of the sequence, or an immediate value.
+ */
+struct SequenceInstruction {
+    int opcode;
+    bool isImmediate;
+    int argument; // Index of the variable, or the immediate value
+};
+
+struct Sequence {
+    int length;
+    int variablesCount;
+    struct SequenceInstruction instructions[MAX_SEQUENCE_LEN];
+};
+
+/// A sequence of instructions, and a shorter one with the same effect on A and on the variables.
+struct Rewrite {
+    struct Sequence pattern;
+    struct Sequence replacement;
+};
+
+/**
+ * Parses instructions separated by semicolons, e.g. "add #'a'; st x".
+ * Immediate values must be constant expressions, and other arguments name
+ * variables. Variables of `sequence` which are already named in
+ * `variableNames` keep their indices. Returns false if the sequence is
+ * invalid.
+ */
+bool parseSequence(char* text, struct Sequence* sequence, char* variableNames[MAX_SEQUENCE_VARIABLES]);
+
+/// Writes the sequence in the format of `parseSequence`, naming the variables x and y.
+void writeSequence(FILE* file, struct Sequence* sequence);
+
+/**
+ * Searches for the shortest sequence with the same effect as `target` using
+ * all processors, and stores it in `*result`. Candidates are built from the
+ * variables of the target and immediate values derived from the target's
+ * ones, and are verified for every possible value of A and the variables.
+ * Returns false if there is no shorter sequence.
+ */
+bool superoptimize(struct Sequence* target, struct Sequence* result);
+
+/**
+ * Parses rewrites written as "pattern => replacement" lines, ignoring empty
+ * lines. Returns the number of rewrites, or -1 if any line is invalid.
+ */
+int parseRewrites(char* contents, struct Rewrite* rewrites);
+
+/**
+ * Returns a copy of the source, in which instructions matching the pattern of
+ * any rewrite are replaced, keeping the line numbers of the remaining lines.
+ * Only sequences of lines containing a single instruction each, with labels
+ * only before the first one, which aren't referenced by any instruction past
+ * their first byte, stored to or named by `.LSB` or `.MSB` data, and whose
+ * variables aren't memory-mapped devices, are replaced. Nothing is replaced
+ * if any instruction refers to code by an address without a label or to the
+ * middle of an instruction. Stores the number of replaced sequences in
+ * `*rewritesCount`.
+ */
+char* applyRewrites(const char* source, struct Rewrite* rewrites, int count, int* rewritesCount);
+
+#endif
@@ -2,12 +2,16 @@
 #include "stdbool.h"
 #include "ctype.h"
 #include "stdlib.h"
-#include "../../common/exit-code.h"
+#include "string.h"
+#include "pthread.h"
+#include "../failure/failure.h"
+
+#define MAX_LEXER_THREADS 64
 
 static void skipUntilTokenStart(char** string, int* lineNumber) {
     bool isComment = false;
 
-    while (isspace(**string) || isComment || **string == ';') {
+    while (**string != 0 && (isspace(**string) || isComment || **string == ';')) {
         if (**string == ';') {
             isComment = true;
         } else if (**string == '\n') {
@@ -35,21 +39,31 @@ static void skipUntilAfterStringEnd(char** string, int* lineNumber) {
     } while (**string != terminator && **string != 0);
 
     if (**string == 0) {
-        printf("Error on line %d: unterminated %s literal.\n", *lineNumber, terminator == '"' ? "string" : "character");
-        exit(ExitCodeUnterminatedString);
+        fail(ExitCodeUnterminatedString, "Error on line %d: unterminated %s literal.\n", *lineNumber, terminator == '"' ? "string" : "character");
     }
 
     ++*string;
 }
 
 static void skipUntilAfterTokenEnd(char** string, int* lineNumber) {
-    while (!isspace(**string) && **string != ';' && **string != 0) {
+    int parenthesesDepth = 0; // Whitespace within parentheses doesn't end the token, unless it's a line feed
+
+    while (((parenthesesDepth > 0 && **string != '\n') || !isspace(**string)) && **string != ';' && **string != 0) {
         if (**string == '"' || **string == '\'') {
             skipUntilAfterStringEnd(string, lineNumber);
         } else {
+            if (**string == '(') {
+                ++parenthesesDepth;
+            } else if (**string == ')' && parenthesesDepth > 0) {
+                --parenthesesDepth;
+            }
             ++*string;
         }
     }
+
+    if (parenthesesDepth > 0) {
+        fail(ExitCodeInvalidExpression, "Error on line %d: unmatched \"(\".\n", *lineNumber);
+    }
 }
 
 static void zeroTerminate(char** string, int* lineNumber) {
@@ -86,3 +100,215 @@ struct Token getToken(char** string, int* lineNumber) {
 
     return (struct Token) { tokenStartLineNumber, end - result, result };
 }
+
+/// The state of tokenizing at the end of a chunk, which isn't in a literal at a safe boundary.
+struct ChunkState {
+    char literalTerminator; // The quote of an unterminated literal, or 0
+    char* literalStart;
+    char* commentStart; // The start of a comment which isn't ended by a line feed, or NULL
+};
+
+struct Chunk {
+    char* start;
+    char* end; // After the line feed ending the chunk, or at the end of the source
+    int lineNumber;
+    int lineFeedsCount;
+    struct ChunkState endState; // Assuming the chunk starts at a safe boundary, until chunks are merged
+    bool endsSource;
+    struct LexedSource lexed;
+};
+
+static bool isSafeBoundary(struct ChunkState state) {
+    return state.literalTerminator == 0;
+}
+
+/// Follows the same rules as `getToken`, but only tracks whether the end of the chunk is in a literal or in a comment.
+static struct ChunkState scanChunk(char* start, char* end, struct ChunkState state) {
+    bool isComment = false;
+
+    for (char* character = start; character < end; ++character) {
+        if (state.literalTerminator != 0) {
+            if (*character == '\\' && character + 1 < end && *(character + 1) == state.literalTerminator) {
+                ++character;
+            } else if (*character == state.literalTerminator) {
+                state.literalTerminator = 0;
+            }
+        } else if (isComment) {
+            isComment = *character != '\n';
+            state.commentStart = isComment ? state.commentStart : NULL;
+        } else if (*character == ';') {
+            isComment = true;
+            state.commentStart = character;
+        } else if (*character == '"' || *character == '\'') {
+            state.literalTerminator = *character;
+            state.literalStart = character;
+        }
+    }
+
+    return state;
+}
+
+static void* scanChunkOnThread(void* argument) {
+    struct Chunk* chunk = argument;
+    chunk->endState = scanChunk(chunk->start, chunk->end, (struct ChunkState) { 0 });
+    chunk->lineFeedsCount = 0;
+    for (char* lineFeed = chunk->start; (lineFeed = memchr(lineFeed, '\n', chunk->end - lineFeed)) != NULL; ++lineFeed) {
+        ++chunk->lineFeedsCount;
+    }
+    return NULL;
+}
+
+char* findUnterminatedLiteral(char* start, char* end) {
+    struct ChunkState state = scanChunk(start, end, (struct ChunkState) { 0 });
+    return state.literalTerminator != 0 ? state.literalStart : NULL;
+}
+
+char* findUnterminatedComment(char* start, char* end) {
+    return scanChunk(start, end, (struct ChunkState) { 0 }).commentStart;
+}
+
+static void addLexedToken(struct LexedSource* lexed, int* capacity, struct Token token, int nextLineNumber) {
+    if (lexed->tokensCount == *capacity) {
+        *capacity = *capacity == 0 ? 0x400 : *capacity * 2;
+        lexed->tokens = realloc(lexed->tokens, *capacity * sizeof(struct LexedToken));
+    }
+    lexed->tokens[lexed->tokensCount++] = (struct LexedToken) { token, nextLineNumber };
+}
+
+/**
+ * Tokenizes the chunk, whose ending line feed is replaced with 0, so that
+ * the chunks are independent. A token ending at that line feed would be
+ * followed by the next line. The last chunk is already terminated, so its
+ * line feed is kept and counted, as it is when tokenizing sequentially.
+ */
+static void* tokenizeChunkOnThread(void* argument) {
+    struct Chunk* chunk = argument;
+    char* lastCharacter = chunk->end - 1;
+    bool endsWithLineFeed = !chunk->endsSource && chunk->end > chunk->start && *lastCharacter == '\n';
+    int capacity = 0;
+    jmp_buf errorJump;
+    char* string = chunk->start;
+    int lineNumber = chunk->lineNumber;
+
+    if (endsWithLineFeed) {
+        *lastCharacter = 0;
+    }
+
+    if (setjmp(errorJump) != 0) {
+        chunk->lexed.exitCode = getCaughtExitCode();
+        return NULL;
+    }
+
+    beginCatchingErrors(&errorJump, chunk->lexed.errorMessage, sizeof(chunk->lexed.errorMessage));
+    while (true) {
+        struct Token token = getToken(&string, &lineNumber);
+        if (token.value == NULL) {
+            break;
+        }
+        bool endsAtLineFeed = endsWithLineFeed && token.value + token.length == lastCharacter;
+        addLexedToken(&chunk->lexed, &capacity, token, lineNumber + (endsAtLineFeed ? 1 : 0));
+    }
+    endCatchingErrors();
+
+    chunk->lexed.endLineNumber = lineNumber + (endsWithLineFeed ? 1 : 0);
+    return NULL;
+}
+
+/**
+ * Runs the function for every chunk on a separate thread, or on the calling
+ * thread if there is a single chunk or a thread can't be created, without
+ * affecting the errors caught on the calling thread.
+ */
+static void runOnThreads(void* (*function)(void*), struct Chunk* chunks, int chunksCount) {
+    pthread_t threads[MAX_LEXER_THREADS];
+    bool isStarted[MAX_LEXER_THREADS];
+
+    for (int i = 0; i < chunksCount; ++i) {
+        isStarted[i] = chunksCount > 1 && pthread_create(&threads[i], NULL, function, &chunks[i]) == 0;
+
+        if (!isStarted[i]) {
+            struct ErrorCatching catching = getErrorCatching();
+            function(&chunks[i]);
+            resumeCatchingErrors(catching);
+        }
+    }
+
+    for (int i = 0; i < chunksCount; ++i) {
+        if (isStarted[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+}
+
+struct LexedSource tokenizeInParallel(char* source, int threadsCount) {
+    struct Chunk chunks[MAX_LEXER_THREADS] = { 0 };
+    size_t size = strlen(source);
+    int chunksCount = 0;
+    char* start = source;
+
+    if (threadsCount > MAX_LEXER_THREADS) {
+        threadsCount = MAX_LEXER_THREADS;
+    }
+
+    for (int i = 1; i <= threadsCount && start < source + size; ++i) {
+        char* splitPoint = source + size * i / threadsCount < start ? start : source + size * i / threadsCount;
+        char* lineFeed = i == threadsCount ? NULL : memchr(splitPoint, '\n', source + size - splitPoint);
+        char* end = lineFeed == NULL ? source + size : lineFeed + 1;
+        chunks[chunksCount].start = start;
+        chunks[chunksCount++].end = end;
+        start = end;
+    }
+
+    if (chunksCount == 0) {
+        chunks[chunksCount].start = source;
+        chunks[chunksCount++].end = source;
+    }
+
+    runOnThreads(scanChunkOnThread, chunks, chunksCount);
+
+    // Merges every chunk which doesn't start at a safe boundary into the previous one
+    int mergedChunksCount = 1;
+    chunks[0].lineNumber = 1;
+    for (int i = 1; i < chunksCount; ++i) {
+        struct Chunk* previous = &chunks[mergedChunksCount - 1];
+        if (isSafeBoundary(previous->endState)) {
+            int lineNumber = previous->lineNumber + previous->lineFeedsCount;
+            chunks[mergedChunksCount++] = chunks[i];
+            chunks[mergedChunksCount - 1].lineNumber = lineNumber;
+        } else {
+            previous->endState = scanChunk(chunks[i].start, chunks[i].end, previous->endState);
+            previous->end = chunks[i].end;
+            previous->lineFeedsCount += chunks[i].lineFeedsCount;
+        }
+    }
+
+    chunks[mergedChunksCount - 1].endsSource = true;
+    runOnThreads(tokenizeChunkOnThread, chunks, mergedChunksCount);
+
+    // Tokenizing sequentially would stop at the first error
+    int lastChunkIndex = 0;
+    while (lastChunkIndex < mergedChunksCount - 1 && chunks[lastChunkIndex].lexed.exitCode == ExitCodeSuccess) {
+        ++lastChunkIndex;
+    }
+
+    struct LexedSource lexed = { NULL, 0, 0, ExitCodeSuccess, { 0 } };
+    int tokensCount = 0;
+    for (int i = 0; i <= lastChunkIndex; ++i) {
+        tokensCount += chunks[i].lexed.tokensCount;
+    }
+
+    lexed.tokens = malloc((tokensCount > 0 ? tokensCount : 1) * sizeof(struct LexedToken));
+    for (int i = 0; i < mergedChunksCount; ++i) {
+        if (i <= lastChunkIndex && chunks[i].lexed.tokensCount > 0) { // Chunks without tokens have no array
+            memcpy(lexed.tokens + lexed.tokensCount, chunks[i].lexed.tokens, chunks[i].lexed.tokensCount * sizeof(struct LexedToken));
+            lexed.tokensCount += chunks[i].lexed.tokensCount;
+        }
+        free(chunks[i].lexed.tokens);
+    }
+
+    struct Chunk* last = &chunks[lastChunkIndex];
+    lexed.endLineNumber = last->lexed.endLineNumber;
+    lexed.exitCode = last->lexed.exitCode;
+    memcpy(lexed.errorMessage, last->lexed.errorMessage, sizeof(lexed.errorMessage));
+    return lexed;
+}
@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <stdio.h>
+#include "../../common/exit-code.h"
 
 struct Token {
     int lineNumber;
@@ -13,10 +14,46 @@ struct Token {
 /**
  * Returned structure field value points to the first token in the string
  * pointed to by `*string`, or NULL if there isn't any token in the string.
+ * Whitespace enclosed in parentheses is a part of the token. Exits the
+ * program if the parentheses aren't closed before the end of the line.
  * Replaces the first non-token character of the string with 0.
  * Updates `*string` to point to the first character after the 0.
  * Increments `*lineNumber` by the number of LF characters encountered.
  */
 struct Token getToken(char** string, int* lineNumber);
 
+/**
+ * Returns the opening quote of the character or string literal which isn't
+ * terminated before `end`, or NULL if there isn't any. `start` must be at
+ * a point where `getToken` could begin, such as after a token.
+ */
+char* findUnterminatedLiteral(char* start, char* end);
+
+/// Returns the `;` starting the comment which isn't ended by a line feed before `end`, or NULL if there isn't any, like `findUnterminatedLiteral`.
+char* findUnterminatedComment(char* start, char* end);
+
+/// A token and the line number following it, as left in `*lineNumber` by `getToken`.
+struct LexedToken {
+    struct Token token;
+    int nextLineNumber;
+};
+
+struct LexedSource {
+    struct LexedToken* tokens;
+    int tokensCount;
+    int endLineNumber; // The line number of the token with a NULL value, which ends the source
+    enum ExitCode exitCode; // The error which tokenizing the rest of the source causes, or ExitCodeSuccess
+    char errorMessage[256];
+};
+
+/**
+ * Tokenizes the whole zero-terminated source with the same result as calling
+ * `getToken` repeatedly. The source is split at line feeds which aren't
+ * enclosed in a literal, and the chunks are tokenized on up to
+ * `threadsCount` threads. Doesn't fail, but stores the error which
+ * tokenizing sequentially would cause after the last token. The tokens must
+ * be freed with `free`.
+ */
+struct LexedSource tokenizeInParallel(char* source, int threadsCount);
+
 #endif
\ No newline at end of file
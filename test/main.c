@@ -17,25 +17,194 @@
     See file COPYING.
 */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
 #include "../common/exit-code.h"
+#include "../common/symbol-index.h"
+#include "../src/assembler/assembler.h"
+#include "../src/output/output.h"
+#include "../src/disassembler/disassembler.h"
+#include "../src/simulator/simulator.h"
+#include "../src/code-coverage/code-coverage.h"
+#include "../src/path-analysis/path-analysis.h"
+#include "../src/superoptimizer/superoptimizer.h"
+#include "../src/compressor/compressor.h"
+#include "../src/memory-map/memory-map.h"
+#include "../src/code-layout/code-layout.h"
 
 #define FAIL "\x1B[31m[FAIL]\x1B[0m"
 #define PASS "\x1B[32m[PASS]\x1B[0m"
 
-struct TestResults {
-    int passed;
-    int failed;
-} testResults;
+#if defined(TARGET_W13)
+#define TEST_CASES_DIRECTORY "test/test-cases"
+#define EXAMPLES_DIRECTORY "examples" // The examples are written for W13
+#else
+#define TEST_CASES_DIRECTORY "test/test-cases-w16"
+#endif
+#define MAX_TEST_CASES 0x400
+#define MAX_PATH_LEN 1024
+#define MAX_EXAMPLE_SUFFIX_LEN 0x20 // Of the files of an example following its name, e.g. "-virtual-clock.txt"
+#define MAX_MESSAGE_LEN 2048
+#define MAX_SIMULATION_STEPS 10000000
+#define TEST_LEXER_THREADS 4 // Every source is also tokenized in up to 4 chunks
+#define TEST_THREAD_STACK_SIZE 0x2000000
+
+struct ExpectedErrorCode {
+    const char* testName;
+    enum ExitCode exitCode;
+};
+
+/// Test cases without an expected.bin file are expected to fail with the given code.
+#if defined(TARGET_W13)
+static const struct ExpectedErrorCode expectedErrorCodes[] = {
+    { "empty-program-should-fail", ExitCodeResultProgramEmpty },
+    { "label-name-should-disallow-invalid-length", ExitCodeLabelNameTooLong },
+    { "label-name-should-disallow-invalid-character", ExitCodeInvalidLabelName },
+    { "declaration-should-disallow-beyond-memory-range", ExitCodeDeclaringValueOutOfMemoryRange },
+    { "instruction-should-disallow-beyond-memory-range", ExitCodeDeclaringValueOutOfMemoryRange },
+    { "memory-overwrite-should-fail", ExitCodeMemoryValueOverridden },
+    { "number-literals-hex-should-disallow-no-digits", ExitCodeInvalidNumberLiteral },
+    { "number-literals-should-disallow-too-high", ExitCodeNumberLiteralOutOutRange },
+    { "number-literals-should-disallow-too-low", ExitCodeNumberLiteralOutOutRange },
+    { "origin-should-disallow-address-beyond-memory-range", ExitCodeOriginOutOfMemoryRange },
+    { "origin-should-disallow-negative-address", ExitCodeOriginOutOfMemoryRange },
+    { "reference-should-disallow-address-beyond-memory-range", ExitCodeReferenceToInvalidAddress },
+    { "reference-should-disallow-negative-address", ExitCodeReferenceToInvalidAddress },
+    { "string-should-disallow-unterminated", ExitCodeUnterminatedString },
+    { "fill-should-disallow-multiple-characters", ExitCodeInvalidDirectiveArgument },
+    { "fill-should-disallow-non-positive-count", ExitCodeInvalidDirectiveArgument },
+    { "align-should-disallow-param-too-low", ExitCodeInvalidDirectiveArgument },
+    { "align-should-disallow-param-too-high", ExitCodeInvalidDirectiveArgument },
+    { "align-should-disallow-beyond-memory-range", ExitCodeOriginOutOfMemoryRange },
+    { "labels-should-disallow-duplicates", ExitCodeLabelNameNotUnique },
+    { "character-expressions-should-disallow-modifiers-too-low", ExitCodeCharacterLiteralOutOutRange },
+    { "character-expressions-should-disallow-modifiers-too-high", ExitCodeCharacterLiteralOutOutRange },
+    { "lsb-msb-should-disallow-offset-too-low", ExitCodeReferenceToInvalidAddress },
+    { "lsb-msb-should-disallow-offset-too-high", ExitCodeReferenceToInvalidAddress },
+    { "immediate-expr-should-disallow-beyond-data-range", ExitCodeImmediateValueDeclarationOutOfMemoryRange },
+    { "immediate-expr-should-disallow-st", ExitCodeInvalidInstructionArgument },
+    { "immediate-expr-should-disallow-too-high", ExitCodeCharacterLiteralOutOutRange },
+    { "immediate-expr-should-disallow-too-low", ExitCodeCharacterLiteralOutOutRange },
+    { "expressions-should-disallow-division-by-zero", ExitCodeInvalidExpression },
+    { "expressions-should-disallow-undefined-symbol", ExitCodeUndefinedLabel },
+    { "expressions-should-disallow-unmatched-parenthesis", ExitCodeInvalidExpression },
+    { "equ-should-disallow-circular-definition", ExitCodeInvalidExpression },
+    { "equ-should-disallow-name-of-label", ExitCodeLabelNameNotUnique },
+    { "table-should-disallow-unknown-function", ExitCodeInvalidDirectiveArgument },
+    { "table-should-disallow-shift-too-high", ExitCodeInvalidDirectiveArgument },
+    { "shl-should-disallow-count-too-high", ExitCodeInvalidInstructionArgument },
+    { "shl-should-disallow-immediate-value", ExitCodeInvalidInstructionArgument },
+    { "pool-should-disallow-non-string", ExitCodeInvalidDirectiveArgument },
+    { "call-should-disallow-recursion", ExitCodeRecursiveCall },
+    { "call-should-disallow-subroutine-without-ret", ExitCodeUnmatchedReturn },
+    { "ret-should-disallow-no-subroutine", ExitCodeUnmatchedReturn },
+};
+#else
+static const struct ExpectedErrorCode expectedErrorCodes[] = {
+    { "instruction-should-disallow-beyond-memory-range", ExitCodeDeclaringValueOutOfMemoryRange },
+    { "reference-should-disallow-address-beyond-memory-range", ExitCodeReferenceToInvalidAddress },
+};
+#endif
+
+/// Test cases run with a budget or a timeout are expected to halt within them, unless they're expected to fail with the given code.
+static const struct ExpectedErrorCode expectedRunErrorCodes[] = {
+    { "run-should-disallow-exceeding-budget", ExitCodeInstructionBudgetExceeded },
+    { "run-should-time-out-on-infinite-loop", ExitCodeRunTimedOut },
+};
+
+/// A test case whose source repeats a line too many times to be kept in a file.
+struct GeneratedTestCase {
+    const char* testName;
+    const char* header; // Followed by the repeated line and the footer
+    const char* repeatedLine;
+    int repeatsCount;
+    const char* footer;
+    enum ExitCode exitCode;
+    int expansionsCount; // Expected if the source assembles
+};
+
+#if defined(TARGET_W13)
+static const struct GeneratedTestCase generatedTestCases[] = {
+    { "ret-should-disallow-too-many-subroutine-events", "", "ret\n", 4096, "", ExitCodeTooManySubroutineEvents, 0 },
+};
+#else
+static const struct GeneratedTestCase generatedTestCases[] = {
+    {
+        "pseudo-instructions-should-allow-more-scratch-cell-uses-than-immediate-values",
+        "; Every OR uses the scratch cell twice, which is more uses than the immediate values may have\njmp start\nx: 1\nstart:\n",
+        "or x\n", 4200, "halt: jmp halt\n", ExitCodeSuccess, 4200
+    },
+};
+#endif
+
+struct TestCase {
+    char name[MAX_PATH_LEN];
+    char sourcePath[MAX_PATH_LEN];
+    char expectedBinaryPath[MAX_PATH_LEN];
+    char expectedSymbolsPath[MAX_PATH_LEN];
+    char expectedIntelHexPath[MAX_PATH_LEN];
+    char expectedSymbolIndexPath[MAX_PATH_LEN];
+    char inputPath[MAX_PATH_LEN];
+    char expectedOutputPath[MAX_PATH_LEN];
+    char expectedTracePath[MAX_PATH_LEN];
+    char expectedCoveragePath[MAX_PATH_LEN];
+    char expectedAnalysisPath[MAX_PATH_LEN];
+    char rewritesPath[MAX_PATH_LEN];
+    char expectedExpansionsPath[MAX_PATH_LEN];
+    char optimizeSpeedPath[MAX_PATH_LEN]; // Pseudo-instructions are expanded for speed if this file exists
+    char expectedCompressedBinaryPath[MAX_PATH_LEN];
+    char expectedListingPath[MAX_PATH_LEN];
+    char virtualClockPath[MAX_PATH_LEN]; // The program is run with the virtual clock rate in nanoseconds per step from this file, if it exists
+    char expectedLayoutPath[MAX_PATH_LEN]; // The source is laid out by the profile of its run before assembling if this file exists
+    char budgetPath[MAX_PATH_LEN]; // The program is also run with the instruction budget from this file, if it exists
+    char timeoutPath[MAX_PATH_LEN]; // The program is also run with the timeout in milliseconds from this file, if it exists
+    char expectedErrorPath[MAX_PATH_LEN]; // The error message of a case expected to fail must match this file, if it exists
+    char expectedDisassemblyPath[MAX_PATH_LEN];
+    char expectedSnapshotPath[MAX_PATH_LEN]; // Only deterministic if the case also has a virtual clock
+    char expectedCoverageFilePath[MAX_PATH_LEN];
+    const struct GeneratedTestCase* generated; // The source is generated instead of read from the source path, if it's not NULL
+    enum ExitCode expectedExitCode;
+    enum ExitCode expectedRunExitCode;
+    bool passed;
+    char message[MAX_MESSAGE_LEN];
+};
+
+enum OutputType {
+    OutputTypeBinary,
+    OutputTypeSymbols,
+    OutputTypeIntelHex,
+    OutputTypeSymbolIndex,
+    OutputTypeTerminal,
+    OutputTypeTrace,
+    OutputTypeCoverage,
+    OutputTypeAnalysis,
+    OutputTypeExpansions,
+    OutputTypeCompressedBinary,
+    OutputTypeListing,
+    OutputTypeLayout,
+    OutputTypeErrorMessage,
+    OutputTypeDisassembly,
+    OutputTypeSnapshot,
+    OutputTypeCoverageFile
+};
 
-enum FileType {
-    FileTypeBinary,
-    FileTypeText
+struct Buffer {
+    char* data;
+    size_t size;
 };
 
+static struct TestCase testCases[MAX_TEST_CASES];
+static int testCasesCount = 0;
+static atomic_int nextTestCaseIndex = 0;
+
 static bool fileExists(char* path) {
     FILE* file = fopen(path, "r");
     if (file == NULL) {
@@ -46,209 +215,996 @@ static bool fileExists(char* path) {
     }
 }
 
-static bool filesIdentical(char* testName, char* fileExtension, enum FileType fileType) {
-    char expectedFilePath[1024];
-    char actualFilePath[1024];
+/// Returns the zero-terminated contents of the file, or a buffer with NULL data if it can't be read.
+static struct Buffer readFile(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return (struct Buffer) { NULL, 0 };
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+    char* data = malloc(size + 1);
+    size = fread(data, 1, size, file);
+    data[size] = 0;
+    fclose(file);
+    return (struct Buffer) { data, size };
+}
 
-    sprintf(expectedFilePath, "test/test-cases/%s/expected.%s", testName, fileExtension);
-    sprintf(actualFilePath, "test/test-cases/%s/actual.%s", testName, fileExtension);
+static const char* getOutputName(enum OutputType outputType) {
+    switch (outputType) {
+        case OutputTypeBinary: return "binary";
+        case OutputTypeSymbols: return "symbols";
+        case OutputTypeIntelHex: return "Intel HEX";
+        case OutputTypeSymbolIndex: return "symbol index";
+        case OutputTypeTerminal: return "terminal";
+        case OutputTypeTrace: return "trace";
+        case OutputTypeCoverage: return "coverage";
+        case OutputTypeAnalysis: return "analysis";
+        case OutputTypeExpansions: return "expansions";
+        case OutputTypeCompressedBinary: return "compressed binary";
+        case OutputTypeListing: return "listing";
+        case OutputTypeLayout: return "layout";
+        case OutputTypeErrorMessage: return "error message";
+        case OutputTypeDisassembly: return "disassembly";
+        case OutputTypeSnapshot: return "snapshot";
+        case OutputTypeCoverageFile: return "coverage file";
+    }
+}
 
-    FILE* expectedFile = fopen(expectedFilePath, fileType == FileTypeBinary ? "rb" : "r");
+static bool outputsIdentical(struct TestCase* testCase, char* expectedPath, struct Buffer actual, enum OutputType outputType) {
+    struct Buffer expected = readFile(expectedPath);
 
-    if (expectedFile == NULL) { 
-        printf(FAIL " %s - reference file \"%s\" is missing, the test can't be evaluated.\n", testName, expectedFilePath);
+    if (expected.data == NULL) {
+        sprintf(testCase->message, "reference file \"%s\" is missing, the test can't be evaluated.", expectedPath);
         return false;
     }
 
-    FILE* actualFile = fopen(actualFilePath, fileType == FileTypeBinary ? "rb" : "r");
+    int line = 1;
+    int col = 1;
+    bool identical = true;
+
+    for (size_t i = 0; identical && i < expected.size && i < actual.size; ++i) {
+        unsigned char expectedByte = expected.data[i];
+        unsigned char actualByte = actual.data[i];
 
-    if (actualFile == NULL) { 
-        fclose(expectedFile);
-        printf(FAIL " %s - file \"%s\" was not produced.\n", testName, actualFilePath);
-        return false; 
+        if (expectedByte != actualByte) {
+            identical = false;
+            switch (outputType) {
+                case OutputTypeBinary:
+                case OutputTypeSymbolIndex:
+                case OutputTypeCompressedBinary:
+                case OutputTypeSnapshot:
+                case OutputTypeCoverageFile:
+                    sprintf(testCase->message, "%s output at byte %zu (0x%04zX): expected 0x%02X, is 0x%02X.", getOutputName(outputType), i, i, expectedByte, actualByte);
+                    break;
+                case OutputTypeSymbols:
+                case OutputTypeIntelHex:
+                case OutputTypeTerminal:
+                case OutputTypeTrace:
+                case OutputTypeCoverage:
+                case OutputTypeAnalysis:
+                case OutputTypeExpansions:
+                case OutputTypeListing:
+                case OutputTypeLayout:
+                case OutputTypeErrorMessage:
+                case OutputTypeDisassembly:
+                    sprintf(testCase->message, "%s output at line %d column %d: expected '%c' (0x%02X), is '%c' (0x%02X).", getOutputName(outputType), line, col, expectedByte, expectedByte, actualByte, actualByte);
+                    break;
+            }
+        } else if (actualByte != '\n') {
+            ++col;
+        } else {
+            col = 1;
+            ++line;
+        }
     }
 
-    unsigned char expectedFileByte;
-    unsigned char actualFileByte;
+    if (identical && expected.size != actual.size) {
+        identical = false;
+        sprintf(testCase->message, "%s output was expected to be %zu bytes, is %zu bytes.", getOutputName(outputType), expected.size, actual.size);
+    }
 
-    int line = 1;
-    int col = 1;
+    free(expected.data);
+    return identical;
+}
+
+/**
+ * Disassembles the program and checks whether the resulting source assembles
+ * to the same binary. Without symbols, only the program memory is kept, as
+ * when disassembling a binary file alone.
+ */
+static bool disassemblyReassembles(struct TestCase* testCase, struct AssemblerResult* result, bool hasSymbols) {
+    int programSize = getProgramSize(result);
+
+    struct AssemblerResult* image = result;
+    if (!hasSymbols) {
+        image = calloc(1, sizeof(struct AssemblerResult));
+        memcpy(image->programMemory, result->programMemory, programSize);
+    }
+
+    struct Buffer source;
+    FILE* sourceStream = open_memstream(&source.data, &source.size);
+    disassemble(sourceStream, image, programSize, hasSymbols);
+    fclose(sourceStream);
+
+    if (image != result) {
+        free(image);
+    }
+
+    if (hasSymbols && fileExists(testCase->expectedDisassemblyPath)
+        && !outputsIdentical(testCase, testCase->expectedDisassemblyPath, source, OutputTypeDisassembly)) {
+        free(source.data);
+        return false;
+    }
+
+    struct AssemblerResult* reassembled = malloc(sizeof(struct AssemblerResult));
+    char errorMessage[MAX_MESSAGE_LEN / 2] = { 0 };
+    enum ExitCode exitCode = tryAssemble(source.data, reassembled, errorMessage, sizeof(errorMessage));
+    errorMessage[strcspn(errorMessage, "\n")] = 0;
+
+    bool identical = exitCode == ExitCodeSuccess
+        && getProgramSize(reassembled) == programSize
+        && memcmp(reassembled->programMemory, result->programMemory, programSize) == 0;
+
+    if (exitCode != ExitCodeSuccess) {
+        sprintf(testCase->message, "disassembly %s symbols produced code %d when reassembled (%s).", hasSymbols ? "with" : "without", exitCode, errorMessage);
+    } else if (!identical) {
+        sprintf(testCase->message, "disassembly %s symbols doesn't reassemble to the same binary.", hasSymbols ? "with" : "without");
+    }
+
+    free(reassembled);
+    free(source.data);
+    return identical;
+}
+
+/// Writes the static path analysis with the lines of the source file, and compares it with the expected analysis.
+static bool expectedAnalysisProduced(struct TestCase* testCase, struct AssemblerResult* result) {
+    struct Buffer source = readFile(testCase->sourcePath);
+    struct Buffer analysis;
+    FILE* analysisStream = open_memstream(&analysis.data, &analysis.size);
+    writePathAnalysis(analysisStream, result, source.data);
+    fclose(analysisStream);
+
+    bool passed = outputsIdentical(testCase, testCase->expectedAnalysisPath, analysis, OutputTypeAnalysis);
+
+    free(analysis.data);
+    free(source.data);
+    return passed;
+}
+
+/// Writes the listing with the lines of the source file, and compares it with the expected listing.
+static bool expectedListingProduced(struct TestCase* testCase, struct AssemblerResult* result) {
+    struct Buffer source = readFile(testCase->sourcePath);
+    struct Buffer listing;
+    FILE* listingStream = open_memstream(&listing.data, &listing.size);
+    writeListing(listingStream, result, source.data);
+    fclose(listingStream);
+
+    bool passed = outputsIdentical(testCase, testCase->expectedListingPath, listing, OutputTypeListing);
+
+    free(listing.data);
+    free(source.data);
+    return passed;
+}
+
+static struct Machine* createMachineWithInput(struct TestCase* testCase, struct AssemblerResult* result, FILE* outputFile) {
+    struct Machine* machine = createMachine(result->programMemory, getProgramSize(result), outputFile);
+    struct Buffer input = readFile(testCase->inputPath);
+    if (input.data != NULL) {
+        provideInput(machine, (unsigned char*) input.data, input.size);
+        free(input.data);
+    }
+    struct Buffer virtualClock = readFile(testCase->virtualClockPath);
+    if (virtualClock.data != NULL) {
+        machine->nanosecondsPerStep = strtoul(virtualClock.data, NULL, 0);
+        free(virtualClock.data);
+    }
+    return machine;
+}
+
+/// Decodes the binary trace with labels of the program, and compares it with the expected trace.
+static bool expectedTraceProduced(struct TestCase* testCase, struct AssemblerResult* result, struct Buffer binaryTrace) {
+    struct Buffer decodedTrace;
+    FILE* decodedTraceStream = open_memstream(&decodedTrace.data, &decodedTrace.size);
+    FILE* binaryTraceStream = fmemopen(binaryTrace.data, binaryTrace.size, "rb");
+    bool valid = decodeTrace(binaryTraceStream, decodedTraceStream, result);
+    fclose(binaryTraceStream);
+    fclose(decodedTraceStream);
+
+    bool passed = valid && outputsIdentical(testCase, testCase->expectedTracePath, decodedTrace, OutputTypeTrace);
+    if (!valid) {
+        sprintf(testCase->message, "the recorded trace could not be decoded.");
+    }
+
+    free(decodedTrace.data);
+    return passed;
+}
+
+/// Writes the coverage report with the lines of the source file, and compares it with the expected report.
+static bool expectedCoverageProduced(struct TestCase* testCase, struct AssemblerResult* result, struct Coverage* coverage) {
+    struct Buffer source = readFile(testCase->sourcePath);
+    struct Buffer report;
+    FILE* reportStream = open_memstream(&report.data, &report.size);
+    writeCoverageReport(reportStream, coverage, result, source.data);
+    fclose(reportStream);
+
+    bool passed = outputsIdentical(testCase, testCase->expectedCoveragePath, report, OutputTypeCoverage);
+
+    free(report.data);
+    free(source.data);
+    return passed;
+}
+
+/// Saves the coverage to a file, compares it with the expected file, if any, and checks whether loading it restores the coverage.
+static bool expectedCoverageFileProduced(struct TestCase* testCase, struct Coverage* coverage) {
+    struct Buffer coverageFile;
+    FILE* coverageFileStream = open_memstream(&coverageFile.data, &coverageFile.size);
+    saveCoverage(coverageFileStream, coverage);
+    fclose(coverageFileStream);
+
+    bool passed = !fileExists(testCase->expectedCoverageFilePath)
+        || outputsIdentical(testCase, testCase->expectedCoverageFilePath, coverageFile, OutputTypeCoverageFile);
+
+    struct Coverage* loaded = createCoverage();
+    coverageFileStream = fmemopen(coverageFile.data, coverageFile.size, "rb");
+    bool loadedIdentical = loadCoverage(coverageFileStream, loaded) && memcmp(loaded, coverage, sizeof(struct Coverage)) == 0;
+    fclose(coverageFileStream);
+
+    if (passed && !loadedIdentical) {
+        sprintf(testCase->message, "the saved coverage file doesn't load back to the coverage of the run.");
+        passed = false;
+    }
+
+    free(loaded);
+    free(coverageFile.data);
+    return passed;
+}
+
+/**
+ * Runs the program until it halts, and checks the terminal output, the
+ * execution trace, the coverage report and the coverage file, if expected.
+ * Then runs it again, pausing halfway to resume both a fork and a snapshot
+ * restored from a file, which is compared as well, if expected, and checks
+ * whether each of them produces the same output, and whether coverage of both
+ * halves merges into the coverage of the whole run.
+ */
+static bool programRunsAsExpected(struct TestCase* testCase, struct AssemblerResult* result) {
+    struct Buffer terminalOutput;
+    FILE* outputStream = open_memstream(&terminalOutput.data, &terminalOutput.size);
+    struct Machine* machine = createMachineWithInput(testCase, result, outputStream);
+    struct Buffer binaryTrace;
+    FILE* binaryTraceStream = open_memstream(&binaryTrace.data, &binaryTrace.size);
+    machine->trace = startTrace(binaryTraceStream);
+    struct Coverage* coverage = machine->coverage = createCoverage();
+    run(machine, MAX_SIMULATION_STEPS);
+    finishTrace(machine->trace);
+    machine->trace = NULL;
+    fclose(binaryTraceStream);
+    uint64_t steps = machine->steps;
+    bool halted = machine->halted;
+    destroyMachine(machine);
+    fclose(outputStream);
+
+    if (!halted) {
+        sprintf(testCase->message, "the program didn't halt within %d steps.", MAX_SIMULATION_STEPS);
+        free(terminalOutput.data);
+        free(binaryTrace.data);
+        free(coverage);
+        return false;
+    }
+
+    bool passed = outputsIdentical(testCase, testCase->expectedOutputPath, terminalOutput, OutputTypeTerminal)
+        && (!fileExists(testCase->expectedTracePath) || expectedTraceProduced(testCase, result, binaryTrace))
+        && (!fileExists(testCase->expectedCoveragePath) || expectedCoverageProduced(testCase, result, coverage))
+        && expectedCoverageFileProduced(testCase, coverage);
+    free(terminalOutput.data);
+    free(binaryTrace.data);
+
+    struct Buffer forkedOutput;
+    FILE* forkedOutputStream = open_memstream(&forkedOutput.data, &forkedOutput.size);
+    struct Machine* original = createMachineWithInput(testCase, result, forkedOutputStream);
+    struct Coverage* mergedCoverage = original->coverage = createCoverage();
+    run(original, steps / 2);
+    fflush(forkedOutputStream);
+
+    struct Buffer snapshot;
+    FILE* snapshotStream = open_memstream(&snapshot.data, &snapshot.size);
+    saveSnapshot(snapshotStream, original);
+    fclose(snapshotStream);
+    passed = passed && (!fileExists(testCase->expectedSnapshotPath)
+        || outputsIdentical(testCase, testCase->expectedSnapshotPath, snapshot, OutputTypeSnapshot));
+
+    struct Buffer restoredOutput = { NULL, 0 };
+    FILE* restoredOutputStream = open_memstream(&restoredOutput.data, &restoredOutput.size);
+    fwrite(forkedOutput.data, sizeof(char), forkedOutput.size, restoredOutputStream);
+
+    struct Machine* fork = forkMachine(original);
+    destroyMachine(original); // The fork must not be affected by releasing the shared pages
+    fork->coverage = createCoverage();
+    run(fork, MAX_SIMULATION_STEPS);
+    mergeCoverage(mergedCoverage, fork->coverage);
+    free(fork->coverage);
+    destroyMachine(fork);
+
+    if (passed && memcmp(mergedCoverage, coverage, sizeof(struct Coverage)) != 0) {
+        sprintf(testCase->message, "coverage of the run resumed from a fork doesn't merge into the coverage of the whole run.");
+        passed = false;
+    }
+    fclose(forkedOutputStream);
+
+    snapshotStream = fmemopen(snapshot.data, snapshot.size, "rb");
+    struct Machine* restored = loadSnapshot(snapshotStream, restoredOutputStream);
+    fclose(snapshotStream);
 
-    for (int i = 0;; ++i) {
-        bool expectedFileEof = !fread(&expectedFileByte, sizeof(unsigned char), 1, expectedFile);
-        bool actualFileEof = !fread(&actualFileByte, sizeof(unsigned char), 1, actualFile);
+    if (restored == NULL) {
+        sprintf(testCase->message, "the snapshot could not be loaded.");
+        passed = false;
+    } else {
+        run(restored, MAX_SIMULATION_STEPS);
+        passed = passed && restored->steps == steps
+            && outputsIdentical(testCase, testCase->expectedOutputPath, forkedOutput, OutputTypeTerminal);
+        destroyMachine(restored);
+    }
+
+    fclose(restoredOutputStream);
+    passed = passed && outputsIdentical(testCase, testCase->expectedOutputPath, restoredOutput, OutputTypeTerminal);
+
+    free(forkedOutput.data);
+    free(restoredOutput.data);
+    free(snapshot.data);
+    free(mergedCoverage);
+    free(coverage);
+    return passed;
+}
+
+/// Runs the program with the budget and the timeout of the test case, and checks whether it halts within them or fails as expected.
+static bool programRunsWithinLimits(struct TestCase* testCase, struct AssemblerResult* result) {
+    uint64_t stepsBudget = UINT64_MAX;
+    double timeoutMs = 0;
+    struct Buffer budget = readFile(testCase->budgetPath);
+    if (budget.data != NULL) {
+        stepsBudget = strtoull(budget.data, NULL, 0);
+        free(budget.data);
+    }
+    struct Buffer timeout = readFile(testCase->timeoutPath);
+    if (timeout.data != NULL) {
+        timeoutMs = strtod(timeout.data, NULL);
+        free(timeout.data);
+    }
 
-        if (actualFileEof && expectedFileEof) {
-            fclose(expectedFile);
-            fclose(actualFile);
-            return true;
+    struct Machine* machine = createMachineWithInput(testCase, result, NULL);
+    uint64_t steps;
+    enum ExitCode exitCode = runWithinLimits(machine, UINT64_MAX, stepsBudget, timeoutMs, &steps);
+    destroyMachine(machine);
+
+    if (exitCode != testCase->expectedRunExitCode) {
+        sprintf(testCase->message, "run code %d was expected, but code %d was produced after %llu steps.", testCase->expectedRunExitCode, exitCode, (unsigned long long) steps);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Compresses the program, unless it doesn't fit along with the stub, and
+ * checks whether the stub unpacks it in place and jumps to it with A set to 0.
+ */
+static bool compressedProgramUnpacks(struct TestCase* testCase, struct AssemblerResult* result) {
+    struct CompressedProgram* compressed = malloc(sizeof(struct CompressedProgram));
+
+    if (!compressProgram(result, compressed)) {
+        free(compressed);
+        return !fileExists(testCase->expectedCompressedBinaryPath);
+    }
+
+    struct Buffer binary;
+    FILE* binaryStream = open_memstream(&binary.data, &binary.size);
+    writeBinary(binaryStream, &compressed->image, compressed->imageSize);
+    fclose(binaryStream);
+
+    bool passed = !fileExists(testCase->expectedCompressedBinaryPath)
+        || outputsIdentical(testCase, testCase->expectedCompressedBinaryPath, binary, OutputTypeCompressedBinary);
+
+    struct Machine* machine = createMachine(compressed->image.programMemory, compressed->imageSize, NULL);
+    while (machine->pc != compressed->relocationAddress && !machine->halted && machine->steps < MAX_SIMULATION_STEPS) {
+        step(machine); // The stub copies the decompressor, looping through address 0
+    }
+    do {
+        step(machine);
+    } while (machine->pc != 0 && !machine->halted && machine->steps < MAX_SIMULATION_STEPS);
+
+    if (passed && (machine->pc != 0 || machine->a != 0)) {
+        sprintf(testCase->message, "the compressed program didn't jump to address 0 with A set to 0 after unpacking.");
+        passed = false;
+    }
+
+    for (int i = 0; passed && i < compressed->programSize; ++i) {
+        if (peekMemory(machine, i) != result->programMemory[i]) {
+            sprintf(testCase->message, "the compressed program unpacked at byte 0x%04X: expected 0x%02X, is 0x%02X.", i, result->programMemory[i], peekMemory(machine, i));
+            passed = false;
         }
+    }
+
+    destroyMachine(machine);
+    free(binary.data);
+    free(compressed);
+    return passed;
+}
 
-        if (expectedFileEof) {
-            fseek(actualFile, 0, SEEK_END);          
-            int actualFileSize = ftell(actualFile);
-            printf(FAIL " %s - file \"%s\" was expected to be %d bytes, is %d bytes.\n", testName, actualFilePath, i, actualFileSize);
-            fclose(expectedFile);
-            fclose(actualFile);
+static uint32_t readIndexUint(struct Buffer* index, uint32_t offset, int size) {
+    uint32_t value = 0;
+    for (int i = size - 1; i >= 0; --i) {
+        value = value << 8 | (unsigned char) index->data[offset + i];
+    }
+    return value;
+}
+
+/// Looks the name up in the hash table of the symbol index, and returns the index of its label or SYMBOL_INDEX_NO_LABEL.
+static uint32_t findIndexedLabel(struct Buffer* index, const char* name) {
+    uint32_t bucketsCount = readIndexUint(index, 16, 4);
+    uint32_t labelsOffset = readIndexUint(index, 28, 4);
+    uint32_t bucketsOffset = readIndexUint(index, 32, 4);
+    uint32_t namesOffset = readIndexUint(index, 36, 4);
+
+    for (uint32_t bucket = hashSymbolName(name) & (bucketsCount - 1);; bucket = (bucket + 1) & (bucketsCount - 1)) {
+        uint32_t entry = readIndexUint(index, bucketsOffset + bucket * sizeof(uint32_t), 4);
+        if (entry == 0) {
+            return SYMBOL_INDEX_NO_LABEL;
+        }
+        uint32_t nameOffset = readIndexUint(index, labelsOffset + (entry - 1) * SYMBOL_INDEX_LABEL_SIZE + 4, 4);
+        if (strcmp(index->data + namesOffset + nameOffset, name) == 0) {
+            return entry - 1;
+        }
+    }
+}
+
+/**
+ * Reads the symbol index back and checks that every label is found by its
+ * name at its address and covers it, while labels of implicitly declared
+ * immediate values aren't indexed.
+ */
+static bool symbolIndexLookupsSucceed(struct TestCase* testCase, struct AssemblerResult* result, struct Buffer* index) {
+    uint32_t labelsOffset = readIndexUint(index, 28, 4);
+    uint32_t coveringLabelsOffset = readIndexUint(index, 24, 4);
+
+    for (int i = 0; i < result->labelsCount; ++i) {
+        struct LabelDefinition* label = &result->labels[i];
+        uint32_t found = findIndexedLabel(index, label->name);
+
+        if (label->name[0] == '#') {
+            if (found != SYMBOL_INDEX_NO_LABEL) {
+                sprintf(testCase->message, "the symbol index contains the label \"%s\" of an immediate value.", label->name);
+                return false;
+            }
+            continue;
+        }
+
+        if (found == SYMBOL_INDEX_NO_LABEL) {
+            sprintf(testCase->message, "the label \"%s\" isn't found in the symbol index.", label->name);
             return false;
         }
 
-        if (actualFileEof) {
-            fseek(expectedFile, 0, SEEK_END);          
-            int expectedFileSize = ftell(expectedFile);
-            printf(FAIL " %s - file \"%s\" was expected to be %d bytes, is %d bytes.\n", testName, actualFilePath, expectedFileSize, i);
-            fclose(expectedFile);
-            fclose(actualFile);
+        uint32_t address = readIndexUint(index, labelsOffset + found * SYMBOL_INDEX_LABEL_SIZE, 2);
+        uint32_t coveringLabel = readIndexUint(index, coveringLabelsOffset + label->address * sizeof(uint16_t), 2);
+        uint32_t coveringAddress = readIndexUint(index, labelsOffset + coveringLabel * SYMBOL_INDEX_LABEL_SIZE, 2);
+
+        if (address != (uint32_t) label->address || coveringLabel == SYMBOL_INDEX_NO_LABEL || coveringAddress != address) {
+            sprintf(testCase->message, "the label \"%s\" is indexed at 0x%04X or not covering it, but is defined at 0x%04X.", label->name, address, label->address);
             return false;
         }
+    }
 
-        if (expectedFileByte != actualFileByte) {
-            switch (fileType) {
-                case FileTypeBinary:
-                    printf(FAIL " %s - file \"%s\" at byte %d (0x%04X): expected 0x%02X, is 0x%02X.\n", testName, actualFilePath, i, i, expectedFileByte, actualFileByte);
-                    break;
-                case FileTypeText:
-                    printf(FAIL " %s - file \"%s\" at line %d column %d: expected '%c' (0x%02X), is '%c' (0x%02X).\n", testName, actualFilePath, line, col, expectedFileByte, expectedFileByte, actualFileByte, actualFileByte);
-                    break;
-            }
-            fclose(expectedFile);
-            fclose(actualFile);
+    return true;
+}
+
+/// Loads the symbol index back as the disassembler does, and checks whether it restores the data types and every label but those of immediate values.
+static bool symbolIndexLoads(struct TestCase* testCase, struct AssemblerResult* result, struct Buffer* index) {
+    struct AssemblerResult* image = calloc(1, sizeof(struct AssemblerResult));
+    char* contents = malloc(index->size);
+    memcpy(contents, index->data, index->size); // Label names of the image point into the contents
+
+    int labelsCount = 0;
+    for (int i = 0; i < result->labelsCount; ++i) {
+        labelsCount += result->labels[i].name[0] != '#';
+    }
+
+    bool passed = loadSymbols(contents, index->size, image)
+        && image->labelsCount == labelsCount
+        && memcmp(image->dataType, result->dataType, sizeof(image->dataType)) == 0;
+    if (!passed) {
+        sprintf(testCase->message, "the symbol index doesn't load back to the data types and the labels of the program.");
+    }
+
+    free(contents);
+    free(image);
+    return passed;
+}
+
+static bool expectedOutputsProduced(struct TestCase* testCase, struct AssemblerResult* result) {
+    struct Buffer binary;
+    FILE* binaryStream = open_memstream(&binary.data, &binary.size);
+    writeBinary(binaryStream, result, getProgramSize(result));
+    fclose(binaryStream);
+
+    struct Buffer symbols;
+    FILE* symbolsStream = open_memstream(&symbols.data, &symbols.size);
+    writeSymbols(symbolsStream, result);
+    fclose(symbolsStream);
+
+    struct Buffer intelHex;
+    FILE* intelHexStream = open_memstream(&intelHex.data, &intelHex.size);
+    writeIntelHex(intelHexStream, result);
+    fclose(intelHexStream);
+
+    struct Buffer symbolIndex;
+    FILE* symbolIndexStream = open_memstream(&symbolIndex.data, &symbolIndex.size);
+    writeSymbolIndex(symbolIndexStream, result);
+    fclose(symbolIndexStream);
+
+    struct Buffer expansions;
+    FILE* expansionsStream = open_memstream(&expansions.data, &expansions.size);
+    writeExpansions(expansionsStream, result);
+    fclose(expansionsStream);
+
+    bool passed = outputsIdentical(testCase, testCase->expectedBinaryPath, binary, OutputTypeBinary)
+        && outputsIdentical(testCase, testCase->expectedSymbolsPath, symbols, OutputTypeSymbols)
+        && (!fileExists(testCase->expectedIntelHexPath) || outputsIdentical(testCase, testCase->expectedIntelHexPath, intelHex, OutputTypeIntelHex))
+        && (!fileExists(testCase->expectedSymbolIndexPath) || outputsIdentical(testCase, testCase->expectedSymbolIndexPath, symbolIndex, OutputTypeSymbolIndex))
+        && symbolIndexLookupsSucceed(testCase, result, &symbolIndex)
+        && symbolIndexLoads(testCase, result, &symbolIndex)
+        && (!fileExists(testCase->expectedAnalysisPath) || expectedAnalysisProduced(testCase, result))
+        && (!fileExists(testCase->expectedExpansionsPath) || outputsIdentical(testCase, testCase->expectedExpansionsPath, expansions, OutputTypeExpansions))
+        && (!fileExists(testCase->expectedListingPath) || expectedListingProduced(testCase, result))
+        && disassemblyReassembles(testCase, result, true)
+        && disassemblyReassembles(testCase, result, false)
+        && compressedProgramUnpacks(testCase, result)
+        && (!fileExists(testCase->expectedOutputPath) || programRunsAsExpected(testCase, result))
+        && ((!fileExists(testCase->budgetPath) && !fileExists(testCase->timeoutPath)) || programRunsWithinLimits(testCase, result));
+
+    free(binary.data);
+    free(symbols.data);
+    free(intelHex.data);
+    free(symbolIndex.data);
+    free(expansions.data);
+    return passed;
+}
+
+static bool sequencesIdentical(struct Sequence* a, struct Sequence* b) {
+    if (a->length != b->length) {
+        return false;
+    }
+    for (int i = 0; i < a->length; ++i) {
+        if (a->instructions[i].opcode != b->instructions[i].opcode || a->instructions[i].isImmediate != b->instructions[i].isImmediate
+            || a->instructions[i].argument != b->instructions[i].argument) {
             return false;
         }
+    }
+    return true;
+}
 
-        if (actualFileByte != '\n') {
-            ++col;
-        } else {
-            col = 1;
-            ++line;
+/**
+ * Checks that the superoptimizer finds the replacement of every rewrite, and
+ * replaces the source with the rewritten one.
+ */
+static bool rewritesApplied(struct TestCase* testCase, struct Buffer* source) {
+    static _Thread_local struct Rewrite rewrites[MAX_REWRITES];
+    struct Buffer rewritesFile = readFile(testCase->rewritesPath);
+    int rewritesCount = parseRewrites(rewritesFile.data, rewrites);
+    free(rewritesFile.data);
+
+    if (rewritesCount < 0) {
+        sprintf(testCase->message, "rewrites file \"%s\" is invalid.", testCase->rewritesPath);
+        return false;
+    }
+
+    for (int i = 0; i < rewritesCount; ++i) {
+        struct Sequence result;
+        if (!superoptimize(&rewrites[i].pattern, &result) || !sequencesIdentical(&result, &rewrites[i].replacement)) {
+            sprintf(testCase->message, "superoptimizer didn't reproduce rewrite %d.", i + 1);
+            return false;
         }
     }
+
+    int appliedCount;
+    char* rewritten = applyRewrites(source->data, rewrites, rewritesCount, &appliedCount);
+    free(source->data);
+    source->data = rewritten;
+    source->size = strlen(rewritten);
+    return true;
 }
 
-static int executeTestCase(char* testName) {
-    char syscall[4096];
-    sprintf(syscall, "./dist/w13asm test/test-cases/%s/test.asm test/test-cases/%s/actual.bin test/test-cases/%s/actual.csv", testName, testName, testName);
-    int status = system(syscall);
-    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+/// Runs the program assembled from the source until it halts, recording coverage if it's not NULL, and returns the number of steps.
+static uint64_t runSource(struct TestCase* testCase, struct Buffer* source, struct Coverage* coverage) {
+    struct AssemblerResult* result = malloc(sizeof(struct AssemblerResult));
+    char* copy = strdup(source->data);
+    char errorMessage[MAX_MESSAGE_LEN / 2];
+    uint64_t steps = 0;
+
+    if (tryAssemble(copy, result, errorMessage, sizeof(errorMessage)) == ExitCodeSuccess) {
+        struct Machine* machine = createMachineWithInput(testCase, result, NULL);
+        machine->coverage = coverage;
+        steps = run(machine, MAX_SIMULATION_STEPS);
+        destroyMachine(machine);
+    }
+
+    free(copy);
+    free(result);
+    return steps;
 }
 
-static int executeExamplesTestCase() {
-    int status = system("./assemble-examples.sh");
-    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+/**
+ * Lays out the source by the profile of its run, compares it with the
+ * expected layout, and checks that the laid-out program takes the expected
+ * number of steps. Replaces the source with the laid-out one.
+ */
+static bool layoutApplied(struct TestCase* testCase, struct Buffer* source) {
+    struct Coverage* profile = createCoverage();
+    runSource(testCase, source, profile);
+
+    struct LayoutReport report;
+    char* laidOut = applyProfileLayout(source->data, profile, &report);
+    free(profile);
+    free(source->data);
+    source->data = laidOut;
+    source->size = strlen(laidOut);
+
+    if (!outputsIdentical(testCase, testCase->expectedLayoutPath, *source, OutputTypeLayout)) {
+        return false;
+    }
+
+    uint64_t steps = runSource(testCase, source, NULL);
+
+    if (steps != report.expectedSteps || report.expectedSteps >= report.profiledSteps) {
+        sprintf(testCase->message, "the profiled run of %llu steps was expected to take %llu steps after the layout, but took %llu.",
+            (unsigned long long) report.profiledSteps, (unsigned long long) report.expectedSteps, (unsigned long long) steps);
+        return false;
+    }
+
+    return true;
 }
 
-static void expectErrorCode(char* testName, int expectedErrorCode) {
-    char actualBinPath[1024];
-    char actualCsvPath[1024];
-    sprintf(actualBinPath, "test/test-cases/%s/actual.bin", testName);
-    sprintf(actualCsvPath, "test/test-cases/%s/actual.csv", testName);
-    remove(actualBinPath);
-    remove(actualCsvPath);
+/// Assembles the source from a stream, and checks that the result is the same as when it's assembled in memory.
+static bool streamedAssemblyIdentical(struct TestCase* testCase, struct Buffer source, enum ExitCode expectedExitCode, struct AssemblerResult* expected) {
+    FILE* stream = tmpfile();
+    fwrite(source.data, sizeof(char), source.size, stream);
+    rewind(stream);
 
-    int returnCode = executeTestCase(testName);
+    struct AssemblerResult* result = malloc(sizeof(struct AssemblerResult));
+    char errorMessage[MAX_MESSAGE_LEN / 2] = { 0 };
+    enum ExitCode exitCode = tryAssembleStream(stream, result, errorMessage, sizeof(errorMessage));
+    errorMessage[strcspn(errorMessage, "\n")] = 0;
+    fclose(stream);
 
-    if (returnCode != expectedErrorCode) {
-        ++testResults.failed;
-        if (returnCode != 0) {
-            printf(FAIL " %s - code %d was expected, but code %d was produced.\n", testName, expectedErrorCode, returnCode);
-        } else {
-            printf(FAIL " %s - code %d was expected, but success code was produced.\n", testName, expectedErrorCode);
+    bool identical = exitCode == expectedExitCode;
+
+    if (identical && exitCode == ExitCodeSuccess) {
+        identical = memcmp(result->programMemory, expected->programMemory, sizeof(result->programMemory)) == 0
+            && memcmp(result->dataType, expected->dataType, sizeof(result->dataType)) == 0
+            && memcmp(result->lineNumberByAddress, expected->lineNumberByAddress, sizeof(result->lineNumberByAddress)) == 0
+            && result->labelsCount == expected->labelsCount;
+
+        for (int i = 0; i < result->labelsCount; ++i) {
+            identical = identical && result->labels[i].address == expected->labels[i].address && strcmp(result->labels[i].name, expected->labels[i].name) == 0;
         }
-        return;
     }
 
-    if (fileExists(actualBinPath) || fileExists(actualCsvPath)) {
-        ++testResults.failed;
-        printf(FAIL " %s - the expected code was produced, however output files were produced as well, when none were expected.\n", testName);
-        return;
+    if (exitCode == ExitCodeSuccess) {
+        for (int i = 0; i < result->labelsCount; ++i) {
+            free(result->labels[i].name);
+        }
+        for (int i = 0; i < result->expansionsCount; ++i) {
+            free(result->expansions[i].argument);
+        }
+    }
+
+    if (exitCode != expectedExitCode) {
+        sprintf(testCase->message, "code %d was expected when assembling a stream, but code %d was produced (%s).", expectedExitCode, exitCode, errorMessage);
+    } else if (!identical) {
+        sprintf(testCase->message, "assembling a stream produced a different result.");
+    }
+
+    free(result);
+    return identical;
+}
+
+/// Assembles the source after tokenizing it on multiple threads, expecting the same result or error message as tokenizing it sequentially.
+static bool parallelLexingIdentical(struct TestCase* testCase, struct Buffer source, enum ExitCode expectedExitCode, const char* expectedErrorMessage, struct AssemblerResult* expected) {
+    struct AssemblerResult* result = malloc(sizeof(struct AssemblerResult));
+    char errorMessage[MAX_MESSAGE_LEN / 2] = { 0 };
+    setParallelLexing(TEST_LEXER_THREADS, 0);
+    enum ExitCode exitCode = tryAssemble(source.data, result, errorMessage, sizeof(errorMessage));
+    setParallelLexing(0, 0);
+    errorMessage[strcspn(errorMessage, "\n")] = 0;
+
+    bool identical = exitCode == expectedExitCode && strcmp(errorMessage, expectedErrorMessage) == 0;
+
+    if (identical && exitCode == ExitCodeSuccess) {
+        identical = memcmp(result->programMemory, expected->programMemory, sizeof(result->programMemory)) == 0
+            && memcmp(result->dataType, expected->dataType, sizeof(result->dataType)) == 0
+            && memcmp(result->lineNumberByAddress, expected->lineNumberByAddress, sizeof(result->lineNumberByAddress)) == 0
+            && result->labelsCount == expected->labelsCount;
+
+        for (int i = 0; i < result->labelsCount; ++i) {
+            identical = identical && result->labels[i].address == expected->labels[i].address && strcmp(result->labels[i].name, expected->labels[i].name) == 0;
+        }
     }
 
-    ++testResults.passed;
-    printf(PASS " %s\n", testName);
+    if (exitCode != expectedExitCode || strcmp(errorMessage, expectedErrorMessage) != 0) {
+        sprintf(testCase->message, "tokenizing in parallel produced code %d (%s) instead of code %d.", exitCode, errorMessage, expectedExitCode);
+    } else if (!identical) {
+        sprintf(testCase->message, "tokenizing in parallel produced a different result.");
+    }
+
+    free(result);
+    return identical;
 }
 
-static void expectSuccess(char* testName) {
-    int returnCode = executeTestCase(testName);
+static struct Buffer generateSource(const struct GeneratedTestCase* generated) {
+    struct Buffer source;
+    FILE* sourceStream = open_memstream(&source.data, &source.size);
+    fputs(generated->header, sourceStream);
+    for (int i = 0; i < generated->repeatsCount; ++i) {
+        fputs(generated->repeatedLine, sourceStream);
+    }
+    fputs(generated->footer, sourceStream);
+    fclose(sourceStream);
+    return source;
+}
 
-    if (returnCode != 0) {
-        ++testResults.failed;
-        printf(FAIL " %s - success code was expected, but code %d was produced.\n", testName, returnCode);
+static void runTestCase(struct TestCase* testCase) {
+    if (testCase->passed || testCase->message[0] != 0) {
+        return; // Already evaluated during discovery
+    }
+
+    struct Buffer source = testCase->generated != NULL ? generateSource(testCase->generated) : readFile(testCase->sourcePath);
+
+    if (source.data == NULL) {
+        sprintf(testCase->message, "source file \"%s\" is missing.", testCase->sourcePath);
         return;
     }
 
-    if (!filesIdentical(testName, "bin", FileTypeBinary)) {
-        ++testResults.failed;
+    if (fileExists(testCase->rewritesPath) && !rewritesApplied(testCase, &source)) {
+        free(source.data);
         return;
     }
 
-    if (!filesIdentical(testName, "csv", FileTypeText)) {
-        ++testResults.failed;
+    setExpansionGoal(fileExists(testCase->optimizeSpeedPath) ? ExpansionGoalSpeed : ExpansionGoalSize);
+
+    if (fileExists(testCase->expectedLayoutPath) && !layoutApplied(testCase, &source)) {
+        free(source.data);
         return;
     }
 
-    ++testResults.passed;
-    printf(PASS " %s\n", testName);
-}
+    struct Buffer streamedSource = { malloc(source.size + 1), source.size };
+    memcpy(streamedSource.data, source.data, source.size + 1);
+    struct Buffer lexedSource = { malloc(source.size + 1), source.size };
+    memcpy(lexedSource.data, source.data, source.size + 1);
 
-static void expectSuccessAssembleExamples() {
-    int examplesReturnCode = executeExamplesTestCase();
-    if (examplesReturnCode == 0) {
-        ++testResults.passed;
-        printf(PASS " assemble-examples\n");
+    struct AssemblerResult* result = malloc(sizeof(struct AssemblerResult));
+    char errorMessage[MAX_MESSAGE_LEN / 2] = { 0 };
+    enum ExitCode exitCode = tryAssemble(source.data, result, errorMessage, sizeof(errorMessage));
+    struct Buffer errorOutput = { strdup(errorMessage), strlen(errorMessage) };
+    errorMessage[strcspn(errorMessage, "\n")] = 0;
+
+    if (testCase->expectedExitCode != ExitCodeSuccess) {
+        if (exitCode == testCase->expectedExitCode) {
+            testCase->passed = !fileExists(testCase->expectedErrorPath) || outputsIdentical(testCase, testCase->expectedErrorPath, errorOutput, OutputTypeErrorMessage);
+        } else if (exitCode != ExitCodeSuccess) {
+            sprintf(testCase->message, "code %d was expected, but code %d was produced (%s).", testCase->expectedExitCode, exitCode, errorMessage);
+        } else {
+            sprintf(testCase->message, "code %d was expected, but success code was produced.", testCase->expectedExitCode);
+        }
+    } else if (exitCode != ExitCodeSuccess) {
+        sprintf(testCase->message, "success code was expected, but code %d was produced (%s).", exitCode, errorMessage);
+    } else if (testCase->generated != NULL && result->expansionsCount != testCase->generated->expansionsCount) {
+        sprintf(testCase->message, "%d expansions were expected, but %d were produced.", testCase->generated->expansionsCount, result->expansionsCount);
     } else {
-        ++testResults.failed;
-        printf(FAIL " assemble-examples - success code was expected, but code %d was produced.\n", examplesReturnCode);
-    }
-}
-
-int main(int argc, const char * argv[]) {
-    expectSuccessAssembleExamples();
-    expectErrorCode("empty-program-should-fail", ExitCodeResultProgramEmpty);
-    expectSuccess("label-name-should-allow-valid-length-and-characters");
-    expectErrorCode("label-name-should-disallow-invalid-length", ExitCodeLabelNameTooLong);
-    expectErrorCode("label-name-should-disallow-invalid-character", ExitCodeInvalidLabelName);
-    expectSuccess("declaration-should-allow-near-memory-range");
-    expectErrorCode("declaration-should-disallow-beyond-memory-range", ExitCodeDeclaringValueOutOfMemoryRange);
-    expectSuccess("instruction-should-allow-near-memory-range");
-    expectErrorCode("instruction-should-disallow-beyond-memory-range", ExitCodeDeclaringValueOutOfMemoryRange);
-    expectErrorCode("memory-overwrite-should-fail", ExitCodeMemoryValueOverridden);
-    expectErrorCode("number-literals-hex-should-disallow-no-digits", ExitCodeInvalidNumberLiteral);
-    expectSuccess("number-literals-should-allow-in-range");
-    expectErrorCode("number-literals-should-disallow-too-high", ExitCodeNumberLiteralOutOutRange);
-    expectErrorCode("number-literals-should-disallow-too-low", ExitCodeNumberLiteralOutOutRange);
-    expectErrorCode("origin-should-disallow-address-beyond-memory-range", ExitCodeOriginOutOfMemoryRange);
-    expectErrorCode("origin-should-disallow-negative-address", ExitCodeOriginOutOfMemoryRange);
-    expectErrorCode("reference-should-disallow-address-beyond-memory-range", ExitCodeReferenceToInvalidAddress);
-    expectErrorCode("reference-should-disallow-negative-address", ExitCodeReferenceToInvalidAddress);
-    expectErrorCode("string-should-disallow-unterminated", ExitCodeUnterminatedString);
-    expectErrorCode("fill-should-disallow-multiple-characters", ExitCodeInvalidDirectiveArgument);
-    expectErrorCode("fill-should-disallow-non-positive-count", ExitCodeInvalidDirectiveArgument);
-    expectSuccess("label-before-align-should-point-to-valid-address");
-    expectSuccess("label-before-fill-should-point-to-valid-address");
-    expectSuccess("label-before-org-should-point-to-valid-address");
-    expectErrorCode("align-should-disallow-param-too-low", ExitCodeInvalidDirectiveArgument);
-    expectErrorCode("align-should-disallow-param-too-high", ExitCodeInvalidDirectiveArgument);
-    expectErrorCode("align-should-disallow-beyond-memory-range", ExitCodeOriginOutOfMemoryRange);
-    expectSuccess("align-should-allow-param-lowest");
-    expectSuccess("align-should-allow-param-highest");
-    expectSuccess("empty-string-should-produce-char-0");
-    expectSuccess("label-at-higher-byte-of-instruction-should-be-int");
-    expectSuccess("align-should-not-change-address-if-already-aligned");
-    expectErrorCode("labels-should-disallow-duplicates", ExitCodeLabelNameNotUnique);
-    expectSuccess("character-expressions-should-allow-modifiers-within-range");
-    expectErrorCode("character-expressions-should-disallow-modifiers-too-low", ExitCodeCharacterLiteralOutOutRange);
-    expectErrorCode("character-expressions-should-disallow-modifiers-too-high", ExitCodeCharacterLiteralOutOutRange);
-    expectSuccess("lsb-msb-should-allow-offset-within-range");
-    expectErrorCode("lsb-msb-should-disallow-offset-too-low", ExitCodeReferenceToInvalidAddress);
-    expectErrorCode("lsb-msb-should-disallow-offset-too-high", ExitCodeReferenceToInvalidAddress);
-    expectSuccess("immediate-expr-same-value-should-point-to-same-addr");
-    expectSuccess("immediate-expr-should-allow-within-byte-limit");
-    expectSuccess("immediate-expr-should-allow-near-data-range");
-    expectErrorCode("immediate-expr-should-disallow-beyond-data-range", ExitCodeImmediateValueDeclarationOutOfMemoryRange);
-    expectErrorCode("immediate-expr-should-disallow-st", ExitCodeInvalidInstructionArgument);
-    expectErrorCode("immediate-expr-should-disallow-too-high", ExitCodeCharacterLiteralOutOutRange);
-    expectErrorCode("immediate-expr-should-disallow-too-low", ExitCodeCharacterLiteralOutOutRange);
-    expectSuccess("immediates-should-declare-explicitly");
-
-    printf("Tests passed: %d\nTests failed: %d\n", testResults.passed, testResults.failed);
-}
\ No newline at end of file
+        testCase->passed = testCase->generated != NULL || expectedOutputsProduced(testCase, result);
+    }
+
+    testCase->passed = testCase->passed && streamedAssemblyIdentical(testCase, streamedSource, testCase->expectedExitCode, result);
+    testCase->passed = testCase->passed && parallelLexingIdentical(testCase, lexedSource, exitCode, errorMessage, result);
+
+    free(result);
+    free(errorOutput.data);
+    free(streamedSource.data);
+    free(lexedSource.data);
+    free(source.data);
+}
+
+static void* runTestCases([[maybe_unused]] void* argument) {
+    int index;
+    while ((index = atomic_fetch_add(&nextTestCaseIndex, 1)) < testCasesCount) {
+        runTestCase(&testCases[index]);
+    }
+    return NULL;
+}
+
+static struct TestCase* addTestCase(const char* name) {
+    if (testCasesCount == MAX_TEST_CASES) {
+        printf("Error: too many test cases.\n");
+        exit(EXIT_FAILURE);
+    }
+    struct TestCase* testCase = &testCases[testCasesCount++];
+    memset(testCase, 0, sizeof(struct TestCase));
+    snprintf(testCase->name, MAX_PATH_LEN, "%s", name);
+    return testCase;
+}
+
+static const struct ExpectedErrorCode* findExpectedErrorCode(const char* testName) {
+    for (size_t i = 0; i < sizeof(expectedErrorCodes) / sizeof(expectedErrorCodes[0]); ++i) {
+        if (strcmp(expectedErrorCodes[i].testName, testName) == 0) {
+            return &expectedErrorCodes[i];
+        }
+    }
+    return NULL;
+}
+
+static enum ExitCode findExpectedRunExitCode(const char* testName) {
+    for (size_t i = 0; i < sizeof(expectedRunErrorCodes) / sizeof(expectedRunErrorCodes[0]); ++i) {
+        if (strcmp(expectedRunErrorCodes[i].testName, testName) == 0) {
+            return expectedRunErrorCodes[i].exitCode;
+        }
+    }
+    return ExitCodeSuccess;
+}
+
+static void discoverTestCases() {
+    DIR* directory = opendir(TEST_CASES_DIRECTORY);
+    if (directory == NULL) {
+        printf("Error: could not open directory \"%s\".\n", TEST_CASES_DIRECTORY);
+        exit(EXIT_FAILURE);
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(directory)) != NULL) {
+        char sourcePath[MAX_PATH_LEN];
+        snprintf(sourcePath, MAX_PATH_LEN, "%s/%s/test.asm", TEST_CASES_DIRECTORY, entry->d_name);
+        if (entry->d_name[0] == '.' || !fileExists(sourcePath)) {
+            continue;
+        }
+
+        struct TestCase* testCase = addTestCase(entry->d_name);
+        strcpy(testCase->sourcePath, sourcePath);
+        snprintf(testCase->expectedBinaryPath, MAX_PATH_LEN, "%s/%s/expected.bin", TEST_CASES_DIRECTORY, entry->d_name);
+        snprintf(testCase->expectedSymbolsPath, MAX_PATH_LEN, "%s/%s/expected.csv", TEST_CASES_DIRECTORY, entry->d_name);
+        snprintf(testCase->expectedIntelHexPath, MAX_PATH_LEN, "%s/%s/expected.hex", TEST_CASES_DIRECTORY, entry->d_name);
+        snprintf(testCase->expectedSymbolIndexPath, MAX_PATH_LEN, "%s/%s/expected.idx", TEST_CASES_DIRECTORY, entry->d_name);
+        snprintf(testCase->inputPath, MAX_PATH_LEN, "%s/%s/input.txt", TEST_CASES_DIRECTORY, entry->d_name);
+        snprintf(testCase->expectedOutputPath, MAX_PATH_LEN, "%s/%s/expected.out", TEST_CASES_DIRECTORY, entry->d_name);
+        snprintf(testCase->expectedTracePath, MAX_PATH_LEN, "%s/%s/expected-trace.csv", TEST_CASES_DIRECTORY, entry->d_name);
+        snprintf(testCase->expectedCoveragePath, MAX_PATH_LEN, "%s/%s/expected-coverage.txt", TEST_CASES_DIRECTORY, entry->d_name);
+        snprintf(testCase->expectedAnalysisPath, MAX_PATH_LEN, "%s/%s/expected-analysis.txt", TEST_CASES_DIRECTORY, entry->d_name);
+        snprintf(testCase->rewritesPath, MAX_PATH_LEN, "%s/%s/rewrites.txt", TEST_CASES_DIRECTORY, entry->d_name);
+        snprintf(testCase->expectedExpansionsPath, MAX_PATH_LEN, "%s/%s/expected-expansions.txt", TEST_CASES_DIRECTORY, entry->d_name);
+        snprintf(testCase->optimizeSpeedPath, MAX_PATH_LEN, "%s/%s/optimize-speed", TEST_CASES_DIRECTORY, entry->d_name);
+        snprintf(testCase->expectedCompressedBinaryPath, MAX_PATH_LEN, "%s/%s/expected-compressed.bin", TEST_CASES_DIRECTORY, entry->d_name);
+        snprintf(testCase->expectedListingPath, MAX_PATH_LEN, "%s/%s/expected-listing.txt", TEST_CASES_DIRECTORY, entry->d_name);
+        snprintf(testCase->virtualClockPath, MAX_PATH_LEN, "%s/%s/virtual-clock.txt", TEST_CASES_DIRECTORY, entry->d_name);
+        snprintf(testCase->expectedLayoutPath, MAX_PATH_LEN, "%s/%s/expected-layout.asm", TEST_CASES_DIRECTORY, entry->d_name);
+        snprintf(testCase->budgetPath, MAX_PATH_LEN, "%s/%s/budget.txt", TEST_CASES_DIRECTORY, entry->d_name);
+        snprintf(testCase->timeoutPath, MAX_PATH_LEN, "%s/%s/timeout.txt", TEST_CASES_DIRECTORY, entry->d_name);
+        snprintf(testCase->expectedErrorPath, MAX_PATH_LEN, "%s/%s/expected-error.txt", TEST_CASES_DIRECTORY, entry->d_name);
+        snprintf(testCase->expectedDisassemblyPath, MAX_PATH_LEN, "%s/%s/expected-disassembly.asm", TEST_CASES_DIRECTORY, entry->d_name);
+        snprintf(testCase->expectedSnapshotPath, MAX_PATH_LEN, "%s/%s/expected-snapshot.bin", TEST_CASES_DIRECTORY, entry->d_name);
+        snprintf(testCase->expectedCoverageFilePath, MAX_PATH_LEN, "%s/%s/expected-coverage.bin", TEST_CASES_DIRECTORY, entry->d_name);
+        testCase->expectedRunExitCode = findExpectedRunExitCode(entry->d_name);
+
+        const struct ExpectedErrorCode* expectedErrorCode = findExpectedErrorCode(entry->d_name);
+        if (expectedErrorCode != NULL) {
+            testCase->expectedExitCode = expectedErrorCode->exitCode;
+        } else if (!fileExists(testCase->expectedBinaryPath)) {
+            sprintf(testCase->message, "neither \"%s\" nor an expected error code is defined.", testCase->expectedBinaryPath);
+        }
+    }
+
+    closedir(directory);
+
+    for (size_t i = 0; i < sizeof(expectedErrorCodes) / sizeof(expectedErrorCodes[0]); ++i) {
+        char sourcePath[MAX_PATH_LEN];
+        snprintf(sourcePath, MAX_PATH_LEN, "%s/%s/test.asm", TEST_CASES_DIRECTORY, expectedErrorCodes[i].testName);
+        if (!fileExists(sourcePath)) {
+            struct TestCase* testCase = addTestCase(expectedErrorCodes[i].testName);
+            sprintf(testCase->message, "an expected error code is defined, but \"%s\" is missing.", sourcePath);
+        }
+    }
+}
+
+#ifdef EXAMPLES_DIRECTORY
+/// Every example is expected to assemble to its committed binary and symbols files.
+static void discoverExamples() {
+    DIR* directory = opendir(EXAMPLES_DIRECTORY);
+    if (directory == NULL) {
+        return;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(directory)) != NULL) {
+        size_t nameLength = strlen(entry->d_name);
+        if (nameLength < 5 || strcmp(entry->d_name + nameLength - 4, ".asm") != 0) {
+            continue;
+        }
+
+        char name[MAX_PATH_LEN - MAX_EXAMPLE_SUFFIX_LEN]; // So that none of the paths is truncated
+        snprintf(name, sizeof(name), "%s/%.*s", EXAMPLES_DIRECTORY, (int) nameLength - 4, entry->d_name);
+        struct TestCase* testCase = addTestCase(name);
+        snprintf(testCase->sourcePath, MAX_PATH_LEN, "%s.asm", name);
+        snprintf(testCase->expectedBinaryPath, MAX_PATH_LEN, "%s.bin", name);
+        snprintf(testCase->expectedSymbolsPath, MAX_PATH_LEN, "%s.csv", name);
+        snprintf(testCase->expectedIntelHexPath, MAX_PATH_LEN, "%s.hex", name);
+        snprintf(testCase->expectedSymbolIndexPath, MAX_PATH_LEN, "%s.idx", name);
+        snprintf(testCase->inputPath, MAX_PATH_LEN, "%s.in", name);
+        snprintf(testCase->expectedOutputPath, MAX_PATH_LEN, "%s.out", name);
+        snprintf(testCase->expectedTracePath, MAX_PATH_LEN, "%s-trace.csv", name);
+        snprintf(testCase->expectedCoveragePath, MAX_PATH_LEN, "%s-coverage.txt", name);
+        snprintf(testCase->expectedAnalysisPath, MAX_PATH_LEN, "%s-analysis.txt", name);
+        snprintf(testCase->rewritesPath, MAX_PATH_LEN, "%s-rewrites.txt", name);
+        snprintf(testCase->expectedExpansionsPath, MAX_PATH_LEN, "%s-expansions.txt", name);
+        snprintf(testCase->optimizeSpeedPath, MAX_PATH_LEN, "%s-optimize-speed", name);
+        snprintf(testCase->expectedCompressedBinaryPath, MAX_PATH_LEN, "%s-compressed.bin", name);
+        snprintf(testCase->expectedListingPath, MAX_PATH_LEN, "%s-listing.txt", name);
+        snprintf(testCase->virtualClockPath, MAX_PATH_LEN, "%s-virtual-clock.txt", name);
+        snprintf(testCase->expectedLayoutPath, MAX_PATH_LEN, "%s-layout.asm", name);
+        snprintf(testCase->budgetPath, MAX_PATH_LEN, "%s-budget.txt", name);
+        snprintf(testCase->timeoutPath, MAX_PATH_LEN, "%s-timeout.txt", name);
+    }
+
+    closedir(directory);
+}
+#endif
+
+static int compareTestCaseNames(const void* a, const void* b) {
+    return strcmp(((const struct TestCase*) a)->name, ((const struct TestCase*) b)->name);
+}
+
+int main(void) {
+#ifdef EXAMPLES_DIRECTORY
+    discoverExamples();
+#endif
+    discoverTestCases();
+    for (size_t i = 0; i < sizeof(generatedTestCases) / sizeof(generatedTestCases[0]); ++i) {
+        struct TestCase* testCase = addTestCase(generatedTestCases[i].testName);
+        testCase->generated = &generatedTestCases[i];
+        testCase->expectedExitCode = generatedTestCases[i].exitCode;
+    }
+    qsort(testCases, testCasesCount, sizeof(struct TestCase), compareTestCaseNames);
+
+    long threadsCount = sysconf(_SC_NPROCESSORS_ONLN);
+    if (threadsCount < 1) {
+        threadsCount = 1;
+    } else if (threadsCount > testCasesCount) {
+        threadsCount = testCasesCount;
+    }
+
+    // The thread-local state of the modules grows with the address space, and is allocated along with the stack
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setstacksize(&attributes, TEST_THREAD_STACK_SIZE);
+
+    pthread_t* threads = malloc(threadsCount * sizeof(pthread_t));
+    for (int i = 0; i < threadsCount; ++i) {
+        pthread_create(&threads[i], &attributes, runTestCases, NULL);
+    }
+    pthread_attr_destroy(&attributes);
+    for (int i = 0; i < threadsCount; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    int passed = 0;
+    int failed = 0;
+
+    for (int i = 0; i < testCasesCount; ++i) {
+        if (testCases[i].passed) {
+            ++passed;
+            printf(PASS " %s\n", testCases[i].name);
+        } else {
+            ++failed;
+            printf(FAIL " %s - %s\n", testCases[i].name, testCases[i].message);
+        }
+    }
+
+    printf("Tests passed: %d\nTests failed: %d\n", passed, failed);
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,24 @@
+; Echoes input characters until the end of input, replacing spaces with underscores, from code above the 13-bit address space
+
+jmp loop
+
+.org 0x2000
+loop: ld IO
+jmz end
+add #-' '
+jmz underscore
+add #' '
+st IO
+jmp loop
+
+underscore: ld #'_'
+st IO
+jmp loop
+
+; Never executed
+unused: ld #0
+jmn unused
+
+end: jmp end
+
+IO: .org 0xFFFF
@@ -0,0 +1,20 @@
+; Disassembled by w16asm
+
+start: ld number
+add 0x2105
+st result
+jmp far
+number: 18
+letter: 'z'
+
+.org 0x2000
+far: ld greeting
+jmn start
+jmz end
+st 0xFFFF
+end: jmp end
+
+.org 0x2100
+greeting: "W16"
+result: 0
+'A'
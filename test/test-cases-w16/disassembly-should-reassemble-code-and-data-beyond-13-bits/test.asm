@@ -0,0 +1,20 @@
+; Mixes instructions, characters, integers and strings on both sides of the 13-bit address space
+
+start: ld number
+add #'A'
+st result
+jmp far
+
+number: 0x12
+letter: 'z'
+
+.org 0x2000
+far: ld greeting
+jmn start
+jmz end
+st 0xFFFF
+end: jmp end
+
+.org 0x2100
+greeting: "W16"
+result: 0
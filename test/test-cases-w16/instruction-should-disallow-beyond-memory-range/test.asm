@@ -0,0 +1 @@
+start: .org 0xfffe jmp start
\ No newline at end of file
@@ -0,0 +1,24 @@
+; Prints "W16!" from code and data above the 13-bit address space, through a subroutine.
+
+jmp start
+
+.ORG 0x4000
+printChar: st IO
+RET
+
+.ORG 0x8000
+start: ld text
+jmz end
+CALL printChar
+ld start
+add #1
+st start
+jmp start
+end: ld #'!'
+CALL printChar
+halt: jmp halt
+
+.ORG 0xC000
+text: "W16"
+
+IO: .ORG 0xFFFF
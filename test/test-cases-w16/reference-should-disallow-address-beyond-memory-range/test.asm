@@ -0,0 +1 @@
+jmp 0x10000
\ No newline at end of file
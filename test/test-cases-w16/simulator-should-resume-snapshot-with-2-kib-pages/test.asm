@@ -0,0 +1,40 @@
+; Reads a line from the terminal into a buffer at the start of the second 2 KiB page, then prints it back after a prefix from the third page
+
+read: ld IO
+jmz read
+store: st buffer    ; The low byte of the address is incremented after each character
+add #-'\n'
+jmz prefix
+ld store
+add #1
+st store
+jmp read
+
+prefix: ld text     ; The low byte of the address is incremented after each character
+jmz print
+st IO
+ld prefix
+add #1
+st prefix
+jmp prefix
+
+print: ld buffer    ; The low byte of the address is incremented after each character
+st IO
+add #-'\n'
+jmz end
+ld print
+add #1
+st print
+jmp print
+
+end: jmp end
+
+.immediates
+
+.org 0x0800
+buffer: 0
+
+.org 0x1000
+text: "echo: "
+
+IO: .org 0xFFFF
@@ -0,0 +1,20 @@
+; Prints "ok" followed by a newline, looping over the characters with code and data above the 13-bit address space
+
+jmp loop
+
+.org 0x2000
+loop: ld text
+jmz end
+st IO
+ld loop
+add #1
+st loop
+jmn end     ; Never taken
+jmp loop
+
+end: jmp end
+
+.org 0x2100
+text: "ok\n"
+
+IO: .org 0xFFFF
@@ -0,0 +1,28 @@
+; Prints 3 rows of 2 asterisks
+row: ld #2
+st column
+column_loop: ld #'*'
+st IO
+ld column
+add #-1
+st column
+jmz row_end
+jmp column_loop ; @bound 1
+row_end: ld #'\n'
+st IO
+ld rows
+add #-1
+st rows
+jmz end
+jmp row ;@bound 2
+
+; Never executed
+wait: ld IO
+jmz wait
+broken: jmp rows
+
+end: jmp end
+
+column: 0
+rows: 3
+IO: .org 0x1fff
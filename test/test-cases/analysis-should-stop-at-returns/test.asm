@@ -0,0 +1,5 @@
+call f
+call f
+end: jmp end
+f: ld #1
+ret
@@ -0,0 +1,6 @@
+a: CALL b
+RET
+b: ld #1
+CALL a
+RET
+CALL a
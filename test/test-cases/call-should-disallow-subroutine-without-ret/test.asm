@@ -0,0 +1,2 @@
+CALL f
+f: ld #1
@@ -0,0 +1,30 @@
+; Prints "Hi-+Hi" by calling subroutines, some of which call other subroutines or return early.
+
+jmp start
+
+printChar: st IO
+RET
+
+greet: ld #'H'
+CALL printChar
+ld #'i'
+CALL printChar
+RET
+
+printSign: jmn negative ; Prints '-' if A is negative, '+' otherwise
+ld #'+'
+st IO
+RET
+negative: ld #'-'
+st IO
+ret ; Jumps to the first RET of printSign
+
+start: CALL greet
+ld #-5
+CALL printSign
+ld #5
+call printSign
+CALL greet
+end: jmp end
+
+IO: .org 0x1fff
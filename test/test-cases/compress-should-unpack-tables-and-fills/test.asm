@@ -0,0 +1,17 @@
+; Prints a string converted to uppercase with a lookup table, which follows a long run of zeros
+
+loop:   ld text         ; Load a character
+        jmz end
+        st lookup       ; Use it as the least significant byte of the table address
+lookup: ld upper
+        st IO
+        ld loop         ; Increment the character pointer
+        add #1
+        st loop
+        jmp loop
+end:    jmp end
+
+text:   "compressed\n"
+        .FILL 0 0x400
+upper:  .TABLE TOUPPER
+IO:     .ORG 0x1fff
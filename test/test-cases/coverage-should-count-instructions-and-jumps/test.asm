@@ -0,0 +1,20 @@
+; Echoes input characters until the end of input, replacing spaces with underscores
+loop: ld IO
+jmz end
+add #-' '
+jmz underscore
+add #' '
+st IO
+jmp loop
+
+underscore: ld #'_'
+st IO
+jmp loop
+
+; Never executed
+unused: ld #0
+jmn unused
+
+end: jmp end
+
+IO: .org 0x1fff
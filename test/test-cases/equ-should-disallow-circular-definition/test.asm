@@ -0,0 +1,3 @@
+.equ A B+1
+.equ B A-1
+ld A
@@ -0,0 +1,2 @@
+foo: 0
+.equ foo 1
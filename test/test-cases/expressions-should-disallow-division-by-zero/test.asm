@@ -0,0 +1,2 @@
+.equ ZERO (1 - 1)
+(10 / ZERO)
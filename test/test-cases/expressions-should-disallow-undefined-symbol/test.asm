@@ -0,0 +1 @@
+ld (foo + 1)
@@ -0,0 +1,3 @@
+ld (table + 1
+st 0x1FFF
+table: 0
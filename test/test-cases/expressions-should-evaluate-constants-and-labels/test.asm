@@ -0,0 +1,15 @@
+.equ SIZE COUNT*2
+.equ COUNT ((1 << 2) + 1)
+.equ MASK ~0x0F&0xFF
+ld #SIZE
+and #(MASK ^ 0x30)
+add #-'a'+SIZE
+ld #LSB(table)
+jmp (table + (SIZE - 1) * 2)
+.lsb table+SIZE
+.msb table+SIZE
+((COUNT * 3 - 1) / 2)
+((7 % 4) | 0x40)
+-(SIZE >> 1)
+(MSB(table) + 'A')
+table: .org 0x123 .fill COUNT SIZE
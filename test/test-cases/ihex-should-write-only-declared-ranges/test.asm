@@ -0,0 +1,12 @@
+start: ld value
+add one
+st value
+jmp start
+value: 0
+one: 1
+
+.org 0x1000
+message: "Hello, world! Hello, again!\n"
+
+.org 0x1FFF
+io: 0
@@ -0,0 +1,6 @@
+ld #LSB(table)
+.immediates
+ld #1
+jmp end
+table: 5
+end: jmp end
@@ -0,0 +1,35 @@
+; Prints "2", then echoes the input with spaces replaced by underscores. The jump at "select" is changed to
+; jump to "two" when running, so its block stays in place with its jump, and so does "two", whose address is
+; data. The loop is still laid out so that the jump over the code replacing spaces falls through.
+ld twoAddress
+st select
+select: jmp one
+
+one: ld #'1'
+st IO
+jmp loop
+
+two: ld #'2'
+st IO
+
+loop: ld IO
+jmz halt
+st character
+add #-' '
+jmz space
+
+echo: ld character
+st IO
+jmp loop
+
+; Executed once per space
+space: ld #'_'
+st character
+jmp echo
+
+halt: jmp halt
+
+character: 0
+twoAddress: .LSB two
+
+IO: .org 0x1fff
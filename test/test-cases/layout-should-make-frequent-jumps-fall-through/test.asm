@@ -0,0 +1,28 @@
+; Echoes the input with spaces replaced by underscores, then prints the number of spaces. Spaces are rare, so the
+; jump over the code replacing them is taken most of the time, and the layout moves that code out of the loop.
+loop: ld IO
+jmz end
+st character
+add #-' '
+jmz space
+jmp echo
+
+; Executed once per space
+space: ld count
+add #1
+st count
+ld #'_'
+st character
+
+echo: ld character
+st IO
+jmp loop
+
+end: ld count
+st IO
+halt: jmp halt
+
+count: '0'
+character: 0
+
+IO: .org 0x1fff
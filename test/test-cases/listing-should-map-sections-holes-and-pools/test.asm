@@ -0,0 +1,13 @@
+; Two sections with an immediate pool in each, separated by holes
+start: ld #1
+add #2
+st buffer
+jmz end
+.IMMEDIATES
+
+.ORG 0x40
+buffer: .FILL 0 24
+message: "Listed"
+end: ld #'A'
+st 0x1FFF
+halt: jmp halt
@@ -0,0 +1,2 @@
+ld text
+text: .POOL 5
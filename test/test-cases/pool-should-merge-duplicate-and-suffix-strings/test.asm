@@ -0,0 +1,39 @@
+; Prints pooled strings, which are declared after the last declaration. Strings which are
+; duplicates or suffixes of another pooled string are stored in its tail.
+
+greeting: .POOL "Hi!\n" ; Declares no bytes here
+
+printGreeting: ld greeting
+jmz printError
+st IO
+ld printGreeting
+add #1
+st printGreeting
+jmp printGreeting
+
+printError: ld error
+jmz printSuffix
+st IO
+ld printError
+add #1
+st printError
+jmp printError
+
+printSuffix: ld suffix
+jmz end
+st IO
+ld printSuffix
+add #1
+st printSuffix
+jmp printSuffix
+
+end: jmp end
+
+error: .POOL "error\n"
+suffix: ror: .pool "ror\n"
+newline: .POOL "\n"
+duplicate: .POOL "error\n"
+ok: .POOL "ok\n"
+"unpooled\n"
+
+IO: .org 0x1fff
@@ -0,0 +1,46 @@
+; Prints letters computed by pseudo-instructions, then echoes characters until Return is pressed.
+
+ld #'a'
+sub #' '
+st IO ; 'A'
+ld #'b'
+sub space
+st IO ; 'B'
+ld #'c'
+xor #0x20
+st IO ; 'C'
+ld #'d'
+xor space
+st IO ; 'D'
+ld #'E'
+or #0x20
+st IO ; 'e'
+ld #'F'
+or space
+st IO ; 'f'
+ld #0x10
+shl 2
+st IO ; '@'
+ld #0x24
+shl 1
+st IO ; 'H'
+ld #0x89
+SHL (1 + 2)
+st IO ; 'H', shifted out bits are lost
+
+loop: ld IO
+jmz loop
+st char
+cmp newline
+jmz end
+ld char
+st IO
+jmp loop
+
+end: jmp end
+
+space: ' '
+newline: '\n'
+char: 0
+
+IO: .org 0x1fff
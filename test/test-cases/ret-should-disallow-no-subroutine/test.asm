@@ -0,0 +1,5 @@
+ld #1
+RET
+
+
+x: 0
@@ -0,0 +1,13 @@
+; The first ADD is made to add 0 when running, so the two aren't replaced by one
+ld zeroAddress
+st change
+ld #'A'
+change: add #1
+add #1
+st IO
+halt: jmp halt
+
+zero: 0
+zeroAddress: .LSB zero
+
+IO: .org 0x1fff
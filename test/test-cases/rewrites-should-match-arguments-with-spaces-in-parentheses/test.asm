@@ -0,0 +1,9 @@
+; The arguments are single tokens although they contain spaces in parentheses, so the sequence is replaced
+
+ld (count + 0)
+add #( 1 )
+add #1
+st ( count )
+halt: jmp halt
+
+count: 5
@@ -0,0 +1,46 @@
+; Echoes characters with lowercase letters capitalized until Return is pressed, then prints '0' plus twice the number of characters.
+
+loop:
+ld IO
+st character
+jmz loop
+add #-'\n'
+jmz end
+
+; Two immediate values in a row are replaced by their sum, keeping the comments and the line numbers
+add #'\n'-'a'
+jmn echo
+add #'a' ; undo
+
+add #-'z'-1
+jmn capitalize
+
+echo:
+ld count ; The label of the first line is kept
+add #1
+add #1
+st count
+ld character
+st IO
+jmp loop
+
+capitalize:
+ld character
+add #-32
+st character
+jmp echo
+
+; Only the last two instructions are replaced, because the second one is a jump target
+twice: ld count
+again: add #1
+add #1
+jmp again
+
+end: ld count
+st IO
+halt: jmp halt
+
+count: '0'
+character: ' '
+
+IO: .org 0x1fff
@@ -0,0 +1,8 @@
+; Counts down from 3 and halts after 10 instructions
+    ld #3
+loop:
+    add #0xFF ; Decrements A
+    jmz halt
+    jmp loop
+halt:
+    jmp halt
@@ -0,0 +1,5 @@
+; Never halts, since the jumps alternate between two addresses
+loop:
+    jmp next
+next:
+    jmp loop
@@ -0,0 +1,2 @@
+ld #1
+shl 8
@@ -0,0 +1,29 @@
+; Reads a line from the terminal into a buffer on another memory page, then prints it back
+
+read: ld IO
+jmz read
+store: st buffer    ; The address is incremented after each character
+add #-'\n'
+jmz print
+ld store
+add #1
+st store
+jmp read
+
+print: ld buffer    ; The address is incremented after each character
+st IO
+add #-'\n'
+jmz end
+ld print
+add #1
+st print
+jmp print
+
+end: jmp end
+
+.immediates
+
+.org 0x1000
+buffer: 0
+
+IO: .org 0x1fff
@@ -0,0 +1,335 @@
+; Longer than the stream buffer, so that forward references are patched after the buffer is refilled.
+jmp start ; forward reference, patched at the end of the source
+; Block 0: comment lines separate the uses of labels from their definitions, and are read in chunks.
+; 00.00 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 00.01 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 00.02 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 00.03 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 00.04 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 00.05 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 00.06 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 00.07 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 00.08 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 00.09 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 00.10 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 00.11 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 00.12 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 00.13 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 00.14 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 00.15 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 00.16 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 00.17 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 00.18 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 00.19 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+block0: ld value0
+add #0
+st value0
+jmz block1 ; forward reference to the next block
+jmn start ; chained with the other uses of start
+value0: 0
+; Block 1: comment lines separate the uses of labels from their definitions, and are read in chunks.
+; 01.00 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 01.01 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 01.02 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 01.03 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 01.04 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 01.05 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 01.06 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 01.07 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 01.08 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 01.09 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 01.10 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 01.11 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 01.12 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 01.13 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 01.14 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 01.15 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 01.16 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 01.17 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 01.18 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 01.19 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+block1: ld value1
+add #1
+st value1
+jmz block2 ; forward reference to the next block
+jmn start ; chained with the other uses of start
+value1: 3
+; Block 2: comment lines separate the uses of labels from their definitions, and are read in chunks.
+; 02.00 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 02.01 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 02.02 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 02.03 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 02.04 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 02.05 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 02.06 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 02.07 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 02.08 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 02.09 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 02.10 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 02.11 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 02.12 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 02.13 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 02.14 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 02.15 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 02.16 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 02.17 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 02.18 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 02.19 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+block2: ld value2
+add #2
+st value2
+jmz block3 ; forward reference to the next block
+jmn start ; chained with the other uses of start
+value2: 6
+; Block 3: comment lines separate the uses of labels from their definitions, and are read in chunks.
+; 03.00 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 03.01 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 03.02 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 03.03 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 03.04 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 03.05 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 03.06 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 03.07 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 03.08 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 03.09 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 03.10 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 03.11 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 03.12 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 03.13 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 03.14 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 03.15 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 03.16 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 03.17 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 03.18 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 03.19 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+block3: ld value3
+add #3
+st value3
+jmz block4 ; forward reference to the next block
+jmn start ; chained with the other uses of start
+value3: 9
+; Block 4: comment lines separate the uses of labels from their definitions, and are read in chunks.
+; 04.00 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 04.01 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 04.02 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 04.03 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 04.04 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 04.05 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 04.06 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 04.07 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 04.08 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 04.09 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 04.10 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 04.11 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 04.12 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 04.13 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 04.14 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 04.15 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 04.16 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 04.17 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 04.18 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 04.19 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+block4: ld value4
+add #4
+st value4
+jmz block5 ; forward reference to the next block
+jmn start ; chained with the other uses of start
+value4: 12
+; Block 5: comment lines separate the uses of labels from their definitions, and are read in chunks.
+; 05.00 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 05.01 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 05.02 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 05.03 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 05.04 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 05.05 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 05.06 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 05.07 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 05.08 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 05.09 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 05.10 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 05.11 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 05.12 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 05.13 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 05.14 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 05.15 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 05.16 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 05.17 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 05.18 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 05.19 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+block5: ld value5
+add #5
+st value5
+jmz block6 ; forward reference to the next block
+jmn start ; chained with the other uses of start
+value5: 15
+; Block 6: comment lines separate the uses of labels from their definitions, and are read in chunks.
+; 06.00 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 06.01 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 06.02 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 06.03 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 06.04 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 06.05 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 06.06 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 06.07 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 06.08 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 06.09 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 06.10 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 06.11 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 06.12 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 06.13 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 06.14 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 06.15 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 06.16 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 06.17 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 06.18 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 06.19 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+block6: ld value6
+add #6
+st value6
+jmz block7 ; forward reference to the next block
+jmn start ; chained with the other uses of start
+value6: 18
+; Block 7: comment lines separate the uses of labels from their definitions, and are read in chunks.
+; 07.00 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 07.01 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 07.02 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 07.03 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 07.04 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 07.05 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 07.06 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 07.07 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 07.08 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 07.09 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 07.10 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 07.11 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 07.12 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 07.13 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 07.14 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 07.15 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 07.16 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 07.17 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 07.18 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 07.19 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+block7: ld value7
+add #7
+st value7
+jmz block8 ; forward reference to the next block
+jmn start ; chained with the other uses of start
+value7: 21
+; Block 8: comment lines separate the uses of labels from their definitions, and are read in chunks.
+; 08.00 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 08.01 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 08.02 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 08.03 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 08.04 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 08.05 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 08.06 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 08.07 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 08.08 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 08.09 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 08.10 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 08.11 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 08.12 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 08.13 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 08.14 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 08.15 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 08.16 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 08.17 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 08.18 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 08.19 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+block8: ld value8
+add #8
+st value8
+jmz block9 ; forward reference to the next block
+jmn start ; chained with the other uses of start
+value8: 24
+; Block 9: comment lines separate the uses of labels from their definitions, and are read in chunks.
+; 09.00 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 09.01 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 09.02 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 09.03 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 09.04 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 09.05 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 09.06 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 09.07 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 09.08 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 09.09 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 09.10 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 09.11 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 09.12 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 09.13 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 09.14 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 09.15 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 09.16 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 09.17 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 09.18 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 09.19 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+block9: ld value9
+add #9
+st value9
+jmz block10 ; forward reference to the next block
+jmn start ; chained with the other uses of start
+value9: 27
+; Block 10: comment lines separate the uses of labels from their definitions, and are read in chunks.
+; 10.00 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 10.01 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 10.02 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 10.03 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 10.04 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 10.05 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 10.06 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 10.07 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 10.08 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 10.09 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 10.10 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 10.11 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 10.12 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 10.13 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 10.14 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 10.15 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 10.16 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 10.17 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 10.18 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 10.19 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+block10: ld value10
+add #10
+st value10
+jmz block11 ; forward reference to the next block
+jmn start ; chained with the other uses of start
+value10: 30
+; Block 11: comment lines separate the uses of labels from their definitions, and are read in chunks.
+; 11.00 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 11.01 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 11.02 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 11.03 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 11.04 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 11.05 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 11.06 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 11.07 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 11.08 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 11.09 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 11.10 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 11.11 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 11.12 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 11.13 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 11.14 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 11.15 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 11.16 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 11.17 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 11.18 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+; 11.19 The quick brown fox jumps over the lazy dog; "not a string" 'x' .org 0x1234 label: jmp label
+block11: ld value11
+add #11
+st value11
+jmz start
+jmn start ; chained with the other uses of start
+value11: 33
+start: .org 0x400 ; the label address changes with .org, after the label is defined
+ld total
+add #LIMIT
+.lsb last
+.msb last
+jmp last
+last: jmp last
+total: 0
+.equ LIMIT 0x20
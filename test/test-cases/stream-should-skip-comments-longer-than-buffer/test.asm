@@ -0,0 +1,5 @@
+; A comment longer than the stream buffer is skipped as it's read, even after a statement.
+start: ld #'A' ; The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed
+; The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed The quick brown fox jumps over the lazy dog; "not a string" 'x' (unclosed
+st 0x1FFF ; Marks the end of the comments
+halt: jmp halt
@@ -0,0 +1,12 @@
+start: ld counter
+loop: add #1
+st counter
+jmp loop
+
+counter: 0
+step: 1
+
+.org 0x100
+first: alias: "ab"
+.org 0x1FF0
+last: 0
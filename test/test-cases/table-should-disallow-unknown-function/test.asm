@@ -0,0 +1,2 @@
+ld table
+table: .TABLE sqrt
@@ -0,0 +1,29 @@
+; Echoes characters capitalized until Return is pressed, looking them up in a table by patching the operand's LSB.
+
+loop: ld IO
+jmz loop
+st lookup ; The least significant byte of the instruction is its argument's LSB
+add #-'\n'
+jmz end
+lookup: ld upper
+st IO
+jmp loop
+
+end: jmp end
+
+upper: .TABLE toupper ; Aligned to 0x0100
+digits: .TABLE ISDIGIT
+.TABLE shl 3
+.TABLE SHR (1 + 1)
+.TABLE mul 3
+.TABLE popcount
+.TABLE reverse
+.TABLE isalpha
+.TABLE isalnum
+.TABLE isupper
+.TABLE islower
+.TABLE isspace
+.TABLE ispunct
+last: .TABLE tolower
+
+IO: .org 0x1fff
@@ -0,0 +1,16 @@
+; Prints "ok" followed by a newline, looping over the characters
+
+loop: ld text
+jmz end
+st IO
+ld loop
+add #1
+st loop
+jmn end     ; Never taken
+jmp loop
+
+end: jmp end
+
+text: "ok\n"
+
+IO: .org 0x1fff
@@ -0,0 +1,17 @@
+; Counts the iterations of a loop until 2 ms have passed, which takes 4 iterations at 0.1 ms per instruction
+
+.EQU TIMER 0x1FFB
+
+loop:   ld count
+        add #1
+        st count
+        ld TIMER        ; Latch the elapsed time
+        add #-2
+        jmn loop        ; Until 2 ms have passed
+        ld count
+        add #'0'
+        st IO
+end:    jmp end
+
+count:  0
+IO:     .ORG 0x1FFF